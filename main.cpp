@@ -1,8 +1,10 @@
 /*
  * nvidia-smi-gui  —  C/C++ Win32 API 1:1 port
- * Build: g++ -std=c++17 -O3 -s -flto -static -Wall -Wextra -Werror -municode -o nvidia-smi-gui.exe main.cpp -lgdi32 -lmsimg32 -ldwmapi -ladvapi32 -mwindows
+ * Build: g++ -std=c++17 -O3 -s -flto -static -Wall -Wextra -Werror -municode -o nvidia-smi-gui.exe main.cpp -lgdi32 -lmsimg32 -ldwmapi -ladvapi32 -lcomctl32 -lws2_32 -mwindows
+ * Headless build (Linux): g++ -std=c++17 -O3 -Wall -Wextra -Werror -pthread -o nvidia-smi-gui main.cpp -lrt
  */
 
+#ifdef _WIN32
 #ifndef UNICODE
 #define UNICODE
 #endif
@@ -10,16 +12,57 @@
 #define _UNICODE
 #endif
 
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include <windows.h>
+#include <commctrl.h>
 #include <dwmapi.h>
+#else
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#endif
 
 #include <string>
 #include <vector>
-#include <map>
-#include <sstream>
 #include <thread>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <cwchar>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <array>
+#include <charconv>
+#include <random>
+#include <new>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "nvsmi_shm.h"
+
+static volatile bool g_running = true;
 
+#ifdef _WIN32
 #include "icons_data.h"
 
 // ─── Theme ───────────────────────────────────────────────────────────────────
@@ -39,13 +82,12 @@ static const Theme THEME_DARK = {
 
 // ─── Custom messages ─────────────────────────────────────────────────────────
 #define WM_SMI_UPDATE  (WM_USER + 1)
+#define WM_GPU_PICK    (WM_USER + 2)    // wParam: slot of the panel clicked
 
 // ─── Globals ─────────────────────────────────────────────────────────────────
 static Theme g_theme;
 static bool  g_darkMode = false;
 static HINSTANCE g_hInst;
-static volatile bool g_running = true;
-static HANDLE g_hProcess = NULL;
 static float g_dpiScale = 1.0f;
 static int D(int px) { return (int)(px * g_dpiScale); }
 
@@ -122,12 +164,6 @@ static void cleanupIcons() {
 }
 
 // ─── Utility ────────────────────────────────────────────────────────────────
-static std::string trim(const std::string& s) {
-    auto b = s.find_first_not_of(" \t\r\n");
-    auto e = s.find_last_not_of(" \t\r\n");
-    return (b == std::string::npos) ? "" : s.substr(b, e - b + 1);
-}
-
 static std::wstring toW(const std::string& s) {
     if (s.empty()) return {};
     int n = MultiByteToWideChar(CP_UTF8, 0, s.c_str(), (int)s.size(), NULL, 0);
@@ -135,394 +171,6911 @@ static std::wstring toW(const std::string& s) {
     MultiByteToWideChar(CP_UTF8, 0, s.c_str(), (int)s.size(), &w[0], n);
     return w;
 }
+#endif // _WIN32
 
-using SmiData = std::map<std::string, std::string>;
+// ─── Sample model ───────────────────────────────────────────────────────────
+// Volatile metrics, queried every tick. N/A and [Not Supported] become NaN.
+enum Metric { M_UTIL, M_TEMP, M_FAN, M_CLOCK, M_MEM_USED, M_POWER, M_COUNT };
+static const char* const METRIC_FIELDS[M_COUNT] = {
+    "utilization.gpu", "temperature.gpu", "fan.speed",
+    "clocks.current.graphics", "memory.used", "power.draw"
+};
 
-// ─── GPUInfoPanel ───────────────────────────────────────────────────────────
-class GPUInfoPanel {
+// A METRIC_FIELDS name, or a prefix of one ("util", "temp", "power").
+static int metricByName(const std::string& name) {
+    for (int m = 0; m < M_COUNT; ++m)
+        if (name == METRIC_FIELDS[m]) return m;
+    for (int m = 0; m < M_COUNT; ++m)
+        if (name.size() >= 3 && strncmp(METRIC_FIELDS[m], name.c_str(), name.size()) == 0) return m;
+    return -1;
+}
+
+struct GpuSample {
+    int index = -1;
+    bool stale = false;      // carried over: the GPU reported nothing this tick
+    double v[M_COUNT];
+    GpuSample() { for (double& x : v) x = NAN; }
+};
+
+// Host grouping for fleet views: with `--simulate HxG` or `--gpus-per-host G`
+// GPU index i belongs to host i / G; otherwise every GPU is on one host.
+static int g_gpusPerHost = 0;
+static inline int hostOf(int index) { return g_gpusPerHost > 0 ? index / g_gpusPerHost : 0; }
+
+// Hosts the window shows, first and last, for --hosts to connect first; -1 if unknown.
+static std::atomic<int> g_visibleHostFirst{-1}, g_visibleHostLast{-1};
+// --hosts: hosts * G, the slots the fleet views lay out before the hosts connect.
+static int g_fleetSlots = 0;
+
+// Fixed-point hundredths, nvidia-smi's own precision, for the wire format and
+// the stores. NaN maps to Q_NAN.
+static const int64_t Q_NAN = INT64_MIN;
+static int64_t quantize(double v) { return std::isnan(v) ? Q_NAN : std::llround(v * 100.0); }
+static double dequantize(int64_t q) { return q == Q_NAN ? NAN : q / 100.0; }
+
+// Hundredths as the shortest decimal, exactly: 9750 -> "97.5", -5 -> "-0.05".
+// Writes at most 24 bytes and returns the end.
+static char* formatHundredths(char* p, int64_t q) {
+    uint64_t u = q < 0 ? 0 - (uint64_t)q : (uint64_t)q;
+    if (q < 0) *p++ = '-';
+    p = std::to_chars(p, p + 21, u / 100).ptr;
+    int frac = (int)(u % 100);
+    if (frac) { *p++ = '.'; *p++ = (char)('0' + frac / 10); if (frac % 10) *p++ = (char)('0' + frac % 10); }
+    return p;
+}
+
+// Fields that almost never change. Queried once at start and then on a slow
+// cadence; each GPU's record is interned and shared by every consumer.
+static const char* const IDENTITY_FIELDS = "index,count,uuid,pci.bus_id,name,memory.total,enforced.power.limit";
+
+struct GpuIdentity {
+    int index = -1, count = 0;      // nvidia-smi's current index and GPU count
+    int slot = -1;                  // DeviceRegistry slot, the key of samples and history
+    std::string uuid, pciBusId, name;
+    double memTotal = NAN, powerLimit = NAN;
+
+    bool operator==(const GpuIdentity& o) const {
+        auto same = [](double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); };
+        return index == o.index && slot == o.slot && count == o.count && uuid == o.uuid && pciBusId == o.pciBusId
+            && name == o.name && same(memTotal, o.memTotal) && same(powerLimit, o.powerLimit);
+    }
+};
+using GpuIdentityPtr = std::shared_ptr<const GpuIdentity>;
+
+class IdentityTable {
 public:
-    static int PANEL_HEIGHT() { return D(170); }
-    static constexpr const wchar_t* CLASS_NAME = L"GPUInfoPanelClass";
-    static bool s_registered;
+    // Replaces the records that differ; unchanged GPUs keep their shared record.
+    void update(const std::vector<GpuIdentity>& ids) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        for (const auto& id : ids) {
+            if (id.slot < 0) continue;
+            if (id.slot >= (int)m_bySlot.size()) m_bySlot.resize(id.slot + 1);
+            auto& rec = m_bySlot[id.slot];
+            if (!rec || !(*rec == id)) rec = std::make_shared<const GpuIdentity>(id);
+        }
+        m_lastRefresh = std::chrono::steady_clock::now();
+        m_refreshRequested = false;
+    }
 
-    static void registerClass() {
-        if (s_registered) return;
-        WNDCLASSW wc = {};
-        wc.lpfnWndProc   = panelProc;
-        wc.hInstance      = g_hInst;
-        wc.lpszClassName  = CLASS_NAME;
-        wc.hCursor        = LoadCursor(NULL, IDC_ARROW);
-        RegisterClassW(&wc);
-        s_registered = true;
+    GpuIdentityPtr get(int slot) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        return (slot >= 0 && slot < (int)m_bySlot.size()) ? m_bySlot[slot] : nullptr;
     }
 
-    GPUInfoPanel(HWND parent, int y, int w) {
-        registerClass();
-        m_hwnd = CreateWindowExW(0, CLASS_NAME, L"", WS_CHILD | WS_VISIBLE,
-                                 0, y, w, PANEL_HEIGHT(), parent, NULL, g_hInst, this);
+    // GPU count as reported by nvidia-smi's `count` field, 0 if not known yet.
+    int gpuCount() const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        for (const auto& id : m_bySlot) if (id) return id->count;
+        return 0;
+    }
 
-        m_fontTitle  = CreateFontW(-D(22), 0, 0, 0, FW_BOLD, 0, 0, 0, DEFAULT_CHARSET,
-                                   0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
-        m_fontNormal = CreateFontW(-D(14), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
-                                   0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
-        m_fontSmall  = CreateFontW(-D(11), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
-                                   0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
-        m_fontTiny   = CreateFontW(-D(10), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
-                                   0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
+    // Called by the fast reader when it sees a GPU it has no identity for
+    // (startup race, hot-plug, reconnect). Rate-limited to one query per 5 s.
+    void requestRefresh() {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (m_refreshRequested) return;
+        m_refreshRequested = true;
+        m_cv.notify_all();
     }
 
-    ~GPUInfoPanel() {
-        DeleteObject(m_fontTitle); DeleteObject(m_fontNormal);
-        DeleteObject(m_fontSmall); DeleteObject(m_fontTiny);
-        if (m_hwnd) DestroyWindow(m_hwnd);
+    // Blocks until the periodic interval elapses, a refresh is requested, or
+    // shutdown. Returns false on shutdown.
+    bool waitForRefresh(std::chrono::seconds interval) {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        auto minNext = m_lastRefresh + std::chrono::seconds(5);
+        m_cv.wait_until(lk, m_lastRefresh + interval, [&] { return m_stop || m_refreshRequested; });
+        if (!m_stop && m_refreshRequested && std::chrono::steady_clock::now() < minNext)
+            m_cv.wait_until(lk, minNext, [&] { return m_stop; });
+        return !m_stop;
     }
 
-    HWND hwnd() const { return m_hwnd; }
-    void reposition(int y, int w) { MoveWindow(m_hwnd, 0, y, w, PANEL_HEIGHT(), TRUE); }
+    void stop() { std::lock_guard<std::mutex> lk(m_mutex); m_stop = true; m_cv.notify_all(); }
 
-    void updateInfo(const SmiData& d) {
-        auto get = [&](const char* k, const char* def = "N/A") -> std::string {
-            auto it = d.find(k); return (it != d.end()) ? it->second : def;
-        };
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<GpuIdentityPtr> m_bySlot;
+    std::chrono::steady_clock::time_point m_lastRefresh{};
+    bool m_refreshRequested = false, m_stop = false;
+};
 
-        m_gpuModel  = toW(get("name", "Unknown GPU"));
-        m_gpuId     = L"#" + toW(get("index", "?"));
-        m_pciBusId  = L"pci: " + toW(get("pci.bus_id", "N/A"));
-        m_util      = toW(get("utilization.gpu", "0")) + L"%";
-        m_clock     = toW(get("clocks.current.graphics", "0")) + L"MHz";
-        m_memUsed   = toW(get("memory.used", "0")) + L"M";
-        m_memTotal  = toW(get("memory.total", "0")) + L"M";
+static IdentityTable g_identities;
 
-        std::string temp = get("temperature.gpu", "N/A");
-        m_temp = (temp != "N/A") ? toW(temp) + L"\u2103" : L"N/A";
+// ─── Device registry ────────────────────────────────────────────────────────
+// Samples, identities, history and statistics are keyed by a dense slot per
+// physical GPU, (host, UUID), not by nvidia-smi's index: that is only the
+// current enumeration, which shifts when a GPU falls off the bus. A slot is
+// assigned the first time a device is seen and kept for the life of the
+// process, so a GPU that is renumbered, or leaves and comes back, keeps its
+// panel, history and statistics. Sources that carry no UUID (the simulator,
+// frame streams, whose indices are already slots) bypass the registry.
+// `--hosts` registers every host's GPUs but lays the fleet out as G slots per
+// host; a device's place among them is `local`, its order of first
+// appearance on the host, which renumbering does not change either.
+//
+// The per-sample path is resolve(): the slot the index named last time,
+// confirmed by comparing UUIDs in place. Only a changed mapping probes the
+// open-addressing UUID hash. Neither allocates; a new device does, once.
+class DeviceRegistry {
+public:
+    struct Device { int host, index, local; std::string uuid; };
 
-        std::string fan = get("fan.speed", "N/A");
-        m_fan = (fan.find("N/A") != std::string::npos || fan.find("Not Supported") != std::string::npos)
-                ? L"N/A" : toW(fan) + L"%";
+    // Slot for the device reporting `uuid` as `index` on `host`, registering
+    // it or moving it to `index` as needed. `local` gets its place on the host.
+    int resolve(int host, int index, const char* ub, const char* ue, int* local = nullptr) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        size_t n = (size_t)(ue - ub);
+        if (host >= 0 && host < (int)m_byIndex.size() && index >= 0 && index < (int)m_byIndex[host].size()) {
+            int slot = m_byIndex[host][index];
+            if (slot >= 0 && m_devices[slot].uuid.size() == n && memcmp(m_devices[slot].uuid.data(), ub, n) == 0) {
+                if (local) *local = m_devices[slot].local;
+                return slot;
+            }
+        }
+        int slot = n ? find(host, ub, n) : -1;
+        if (slot < 0) {
+            slot = (int)m_devices.size();
+            if (host >= (int)m_byLocal.size()) m_byLocal.resize(host + 1);
+            m_devices.push_back({host, -1, (int)m_byLocal[host].size(), std::string(ub, n)});
+            m_byLocal[host].push_back(slot);
+            if (n) insert(slot);
+            ++m_added;
+        } else if (m_devices[slot].index != index) {
+            ++m_renumbered;
+        }
+        Device& d = m_devices[slot];
+        if (local) *local = d.local;
+        if (d.index >= 0 && d.index < (int)m_byIndex[d.host].size() && m_byIndex[d.host][d.index] == slot)
+            m_byIndex[d.host][d.index] = -1;
+        d.index = index;
+        if (index >= 0) {
+            if (host >= (int)m_byIndex.size()) m_byIndex.resize(host + 1);
+            std::vector<int>& map = m_byIndex[host];
+            if (index >= (int)map.size()) map.resize(index + 1, -1);
+            if (map[index] >= 0) m_devices[map[index]].index = -1;   // whoever had the index lost it
+            map[index] = slot;
+        }
+        return slot;
+    }
 
-        m_powerDraw  = toW(get("power.draw", "0")) + L"W";
-        m_powerLimit = toW(get("enforced.power.limit", "0")) + L"W";
+    // Slot of a known device, or -1.
+    int find(int host, const std::string& uuid) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        return uuid.empty() ? -1 : find(host, uuid.data(), uuid.size());
+    }
 
-        double mu = 0, mt = 1;
-        try { mu = std::stod(get("memory.used", "0")); } catch (...) {}
-        try { mt = std::stod(get("memory.total", "1")); } catch (...) {}
-        m_memPct = (mt > 0) ? (int)(mu * 100.0 / mt) : 0;
+    // UUID of the device `local` on `host`; false if there is none.
+    bool uuidAt(int host, int local, std::string& uuid) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (host < 0 || host >= (int)m_byLocal.size() || local < 0 || local >= (int)m_byLocal[host].size()) return false;
+        uuid = m_devices[m_byLocal[host][local]].uuid;
+        return !uuid.empty();
+    }
 
-        double pd = 0, pl = 1;
-        try { pd = std::stod(get("power.draw", "0")); } catch (...) {}
-        try { pl = std::stod(get("enforced.power.limit", "1")); } catch (...) {}
-        m_powerPct = (pl > 0) ? (int)(pd * 100.0 / pl) : 0;
+    int size() const { std::lock_guard<std::mutex> lk(m_mutex); return (int)m_devices.size(); }
 
-        InvalidateRect(m_hwnd, NULL, FALSE);
+    void print(FILE* f) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (m_devices.empty()) return;
+        int absent = 0;
+        for (const auto& d : m_devices) absent += d.index < 0;
+        fprintf(f, "devices: %zu registered, %d without an index, %llu renumbered\n",
+                m_devices.size(), absent, (unsigned long long)m_renumbered);
     }
 
 private:
-    HWND m_hwnd = NULL;
-    HFONT m_fontTitle, m_fontNormal, m_fontSmall, m_fontTiny;
-
-    std::wstring m_gpuModel = L"Graphics Device", m_gpuId = L"#0", m_pciBusId = L"bus: 00:00.0";
-    std::wstring m_temp = L"N/A", m_fan = L"N/A", m_util = L"N/A", m_clock = L"N/A";
-    std::wstring m_memUsed = L"N/A", m_memTotal = L"N/A";
-    std::wstring m_powerDraw = L"N/A", m_powerLimit = L"N/A";
-    int m_memPct = 0, m_powerPct = 0;
+    mutable std::mutex m_mutex;
+    std::vector<Device> m_devices;                  // by slot
+    std::vector<std::vector<int>> m_byIndex;        // host, index -> slot or -1
+    std::vector<std::vector<int>> m_byLocal;        // host, local -> slot
+    std::vector<int> m_hash;                        // slot + 1, 0 = empty; power-of-two size
+    uint64_t m_added = 0, m_renumbered = 0;
 
-    void drawProgressBar(HDC hdc, int x, int y, int w, int h, int pct) {
-        HRGN clip = CreateRoundRectRgn(x, y, x + w, y + h, D(16), D(16));
-        SelectClipRgn(hdc, clip);
+    static uint64_t hash(int host, const char* p, size_t n) {
+        uint64_t h = 1469598103934665603ull ^ (uint64_t)(uint32_t)host;
+        for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)p[i]) * 1099511628211ull;
+        return h ^ (h >> 29);
+    }
 
-        RECT rcBg = {x, y, x + w, y + h};
-        HBRUSH bgBr = CreateSolidBrush(g_theme.progress_bg);
-        FillRect(hdc, &rcBg, bgBr); DeleteObject(bgBr);
+    int find(int host, const char* p, size_t n) const {
+        if (m_hash.empty()) return -1;
+        size_t mask = m_hash.size() - 1;
+        for (size_t i = hash(host, p, n) & mask; m_hash[i]; i = (i + 1) & mask) {
+            const Device& d = m_devices[m_hash[i] - 1];
+            if (d.host == host && d.uuid.size() == n && memcmp(d.uuid.data(), p, n) == 0) return m_hash[i] - 1;
+        }
+        return -1;
+    }
 
-        if (pct > 0) {
-            int cw = w * std::min(pct, 100) / 100;
-            RECT rcChunk = {x, y, x + cw, y + h};
-            HBRUSH chBr = CreateSolidBrush(g_theme.progress_chunk);
-            FillRect(hdc, &rcChunk, chBr); DeleteObject(chBr);
+    void insert(int slot) {
+        if ((m_added + 1) * 2 > m_hash.size()) {
+            std::vector<int> old(std::max<size_t>(64, m_hash.size() * 2), 0);
+            old.swap(m_hash);
+            for (int s : old) if (s) place(s - 1);
         }
-        SelectClipRgn(hdc, NULL); DeleteObject(clip);
+        place(slot);
+    }
 
-        HPEN pen = CreatePen(PS_SOLID, 1, g_theme.border);
-        HPEN oldPen = (HPEN)SelectObject(hdc, pen);
-        SelectObject(hdc, GetStockObject(NULL_BRUSH));
-        RoundRect(hdc, x, y, x + w, y + h, D(16), D(16));
-        SelectObject(hdc, oldPen); DeleteObject(pen);
+    void place(int slot) {
+        const Device& d = m_devices[slot];
+        size_t mask = m_hash.size() - 1, i = hash(d.host, d.uuid.data(), d.uuid.size()) & mask;
+        while (m_hash[i]) i = (i + 1) & mask;
+        m_hash[i] = slot + 1;
+    }
+};
 
-        wchar_t buf[16]; wsprintfW(buf, L"%d%%", pct);
-        RECT rcText = {x, y, x + w, y + h};
-        SelectObject(hdc, m_fontNormal);
-        SetTextColor(hdc, g_theme.progress_text);
-        DrawTextW(hdc, buf, -1, &rcText, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+static DeviceRegistry g_registry;
+
+// ─── CSV scanning ───────────────────────────────────────────────────────────
+// Walks one CSV line in place: no substrings, no allocations.
+struct FieldScanner {
+    const char* p; const char* end;
+    bool next(const char*& b, const char*& e) {
+        if (p > end) return false;
+        const char* c = (const char*)memchr(p, ',', end - p);
+        const char* stop = c ? c : end;
+        b = p; e = stop;
+        while (b < e && (*b == ' ' || *b == '\t')) ++b;
+        while (e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) --e;
+        p = stop + 1;
+        return true;
     }
+};
 
-    void onPaint() {
-        PAINTSTRUCT ps;
-        HDC hdc = BeginPaint(m_hwnd, &ps);
-        RECT rc; GetClientRect(m_hwnd, &rc);
-        int W = rc.right, H = rc.bottom;
+// Plain decimal parser for nvidia-smi's nounits output. Anything that is not
+// a number ("[N/A]", "[Not Supported]") yields NaN. Digits are accumulated
+// as an integer and scaled once, so "355.22" parses to exactly 35522 / 100.0.
+static double scanNumber(const char* b, const char* e) {
+    static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                   1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    bool neg = false;
+    if (b < e && (*b == '-' || *b == '+')) { neg = (*b == '-'); ++b; }
+    uint64_t mant = 0; int digits = 0, frac = 0;
+    while (b < e && *b >= '0' && *b <= '9') { mant = mant * 10 + (*b++ - '0'); ++digits; }
+    if (b < e && *b == '.') {
+        ++b;
+        while (b < e && *b >= '0' && *b <= '9') { mant = mant * 10 + (*b++ - '0'); ++digits; ++frac; }
+    }
+    if (b != e || digits == 0 || digits > 18) return NAN;
+    double v = (double)mant / POW10[frac];
+    return neg ? -v : v;
+}
 
-        HDC mem = CreateCompatibleDC(hdc);
-        HBITMAP bmp = CreateCompatibleBitmap(hdc, W, H);
-        SelectObject(mem, bmp);
+// "YYYY/MM/DD HH:MM:SS.mmm" -> milliseconds since 1970-01-01 in the source's
+// own (local) clock. Returns -1 if the field is malformed.
+static int64_t scanTimestamp(const char* b, const char* e) {
+    int f[7] = {}; int n = 0;
+    for (const char* p = b; p < e && n < 7; ) {
+        if (*p < '0' || *p > '9') { ++p; continue; }
+        int v = 0;
+        while (p < e && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+        f[n++] = v;
+    }
+    if (n < 6) return -1;
+    // days_from_civil (H. Hinnant)
+    int y = f[0] - (f[1] <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (f[1] + (f[1] > 2 ? -3 : 9)) + 2) / 5 + f[2] - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    return ((days * 24 + f[3]) * 60 + f[4]) * 60000 + (int64_t)f[5] * 1000 + f[6];
+}
 
-        // Background
-        HBRUSH bgBr = CreateSolidBrush(g_theme.bg);
-        FillRect(mem, &rc, bgBr); DeleteObject(bgBr);
-        SetBkMode(mem, TRANSPARENT);
+// timestamp,index,uuid,<METRIC_FIELDS...>; the UUID is left in place.
+static bool parseSampleLine(const char* b, const char* e, int64_t& ts, GpuSample& out, const char*& ub, const char*& ue) {
+    FieldScanner sc{b, e}; const char *fb, *fe;
+    if (!sc.next(fb, fe)) return false;
+    ts = scanTimestamp(fb, fe);
+    if (!sc.next(fb, fe)) return false;
+    double idx = scanNumber(fb, fe);
+    if (std::isnan(idx)) return false;
+    out.index = (int)idx;
+    if (!sc.next(ub, ue)) return false;
+    for (int m = 0; m < M_COUNT && sc.next(fb, fe); ++m) out.v[m] = scanNumber(fb, fe);
+    return true;
+}
 
-        int xPad = D(10);
-        int iconSz = D(24);
+// IDENTITY_FIELDS, in order
+static bool parseIdentityLine(const char* b, const char* e, GpuIdentity& out) {
+    FieldScanner sc{b, e}; const char *fb, *fe;
+    if (!sc.next(fb, fe)) return false;
+    double idx = scanNumber(fb, fe);
+    if (std::isnan(idx)) return false;
+    out.index = (int)idx;
+    if (sc.next(fb, fe)) { double c = scanNumber(fb, fe); out.count = std::isnan(c) ? 0 : (int)c; }
+    if (sc.next(fb, fe)) out.uuid.assign(fb, fe);
+    if (sc.next(fb, fe)) out.pciBusId.assign(fb, fe);
+    if (sc.next(fb, fe)) out.name.assign(fb, fe);
+    if (sc.next(fb, fe)) out.memTotal = scanNumber(fb, fe);
+    if (sc.next(fb, fe)) out.powerLimit = scanNumber(fb, fe);
+    return true;
+}
 
-        // ── Row 1: GPU model name ──
-        SelectObject(mem, m_fontTitle);
-        SetTextColor(mem, g_theme.title_text);
-        RECT r1 = {xPad, D(5), W - xPad, D(33)};
-        DrawTextW(mem, m_gpuModel.c_str(), -1, &r1, DT_LEFT | DT_SINGLELINE | DT_END_ELLIPSIS);
+// ─── XML scanning ───────────────────────────────────────────────────────────
+// SAX-style scanner for `nvidia-smi -q -x`, fed the output as it arrives. It
+// keeps only the current element path, in a fixed buffer, and reports the
+// subscribed paths to a handler; an element that is not on the way to a
+// subscription is skipped with its whole subtree, tag by tag, without its
+// text being looked at. Nothing is allocated and no tree is built. The root
+// element is transparent, so paths start below it ("gpu/uuid"), and a '*'
+// component matches any name.
+struct XmlPath { const char* path; int field; };
 
-        // ── Row 2: GPU ID + PCI bus ──
-        SelectObject(mem, m_fontSmall);
-        SetTextColor(mem, g_theme.sub_text);
-        RECT r2a = {xPad, D(35), xPad + D(30), D(49)};
-        DrawTextW(mem, m_gpuId.c_str(), -1, &r2a, DT_LEFT | DT_SINGLELINE);
-        RECT r2b = {xPad + D(32), D(35), W - xPad, D(49)};
-        DrawTextW(mem, m_pciBusId.c_str(), -1, &r2b, DT_LEFT | DT_SINGLELINE);
+class XmlScanner {
+public:
+    static constexpr int XML_DEPTH = 16, XML_PATH = 256;
 
-        // ── Row 3: Stats with icons ──
-        int statsY = D(55);
-        int usableW = W - 2 * xPad;
-        struct StatItem { HBITMAP icon; const std::wstring* val; };
-        StatItem stats[] = {
-            {g_bmpGear,   &m_util},
-            {g_bmpThermo, &m_temp},
-            {g_bmpFan,    &m_fan},
-            {g_bmpWave,   &m_clock},
-        };
+    XmlScanner(const XmlPath* subs, int n) : m_subs(subs), m_nsubs(n) {}
 
-        SelectObject(mem, m_fontNormal);
-        SetTextColor(mem, g_theme.text);
-        for (int i = 0; i < 4; ++i) {
-            int sx = xPad + i * usableW / 4;
-            drawBmp(mem, stats[i].icon, sx, statsY, iconSz);
-            RECT rs = {sx + iconSz + D(4), statsY, sx + usableW / 4, statsY + iconSz};
-            DrawTextW(mem, stats[i].val->c_str(), -1, &rs, DT_LEFT | DT_VCENTER | DT_SINGLELINE);
+    // Scans [b, e) and returns where the first incomplete token starts; the
+    // caller passes that tail again with more input appended. Calls
+    // h.open(field, attrs, attrsEnd) when a subscribed element opens and
+    // h.text(field, name, nameEnd, b, e) with its trimmed text, entities
+    // left encoded.
+    template <typename Handler>
+    const char* feed(const char* b, const char* e, Handler& h) {
+        const char* p = b;
+        while (p < e) {
+            if (*p != '<') {
+                const char* lt = (const char*)memchr(p, '<', e - p);
+                if (!lt) return p;
+                if (!m_skip && m_depth > 1 && m_field[m_depth] >= 0) {
+                    const char* tb = p; const char* te = lt;
+                    while (tb < te && isspace((unsigned char)*tb)) ++tb;
+                    while (te > tb && isspace((unsigned char)te[-1])) --te;
+                    if (tb < te) h.text(m_field[m_depth], m_path + m_len[m_depth - 1] + (m_depth > 2), m_path + m_len[m_depth], tb, te);
+                }
+                p = lt;
+                continue;
+            }
+            if (e - p < 4) return p;
+            if (memcmp(p, "<!--", 4) == 0) {
+                const char* c = std::search(p + 4, e, "-->", "-->" + 3);
+                if (c == e) return p;
+                p = c + 3;
+                continue;
+            }
+            const char* gt = (const char*)memchr(p, '>', e - p);
+            if (!gt) return p;
+            if (p[1] == '?' || p[1] == '!') { p = gt + 1; continue; }
+            if (p[1] == '/') { close(); p = gt + 1; continue; }
+            const char* nb = p + 1; const char* ne = nb;
+            while (ne < gt && !isspace((unsigned char)*ne) && *ne != '/') ++ne;
+            bool empty = gt[-1] == '/';
+            open(nb, ne, ne, empty ? gt - 1 : gt, h);
+            if (empty) close();
+            p = gt + 1;
         }
+        return p;
+    }
 
-        // ── Row 4: Memory bar ──
-        int barRowY1 = D(88);
-        int xIcon = xPad;
-        int xVal  = xPad + iconSz + D(6);
-        int wVal  = D(60);
-        int xBar  = xVal + wVal + D(8);
-        int wBar  = W - xBar - xPad;
-        int barH  = D(20);
-        int rowH  = D(38);
+    void reset() { m_depth = m_skip = 0; }
 
-        drawBmp(mem, g_bmpRam, xIcon, barRowY1 + (rowH - iconSz) / 2, iconSz);
+private:
+    const XmlPath* m_subs;
+    int m_nsubs;
+    char m_path[XML_PATH];
+    int m_len[XML_DEPTH + 1] = {};      // path length with `depth` elements open
+    int m_field[XML_DEPTH + 1] = {};    // subscription of the element at each depth, -1 if none
+    int m_depth = 0;                    // open elements on subscribed paths, root included
+    int m_skip = 0;                     // levels open inside a skipped subtree
 
-        SelectObject(mem, m_fontTiny);
-        SetTextColor(mem, g_theme.text);
-        RECT rmU = {xVal, barRowY1, xVal + wVal, barRowY1 + D(14)};
-        DrawTextW(mem, m_memUsed.c_str(), -1, &rmU, DT_CENTER | DT_SINGLELINE);
-        HPEN sepPen = CreatePen(PS_SOLID, 1, g_theme.sub_text);
-        HPEN oldP = (HPEN)SelectObject(mem, sepPen);
-        MoveToEx(mem, xVal, barRowY1 + D(15), NULL);
-        LineTo(mem, xVal + wVal, barRowY1 + D(15));
-        SelectObject(mem, oldP); DeleteObject(sepPen);
-        RECT rmT = {xVal, barRowY1 + D(17), xVal + wVal, barRowY1 + D(31)};
-        DrawTextW(mem, m_memTotal.c_str(), -1, &rmT, DT_CENTER | DT_SINGLELINE);
-        drawProgressBar(mem, xBar, barRowY1 + (rowH - barH) / 2, wBar, barH, m_memPct);
+    template <typename Handler>
+    void open(const char* nb, const char* ne, const char* ab, const char* ae, Handler& h) {
+        if (m_skip || m_depth >= XML_DEPTH) { ++m_skip; return; }
+        if (m_depth == 0) { m_depth = 1; m_len[1] = 0; m_field[1] = -1; return; }
+        int base = m_len[m_depth], n = (int)(ne - nb), sep = m_depth > 1;
+        if (base + sep + n >= XML_PATH) { ++m_skip; return; }
+        if (sep) m_path[base] = '/';
+        memcpy(m_path + base + sep, nb, n);
+        int len = base + sep + n, field = -1, k = match(len, field);
+        if (k == 0) { ++m_skip; return; }
+        ++m_depth;
+        m_len[m_depth] = len;
+        m_field[m_depth] = field;
+        if (field >= 0) h.open(field, ab, ae);
+    }
 
-        // ── Row 5: Power bar ──
-        int barRowY2 = D(130);
+    void close() { if (m_skip) --m_skip; else if (m_depth) --m_depth; }
 
-        drawBmp(mem, g_bmpGauge, xIcon, barRowY2 + (rowH - iconSz) / 2, iconSz);
+    // 0 if the first `len` path bytes lead to no subscription, 1 if they lead
+    // to one, 2 if they are one (and `field` is set).
+    int match(int len, int& field) const {
+        int best = 0;
+        for (int i = 0; i < m_nsubs; ++i) {
+            const char* s = m_subs[i].path;
+            const char* q = m_path; const char* qe = m_path + len;
+            for (;;) {
+                const char* se = s; while (*se && *se != '/') ++se;
+                const char* ce = (const char*)memchr(q, '/', qe - q); if (!ce) ce = qe;
+                bool any = se - s == 1 && *s == '*';
+                if (!any && (se - s != ce - q || memcmp(s, q, se - s) != 0)) break;
+                if (ce == qe) {
+                    if (*se) best = std::max(best, 1);
+                    else { field = m_subs[i].field; return 2; }
+                    break;
+                }
+                if (!*se) break;
+                s = se + 1; q = ce + 1;
+            }
+        }
+        return best;
+    }
+};
 
-        SelectObject(mem, m_fontTiny);
-        SetTextColor(mem, g_theme.text);
-        RECT rpD = {xVal, barRowY2, xVal + wVal, barRowY2 + D(14)};
-        DrawTextW(mem, m_powerDraw.c_str(), -1, &rpD, DT_CENTER | DT_SINGLELINE);
-        sepPen = CreatePen(PS_SOLID, 1, g_theme.sub_text);
-        oldP = (HPEN)SelectObject(mem, sepPen);
-        MoveToEx(mem, xVal, barRowY2 + D(15), NULL);
-        LineTo(mem, xVal + wVal, barRowY2 + D(15));
-        SelectObject(mem, oldP); DeleteObject(sepPen);
-        RECT rpL = {xVal, barRowY2 + D(17), xVal + wVal, barRowY2 + D(31)};
-        DrawTextW(mem, m_powerLimit.c_str(), -1, &rpL, DT_CENTER | DT_SINGLELINE);
-        drawProgressBar(mem, xBar, barRowY2 + (rowH - barH) / 2, wBar, barH, m_powerPct);
+// `-q -x` state that has no --query-gpu field. Counters are NaN where the
+// GPU does not report them (no ECC, no page retirement or row remapping).
+static const char* const CLOCK_EVENT_NAMES[] = {
+    "gpu_idle", "applications_clocks_setting", "sw_power_cap", "hw_slowdown", "hw_thermal_slowdown",
+    "hw_power_brake_slowdown", "sync_boost", "sw_thermal_slowdown", "display_clocks_setting"
+};
+static const int CLOCK_EVENT_COUNT = (int)(sizeof(CLOCK_EVENT_NAMES) / sizeof(CLOCK_EVENT_NAMES[0]));
 
-        // Bottom border line
-        HPEN borderPen = CreatePen(PS_SOLID, 1, g_theme.border);
-        oldP = (HPEN)SelectObject(mem, borderPen);
-        MoveToEx(mem, 0, H - 1, NULL);
-        LineTo(mem, W, H - 1);
-        SelectObject(mem, oldP); DeleteObject(borderPen);
+struct GpuProcessInfo {
+    uint32_t pid = 0;
+    int gi = -1, ci = -1;           // MIG instance the process runs in, -1 without MIG
+    std::string type, name;
+    double memUsed = NAN;           // MiB
+};
 
-        BitBlt(hdc, 0, 0, W, H, mem, 0, 0, SRCCOPY);
-        DeleteObject(bmp); DeleteDC(mem);
-        EndPaint(m_hwnd, &ps);
+// A MIG compute instance, a child of its parent GPU keyed by (slot, gi, ci).
+// nvidia-smi reports no per-instance utilization; memory fill and resident
+// processes are what shows a slice is saturated.
+struct MigDevice {
+    int index = -1, gi = -1, ci = -1;
+    double sms = NAN;                       // multiprocessors
+    double memTotal = NAN, memUsed = NAN;   // MiB
+    int processes = 0;
+};
+
+struct GpuDetail {
+    int index = -1;
+    std::string uuid;
+    double pcieGen = NAN, pcieGenMax = NAN, pcieWidth = NAN, pcieWidthMax = NAN;
+    uint32_t clockEvents = 0;       // bit i: CLOCK_EVENT_NAMES[i] is active
+    double eccVolatile[2] = {NAN, NAN}, eccAggregate[2] = {NAN, NAN};   // corrected, uncorrected
+    double retiredPages[2] = {NAN, NAN};                                // single-bit, double-bit
+    double remappedRows[2] = {NAN, NAN};                                // correctable, uncorrectable
+    bool retirePending = false;
+    bool migEnabled = false;
+    std::vector<GpuProcessInfo> processes;
+    std::vector<MigDevice> mig;     // in mig_device order
+};
+using GpuDetailPtr = std::shared_ptr<const GpuDetail>;
+
+enum DetailField {
+    DF_GPU, DF_UUID, DF_PCIE_GEN, DF_PCIE_GEN_MAX, DF_PCIE_WIDTH, DF_PCIE_WIDTH_MAX, DF_CLOCK_EVENT,
+    DF_ECC_VOL_CORR, DF_ECC_VOL_UNCORR, DF_ECC_AGG_CORR, DF_ECC_AGG_UNCORR,
+    DF_RETIRED_SBE, DF_RETIRED_DBE, DF_RETIRE_PENDING, DF_REMAP_CORR, DF_REMAP_UNCORR, DF_REMAP_PENDING,
+    DF_PROCESS, DF_PROC_PID, DF_PROC_TYPE, DF_PROC_NAME, DF_PROC_MEM, DF_PROC_GI, DF_PROC_CI,
+    DF_MIG_MODE, DF_MIG, DF_MIG_INDEX, DF_MIG_GI, DF_MIG_CI, DF_MIG_SMS, DF_MIG_MEM_TOTAL, DF_MIG_MEM_USED
+};
+
+// Older drivers say clocks_throttle_reasons, Ampere and later report ECC per
+// SRAM/DRAM and remap rows instead of retiring pages; both spellings are in.
+static const XmlPath DETAIL_PATHS[] = {
+    {"gpu", DF_GPU}, {"gpu/uuid", DF_UUID},
+    {"gpu/pci/pci_gpu_link_info/pcie_gen/current_link_gen", DF_PCIE_GEN},
+    {"gpu/pci/pci_gpu_link_info/pcie_gen/max_link_gen", DF_PCIE_GEN_MAX},
+    {"gpu/pci/pci_gpu_link_info/link_widths/current_link_width", DF_PCIE_WIDTH},
+    {"gpu/pci/pci_gpu_link_info/link_widths/max_link_width", DF_PCIE_WIDTH_MAX},
+    {"gpu/clocks_event_reasons/*", DF_CLOCK_EVENT}, {"gpu/clocks_throttle_reasons/*", DF_CLOCK_EVENT},
+    {"gpu/ecc_errors/volatile/single_bit/total", DF_ECC_VOL_CORR},
+    {"gpu/ecc_errors/volatile/double_bit/total", DF_ECC_VOL_UNCORR},
+    {"gpu/ecc_errors/volatile/sram_correctable", DF_ECC_VOL_CORR},
+    {"gpu/ecc_errors/volatile/dram_correctable", DF_ECC_VOL_CORR},
+    {"gpu/ecc_errors/volatile/sram_uncorrectable", DF_ECC_VOL_UNCORR},
+    {"gpu/ecc_errors/volatile/dram_uncorrectable", DF_ECC_VOL_UNCORR},
+    {"gpu/ecc_errors/aggregate/single_bit/total", DF_ECC_AGG_CORR},
+    {"gpu/ecc_errors/aggregate/double_bit/total", DF_ECC_AGG_UNCORR},
+    {"gpu/ecc_errors/aggregate/sram_correctable", DF_ECC_AGG_CORR},
+    {"gpu/ecc_errors/aggregate/dram_correctable", DF_ECC_AGG_CORR},
+    {"gpu/ecc_errors/aggregate/sram_uncorrectable", DF_ECC_AGG_UNCORR},
+    {"gpu/ecc_errors/aggregate/dram_uncorrectable", DF_ECC_AGG_UNCORR},
+    {"gpu/retired_pages/multiple_single_bit_retirement/retired_count", DF_RETIRED_SBE},
+    {"gpu/retired_pages/double_bit_retirement/retired_count", DF_RETIRED_DBE},
+    {"gpu/retired_pages/pending_blacklist", DF_RETIRE_PENDING},
+    {"gpu/retired_pages/pending_retirement", DF_RETIRE_PENDING},
+    {"gpu/remapped_rows/remapped_row_corr", DF_REMAP_CORR},
+    {"gpu/remapped_rows/remapped_row_unc", DF_REMAP_UNCORR},
+    {"gpu/remapped_rows/remapped_row_pending", DF_REMAP_PENDING},
+    {"gpu/processes/process_info", DF_PROCESS},
+    {"gpu/processes/process_info/pid", DF_PROC_PID},
+    {"gpu/processes/process_info/type", DF_PROC_TYPE},
+    {"gpu/processes/process_info/process_name", DF_PROC_NAME},
+    {"gpu/processes/process_info/used_memory", DF_PROC_MEM},
+    {"gpu/processes/process_info/gpu_instance_id", DF_PROC_GI},
+    {"gpu/processes/process_info/compute_instance_id", DF_PROC_CI},
+    {"gpu/mig_mode/current_mig", DF_MIG_MODE},
+    {"gpu/mig_devices/mig_device", DF_MIG},
+    {"gpu/mig_devices/mig_device/index", DF_MIG_INDEX},
+    {"gpu/mig_devices/mig_device/gpu_instance_id", DF_MIG_GI},
+    {"gpu/mig_devices/mig_device/compute_instance_id", DF_MIG_CI},
+    {"gpu/mig_devices/mig_device/device_attributes/shared/multiprocessor_count", DF_MIG_SMS},
+    {"gpu/mig_devices/mig_device/fb_memory_usage/total", DF_MIG_MEM_TOTAL},
+    {"gpu/mig_devices/mig_device/fb_memory_usage/used", DF_MIG_MEM_USED},
+};
+
+// Fills one GpuDetail per <gpu>, in document order.
+struct DetailHandler {
+    std::vector<GpuDetail>& out;
+
+    void open(int field, const char*, const char*) {
+        if (field == DF_GPU) { out.emplace_back(); out.back().index = (int)out.size() - 1; }
+        else if (field == DF_PROCESS && !out.empty()) out.back().processes.emplace_back();
+        else if (field == DF_MIG && !out.empty()) out.back().mig.emplace_back();
     }
 
-    static LRESULT CALLBACK panelProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
-        GPUInfoPanel* self = nullptr;
-        if (msg == WM_NCCREATE) {
-            auto* cs = reinterpret_cast<CREATESTRUCTW*>(lp);
-            self = reinterpret_cast<GPUInfoPanel*>(cs->lpCreateParams);
-            SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(self));
-        } else {
-            self = reinterpret_cast<GPUInfoPanel*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    void text(int field, const char* nb, const char* ne, const char* b, const char* e) {
+        if (out.empty()) return;
+        GpuDetail& d = out.back();
+        GpuProcessInfo* p = d.processes.empty() ? nullptr : &d.processes.back();
+        MigDevice* m = d.mig.empty() ? nullptr : &d.mig.back();
+        auto id = [&] { double v = leadingNumber(b, e); return std::isnan(v) ? -1 : (int)v; };
+        switch (field) {
+        case DF_UUID: d.uuid.assign(b, e); break;
+        case DF_PCIE_GEN: d.pcieGen = leadingNumber(b, e); break;
+        case DF_PCIE_GEN_MAX: d.pcieGenMax = leadingNumber(b, e); break;
+        case DF_PCIE_WIDTH: d.pcieWidth = leadingNumber(b, e); break;
+        case DF_PCIE_WIDTH_MAX: d.pcieWidthMax = leadingNumber(b, e); break;
+        case DF_CLOCK_EVENT: {
+            static const char PREFIX[] = "_reason_";
+            const char* r = std::search(nb, ne, PREFIX, PREFIX + 8);
+            if (r == ne || !is(b, e, "Active")) break;
+            for (int i = 0; i < CLOCK_EVENT_COUNT; ++i)
+                if (is(r + 8, ne, CLOCK_EVENT_NAMES[i])) d.clockEvents |= 1u << i;
+            break;
         }
-        switch (msg) {
-        case WM_PAINT:    if (self) self->onPaint(); return 0;
-        case WM_ERASEBKGND: return 1;
+        case DF_ECC_VOL_CORR: add(d.eccVolatile[0], b, e); break;
+        case DF_ECC_VOL_UNCORR: add(d.eccVolatile[1], b, e); break;
+        case DF_ECC_AGG_CORR: add(d.eccAggregate[0], b, e); break;
+        case DF_ECC_AGG_UNCORR: add(d.eccAggregate[1], b, e); break;
+        case DF_RETIRED_SBE: d.retiredPages[0] = leadingNumber(b, e); break;
+        case DF_RETIRED_DBE: d.retiredPages[1] = leadingNumber(b, e); break;
+        case DF_REMAP_CORR: d.remappedRows[0] = leadingNumber(b, e); break;
+        case DF_REMAP_UNCORR: d.remappedRows[1] = leadingNumber(b, e); break;
+        case DF_RETIRE_PENDING: case DF_REMAP_PENDING: d.retirePending |= is(b, e, "Yes"); break;
+        case DF_PROC_PID: if (p) p->pid = (uint32_t)leadingNumber(b, e); break;
+        case DF_PROC_TYPE: if (p) p->type.assign(b, e); break;
+        case DF_PROC_NAME: if (p) unescape(p->name, b, e); break;
+        case DF_PROC_MEM: if (p) p->memUsed = leadingNumber(b, e); break;
+        case DF_PROC_GI: if (p) p->gi = id(); break;
+        case DF_PROC_CI: if (p) p->ci = id(); break;
+        case DF_MIG_MODE: d.migEnabled = is(b, e, "Enabled"); break;
+        case DF_MIG_INDEX: if (m) m->index = id(); break;
+        case DF_MIG_GI: if (m) m->gi = id(); break;
+        case DF_MIG_CI: if (m) m->ci = id(); break;
+        case DF_MIG_SMS: if (m) m->sms = leadingNumber(b, e); break;
+        case DF_MIG_MEM_TOTAL: if (m) m->memTotal = leadingNumber(b, e); break;
+        case DF_MIG_MEM_USED: if (m) m->memUsed = leadingNumber(b, e); break;
         }
-        return DefWindowProcW(hwnd, msg, wp, lp);
     }
-};
-bool GPUInfoPanel::s_registered = false;
 
-// ─── MainWindow ─────────────────────────────────────────────────────────────
-class MainWindow {
-public:
-    static constexpr const wchar_t* CLASS_NAME = L"NvSmiGuiMainClass";
+    static bool is(const char* b, const char* e, const char* s) { return (size_t)(e - b) == strlen(s) && memcmp(b, s, e - b) == 0; }
 
-    static void registerClass() {
-        WNDCLASSW wc = {};
-        wc.lpfnWndProc   = wndProc;
-        wc.hInstance      = g_hInst;
-        wc.lpszClassName  = CLASS_NAME;
-        wc.hCursor        = LoadCursor(NULL, IDC_ARROW);
-        wc.hbrBackground  = CreateSolidBrush(g_theme.bg);
-        RegisterClassW(&wc);
+    // "16x", "1024 MiB" -> the number; "N/A" -> NaN.
+    static double leadingNumber(const char* b, const char* e) {
+        const char* q = b;
+        while (q < e && ((*q >= '0' && *q <= '9') || *q == '.' || *q == '-')) ++q;
+        return scanNumber(b, q);
     }
 
-    MainWindow(const std::wstring& title) {
-        registerClass();
-        m_hwnd = CreateWindowExW(0, CLASS_NAME, title.c_str(),
-                                 WS_FIXED, CW_USEDEFAULT, CW_USEDEFAULT,
-                                 D(500), D(100), NULL, NULL, g_hInst, this);
-        if (g_windowIcon) {
-            SendMessageW(m_hwnd, WM_SETICON, ICON_BIG, (LPARAM)g_windowIcon);
-            SendMessageW(m_hwnd, WM_SETICON, ICON_SMALL, (LPARAM)g_windowIcon);
+    static void add(double& acc, const char* b, const char* e) {
+        double v = leadingNumber(b, e);
+        if (!std::isnan(v)) acc = std::isnan(acc) ? v : acc + v;
+    }
+
+    static void unescape(std::string& out, const char* b, const char* e) {
+        static const char* const ENT[5][2] = {{"&amp;", "&"}, {"&lt;", "<"}, {"&gt;", ">"}, {"&quot;", "\""}, {"&apos;", "'"}};
+        out.clear();
+        while (b < e) {
+            int k = 0;
+            if (*b == '&') while (k < 5 && !(e - b >= (ptrdiff_t)strlen(ENT[k][0]) && memcmp(b, ENT[k][0], strlen(ENT[k][0])) == 0)) ++k;
+            if (*b == '&' && k < 5) { out += ENT[k][1]; b += strlen(ENT[k][0]); }
+            else out += *b++;
         }
-        // Dark title bar (Windows 10 1809+ / Windows 11)
+    }
+};
+
+// Counts each MIG instance's processes; run once a GpuDetail is complete.
+static void attachMigProcesses(GpuDetail& d) {
+    for (auto& m : d.mig) {
+        m.processes = 0;
+        for (const auto& p : d.processes) m.processes += p.gi == m.gi && p.ci == m.ci;
+    }
+}
+
+// A MIG parent's instances summed up: what its panel shows collapsed.
+struct MigRollup {
+    int instances = 0, busy = 0;            // busy: with a resident process
+    double memUsed = 0, memTotal = 0;       // MiB over the instances that report it
+    int fullest = -1;                       // instance with the highest memory fill
+};
+
+static MigRollup rollupMig(const GpuDetail& d) {
+    MigRollup r;
+    double best = -1;
+    for (size_t i = 0; i < d.mig.size(); ++i) {
+        const MigDevice& m = d.mig[i];
+        ++r.instances; r.busy += m.processes > 0;
+        if (std::isnan(m.memTotal) || std::isnan(m.memUsed) || m.memTotal <= 0) continue;
+        r.memUsed += m.memUsed; r.memTotal += m.memTotal;
+        if (m.memUsed / m.memTotal > best) { best = m.memUsed / m.memTotal; r.fullest = (int)i; }
+    }
+    return r;
+}
+
+static std::string describeMig(const GpuDetail& d) {
+    MigRollup r = rollupMig(d);
+    char buf[160];
+    snprintf(buf, sizeof(buf), "MIG %d instance%s, %d busy, %.1f/%.1f GiB", r.instances, r.instances == 1 ? "" : "s",
+             r.busy, r.memUsed / 1024, r.memTotal / 1024);
+    return buf;
+}
+
+static std::string describeMigDevice(const MigDevice& m) {
+    char buf[160];
+    auto num = [](double v) { return std::isnan(v) ? std::string("N/A") : std::to_string((long long)v); };
+    snprintf(buf, sizeof(buf), "gi %d ci %d, %s SMs, %s/%s MiB, %d process%s", m.gi, m.ci, num(m.sms).c_str(),
+             num(m.memUsed).c_str(), num(m.memTotal).c_str(), m.processes, m.processes == 1 ? "" : "es");
+    return buf;
+}
+
+// One line per GPU for the detail window and --stats.
+static std::string describeDetail(const GpuDetail& d) {
+    char buf[256];
+    std::string s;
+    auto num = [](double v) { return std::isnan(v) ? std::string("N/A") : std::to_string((long long)v); };
+    snprintf(buf, sizeof(buf), "PCIe gen %s/%s x%s/%s", num(d.pcieGen).c_str(), num(d.pcieGenMax).c_str(),
+             num(d.pcieWidth).c_str(), num(d.pcieWidthMax).c_str());
+    s += buf;
+    s += "  ·  clocks held by ";
+    if (!(d.clockEvents & ~1u)) s += d.clockEvents ? "idle" : "nothing";
+    else for (int i = 1, n = 0; i < CLOCK_EVENT_COUNT; ++i)
+        if (d.clockEvents & (1u << i)) { if (n++) s += ", "; s += CLOCK_EVENT_NAMES[i]; }
+    snprintf(buf, sizeof(buf), "  ·  ECC %s/%s volatile, %s/%s aggregate", num(d.eccVolatile[0]).c_str(),
+             num(d.eccVolatile[1]).c_str(), num(d.eccAggregate[0]).c_str(), num(d.eccAggregate[1]).c_str());
+    s += buf;
+    if (!std::isnan(d.retiredPages[0]) || !std::isnan(d.retiredPages[1])) {
+        snprintf(buf, sizeof(buf), "  ·  retired pages %s sbe %s dbe", num(d.retiredPages[0]).c_str(), num(d.retiredPages[1]).c_str());
+        s += buf;
+    }
+    if (!std::isnan(d.remappedRows[0]) || !std::isnan(d.remappedRows[1])) {
+        snprintf(buf, sizeof(buf), "  ·  remapped rows %s/%s", num(d.remappedRows[0]).c_str(), num(d.remappedRows[1]).c_str());
+        s += buf;
+    }
+    if (d.retirePending) s += " (pending)";
+    if (d.migEnabled) { s += "  ·  "; s += describeMig(d); }
+    snprintf(buf, sizeof(buf), "  ·  %zu process%s", d.processes.size(), d.processes.size() == 1 ? "" : "es");
+    s += buf;
+    for (size_t i = 0; i < d.processes.size() && i < 4; ++i) {
+        const auto& p = d.processes[i];
+        snprintf(buf, sizeof(buf), "%s%u %s (%s, %s MiB)", i ? ", " : ": ", p.pid, p.name.c_str(), p.type.c_str(), num(p.memUsed).c_str());
+        s += buf;
+    }
+    if (d.processes.size() > 4) s += ", ...";
+    return s;
+}
+
+// Latest `-q -x` result per GPU, with the scan cost for --stats.
+class DetailTable {
+public:
+    void update(std::vector<GpuDetail>& ds, size_t bytes, double parseMs) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        for (auto& d : ds) {
+            if (d.index < 0) continue;
+            if (d.index >= (int)m_byIndex.size()) m_byIndex.resize(d.index + 1);
+            m_byIndex[d.index] = std::make_shared<const GpuDetail>(std::move(d));
+        }
+        ++m_runs; m_bytes += bytes; m_parseMs += parseMs;
+    }
+
+    GpuDetailPtr get(int index) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        return (index >= 0 && index < (int)m_byIndex.size()) ? m_byIndex[index] : nullptr;
+    }
+
+    // Sleeps for `interval`; false on shutdown.
+    bool wait(std::chrono::seconds interval) {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        return !m_cv.wait_for(lk, interval, [&] { return m_stop; });
+    }
+
+    void stop() { std::lock_guard<std::mutex> lk(m_mutex); m_stop = true; m_cv.notify_all(); }
+
+    void print(FILE* f) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (!m_runs) return;
+        if (!m_bytes) fprintf(f, "detail: %llu simulated runs\n", (unsigned long long)m_runs);
+        else fprintf(f, "detail: %llu runs, %.0f KB each, scanned in %.2f ms (%.0f MB/s)\n",
+                     (unsigned long long)m_runs, m_bytes / 1024.0 / m_runs, m_parseMs / m_runs,
+                     m_parseMs > 0 ? m_bytes / 1048576.0 / (m_parseMs / 1000) : 0.0);
+        for (const auto& d : m_byIndex) {
+            if (!d) continue;
+            fprintf(f, "  gpu %d: %s\n", d->index, describeDetail(*d).c_str());
+            for (const auto& m : d->mig) fprintf(f, "    mig %d: %s\n", m.index, describeMigDevice(m).c_str());
+        }
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<GpuDetailPtr> m_byIndex;
+    uint64_t m_runs = 0, m_bytes = 0;
+    double m_parseMs = 0;
+    bool m_stop = false;
+};
+
+static DetailTable g_details;
+
+// ─── Host metrics ───────────────────────────────────────────────────────────
+// CPU, memory, load, network and disk of the machine the GPUs are in, so a
+// GPU at 30 % can be read against a saturated CPU or NUMA node. Sampled
+// locally on Linux and carried to viewers in the frame stream.
+enum HostMetric { H_CPU, H_MEM_USED, H_MEM_TOTAL, H_LOAD, H_NET_RX, H_NET_TX, H_DISK_READ, H_DISK_WRITE, H_COUNT };
+static const char* const HOST_FIELDS[H_COUNT] = {
+    "cpu.util", "memory.used", "memory.total", "load.1m", "net.rx", "net.tx", "disk.read", "disk.write"
+};
+// %, MiB, MiB, runnable tasks, then KiB/s
+
+struct HostSample {
+    int host = 0;
+    int64_t ts = 0;
+    double v[H_COUNT];
+    std::vector<double> nodeCpu;    // % busy per NUMA node
+    HostSample() { for (double& x : v) x = NAN; }
+};
+
+// Latest sample per host; `version` moves on every update so stream writers
+// can tell when to send.
+class HostTable {
+public:
+    void update(const HostSample& s) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (s.host < 0) return;
+        if (s.host >= (int)m_hosts.size()) m_hosts.resize(s.host + 1);
+        m_hosts[s.host] = s;
+        ++m_version;
+    }
+
+    bool get(int host, HostSample& out) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (host < 0 || host >= (int)m_hosts.size() || !m_hosts[host].ts) return false;
+        out = m_hosts[host];
+        return true;
+    }
+
+    std::vector<HostSample> all() const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        std::vector<HostSample> out;
+        for (const auto& h : m_hosts) if (h.ts) out.push_back(h);
+        return out;
+    }
+
+    uint64_t version() const { std::lock_guard<std::mutex> lk(m_mutex); return m_version; }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<HostSample> m_hosts;
+    uint64_t m_version = 0;
+};
+
+static HostTable g_hostMetrics;
+
+static std::string describeHost(const HostSample& h) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "cpu %.0f%%", h.v[H_CPU]);
+    std::string s = buf;
+    if (h.nodeCpu.size() > 1) {
+        s += " (";
+        for (size_t i = 0; i < h.nodeCpu.size(); ++i) {
+            snprintf(buf, sizeof(buf), "%snode%zu %.0f%%", i ? ", " : "", i, h.nodeCpu[i]);
+            s += buf;
+        }
+        s += ")";
+    }
+    snprintf(buf, sizeof(buf), "  ·  mem %.1f / %.1f GiB  ·  load %.2f  ·  net %.1f / %.1f MB/s  ·  disk %.1f / %.1f MB/s",
+             h.v[H_MEM_USED] / 1024, h.v[H_MEM_TOTAL] / 1024, h.v[H_LOAD], h.v[H_NET_RX] / 1024, h.v[H_NET_TX] / 1024,
+             h.v[H_DISK_READ] / 1024, h.v[H_DISK_WRITE] / 1024);
+    return s + buf;
+}
+
+#ifndef _WIN32
+// Reads /proc and /sys through descriptors opened once and re-read with
+// pread into buffers sized at open, parsed in place: a sample is a handful
+// of syscalls, no allocations and no processes. `root` replaces "/" so a
+// fixture directory can stand in for the real files. Rates are over the
+// time between samples; the first sample only primes them.
+class HostSampler {
+public:
+    static constexpr int64_t HOST_MIN_INTERVAL_MS = 200;
+
+    ~HostSampler() { close(); }
+
+    bool open(const std::string& root, int host) {
+        m_host = host;
+        for (int f = 0; f < PF_COUNT; ++f) {
+            m_fd[f] = ::open((root + PROC_FILES[f]).c_str(), O_RDONLY | O_CLOEXEC);
+            if (m_fd[f] < 0) { close(); return false; }
+            m_buf[f].resize(16384);
+        }
+        // CPU -> NUMA node from node*/cpulist; one node if there is no NUMA.
+        std::string nodes = root + "/sys/devices/system/node";
+        if (DIR* d = opendir(nodes.c_str())) {
+            while (dirent* e = readdir(d)) {
+                int node;
+                if (sscanf(e->d_name, "node%d", &node) != 1) continue;
+                FILE* f = fopen((nodes + "/" + e->d_name + "/cpulist").c_str(), "r");
+                if (!f) continue;
+                char list[4096] = {};
+                if (fgets(list, sizeof(list), f)) {
+                    // "0-15,32-47"
+                    for (char* q = list; *q >= '0' && *q <= '9'; ) {
+                        long a = strtol(q, &q, 10), b = a;
+                        if (*q == '-') b = strtol(q + 1, &q, 10);
+                        for (long c = a; c <= b && c < 65536; ++c) {
+                            if (c >= (long)m_cpuNode.size()) m_cpuNode.resize(c + 1, 0);
+                            m_cpuNode[c] = node;
+                        }
+                        m_nodes = std::max(m_nodes, node + 1);
+                        if (*q == ',') ++q;
+                    }
+                }
+                fclose(f);
+            }
+            closedir(d);
+        }
+        // Whole disks only, as listed in /sys/block, without loop and ram devices.
+        if (DIR* d = opendir((root + "/sys/block").c_str())) {
+            while (dirent* e = readdir(d))
+                if (e->d_name[0] != '.' && strncmp(e->d_name, "loop", 4) && strncmp(e->d_name, "ram", 3)) m_disks.push_back(e->d_name);
+            closedir(d);
+        }
+        m_busy.assign(m_nodes + 1, 0); m_total.assign(m_nodes + 1, 0);
+        m_prevBusy = m_busy; m_prevTotal = m_total;
+        return true;
+    }
+
+    void close() { for (int& fd : m_fd) if (fd >= 0) { ::close(fd); fd = -1; } }
+
+    // Takes a sample stamped `ts` into `out`; false until rates are primed
+    // or if a file could not be read.
+    bool sample(int64_t ts, HostSample& out) {
+        auto t0 = std::chrono::steady_clock::now();
+        const char* b[PF_COUNT]; const char* e[PF_COUNT];
+        for (int f = 0; f < PF_COUNT; ++f) if (!read(f, b[f], e[f])) return false;
+
+        std::fill(m_busy.begin(), m_busy.end(), 0); std::fill(m_total.begin(), m_total.end(), 0);
+        for (LineScanner ln{b[PF_STAT], e[PF_STAT]}; ln.next(); ) {
+            if (!ln.starts("cpu")) break;   // cpu lines come first; skip intr and the rest
+            uint64_t t[8] = {}, total = 0;
+            int cpu = ln.p[3] == ' ' ? -1 : (int)ln.u64(3);
+            ln.word();
+            for (uint64_t& x : t) total += x = ln.u64();
+            uint64_t busy = total - t[3] - t[4];            // less idle and iowait
+            int slot = cpu < 0 ? m_nodes : (cpu < (int)m_cpuNode.size() ? m_cpuNode[cpu] : 0);
+            m_busy[slot] += busy; m_total[slot] += total;
+        }
+
+        out = HostSample();
+        out.host = m_host; out.ts = ts;
+        double kbTotal = NAN, kbAvail = NAN;
+        for (LineScanner ln{b[PF_MEMINFO], e[PF_MEMINFO]}; ln.next(); ) {
+            if (ln.starts("MemTotal:")) kbTotal = (double)ln.u64(9);
+            else if (ln.starts("MemAvailable:")) { kbAvail = (double)ln.u64(13); break; }
+        }
+        out.v[H_MEM_TOTAL] = kbTotal / 1024;
+        out.v[H_MEM_USED] = (kbTotal - kbAvail) / 1024;
+        out.v[H_LOAD] = scanNumber(b[PF_LOADAVG], std::find(b[PF_LOADAVG], e[PF_LOADAVG], ' '));
+
+        uint64_t net[2] = {}, disk[2] = {};
+        for (LineScanner ln{b[PF_NETDEV], e[PF_NETDEV]}; ln.next(); ) {
+            const char* colon = (const char*)memchr(ln.p, ':', ln.end - ln.p);
+            if (!colon) continue;                           // the two header lines
+            const char* name = ln.p; while (*name == ' ') ++name;
+            if (colon - name == 2 && memcmp(name, "lo", 2) == 0) continue;
+            ln.p = colon + 1;
+            net[0] += ln.u64();                             // rx bytes
+            for (int i = 0; i < 7; ++i) ln.u64();
+            net[1] += ln.u64();                             // tx bytes
+        }
+        for (LineScanner ln{b[PF_DISKSTATS], e[PF_DISKSTATS]}; ln.next(); ) {
+            ln.u64(); ln.u64();
+            const char* nb; const char* ne; ln.word(nb, ne);
+            bool whole = false;
+            for (const auto& d : m_disks) if (d.size() == (size_t)(ne - nb) && memcmp(d.data(), nb, ne - nb) == 0) { whole = true; break; }
+            if (!whole) continue;
+            ln.u64(); ln.u64(); disk[0] += ln.u64();        // sectors read
+            ln.u64(); ln.u64(); ln.u64(); disk[1] += ln.u64();   // sectors written
+        }
+
+        bool primed = m_prevTs != 0 && ts > m_prevTs;
+        if (primed) {
+            auto pct = [&](int i) {
+                uint64_t dt = m_total[i] - m_prevTotal[i];
+                return dt ? 100.0 * (double)(m_busy[i] - m_prevBusy[i]) / (double)dt : NAN;
+            };
+            out.v[H_CPU] = pct(m_nodes);
+            out.nodeCpu.resize(m_nodes);
+            for (int i = 0; i < m_nodes; ++i) out.nodeCpu[i] = pct(i);
+            double secs = (ts - m_prevTs) / 1000.0;
+            out.v[H_NET_RX] = (net[0] - m_net[0]) / 1024.0 / secs;
+            out.v[H_NET_TX] = (net[1] - m_net[1]) / 1024.0 / secs;
+            out.v[H_DISK_READ] = (disk[0] - m_disk[0]) * 512 / 1024.0 / secs;
+            out.v[H_DISK_WRITE] = (disk[1] - m_disk[1]) * 512 / 1024.0 / secs;
+        }
+        m_prevBusy.swap(m_busy); m_prevTotal.swap(m_total);
+        m_net[0] = net[0]; m_net[1] = net[1]; m_disk[0] = disk[0]; m_disk[1] = disk[1];
+        m_prevTs = ts;
+        m_samples++;
+        m_ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        return primed;
+    }
+
+    // Samples into g_hostMetrics, at most every HOST_MIN_INTERVAL_MS.
+    void tick(int64_t ts) {
+        if (ts - m_prevTs < HOST_MIN_INTERVAL_MS) return;
+        HostSample h;
+        if (sample(ts, h)) g_hostMetrics.update(h);
+    }
+
+    void print(FILE* f) const {
+        if (!m_samples) return;
+        fprintf(f, "host sampler: %llu samples, %.1f us mean, %d NUMA nodes, %zu disks\n",
+                (unsigned long long)m_samples, m_ns / 1000.0 / m_samples, m_nodes, m_disks.size());
+    }
+
+private:
+    enum { PF_STAT, PF_MEMINFO, PF_LOADAVG, PF_NETDEV, PF_DISKSTATS, PF_COUNT };
+    static constexpr const char* PROC_FILES[PF_COUNT] = {
+        "/proc/stat", "/proc/meminfo", "/proc/loadavg", "/proc/net/dev", "/proc/diskstats"
+    };
+
+    // Whitespace-separated words of one line at a time, in place.
+    struct LineScanner {
+        const char* p; const char* end;
+        const char* eol = nullptr;      // end of the current line
+        bool next() {
+            if (eol) p = eol < end ? eol + 1 : end;
+            if (p >= end) return false;
+            eol = (const char*)memchr(p, '\n', end - p);
+            if (!eol) eol = end;
+            return true;
+        }
+        bool starts(const char* s) const { size_t n = strlen(s); return (size_t)(eol - p) >= n && memcmp(p, s, n) == 0; }
+        void word() { while (p < eol && *p != ' ') ++p; }
+        void word(const char*& b, const char*& e) {
+            while (p < eol && *p == ' ') ++p;
+            b = p; word(); e = p;
+        }
+        // Next unsigned number, after skipping `skip` bytes and any blanks.
+        uint64_t u64(size_t skip = 0) {
+            p += std::min(skip, (size_t)(eol - p));
+            while (p < eol && (*p < '0' || *p > '9')) ++p;
+            uint64_t v = 0;
+            while (p < eol && *p >= '0' && *p <= '9') v = v * 10 + (uint64_t)(*p++ - '0');
+            return v;
+        }
+    };
+
+    int m_host = 0, m_nodes = 1;
+    int m_fd[PF_COUNT] = {-1, -1, -1, -1, -1};
+    std::vector<char> m_buf[PF_COUNT];
+    std::vector<int> m_cpuNode;
+    std::vector<std::string> m_disks;
+    std::vector<uint64_t> m_busy, m_total, m_prevBusy, m_prevTotal;   // per node, then the machine
+    uint64_t m_net[2] = {}, m_disk[2] = {};
+    int64_t m_prevTs = 0;
+    uint64_t m_samples = 0, m_ns = 0;
+
+    // Whole file into its buffer, doubling it if the file outgrew it.
+    bool read(int f, const char*& b, const char*& e) {
+        for (;;) {
+            ssize_t n = pread(m_fd[f], m_buf[f].data(), m_buf[f].size(), 0);
+            if (n < 0) return false;
+            if ((size_t)n < m_buf[f].size()) { b = m_buf[f].data(); e = b + n; return true; }
+            m_buf[f].resize(m_buf[f].size() * 2);
+        }
+    }
+};
+#endif
+
+// ─── Tick assembly ──────────────────────────────────────────────────────────
+// One snapshot per nvidia-smi loop iteration, covering every known GPU.
+struct FleetSnapshot {
+    uint64_t seq = 0;
+    int64_t timestampMs = -1;      // source time of the tick's first line
+    std::vector<GpuSample> gpus;   // ordered by index
+};
+using SnapshotPtr = std::shared_ptr<const FleetSnapshot>;
+
+// Groups per-GPU lines into ticks. A tick closes when a GPU repeats, when a
+// line's timestamp is more than half an interval past the tick start, or as
+// soon as all `expected` GPUs have reported. GPUs missing from a tick are
+// carried over from the previous snapshot marked stale, and dropped after
+// MAX_STALE_TICKS; GPUs never seen before are simply added.
+class TickAssembler {
+public:
+    static constexpr int MAX_STALE_TICKS = 10;
+
+    explicit TickAssembler(int intervalMs) : m_gapMs(intervalMs / 2) {}
+
+    // Returns a snapshot when `s` (or the tick it completes) closes a tick.
+    SnapshotPtr add(int64_t ts, const GpuSample& s, int expected) {
+        SnapshotPtr out;
+        bool repeat = std::any_of(m_pending.begin(), m_pending.end(),
+                                  [&](const GpuSample& p) { return p.index == s.index; });
+        bool late = m_tickTs >= 0 && ts >= 0 && ts - m_tickTs > m_gapMs;
+        if (!m_pending.empty() && (repeat || late)) out = emit();
+        if (m_pending.empty()) m_tickTs = ts;
+        m_pending.push_back(s);
+        if (!out && expected > 0 && (int)m_pending.size() >= expected) out = emit();
+        return out;
+    }
+
+private:
+    int m_gapMs;
+    int64_t m_tickTs = -1;
+    uint64_t m_seq = 0;
+    std::vector<GpuSample> m_pending;
+    std::vector<GpuSample> m_last;
+    std::vector<int> m_staleTicks;   // parallel to m_last
+
+    SnapshotPtr emit() {
+        auto snap = std::make_shared<FleetSnapshot>();
+        snap->seq = ++m_seq;
+        snap->timestampMs = m_tickTs;
+        std::sort(m_pending.begin(), m_pending.end(),
+                  [](const GpuSample& a, const GpuSample& b) { return a.index < b.index; });
+
+        std::vector<int> staleTicks;
+        size_t i = 0, j = 0;
+        while (i < m_pending.size() || j < m_last.size()) {
+            if (j == m_last.size() || (i < m_pending.size() && m_pending[i].index <= m_last[j].index)) {
+                if (j < m_last.size() && m_last[j].index == m_pending[i].index) ++j;
+                snap->gpus.push_back(m_pending[i++]);
+                staleTicks.push_back(0);
+            } else {
+                if (m_staleTicks[j] < MAX_STALE_TICKS) {
+                    snap->gpus.push_back(m_last[j]);
+                    snap->gpus.back().stale = true;
+                    staleTicks.push_back(m_staleTicks[j] + 1);
+                }
+                ++j;
+            }
+        }
+        m_last = snap->gpus;
+        m_staleTicks.swap(staleTicks);
+        m_pending.clear();
+        m_tickTs = -1;
+        return snap;
+    }
+};
+
+// Holds the latest snapshot. Sinks run on the reader thread for every tick;
+// the UI gets at most one notification in flight and always reads the newest.
+// The sinks have their own lock, so a take() waits for the newest snapshot
+// to be stored, never for the sinks to write, send or queue it.
+class SnapshotHub {
+public:
+    using Sink = std::function<void(const FleetSnapshot&)>;
+
+    void setNotify(std::function<void()> fn) { m_notify = std::move(fn); }
+    void addSink(Sink s) { std::lock_guard<std::mutex> lk(m_sinkMutex); m_sinks.push_back(std::move(s)); }
+
+    // For a display that draws fewer frames than there are ticks: take() then
+    // returns, per GPU and metric, the value furthest from what the previous
+    // take showed among the ticks since, so a spike or a dip shorter than a
+    // frame still reaches the screen. Ticks older than a second are dropped
+    // from the reduction. Sinks see every tick either way.
+    void keepExtremes() { std::lock_guard<std::mutex> lk(m_mutex); m_extremes = true; }
+
+    void publish(SnapshotPtr snap) {
+        auto t0 = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_latest = snap;
+            if (m_extremes) mergeExtremes(*snap, t0);
+        }
+        {
+            std::lock_guard<std::mutex> lk(m_sinkMutex);
+            for (auto& sink : m_sinks) sink(*snap);
+            uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+            ++m_published; m_sinkNs += ns; m_sinkWorstNs = std::max(m_sinkWorstNs, ns);
+        }
+        if (m_notify && !m_notified.exchange(true)) m_notify();
+    }
+
+    SnapshotPtr take() {
+        m_notified = false;
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (!m_extremes) return m_latest;
+        if (m_pending) { m_shown = std::move(m_pending); m_pending.reset(); }
+        return m_shown;
+    }
+
+    // Sink cost per tick; a worst case near the sample interval means the
+    // source is being held up.
+    void print(FILE* f) {
+        std::lock_guard<std::mutex> lk(m_sinkMutex);
+        fprintf(f, "hub: %llu ticks, sinks %.1f us mean, %.1f us worst per tick\n", (unsigned long long)m_published,
+                m_published ? m_sinkNs / 1e3 / m_published : 0.0, m_sinkWorstNs / 1e3);
+    }
+
+private:
+    std::mutex m_mutex;                          // the snapshots below
+    std::mutex m_sinkMutex;                      // m_sinks and their cost
+    std::function<void()> m_notify;
+    SnapshotPtr m_latest, m_shown;
+    std::shared_ptr<FleetSnapshot> m_pending;    // reduction since the last take
+    std::chrono::steady_clock::time_point m_pendingSince;
+    std::vector<Sink> m_sinks;
+    std::atomic<bool> m_notified{false};
+    bool m_extremes = false;
+    uint64_t m_published = 0, m_sinkNs = 0, m_sinkWorstNs = 0;
+
+    void mergeExtremes(const FleetSnapshot& snap, std::chrono::steady_clock::time_point now) {
+        if (!m_pending || !m_shown || now - m_pendingSince > std::chrono::seconds(1)
+            || m_pending->gpus.size() != snap.gpus.size() || m_shown->gpus.size() != snap.gpus.size()) {
+            m_pending = std::make_shared<FleetSnapshot>(snap);
+            m_pendingSince = now;
+            return;
+        }
+        m_pending->seq = snap.seq; m_pending->timestampMs = snap.timestampMs;
+        for (size_t i = 0; i < snap.gpus.size(); ++i) {
+            const GpuSample& s = snap.gpus[i];
+            const GpuSample& ref = m_shown->gpus[i];
+            GpuSample& d = m_pending->gpus[i];
+            if (s.index != d.index || s.index != ref.index || d.stale) { d = s; continue; }
+            if (s.stale) continue;
+            for (int m = 0; m < M_COUNT; ++m) {
+                double v = s.v[m];
+                if (std::isnan(v)) continue;
+                if (std::isnan(d.v[m]) || std::isnan(ref.v[m]) || fabs(v - ref.v[m]) > fabs(d.v[m] - ref.v[m])) d.v[m] = v;
+            }
+        }
+    }
+};
+
+static SnapshotHub g_hub;
+
+// Bytes read from the source and time spent turning them into snapshots;
+// printed on exit by --stats.
+struct SourceStats {
+    std::atomic<uint64_t> bytes{0}, ticks{0}, decodeNs{0};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    void add(size_t n, std::chrono::steady_clock::time_point t0) {
+        bytes += n;
+        decodeNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+    }
+
+    void print(FILE* f) const {
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t t = ticks;
+        fprintf(f, "source: %llu bytes, %llu ticks in %.1f s (%.0f bytes/hour), %.0f ns decode per tick\n",
+                (unsigned long long)bytes.load(), (unsigned long long)t, secs,
+                secs > 0 ? bytes * 3600.0 / secs : 0.0, t ? (double)decodeNs / t : 0.0);
+    }
+};
+
+static SourceStats g_sourceStats;
+
+// ─── Rolling statistics ─────────────────────────────────────────────────────
+// Source time of a snapshot, or the local clock if the source has none.
+static int64_t snapshotTimeMs(const FleetSnapshot& snap) {
+    if (snap.timestampMs >= 0) return snap.timestampMs;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Growable ring of sample sequence numbers, used as a monotonic deque.
+// Never shrinks, so steady state does not allocate.
+class SeqRing {
+public:
+    bool empty() const { return m_size == 0; }
+    uint64_t front() const { return m_buf[m_head]; }
+    uint64_t back() const { return m_buf[(m_head + m_size - 1) & (m_buf.size() - 1)]; }
+    void pop_front() { m_head = (m_head + 1) & (m_buf.size() - 1); --m_size; }
+    void pop_back() { --m_size; }
+    void push_back(uint64_t v) {
+        if (m_size == m_buf.size()) grow();
+        m_buf[(m_head + m_size++) & (m_buf.size() - 1)] = v;
+    }
+
+private:
+    std::vector<uint64_t> m_buf = std::vector<uint64_t>(8);
+    size_t m_head = 0, m_size = 0;
+
+    void grow() {
+        std::vector<uint64_t> nb(m_buf.size() * 2);
+        for (size_t i = 0; i < m_size; ++i) nb[i] = m_buf[(m_head + i) & (m_buf.size() - 1)];
+        m_buf.swap(nb); m_head = 0;
+    }
+};
+
+struct WindowStats { double min = NAN, max = NAN, mean = NAN, stddev = NAN; uint32_t n = 0; };
+
+// Min, max, mean and stddev of every metric of one GPU over several sliding
+// time windows. Samples live once in a ring sized for the longest window;
+// each window keeps running sums (shifted by a per-lane reference value to
+// limit cancellation) and monotonic deques for min and max, so an update is
+// O(1) amortized per metric per window. Adding and evicting leaves rounding
+// in the sums, and a level shift moves the data away from the reference, so
+// after as many updates as the lane holds its sums are recomputed from the
+// ring around the current mean: still O(1) amortized. If samples arrive
+// faster than `intervalMs`, the oldest ones are evicted early rather than
+// growing the ring.
+class RollingStats {
+public:
+    RollingStats(const std::vector<int>& windowsSec, int intervalMs) {
+        int64_t maxSpan = 0;
+        for (int w : windowsSec) {
+            Window win; win.spanMs = (int64_t)w * 1000;
+            m_windows.push_back(win);
+            maxSpan = std::max(maxSpan, win.spanMs);
+        }
+        m_cap = (size_t)(maxSpan / std::max(1, intervalMs)) * 5 / 4 + 8;
+        m_ts.resize(m_cap);
+        m_val.resize(m_cap * M_COUNT);
+    }
+
+    void add(int64_t ts, const double* v) {
+        uint64_t seq = m_seq++;
+        if (seq >= m_cap)
+            for (auto& w : m_windows) while (w.first + m_cap <= seq) evict(w);
+        size_t slot = seq % m_cap;
+        m_ts[slot] = ts;
+        for (int m = 0; m < M_COUNT; ++m) m_val[slot * M_COUNT + m] = (float)v[m];
+
+        for (auto& w : m_windows) {
+            for (int m = 0; m < M_COUNT; ++m) {
+                float x = m_val[slot * M_COUNT + m];
+                if (std::isnan(x)) continue;
+                Lane& l = w.lanes[m];
+                if (l.n == 0) { l.ref = x; l.sum = l.sumSq = 0; }
+                double d = x - l.ref;
+                l.sum += d; l.sumSq += d * d; ++l.n;
+                while (!l.minQ.empty() && value(l.minQ.back(), m) >= x) l.minQ.pop_back();
+                l.minQ.push_back(seq);
+                while (!l.maxQ.empty() && value(l.maxQ.back(), m) <= x) l.maxQ.pop_back();
+                l.maxQ.push_back(seq);
+            }
+            while (w.first < seq && m_ts[w.first % m_cap] <= ts - w.spanMs) evict(w);
+            for (int m = 0; m < M_COUNT; ++m) {
+                Lane& l = w.lanes[m];
+                if (l.n && ++l.updates >= std::max<uint32_t>(l.n, 64)) rebase(w, l, m, seq);
+            }
+        }
+    }
+
+    WindowStats get(int metric, size_t window) const {
+        WindowStats r;
+        const Lane& l = m_windows[window].lanes[metric];
+        if (l.n == 0) return r;
+        double mean = l.sum / l.n;
+        r.n = l.n;
+        r.mean = l.ref + mean;
+        r.stddev = std::sqrt(std::max(0.0, l.sumSq / l.n - mean * mean));
+        r.min = value(l.minQ.front(), metric);
+        r.max = value(l.maxQ.front(), metric);
+        return r;
+    }
+
+private:
+    struct Lane { double ref = 0, sum = 0, sumSq = 0; uint32_t n = 0, updates = 0; SeqRing minQ, maxQ; };
+    struct Window { int64_t spanMs = 0; uint64_t first = 0; Lane lanes[M_COUNT]; };
+
+    size_t m_cap;
+    uint64_t m_seq = 0;
+    std::vector<int64_t> m_ts;      // ring of sample times
+    std::vector<float> m_val;       // ring of samples, M_COUNT per slot
+    std::vector<Window> m_windows;
+
+    float value(uint64_t seq, int m) const { return m_val[(seq % m_cap) * M_COUNT + m]; }
+
+    void rebase(const Window& w, Lane& l, int m, uint64_t last) {
+        l.ref += l.sum / l.n;
+        l.sum = l.sumSq = 0; l.updates = 0;
+        for (uint64_t seq = w.first; seq <= last; ++seq) {
+            float x = value(seq, m);
+            if (std::isnan(x)) continue;
+            double d = x - l.ref;
+            l.sum += d; l.sumSq += d * d;
+        }
+    }
+
+    void evict(Window& w) {
+        uint64_t seq = w.first++;
+        for (int m = 0; m < M_COUNT; ++m) {
+            float x = value(seq, m);
+            if (std::isnan(x)) continue;
+            Lane& l = w.lanes[m];
+            double d = x - l.ref;
+            l.sum -= d; l.sumSq -= d * d; --l.n;
+            if (!l.minQ.empty() && l.minQ.front() == seq) l.minQ.pop_front();
+            if (!l.maxQ.empty() && l.maxQ.front() == seq) l.maxQ.pop_front();
+        }
+    }
+};
+
+// Rolling statistics for every GPU, fed from the snapshot stream. Stale
+// (carried-over) samples are not counted.
+class StatsTable {
+public:
+    void configure(const std::vector<int>& windowsSec, int intervalMs) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_windows = windowsSec; m_intervalMs = intervalMs; m_gpus.clear();
+    }
+
+    void add(const FleetSnapshot& snap) {
+        int64_t ts = snapshotTimeMs(snap);
+        std::lock_guard<std::mutex> lk(m_mutex);
+        for (const auto& g : snap.gpus) {
+            if (g.stale || g.index < 0) continue;
+            if (g.index >= (int)m_gpus.size()) m_gpus.resize(g.index + 1);
+            if (!m_gpus[g.index]) m_gpus[g.index].reset(new RollingStats(m_windows, m_intervalMs));
+            m_gpus[g.index]->add(ts, g.v);
+        }
+    }
+
+    // One entry per configured window; empty if the GPU has no samples yet.
+    std::vector<WindowStats> get(int index, int metric) const {
+        std::vector<WindowStats> out;
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (index < 0 || index >= (int)m_gpus.size() || !m_gpus[index]) return out;
+        for (size_t w = 0; w < m_windows.size(); ++w) out.push_back(m_gpus[index]->get(metric, w));
+        return out;
+    }
+
+    std::vector<int> windows() const { std::lock_guard<std::mutex> lk(m_mutex); return m_windows; }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<int> m_windows;
+    int m_intervalMs = 300;
+    std::vector<std::unique_ptr<RollingStats>> m_gpus;
+};
+
+static StatsTable g_stats;
+
+// ─── Quantile sketches ──────────────────────────────────────────────────────
+// DDSketch-style quantile summary with logarithmic buckets. Any quantile it
+// returns is within ALPHA (1%) relative error of the true sample at that
+// rank; values below MIN_VALUE are counted as 0 (absolute error < MIN_VALUE).
+// Sketches merge exactly by adding bucket counts, so per-GPU sketches
+// combine into fleet-level ones with the same guarantee. Buckets are a dense
+// range spanning the observed values (a GPU's utilization over an hour is a
+// few hundred bytes); beyond MAX_BINS the lowest buckets are folded together,
+// which only loosens the bound for the lowest quantiles.
+class QuantileSketch {
+public:
+    static constexpr double ALPHA = 0.01;
+    static constexpr double MIN_VALUE = 0.01;
+    static constexpr size_t MAX_BINS = 2048;
+
+    void add(double x) {
+        if (std::isnan(x)) return;
+        ++m_count;
+        if (x < MIN_VALUE) { ++m_zero; return; }
+        addBin((int)std::ceil(std::log(x) * INV_LOG_GAMMA), 1);
+    }
+
+    void merge(const QuantileSketch& o) {
+        m_count += o.m_count; m_zero += o.m_zero;
+        if (o.m_bins.empty()) return;
+        addBin(o.m_offset, 0);
+        addBin(o.m_offset + (int)o.m_bins.size() - 1, 0);
+        for (size_t i = 0; i < o.m_bins.size(); ++i)
+            if (o.m_bins[i]) addBin(o.m_offset + (int)i, o.m_bins[i]);
+    }
+
+    double quantile(double q) const {
+        if (m_count == 0) return NAN;
+        uint64_t rank = (uint64_t)(std::min(1.0, std::max(0.0, q)) * (double)(m_count - 1));
+        uint64_t seen = m_zero;
+        if (rank < seen) return 0;
+        for (size_t i = 0; i < m_bins.size(); ++i) {
+            seen += m_bins[i];
+            if (seen > rank) return value(m_offset + (int)i);
+        }
+        return value(m_offset + (int)m_bins.size() - 1);
+    }
+
+    uint64_t count() const { return m_count; }
+    size_t bytes() const { return sizeof(*this) + m_bins.capacity() * sizeof(uint32_t); }
+    void clear() { m_bins.clear(); m_count = m_zero = 0; m_offset = 0; }
+
+private:
+    static inline const double GAMMA = (1 + ALPHA) / (1 - ALPHA);
+    static inline const double INV_LOG_GAMMA = 1 / std::log(GAMMA);
+
+    std::vector<uint32_t> m_bins;   // m_bins[i] counts (gamma^(k-1), gamma^k], k = m_offset + i
+    int m_offset = 0;
+    uint64_t m_count = 0, m_zero = 0;
+
+    static double value(int k) { return 2 * std::pow(GAMMA, k) / (GAMMA + 1); }
+
+    void addBin(int k, uint32_t c) {
+        if (m_bins.empty()) { m_offset = k; m_bins.assign(1, 0); }
+        else if (k < m_offset) { m_bins.insert(m_bins.begin(), (size_t)(m_offset - k), 0); m_offset = k; }
+        else if (k - m_offset >= (int)m_bins.size()) m_bins.resize((size_t)(k - m_offset) + 1, 0);
+        uint32_t& b = m_bins[(size_t)(k - m_offset)];
+        b = (uint32_t)std::min<uint64_t>(UINT32_MAX, (uint64_t)b + c);
+        if (m_bins.size() > MAX_BINS) {
+            size_t extra = m_bins.size() - MAX_BINS;
+            for (size_t i = 0; i < extra; ++i)
+                m_bins[extra] = (uint32_t)std::min<uint64_t>(UINT32_MAX, (uint64_t)m_bins[extra] + m_bins[i]);
+            m_bins.erase(m_bins.begin(), m_bins.begin() + (ptrdiff_t)extra);
+            m_offset += (int)extra;
+        }
+    }
+};
+
+// Long-window percentiles for one GPU: a sketch per metric per time slot,
+// in two tiers (hourly for the last day, daily for the last week). A query
+// merges the slots covering the requested span from the finest tier that
+// reaches back far enough, so spans are rounded up to whole slots.
+class SketchHistory {
+public:
+    void add(int64_t ts, const double* v) {
+        for (auto& t : m_tiers) {
+            int64_t id = floorDiv(ts, t.slotMs);
+            Slot& s = t.slots[(size_t)(id % (int64_t)t.slots.size())];
+            if (s.id != id) { s.id = id; for (auto& q : s.q) q.clear(); }
+            for (int m = 0; m < M_COUNT; ++m) s.q[m].add(v[m]);
+        }
+        m_latest = std::max(m_latest, ts);
+    }
+
+    void collect(int metric, int64_t spanMs, int64_t nowMs, QuantileSketch& out) const {
+        const Tier* t = &m_tiers.back();
+        for (const auto& c : m_tiers)
+            if (c.slotMs * (int64_t)(c.slots.size() - 1) >= spanMs) { t = &c; break; }
+        int64_t last = floorDiv(nowMs, t->slotMs);
+        int64_t first = last - (spanMs + t->slotMs - 1) / t->slotMs;
+        for (const auto& s : t->slots)
+            if (s.id >= first && s.id <= last) out.merge(s.q[metric]);
+    }
+
+    int64_t latest() const { return m_latest; }
+
+    size_t bytes() const {
+        size_t n = sizeof(*this);
+        for (const auto& t : m_tiers)
+            for (const auto& s : t.slots)
+                for (const auto& q : s.q) n += q.bytes();
+        return n;
+    }
+
+private:
+    struct Slot { int64_t id = INT64_MIN; QuantileSketch q[M_COUNT]; };
+    struct Tier { int64_t slotMs; std::vector<Slot> slots; };
+
+    std::vector<Tier> m_tiers = {{3600000LL, std::vector<Slot>(25)}, {86400000LL, std::vector<Slot>(8)}};
+    int64_t m_latest = INT64_MIN;
+
+    static int64_t floorDiv(int64_t a, int64_t b) { return a / b - ((a % b) < 0 ? 1 : 0); }
+};
+
+// Percentile spans offered in the GUI and the headless summary.
+static const struct { int64_t ms; const char* label; } QUANTILE_SPANS[] = {
+    {86400000LL, "24h"}, {7 * 86400000LL, "7d"},
+};
+
+// Sketch history for every GPU, fed from the snapshot stream like StatsTable.
+class QuantileTable {
+public:
+    void add(const FleetSnapshot& snap) {
+        int64_t ts = snapshotTimeMs(snap);
+        std::lock_guard<std::mutex> lk(m_mutex);
+        for (const auto& g : snap.gpus) {
+            if (g.stale || g.index < 0) continue;
+            if (g.index >= (int)m_gpus.size()) m_gpus.resize(g.index + 1);
+            if (!m_gpus[g.index]) m_gpus[g.index].reset(new SketchHistory);
+            m_gpus[g.index]->add(ts, g.v);
+        }
+    }
+
+    // index < 0 merges every GPU.
+    QuantileSketch get(int index, int metric, int64_t spanMs) const {
+        QuantileSketch out;
+        std::lock_guard<std::mutex> lk(m_mutex);
+        int64_t now = INT64_MIN;
+        for (const auto& h : m_gpus) if (h) now = std::max(now, h->latest());
+        for (int i = 0; i < (int)m_gpus.size(); ++i)
+            if (m_gpus[i] && (index < 0 || i == index)) m_gpus[i]->collect(metric, spanMs, now, out);
+        return out;
+    }
+
+    void print(FILE* f) const {
+        for (const auto& span : QUANTILE_SPANS) {
+            for (int m = 0; m < M_COUNT; ++m) {
+                QuantileSketch q = get(-1, m, span.ms);
+                if (!q.count()) continue;
+                fprintf(f, "fleet %s %s: p50 %.2f  p95 %.2f  p99 %.2f  (%llu samples)\n", span.label,
+                        METRIC_FIELDS[m], q.quantile(0.5), q.quantile(0.95), q.quantile(0.99),
+                        (unsigned long long)q.count());
+            }
+        }
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<SketchHistory>> m_gpus;
+};
+
+static QuantileTable g_quantiles;
+
+// ─── Fleet store ────────────────────────────────────────────────────────────
+// Latest value of every metric for every GPU, one cache-line-aligned column
+// per metric (structure of arrays, indexed by GPU index, NaN = no value),
+// plus per-host and fleet-wide aggregates. Each tick applies only the
+// per-GPU deltas to the aggregates; the SIMD full recompute is used to
+// verify them and, every RESYNC_TICKS, to shed floating-point drift.
+template <class T> struct CacheAligned {
+    using value_type = T;
+    CacheAligned() = default;
+    template <class U> CacheAligned(const CacheAligned<U>&) {}
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(64))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(64)); }
+    template <class U> bool operator==(const CacheAligned<U>&) const { return true; }
+    template <class U> bool operator!=(const CacheAligned<U>&) const { return false; }
+};
+template <class T> using AlignedVector = std::vector<T, CacheAligned<T>>;
+
+enum { C_MEM_FREE = M_COUNT, C_COUNT };   // columns: the metrics, then memory.total - memory.used
+static constexpr double HOT_TEMP = 80;    // °C
+
+struct FleetAggregate {
+    double sum[C_COUNT] = {};
+    uint32_t n[C_COUNT] = {};    // GPUs with a value in the column
+    uint32_t gpus = 0, hot = 0;  // GPUs present; GPUs at or above HOT_TEMP
+
+    double mean(int c) const { return n[c] ? sum[c] / n[c] : NAN; }
+};
+
+// Sum and count of the non-NaN values in p[0, n), and how many are >= hot.
+// p is a host's first GPU, so it is only 8-byte aligned when G is odd.
+static void sumColumn(const double* p, size_t n, double& sum, uint32_t& count, double hot, uint32_t* hotCount) {
+    size_t i = 0;
+    double s = 0; uint32_t c = 0, h = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128d one = _mm_set1_pd(1.0), th = _mm_set1_pd(hot);
+    __m128d vs = _mm_setzero_pd(), vc = _mm_setzero_pd(), vh = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(p + i);
+        __m128d ok = _mm_cmpord_pd(x, x);
+        vs = _mm_add_pd(vs, _mm_and_pd(ok, x));
+        vc = _mm_add_pd(vc, _mm_and_pd(ok, one));
+        vh = _mm_add_pd(vh, _mm_and_pd(_mm_cmpge_pd(x, th), one));
+    }
+    double ls[2], lc[2], lh[2];
+    _mm_storeu_pd(ls, vs); _mm_storeu_pd(lc, vc); _mm_storeu_pd(lh, vh);
+    s = ls[0] + ls[1]; c = (uint32_t)(lc[0] + lc[1]); h = (uint32_t)(lh[0] + lh[1]);
+#endif
+    for (; i < n; ++i) {
+        if (std::isnan(p[i])) continue;
+        s += p[i]; ++c;
+        if (p[i] >= hot) ++h;
+    }
+    sum = s; count = c;
+    if (hotCount) *hotCount = h;
+}
+
+class FleetStore {
+public:
+    static constexpr unsigned RESYNC_TICKS = 1024;
+
+    void apply(const FleetSnapshot& snap) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        int count = snap.gpus.empty() ? 0 : snap.gpus.back().index + 1;
+        bool grew = count > m_size;
+        if (grew) resize(count);
+        if (grew || m_ticks % 64 == 0) refreshCapacity();
+        int next = 0;
+        for (const auto& g : snap.gpus) {
+            if (g.index < next || g.index >= m_size) continue;
+            for (; next < g.index; ++next) setGpu(next, nullptr);
+            setGpu(g.index, g.v);
+            next = g.index + 1;
+        }
+        for (; next < m_size; ++next) setGpu(next, nullptr);
+        if (++m_ticks % RESYNC_TICKS == 0) resync();
+    }
+
+    FleetAggregate fleet() const { std::lock_guard<std::mutex> lk(m_mutex); return m_fleet; }
+
+    FleetAggregate host(int h) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        return h >= 0 && h < (int)m_hosts.size() ? m_hosts[h] : FleetAggregate();
+    }
+
+    int hostCount() const { std::lock_guard<std::mutex> lk(m_mutex); return (int)m_hosts.size(); }
+
+    // Largest difference between the incremental sums and a full recompute,
+    // relative to the recomputed magnitude; counts must match exactly.
+    double verify() const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        double worst = 0;
+        for (int h = 0; h <= (int)m_hosts.size(); ++h) {
+            const FleetAggregate& a = h < (int)m_hosts.size() ? m_hosts[h] : m_fleet;
+            FleetAggregate r = h < (int)m_hosts.size() ? recompute(hostBegin(h), hostEnd(h)) : recompute(0, m_size);
+            if (r.gpus != a.gpus || r.hot != a.hot) return INFINITY;
+            for (int c = 0; c < C_COUNT; ++c) {
+                if (r.n[c] != a.n[c]) return INFINITY;
+                worst = std::max(worst, std::fabs(r.sum[c] - a.sum[c]) / std::max(1.0, std::fabs(r.sum[c])));
+            }
+        }
+        return worst;
+    }
+
+    void print(FILE* f) const {
+        FleetAggregate a = fleet();
+        fprintf(f, "fleet: %u GPUs on %d hosts, power %.1f W, mean util %.1f %%, %u at or above %.0f C, %.0f MiB free\n",
+                a.gpus, hostCount(), a.sum[M_POWER], a.mean(M_UTIL), a.hot, HOT_TEMP, a.sum[C_MEM_FREE]);
+        double drift = verify();
+        fprintf(f, "fleet aggregates vs full recompute: %s (max relative difference %.3g)\n",
+                drift < 1e-9 ? "ok" : "MISMATCH", drift);
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    AlignedVector<double> m_col[C_COUNT];
+    AlignedVector<double> m_memTotal;
+    AlignedVector<uint8_t> m_present;
+    std::vector<FleetAggregate> m_hosts;
+    FleetAggregate m_fleet;
+    int m_size = 0;
+    unsigned m_ticks = 0;
+
+    int hostBegin(int h) const { return g_gpusPerHost > 0 ? h * g_gpusPerHost : 0; }
+    int hostEnd(int h) const { return g_gpusPerHost > 0 ? std::min(m_size, (h + 1) * g_gpusPerHost) : m_size; }
+
+    void resize(int count) {
+        size_t cap = ((size_t)count + 7) & ~(size_t)7;   // whole cache lines
+        for (auto& c : m_col) c.resize(cap, NAN);
+        m_memTotal.resize(cap, NAN);
+        m_present.resize(cap, 0);
+        m_hosts.resize(hostOf(count - 1) + 1);
+        m_size = count;
+    }
+
+    // memory.total comes from the identity table, which changes rarely.
+    void refreshCapacity() {
+        for (int i = 0; i < m_size; ++i) {
+            GpuIdentityPtr id = g_identities.get(i);
+            double total = id ? id->memTotal : NAN;
+            if (total == m_memTotal[i] || (std::isnan(total) && std::isnan(m_memTotal[i]))) continue;
+            m_memTotal[i] = total;
+            setCell(i, C_MEM_FREE, total - m_col[M_MEM_USED][i]);
+        }
+    }
+
+    void setGpu(int i, const double* v) {
+        FleetAggregate& host = m_hosts[hostOf(i)];
+        uint8_t present = v != nullptr;
+        if (present != m_present[i]) {
+            int d = present ? 1 : -1;
+            m_present[i] = present;
+            host.gpus += d; m_fleet.gpus += d;
+        }
+        for (int c = 0; c < M_COUNT; ++c) setCell(host, i, c, v ? v[c] : NAN);
+        setCell(host, i, C_MEM_FREE, m_memTotal[i] - m_col[M_MEM_USED][i]);
+    }
+
+    void setCell(int i, int c, double x) { setCell(m_hosts[hostOf(i)], i, c, x); }
+
+    void setCell(FleetAggregate& host, int i, int c, double x) {
+        double old = m_col[c][i];
+        if (old == x || (std::isnan(old) && std::isnan(x))) return;
+        m_col[c][i] = x;
+        for (FleetAggregate* a : {&host, &m_fleet}) {
+            if (!std::isnan(old)) { a->sum[c] -= old; --a->n[c]; }
+            if (!std::isnan(x))   { a->sum[c] += x;   ++a->n[c]; }
+            if (c == M_TEMP) a->hot += (x >= HOT_TEMP) - (old >= HOT_TEMP);
+        }
+    }
+
+    FleetAggregate recompute(int b, int e) const {
+        FleetAggregate r;
+        for (int c = 0; c < C_COUNT; ++c)
+            sumColumn(m_col[c].data() + b, (size_t)(e - b), r.sum[c], r.n[c], HOT_TEMP, c == M_TEMP ? &r.hot : nullptr);
+        for (int i = b; i < e; ++i) r.gpus += m_present[i];
+        return r;
+    }
+
+    void resync() {
+        for (int h = 0; h < (int)m_hosts.size(); ++h) m_hosts[h] = recompute(hostBegin(h), hostEnd(h));
+        m_fleet = recompute(0, m_size);
+    }
+};
+
+static FleetStore g_fleet;
+
+// ─── Compressed history ─────────────────────────────────────────────────────
+// Per-GPU metric history for graphs and range queries. The newest samples sit
+// in an uncompressed head; every HISTORY_SEGMENT samples the head is sealed
+// into a Gorilla-style segment (Pelkonen et al., VLDB 2015): timestamps as
+// delta-of-delta with variable-width buckets, values as the XOR of
+// consecutive fixed-point hundredths with leading/trailing-zero windows.
+// XOR runs on the integers rather than on doubles because decimal fractions
+// have long binary mantissas. Each segment keeps one bit stream per metric,
+// so reading a range decodes only the timestamps and the asked-for metric
+// of the segments that overlap it.
+class BitWriter {
+public:
+    // Low `n` bits of `v`, least significant first.
+    void put(uint64_t v, int n) {
+        if (n == 0) return;
+        if (n < 64) v &= (1ull << n) - 1;
+        int used = (int)(m_bits & 63);
+        if (used == 0) m_words.push_back(0);
+        m_words.back() |= v << used;
+        if (used + n > 64) m_words.push_back(v >> (64 - used));
+        m_bits += n;
+    }
+    std::vector<uint64_t> take() { m_words.shrink_to_fit(); m_bits = 0; return std::move(m_words); }
+
+private:
+    std::vector<uint64_t> m_words;
+    uint64_t m_bits = 0;
+};
+
+class BitReader {
+public:
+    explicit BitReader(const std::vector<uint64_t>& w) : m_w(w.data()), m_n((uint64_t)w.size() * 64) {}
+    uint64_t get(int n) {
+        if (n == 0 || m_pos + n > m_n) { m_pos += n; return 0; }
+        uint64_t i = m_pos >> 6; int off = (int)(m_pos & 63);
+        uint64_t v = m_w[i] >> off;
+        if (off + n > 64) v |= m_w[i + 1] << (64 - off);
+        m_pos += n;
+        return n < 64 ? v & ((1ull << n) - 1) : v;
+    }
+    // Counts leading 1 bits up to `max`, consuming the terminating 0.
+    int ones(int max) { int k = 0; while (k < max && get(1)) ++k; return k; }
+
+private:
+    const uint64_t* m_w;
+    uint64_t m_n, m_pos = 0;
+};
+
+static void putTimestamp(BitWriter& w, int64_t dod) {
+    uint64_t z = ((uint64_t)dod << 1) ^ (uint64_t)(dod >> 63);
+    if (z == 0) w.put(0, 1);
+    else if (z < (1u << 7))  { w.put(0x1, 2); w.put(z, 7); }
+    else if (z < (1u << 9))  { w.put(0x3, 3); w.put(z, 9); }
+    else if (z < (1u << 12)) { w.put(0x7, 4); w.put(z, 12); }
+    else                     { w.put(0xf, 4); w.put(z, 64); }
+}
+
+static int64_t getTimestamp(BitReader& r) {
+    static const int WIDTH[5] = {0, 7, 9, 12, 64};
+    uint64_t z = r.get(WIDTH[r.ones(4)]);
+    return (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+}
+
+struct XorState { uint64_t prev = 0; int lead = -1, trail = 0; };
+
+static void putValue(BitWriter& w, XorState& s, uint64_t v) {
+    uint64_t x = v ^ s.prev;
+    s.prev = v;
+    if (x == 0) { w.put(0, 1); return; }
+    int lead = std::min(31, __builtin_clzll(x)), trail = __builtin_ctzll(x);
+    if (s.lead >= 0 && lead >= s.lead && trail >= s.trail) {
+        w.put(0x1, 2);                      // '1','0': reuse the previous window
+        w.put(x >> s.trail, 64 - s.lead - s.trail);
+        return;
+    }
+    int sig = 64 - lead - trail;
+    w.put(0x3, 2);                          // '1','1': new window
+    w.put((uint64_t)lead, 5); w.put((uint64_t)(sig - 1), 6);
+    w.put(x >> trail, sig);
+    s.lead = lead; s.trail = trail;
+}
+
+static uint64_t getValue(BitReader& r, XorState& s) {
+    if (r.get(1) == 0) return s.prev;
+    if (r.get(1) == 1) {
+        s.lead = (int)r.get(5);
+        int sig = (int)r.get(6) + 1;
+        s.trail = 64 - s.lead - sig;
+    }
+    s.prev ^= r.get(64 - s.lead - s.trail) << s.trail;
+    return s.prev;
+}
+
+struct HistoryPoint { int64_t ts; double v; };
+
+// Per-metric summary of a sealed segment, in hundredths, so aggregates over
+// whole segments can skip decoding. `n` counts the non-NaN samples.
+struct ColumnSummary { int64_t sum = 0; int32_t min = INT32_MAX, max = INT32_MIN; uint32_t n = 0; };
+
+// A run of rows handed to a scan consumer. Metric columns that were not asked
+// for are null; `index` is null when every row belongs to GPU `gpu`.
+struct ColumnChunk {
+    uint32_t rows = 0;
+    int gpu = -1;
+    const int64_t* ts = nullptr;
+    const int* index = nullptr;
+    const int64_t* q[M_COUNT] = {};
+};
+
+class GpuHistory {
+public:
+    static constexpr uint32_t HISTORY_SEGMENT = 256;
+
+    void add(int64_t ts, const double* v) {
+        m_headTs.push_back(ts);
+        for (int m = 0; m < M_COUNT; ++m) m_headQ[m].push_back(quantize(v[m]));
+        if (m_headTs.size() >= HISTORY_SEGMENT) seal();
+    }
+
+    // Appends the samples of `metric` with from <= ts <= to, oldest first.
+    void read(int metric, int64_t from, int64_t to, std::vector<HistoryPoint>& out) const {
+        auto it = std::lower_bound(m_segs.begin(), m_segs.end(), from,
+                                   [](const Segment& s, int64_t t) { return s.lastTs < t; });
+        for (; it != m_segs.end() && it->firstTs <= to; ++it) {
+            BitReader rt(it->ts), rv(it->val[metric]);
+            XorState xs;
+            xs.prev = rv.get(64);
+            int64_t ts = it->firstTs, delta = 0;
+            for (uint32_t i = 0; i < it->count; ++i) {
+                if (i) { delta += getTimestamp(rt); ts += delta; xs.prev = getValue(rv, xs); }
+                if (ts >= from && ts <= to) out.push_back({ts, dequantize((int64_t)xs.prev)});
+            }
+        }
+        for (size_t i = 0; i < m_headTs.size(); ++i)
+            if (m_headTs[i] >= from && m_headTs[i] <= to) out.push_back({m_headTs[i], dequantize(m_headQ[metric][i])});
+    }
+
+    // Hands the rows with from <= ts <= to to `rows`, oldest first, decoding
+    // only the metrics in `need`. A sealed segment that lies inside the range
+    // is first offered to `summary` with its time bounds, which returns true
+    // if that was enough.
+    template <typename Summary, typename Rows>
+    void scan(int gpu, int64_t from, int64_t to, const bool* need, Summary&& summary, Rows&& rows) const {
+        std::vector<int64_t> ts, q[M_COUNT];
+        ColumnSummary cs[M_COUNT];
+        auto it = std::lower_bound(m_segs.begin(), m_segs.end(), from,
+                                   [](const Segment& s, int64_t t) { return s.lastTs < t; });
+        for (; it != m_segs.end() && it->firstTs <= to; ++it) {
+            if (it->firstTs >= from && it->lastTs <= to) {
+                for (int m = 0; m < M_COUNT; ++m) if (need[m]) cs[m] = m_sum[m][it - m_segs.begin()];
+                if (summary(cs, it->count, it->firstTs, it->lastTs)) continue;
+            }
+            decodeTs(*it, ts);
+            for (int m = 0; m < M_COUNT; ++m) if (need[m]) decodeValues(*it, m, q[m]);
+            emit(gpu, ts.data(), q, need, ts.size(), from, to, rows);
+        }
+        emit(gpu, m_headTs.data(), m_headQ, need, m_headTs.size(), from, to, rows);
+    }
+
+    // Drops sealed segments that end before `ts`.
+    void trim(int64_t ts) {
+        size_t n = 0;
+        while (n < m_segs.size() && m_segs[n].lastTs < ts) ++n;
+        m_segs.erase(m_segs.begin(), m_segs.begin() + n);
+        for (auto& s : m_sum) s.erase(s.begin(), s.begin() + n);
+    }
+
+    size_t samples() const { return m_segs.size() * HISTORY_SEGMENT + m_headTs.size(); }
+
+    size_t bytes() const {
+        size_t n = sizeof(*this) + m_headTs.capacity() * sizeof(int64_t) * (1 + M_COUNT);
+        for (const auto& c : m_sum) n += c.capacity() * sizeof(ColumnSummary);
+        for (const auto& s : m_segs) {
+            n += sizeof(s) + s.ts.capacity() * 8;
+            for (const auto& v : s.val) n += v.capacity() * 8;
+        }
+        return n;
+    }
+
+private:
+    struct Segment {
+        int64_t firstTs, lastTs;
+        uint32_t count;
+        std::vector<uint64_t> ts, val[M_COUNT];
+    };
+    std::vector<Segment> m_segs;
+    std::vector<ColumnSummary> m_sum[M_COUNT];   // per segment, apart so scans touch only what they read
+    std::vector<int64_t> m_headTs, m_headQ[M_COUNT];
+
+    static void decodeTs(const Segment& s, std::vector<int64_t>& out) {
+        out.resize(s.count);
+        BitReader r(s.ts);
+        int64_t ts = s.firstTs, delta = 0;
+        out[0] = ts;
+        for (uint32_t i = 1; i < s.count; ++i) { delta += getTimestamp(r); out[i] = ts += delta; }
+    }
+
+    static void decodeValues(const Segment& s, int metric, std::vector<int64_t>& out) {
+        out.resize(s.count);
+        BitReader r(s.val[metric]);
+        XorState xs;
+        xs.prev = r.get(64);
+        out[0] = (int64_t)xs.prev;
+        for (uint32_t i = 1; i < s.count; ++i) out[i] = (int64_t)getValue(r, xs);
+    }
+
+    template <typename Rows>
+    static void emit(int gpu, const int64_t* ts, const std::vector<int64_t>* q, const bool* need, size_t n,
+                     int64_t from, int64_t to, Rows& rows) {
+        size_t b = std::lower_bound(ts, ts + n, from) - ts, e = std::upper_bound(ts, ts + n, to) - ts;
+        if (b >= e) return;
+        ColumnChunk c;
+        c.rows = (uint32_t)(e - b); c.gpu = gpu; c.ts = ts + b;
+        for (int m = 0; m < M_COUNT; ++m) if (need[m]) c.q[m] = q[m].data() + b;
+        rows(c);
+    }
+
+    void seal() {
+        Segment s;
+        s.firstTs = m_headTs.front(); s.lastTs = m_headTs.back();
+        s.count = (uint32_t)m_headTs.size();
+        BitWriter w;
+        int64_t delta = 0;
+        for (size_t i = 1; i < m_headTs.size(); ++i) {
+            int64_t d = m_headTs[i] - m_headTs[i - 1];
+            putTimestamp(w, d - delta);
+            delta = d;
+        }
+        s.ts = w.take();
+        for (int m = 0; m < M_COUNT; ++m) {
+            ColumnSummary cs;
+            for (int64_t q : m_headQ[m]) {
+                if (q == Q_NAN) continue;
+                cs.sum += q; ++cs.n;
+                cs.min = std::min(cs.min, (int32_t)q); cs.max = std::max(cs.max, (int32_t)q);
+            }
+            m_sum[m].push_back(cs);
+            XorState xs;
+            xs.prev = (uint64_t)m_headQ[m][0];
+            w.put(xs.prev, 64);
+            for (size_t i = 1; i < m_headQ[m].size(); ++i) putValue(w, xs, (uint64_t)m_headQ[m][i]);
+            s.val[m] = w.take();
+            m_headQ[m].clear();
+        }
+        m_headTs.clear();
+        m_segs.push_back(std::move(s));
+    }
+};
+
+// ─── History file ───────────────────────────────────────────────────────────
+// The recent past on disk, so a reopened window shows graphs at once. One
+// fixed-size file per host, memory-mapped; each GPU, by UUID, owns an entry
+// with two rings of buckets (5 s for the last hour, 60 s for six hours)
+// holding the mean, low and high of every metric. Opening maps the file and
+// finds each ring's head from the records' sequence words: nothing is parsed
+// or replayed. The bucket being filled is rewritten in place on every
+// sample, and the session keeps appending where the last one stopped.
+//
+// Crash consistency is per record: its sequence word turns odd before the
+// payload changes and even, one higher, after, and a checksum covers the
+// payload. A record that a kill -9 interrupted is rejected on the next open,
+// losing that one bucket, and the rest of its ring stands. Pages reach the
+// disk when the OS writes them back; after a power cut the checksum catches
+// torn records.
+class HistoryFile {
+public:
+    static constexpr uint32_t MAGIC = 0x4853564E;   // "NVSH"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr int ENTRIES = 64, TIERS = 2;
+    static constexpr int64_t BUCKET_MS[TIERS] = {5000, 60000};
+    static constexpr uint32_t RING[TIERS] = {720, 360};
+
+    ~HistoryFile() { close(); }
+
+    // Maps `path`, creating it or starting it over if it is not a history
+    // file of this layout. Fails if another process has it open.
+    bool open(const std::string& path) {
+        auto t0 = std::chrono::steady_clock::now();
+        m_path = path;
+#ifdef _WIN32
+        m_file = CreateFileW(toW(path).c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_file == INVALID_HANDLE_VALUE) { m_file = NULL; return false; }
+        m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)SIZE >> 32), (DWORD)SIZE, NULL);
+        if (m_mapping) m_base = (char*)MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, SIZE);
+#else
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (m_fd < 0) return false;
+        struct stat st;
+        if (flock(m_fd, LOCK_EX | LOCK_NB) == 0 && fstat(m_fd, &st) == 0
+            && (st.st_size == (off_t)SIZE || ftruncate(m_fd, SIZE) == 0)) {
+            void* p = mmap(NULL, SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+            if (p != MAP_FAILED) m_base = (char*)p;
+        }
+#endif
+        if (!m_base) { close(); return false; }
+        Header* h = header();
+        if (h->magic != MAGIC || h->version != VERSION || h->entries != ENTRIES || h->recordSize != sizeof(Record)
+            || h->entrySize != sizeof(Entry) || h->bucketMs[0] != BUCKET_MS[0] || h->bucketMs[1] != BUCKET_MS[1]
+            || h->ring[0] != RING[0] || h->ring[1] != RING[1]) {
+            memset(m_base, 0, HEADER_SIZE);      // entries are cleared when claimed; a fresh file stays sparse
+            for (int e = 0; e < ENTRIES; ++e) entry(e)->seq = 0;
+            h->version = VERSION; h->entries = ENTRIES; h->recordSize = sizeof(Record); h->entrySize = sizeof(Entry);
+            for (int t = 0; t < TIERS; ++t) { h->bucketMs[t] = BUCKET_MS[t]; h->ring[t] = RING[t]; }
+            __atomic_store_n(&h->magic, MAGIC, __ATOMIC_RELEASE);
+            m_reset = true;
+        }
+        for (int e = 0; e < ENTRIES; ++e) recover(e);
+        m_openMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (m_base) UnmapViewOfFile(m_base);
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file) CloseHandle(m_file);
+        m_mapping = m_file = NULL;
+#else
+        if (m_base) munmap(m_base, SIZE);
+        if (m_fd >= 0) ::close(m_fd);      // releases the lock
+        m_fd = -1;
+#endif
+        m_base = nullptr;
+    }
+
+    // Entry holding `key`, claiming one (free, else the stalest) if `create`; -1 if none.
+    int entryFor(const std::string& key, bool create) {
+        for (int e = 0; e < ENTRIES; ++e) if (m_state[e].valid && key == entry(e)->key) return e;
+        if (!create || !m_base) return -1;
+        int pick = 0;
+        for (int e = 0; e < ENTRIES; ++e) {
+            if (!m_state[e].valid) { pick = e; break; }
+            if (entry(e)->lastTs < entry(pick)->lastTs) pick = e;
+        }
+        Entry* en = entry(pick);
+        uint64_t seq = en->seq | 1;
+        __atomic_store_n(&en->seq, seq, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memset(en->records, 0, sizeof(en->records));
+        memset(en->key, 0, sizeof(en->key));
+        memcpy(en->key, key.data(), std::min(key.size(), sizeof(en->key) - 1));
+        en->lastTs = 0;
+        en->check = fnv(en->key, sizeof(en->key));
+        __atomic_store_n(&en->seq, seq + 1, __ATOMIC_RELEASE);
+        m_state[pick] = State();
+        m_state[pick].valid = true;
+        return pick;
+    }
+
+    // Folds one sample into the entry's open bucket of each tier.
+    void add(int e, int64_t ts, const double* v) {
+        Entry* en = entry(e);
+        State& st = m_state[e];
+        en->lastTs = ts;
+        for (int t = 0; t < TIERS; ++t) {
+            Ring& r = st.rings[t];
+            int64_t bucket = ts - ts % BUCKET_MS[t];
+            if (r.bucket != bucket) {
+                if (r.bucket != INT64_MIN) r.head = (r.head + 1) % RING[t];
+                r.bucket = bucket; r.n = 0;
+                for (int m = 0; m < M_COUNT; ++m) { r.sum[m] = 0; r.cnt[m] = 0; r.lo[m] = INFINITY; r.hi[m] = -INFINITY; }
+            }
+            ++r.n;
+            for (int m = 0; m < M_COUNT; ++m) {
+                if (std::isnan(v[m])) continue;
+                r.sum[m] += v[m]; ++r.cnt[m];
+                r.lo[m] = std::min(r.lo[m], (float)v[m]); r.hi[m] = std::max(r.hi[m], (float)v[m]);
+            }
+            Record& rec = en->records[offset(t) + r.head];
+            __atomic_store_n(&rec.seq, 2 * ++r.commit + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            rec.ts = bucket; rec.n = r.n;
+            for (int m = 0; m < M_COUNT; ++m) {
+                bool any = r.cnt[m] > 0;
+                rec.mean[m] = any ? (float)(r.sum[m] / r.cnt[m]) : NAN;
+                rec.lo[m] = any ? r.lo[m] : NAN; rec.hi[m] = any ? r.hi[m] : NAN;
+            }
+            rec.check = checksum(rec);
+            __atomic_store_n(&rec.seq, 2 * r.commit + 2, __ATOMIC_RELEASE);
+        }
+    }
+
+    // Calls fn(start, end, low, high) for the committed buckets of `metric`
+    // that start before `before` and overlap [from, to], oldest first: the
+    // 60 s tier up to where the 5 s tier begins, then the 5 s tier.
+    template <typename Fn>
+    void read(int e, int metric, int64_t before, int64_t from, int64_t to, Fn&& fn) const {
+        if (e < 0 || !m_base) return;
+        const Entry* en = entry(e);
+        int64_t fineStart = INT64_MAX;
+        forEach(en, 0, [&](const Record& r) { fineStart = std::min(fineStart, r.ts); });
+        for (int t = TIERS - 1; t >= 0; --t)
+            forEach(en, t, [&](const Record& r) {
+                int64_t end = r.ts + BUCKET_MS[t];
+                if ((t > 0 && r.ts >= fineStart) || r.ts >= before || end <= from || r.ts > to || std::isnan(r.lo[metric])) return;
+                fn(r.ts, std::min(end, before), r.lo[metric], r.hi[metric]);
+            });
+    }
+
+    void print(FILE* f) const {
+        if (!m_base) return;
+        int entries = 0;
+        for (const auto& st : m_state) entries += st.valid;
+        fprintf(f, "history file %s: %d GPUs, %llu buckets restored, %llu rejected%s, opened in %.2f ms\n", m_path.c_str(),
+                entries, (unsigned long long)m_restored, (unsigned long long)m_rejected, m_reset ? " (new file)" : "", m_openMs);
+    }
+
+private:
+    struct Record {
+        uint64_t seq;               // 0 never written, odd while being written, even once committed
+        int64_t ts;                 // bucket start, ms
+        uint32_t n, check;          // samples folded in; FNV-1a of everything after `check`, then ts and n
+        float mean[M_COUNT], lo[M_COUNT], hi[M_COUNT];
+    };
+    struct Entry {
+        uint64_t seq;               // as for records, around claiming the entry
+        int64_t lastTs;             // newest sample, to pick the stalest entry to reuse
+        char key[48];               // GPU UUID, or "#<index>" for sources without one
+        uint32_t check, pad;        // FNV-1a of key
+        Record records[RING[0] + RING[1]];
+    };
+    struct Header {
+        uint32_t magic, version, entries, recordSize;
+        uint64_t entrySize;
+        int64_t bucketMs[TIERS];
+        uint32_t ring[TIERS];
+    };
+    static constexpr size_t HEADER_SIZE = 4096;
+    static constexpr size_t SIZE = HEADER_SIZE + sizeof(Entry) * ENTRIES;
+
+    struct Ring {
+        int64_t bucket = INT64_MIN;     // start of the open bucket
+        uint32_t head = 0, n = 0;
+        uint64_t commit = 0;
+        double sum[M_COUNT]; uint32_t cnt[M_COUNT]; float lo[M_COUNT], hi[M_COUNT];
+    };
+    struct State { bool valid = false; Ring rings[TIERS]; };
+
+    std::string m_path;
+#ifdef _WIN32
+    HANDLE m_file = NULL, m_mapping = NULL;
+#else
+    int m_fd = -1;
+#endif
+    char* m_base = nullptr;
+    State m_state[ENTRIES];
+    uint64_t m_restored = 0, m_rejected = 0;
+    bool m_reset = false;
+    double m_openMs = 0;
+
+    Header* header() const { return (Header*)m_base; }
+    Entry* entry(int e) const { return (Entry*)(m_base + HEADER_SIZE) + e; }
+    static uint32_t offset(int tier) { return tier ? RING[0] : 0; }
+
+    static uint32_t fnv(const void* p, size_t n, uint32_t h = 2166136261u) {
+        for (size_t i = 0; i < n; ++i) h = (h ^ ((const unsigned char*)p)[i]) * 16777619u;
+        return h;
+    }
+    static uint32_t checksum(const Record& r) {
+        uint32_t h = fnv(r.mean, sizeof(r.mean) + sizeof(r.lo) + sizeof(r.hi));
+        h = fnv(&r.ts, sizeof(r.ts), h);
+        return fnv(&r.n, sizeof(r.n), h);
+    }
+    static bool committed(const Record& r, int tier) {
+        return r.seq && !(r.seq & 1) && r.ts % BUCKET_MS[tier] == 0 && r.check == checksum(r);
+    }
+
+    template <typename Fn>
+    static void forEach(const Entry* en, int t, Fn&& fn) {
+        const Record* ring = en->records + offset(t);
+        uint32_t head = 0;
+        for (uint32_t i = 1; i < RING[t]; ++i) if (ring[i].seq > ring[head].seq) head = i;
+        for (uint32_t k = 1; k <= RING[t]; ++k) {
+            const Record& r = ring[(head + k) % RING[t]];
+            if (committed(r, t)) fn(r);
+        }
+    }
+
+    // Finds each ring's head and resumes its newest bucket.
+    void recover(int e) {
+        Entry* en = entry(e);
+        State& st = m_state[e];
+        st = State();
+        if (!en->seq || (en->seq & 1) || en->check != fnv(en->key, sizeof(en->key)) || !en->key[0]) {
+            if (en->seq) memset(en, 0, sizeof(Entry));
+            return;
+        }
+        st.valid = true;
+        for (int t = 0; t < TIERS; ++t) {
+            Record* ring = en->records + offset(t);
+            Ring& r = st.rings[t];
+            uint64_t best = 0;
+            for (uint32_t i = 0; i < RING[t]; ++i) {
+                r.commit = std::max(r.commit, ring[i].seq / 2);
+                if (!ring[i].seq) continue;
+                if (!committed(ring[i], t)) { ++m_rejected; continue; }
+                ++m_restored;
+                if (ring[i].seq > best) { best = ring[i].seq; r.head = i; }
+            }
+            if (!best) continue;
+            const Record& last = ring[r.head];
+            r.bucket = last.ts; r.n = last.n;
+            for (int m = 0; m < M_COUNT; ++m) {
+                bool any = !std::isnan(last.mean[m]);
+                r.cnt[m] = any ? last.n : 0; r.sum[m] = any ? (double)last.mean[m] * last.n : 0;
+                r.lo[m] = any ? last.lo[m] : INFINITY; r.hi[m] = any ? last.hi[m] : -INFINITY;
+            }
+        }
+    }
+};
+
+// Where history files live when --history-dir is not given: the user's
+// local state directory, created if needed; empty if there is none.
+static std::string defaultHistoryDir() {
+#ifdef _WIN32
+    const char* base = getenv("LOCALAPPDATA");
+    if (!base || !*base) return "";
+    std::string d = std::string(base) + "\\nvidia-smi-gui";
+    CreateDirectoryW(toW(d).c_str(), NULL);
+#else
+    const char* xdg = getenv("XDG_STATE_HOME");
+    const char* home = getenv("HOME");
+    std::string d;
+    if (xdg && *xdg) d = xdg;
+    else if (home && *home) { d = std::string(home) + "/.local"; mkdir(d.c_str(), 0755); d += "/state"; }
+    else return "";
+    mkdir(d.c_str(), 0755);
+    d += "/nvidia-smi-gui";
+    mkdir(d.c_str(), 0700);
+#endif
+    return d;
+}
+
+// ─── History store ──────────────────────────────────────────────────────────
+// History for every GPU, fed from the snapshot stream; keeps `retention`.
+class HistoryStore {
+public:
+    void configure(int64_t retentionMs) { std::lock_guard<std::mutex> lk(m_mutex); m_retentionMs = retentionMs; }
+
+    // Backs recent history with one HistoryFile per host in `dir`, named
+    // after `hosts`. GPUs are keyed by UUID; with `uuidKeys` false (no
+    // identities) by the UUID the registry has for their slot on the host,
+    // or failing that by the slot.
+    void persist(const std::string& dir, const std::vector<std::string>& hosts, bool uuidKeys) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_uuidKeys = uuidKeys;
+        for (const auto& h : hosts) {
+            std::string name = h.empty() ? "localhost" : h;
+            for (char& c : name) if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != '_') c = '_';
+            std::unique_ptr<HistoryFile> f(new HistoryFile);
+#ifdef _WIN32
+            std::string path = dir + "\\" + name + ".hist";
+#else
+            std::string path = dir + "/" + name + ".hist";
+#endif
+            if (!f->open(path)) { fprintf(stderr, "history file %s: cannot open, not persisting\n", path.c_str()); f.reset(); }
+            m_files.push_back(std::move(f));
+        }
+    }
+
+    void add(const FleetSnapshot& snap) {
+        int64_t ts = snapshotTimeMs(snap);
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_latest = std::max(m_latest, ts);
+        for (const auto& g : snap.gpus) {
+            if (g.stale || g.index < 0) continue;
+            if (g.index >= (int)m_gpus.size()) { m_gpus.resize(g.index + 1); m_firstTs.resize(g.index + 1, INT64_MAX); m_entry.resize(g.index + 1, -1); }
+            if (!m_gpus[g.index]) { m_gpus[g.index].reset(new GpuHistory); m_firstTs[g.index] = ts; }
+            m_gpus[g.index]->add(ts, g.v);
+            if (HistoryFile* f = fileFor(g.index)) {
+                int e = entryOf(g.index, true);
+                if (e >= 0) f->add(e, ts, g.v);
+            }
+        }
+        if (ts - m_lastTrim >= 60000) {
+            for (auto& h : m_gpus) if (h) h->trim(ts - m_retentionMs);
+            m_lastTrim = ts;
+        }
+    }
+
+    void read(int index, int metric, int64_t from, int64_t to, std::vector<HistoryPoint>& out) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (index >= 0 && index < (int)m_gpus.size() && m_gpus[index]) m_gpus[index]->read(metric, from, to, out);
+    }
+
+    // GpuHistory::scan over every GPU, holding the store for the duration.
+    template <typename Summary, typename Rows>
+    void scan(int64_t from, int64_t to, const bool* need, Summary&& summary, Rows&& rows) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        for (int i = 0; i < (int)m_gpus.size(); ++i)
+            if (m_gpus[i])
+                m_gpus[i]->scan(i, from, to, need, [&](const ColumnSummary* s, uint32_t n, int64_t, int64_t) { return summary(i, s, n); }, rows);
+    }
+
+    // GpuHistory::scan over one GPU.
+    template <typename Summary, typename Rows>
+    void scanGpu(int index, int64_t from, int64_t to, const bool* need, Summary&& summary, Rows&& rows) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (index >= 0 && index < (int)m_gpus.size() && m_gpus[index]) m_gpus[index]->scan(index, from, to, need, summary, rows);
+    }
+
+    // HistoryFile::read for GPU `index`, limited to before this session's
+    // first sample of it: what a previous run left behind.
+    template <typename Fn>
+    void warm(int index, int metric, int64_t from, int64_t to, Fn&& fn) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (index < 0) return;
+        if (HistoryFile* f = fileFor(index))
+            f->read(entryOf(index, false), metric, index < (int)m_firstTs.size() ? m_firstTs[index] : INT64_MAX, from, to, fn);
+    }
+
+    int64_t latest() const { std::lock_guard<std::mutex> lk(m_mutex); return m_latest; }
+
+    void print(FILE* f) const {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        size_t samples = 0, bytes = 0;
+        for (const auto& h : m_gpus) if (h) { samples += h->samples(); bytes += h->bytes(); }
+        size_t raw = samples * sizeof(double) * (1 + M_COUNT);
+        fprintf(f, "history: %zu samples in %zu bytes (%.2f bytes/sample, %.1fx vs doubles)\n",
+                samples, bytes, samples ? (double)bytes / samples : 0.0, bytes ? (double)raw / bytes : 0.0);
+        for (const auto& file : m_files) if (file) file->print(f);
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<GpuHistory>> m_gpus;
+    std::vector<int64_t> m_firstTs;                     // this session's first sample, per GPU
+    std::vector<std::unique_ptr<HistoryFile>> m_files;  // per host; null where the file would not open
+    mutable std::vector<int> m_entry;                   // file entry per GPU, -1 until resolved
+    bool m_uuidKeys = true;
+    int64_t m_retentionMs = 3600000, m_lastTrim = 0, m_latest = 0;
+
+    HistoryFile* fileFor(int index) const {
+        int host = hostOf(index);
+        return host < (int)m_files.size() ? m_files[host].get() : nullptr;
+    }
+
+    // The GPU's entry in its host's file, claiming one if `create`; -1 if
+    // there is none, or no key yet (the UUID arrives with the identities).
+    int entryOf(int index, bool create) const {
+        if (index < (int)m_entry.size() && m_entry[index] >= 0) return m_entry[index];
+        std::string key;
+        int local = g_gpusPerHost > 0 ? index % g_gpusPerHost : index;
+        if (m_uuidKeys) { if (GpuIdentityPtr id = g_identities.get(index)) key = id->uuid; }
+        else if (!g_registry.uuidAt(hostOf(index), local, key)) key = "#" + std::to_string(local);
+        if (key.empty()) return -1;
+        int e = fileFor(index)->entryFor(key, create);
+        if (index < (int)m_entry.size()) m_entry[index] = e;
+        return e;
+    }
+};
+
+static HistoryStore g_history;
+
+// ─── Analytics expressions ──────────────────────────────────────────────────
+// Ad-hoc aggregates over history, typed into the GUI (E) or given to --eval:
+//   avg(utilization.gpu) by host over 1h
+//   max(power.draw / enforced.power.limit)
+//   count(temperature.gpu > 80) by gpu over 30m
+// AGG(expr) [by host|gpu] [over N s|m|h|d], AGG one of avg, min, max, sum,
+// count. An expr combines numbers, metric fields (or a prefix of one) and
+// the identity fields memory.total and enforced.power.limit with + - * /,
+// unary minus and comparisons, which yield 1 or 0. count of a comparison
+// counts the rows where it holds, count of anything else the non-NaN rows;
+// NaN rows never take part. `over` ends at the newest sample.
+//
+// A query is parsed once into a postfix program over column registers that
+// runs a chunk of rows at a time. Before a sealed history segment is
+// decoded the program is run over its summary instead: interval arithmetic
+// settles min/max when the expression uses one metric once, and comparisons
+// that hold or fail for the whole range; an expression affine in one metric
+// turns sum/avg into a*sum + b*n.
+enum ExprField { F_MEM_TOTAL = M_COUNT, F_POWER_LIMIT, F_COUNT };
+enum ExprOpCode { X_FIELD, X_CONST, X_NEG, X_ADD, X_SUB, X_MUL, X_DIV, X_GT, X_LT, X_GE, X_LE, X_EQ, X_NE };
+enum Aggregate { A_AVG, A_MIN, A_MAX, A_SUM, A_COUNT };
+enum GroupBy { G_NONE, G_HOST, G_GPU };
+
+struct ExprOp { ExprOpCode op; int field; double value; };
+
+struct AnalyticsQuery {
+    Aggregate agg = A_AVG;
+    GroupBy by = G_NONE;
+    int64_t overMs = 0;              // 0: all history
+    std::vector<ExprOp> prog;        // postfix
+    int depth = 0;                   // registers the program needs
+    bool boolean = false;            // the expression is a comparison
+    int metricUses = 0;
+    bool need[M_COUNT] = {};
+    bool identity = false;           // uses memory.total or the power limit
+};
+
+static int exprFieldByName(const std::string& name) {
+    if (name == "memory.total") return F_MEM_TOTAL;
+    if (name == "enforced.power.limit" || name == "power.limit") return F_POWER_LIMIT;
+    return metricByName(name);
+}
+
+// Recursive descent straight to postfix.
+class ExprParser {
+public:
+    explicit ExprParser(const std::string& text) : m_s(text) {}
+
+    bool parse(AnalyticsQuery& q, std::string& err) {
+        static const char* const AGGS[] = {"avg", "min", "max", "sum", "count"};
+        m_q = &q;
+        next();
+        int agg = 0;
+        while (agg < 5 && m_tok != AGGS[agg]) ++agg;
+        if (agg == 5) fail("expected avg, min, max, sum or count");
+        else {
+            q.agg = (Aggregate)agg;
+            next();
+            if (expect("(") && comparison() && expect(")")) {
+                q.boolean = q.prog.back().op >= X_GT;
+                if (m_tok == "by") {
+                    next();
+                    if (m_tok == "host") q.by = G_HOST;
+                    else if (m_tok == "gpu") q.by = G_GPU;
+                    else fail("expected host or gpu");
+                    next();
+                }
+                if (m_err.empty() && m_tok == "over") {
+                    next();
+                    char* end;
+                    double n = strtod(m_tok.c_str(), &end);
+                    static const char UNITS[] = "smhd";
+                    static const int64_t MS[] = {1000, 60000, 3600000, 86400000};
+                    const char* u = *end && !end[1] ? strchr(UNITS, *end) : nullptr;
+                    if (!u || !(n > 0)) fail("expected a duration like 30m or 2h");
+                    else { q.overMs = (int64_t)(n * MS[u - UNITS]); next(); }
+                }
+                if (m_err.empty() && !m_tok.empty()) fail("unexpected");
+            }
+        }
+        err = m_err;
+        return m_err.empty();
+    }
+
+private:
+    const std::string& m_s;
+    size_t m_pos = 0;
+    std::string m_tok, m_err;
+    AnalyticsQuery* m_q = nullptr;
+    int m_sp = 0;
+
+    static bool wordChar(char c) { return isalnum((unsigned char)c) || c == '.' || c == '_'; }
+
+    void next() {
+        while (m_pos < m_s.size() && isspace((unsigned char)m_s[m_pos])) ++m_pos;
+        size_t b = m_pos;
+        if (m_pos < m_s.size() && wordChar(m_s[m_pos])) while (m_pos < m_s.size() && wordChar(m_s[m_pos])) ++m_pos;
+        else if (m_pos + 1 < m_s.size() && strchr("<>=!", m_s[m_pos]) && m_s[m_pos + 1] == '=') m_pos += 2;
+        else if (m_pos < m_s.size()) ++m_pos;
+        m_tok = m_s.substr(b, m_pos - b);
+    }
+
+    bool fail(const std::string& what) {
+        if (m_err.empty()) m_err = what + (m_tok.empty() ? " at end" : " at '" + m_tok + "'");
+        return false;
+    }
+
+    bool expect(const char* t) { if (m_tok != t) return fail(std::string("expected '") + t + "'"); next(); return true; }
+
+    void emit(ExprOpCode op, int field = 0, double value = 0) {
+        m_q->prog.push_back({op, field, value});
+        if (op == X_FIELD || op == X_CONST) m_q->depth = std::max(m_q->depth, ++m_sp);
+        else if (op != X_NEG) --m_sp;
+    }
+
+    bool comparison() {
+        static const char* const OPS[] = {">", "<", ">=", "<=", "==", "!="};
+        if (!sum()) return false;
+        for (int k = 0; k < 6; ++k)
+            if (m_tok == OPS[k]) { next(); if (!sum()) return false; emit((ExprOpCode)(X_GT + k)); break; }
+        return true;
+    }
+
+    bool sum() {
+        if (!product()) return false;
+        while (m_tok == "+" || m_tok == "-") {
+            ExprOpCode op = m_tok == "+" ? X_ADD : X_SUB;
+            next();
+            if (!product()) return false;
+            emit(op);
+        }
+        return true;
+    }
+
+    bool product() {
+        if (!unary()) return false;
+        while (m_tok == "*" || m_tok == "/") {
+            ExprOpCode op = m_tok == "*" ? X_MUL : X_DIV;
+            next();
+            if (!unary()) return false;
+            emit(op);
+        }
+        return true;
+    }
+
+    bool unary() {
+        if (m_tok != "-") return primary();
+        next();
+        if (!unary()) return false;
+        emit(X_NEG);
+        return true;
+    }
+
+    bool primary() {
+        if (m_tok == "(") { next(); return comparison() && expect(")"); }
+        if (m_tok.empty() || !wordChar(m_tok[0])) return fail("expected a field or number");
+        if (isdigit((unsigned char)m_tok[0]) || m_tok[0] == '.') {
+            char* end;
+            double v = strtod(m_tok.c_str(), &end);
+            if (*end) return fail("bad number");
+            emit(X_CONST, 0, v);
+        } else {
+            int f = exprFieldByName(m_tok);
+            if (f < 0) return fail("unknown field");
+            emit(X_FIELD, f);
+            if (f < M_COUNT) { m_q->need[f] = true; ++m_q->metricUses; }
+            else m_q->identity = true;
+        }
+        next();
+        return true;
+    }
+};
+
+// Runs a query over chunks and segment summaries; one accumulator per group.
+class AnalyticsEval {
+public:
+    static constexpr uint32_t CHUNK = 512;
+
+    struct Acc { double sum = 0, min = INFINITY, max = -INFINITY; uint64_t n = 0; };
+
+    explicit AnalyticsEval(const AnalyticsQuery& q) : m_q(q), m_regs((size_t)std::max(1, q.depth) * CHUNK) {}
+
+    uint64_t summarized = 0, decoded = 0;   // rows
+
+    // A sealed segment of one GPU with no rows outside the range. Returns
+    // false if it has to be decoded. NaN rows take no part, so with one
+    // metric the rows that count are its non-NaN ones; with more, which
+    // rows have a NaN somewhere is unknown unless none do.
+    bool summary(int gpu, const ColumnSummary* s, uint32_t rows) {
+        double lo[F_COUNT], hi[F_COUNT];
+        bool done = false;
+        int metrics = 0;
+        uint32_t live = rows;
+        for (int m = 0; m < M_COUNT; ++m) metrics += m_q.need[m];
+        for (int m = 0; m < M_COUNT; ++m) {
+            if (!m_q.need[m]) continue;
+            if (s[m].n == 0) done = true;            // every row NaN
+            else if (metrics == 1) live = s[m].n;
+            else if (s[m].n != rows) return false;
+            lo[m] = s[m].min / 100.0; hi[m] = s[m].max / 100.0;
+        }
+        for (int f = M_COUNT; f < F_COUNT && m_q.identity; ++f) {
+            lo[f] = hi[f] = identityValue(f, gpu);
+            if (std::isnan(lo[f])) done = true;
+        }
+        if (!done) done = settle(acc(groupOf(gpu)), range(lo, hi), live, s);
+        if (done) summarized += rows;
+        return done;
+    }
+
+    // A log block with no rows outside the range, known only by the min and
+    // max of each metric over its non-NaN rows. Without NaN counts or groups
+    // it can only be dropped when it cannot change the answer.
+    bool bounds(const float* min, const float* max, uint32_t rows) {
+        if (m_q.by != G_NONE || m_q.identity) return false;
+        double lo[F_COUNT], hi[F_COUNT];
+        for (int m = 0; m < M_COUNT; ++m) {
+            if (!m_q.need[m]) continue;
+            if (std::isnan(min[m])) { summarized += rows; return true; }
+            // Hundredths survive the trip through float below 2^24.
+            if (fabsf(min[m]) >= 100000 || fabsf(max[m]) >= 100000) return false;
+            lo[m] = std::round(min[m] * 100.0) / 100; hi[m] = std::round(max[m] * 100.0) / 100;
+        }
+        Range r = range(lo, hi);
+        Acc& a = acc(0);
+        bool done = false;
+        if (m_q.agg == A_MIN || m_q.agg == A_MAX) {
+            if (exact(r)) { a.min = std::min(a.min, r.lo); a.max = std::max(a.max, r.hi); ++a.n; done = true; }
+            else done = a.n && (m_q.agg == A_MIN ? r.lo >= a.min : r.hi <= a.max);
+        } else if (m_q.boolean && (m_q.agg == A_COUNT || m_q.agg == A_SUM)) {
+            done = r.lo == 0 && r.hi == 0;
+        }
+        if (done) summarized += rows;
+        return done;
+    }
+
+    void rows(const ColumnChunk& c) {
+        decoded += c.rows;
+        for (uint32_t b = 0; b < c.rows; b += CHUNK) {
+            uint32_t n = std::min(CHUNK, c.rows - b);
+            const double* v = run(c, b, n);
+            if (!c.index) {
+                Acc& a = acc(groupOf(c.gpu));
+                for (uint32_t i = 0; i < n; ++i) add(a, v[i]);
+            } else {
+                for (uint32_t i = 0; i < n; ++i) add(acc(groupOf(c.index[b + i])), v[i]);
+            }
+        }
+    }
+
+    // Appends "value" (or "host H: value" per group) lines to `out`.
+    void report(std::string& out) const {
+        char buf[96];
+        bool any = false;
+        for (size_t g = 0; g < m_acc.size(); ++g) {
+            const Acc& a = m_acc[g];
+            if (!a.n) continue;
+            double v = m_q.agg == A_AVG ? a.sum / a.n : m_q.agg == A_MIN ? a.min : m_q.agg == A_MAX ? a.max
+                     : m_q.agg == A_SUM || m_q.boolean ? a.sum : (double)a.n;
+            if (m_q.by == G_NONE) snprintf(buf, sizeof(buf), "%.6g\n", v);
+            else snprintf(buf, sizeof(buf), "%s %zu: %.6g\n", m_q.by == G_HOST ? "host" : "gpu", g, v);
+            out += buf;
+            any = true;
+        }
+        if (!any) out += "no data\n";
+    }
+
+private:
+    // Value interval of the expression, and its affine form a*x[var] + b
+    // where it has one (var -1: constant).
+    struct Range { double lo, hi, a, b; int var; bool affine; };
+
+    const AnalyticsQuery& m_q;
+    std::vector<double> m_regs;
+    std::vector<Acc> m_acc;
+    std::vector<double> m_identity;          // F_COUNT - M_COUNT per GPU, filled on first use
+    std::vector<bool> m_identityLoaded;
+
+    int groupOf(int gpu) const { return m_q.by == G_GPU ? gpu : m_q.by == G_HOST ? hostOf(gpu) : 0; }
+
+    Acc& acc(int group) {
+        if (group >= (int)m_acc.size()) m_acc.resize(group + 1);
+        return m_acc[group];
+    }
+
+    static void add(Acc& a, double v) {
+        if (std::isnan(v)) return;
+        a.sum += v; ++a.n;
+        a.min = std::min(a.min, v); a.max = std::max(a.max, v);
+    }
+
+    double identityValue(int field, int gpu) {
+        const int k = F_COUNT - M_COUNT;
+        if (gpu >= (int)m_identityLoaded.size()) { m_identityLoaded.resize(gpu + 1); m_identity.resize((size_t)(gpu + 1) * k); }
+        if (!m_identityLoaded[gpu]) {
+            GpuIdentityPtr id = g_identities.get(gpu);
+            m_identity[(size_t)gpu * k + (F_MEM_TOTAL - M_COUNT)] = id ? id->memTotal : NAN;
+            m_identity[(size_t)gpu * k + (F_POWER_LIMIT - M_COUNT)] = id ? id->powerLimit : NAN;
+            m_identityLoaded[gpu] = true;
+        }
+        return m_identity[(size_t)gpu * k + (field - M_COUNT)];
+    }
+
+    // Endpoints are attained: one metric use, finite bounds.
+    bool exact(const Range& r) const { return m_q.metricUses <= 1 && std::isfinite(r.lo) && std::isfinite(r.hi); }
+
+    Range range(const double* lo, const double* hi) const {
+        Range st[64];
+        int sp = 0;
+        for (const ExprOp& op : m_q.prog) {
+            if (op.op == X_FIELD || op.op == X_CONST) {
+                if (sp == 64) return {-INFINITY, INFINITY, 0, 0, -1, false};
+                bool metric = op.op == X_FIELD && op.field < M_COUNT;
+                double l = op.op == X_CONST ? op.value : lo[op.field], h = op.op == X_CONST ? op.value : hi[op.field];
+                st[sp++] = metric ? Range{l, h, 1, 0, op.field, true} : Range{l, h, 0, l, -1, true};
+                continue;
+            }
+            if (op.op == X_NEG) { Range& x = st[sp - 1]; x = {-x.hi, -x.lo, -x.a, -x.b, x.var, x.affine}; continue; }
+            Range y = st[--sp], &x = st[sp - 1], r{0, 0, 0, 0, -1, false};
+            bool oneVar = x.affine && y.affine && (x.var < 0 || y.var < 0 || x.var == y.var);
+            switch (op.op) {
+            case X_ADD: case X_SUB: {
+                double s = op.op == X_ADD ? 1 : -1;
+                r = {x.lo + (s > 0 ? y.lo : -y.hi), x.hi + (s > 0 ? y.hi : -y.lo), x.a + s * y.a, x.b + s * y.b,
+                     x.var >= 0 ? x.var : y.var, oneVar};
+                break;
+            }
+            case X_MUL: case X_DIV: {
+                if (op.op == X_DIV && y.lo <= 0 && y.hi >= 0) { r = {-INFINITY, INFINITY, 0, 0, -1, false}; break; }
+                auto f = [&](double p, double q) { return op.op == X_MUL ? p * q : p / q; };
+                double c[4] = {f(x.lo, y.lo), f(x.lo, y.hi), f(x.hi, y.lo), f(x.hi, y.hi)};
+                r.lo = *std::min_element(c, c + 4); r.hi = *std::max_element(c, c + 4);
+                if (x.affine && y.affine && y.var < 0) { r.a = f(x.a, y.b); r.b = f(x.b, y.b); r.var = x.var; r.affine = true; }
+                else if (op.op == X_MUL && x.affine && y.affine && x.var < 0) { r.a = x.b * y.a; r.b = x.b * y.b; r.var = y.var; r.affine = true; }
+                break;
+            }
+            default: {
+                // Comparisons: certain when the intervals do not overlap the wrong way.
+                bool yes, no;
+                switch (op.op) {
+                case X_GT: yes = x.lo > y.hi;  no = x.hi <= y.lo; break;
+                case X_LT: yes = x.hi < y.lo;  no = x.lo >= y.hi; break;
+                case X_GE: yes = x.lo >= y.hi; no = x.hi < y.lo;  break;
+                case X_LE: yes = x.hi <= y.lo; no = x.lo > y.hi;  break;
+                case X_EQ: yes = x.lo == x.hi && y.lo == y.hi && x.lo == y.lo; no = x.hi < y.lo || x.lo > y.hi; break;
+                default:   no = x.lo == x.hi && y.lo == y.hi && x.lo == y.lo; yes = x.hi < y.lo || x.lo > y.hi; break;
+                }
+                r = yes ? Range{1, 1, 0, 1, -1, true} : no ? Range{0, 0, 0, 0, -1, true} : Range{0, 1, 0, 0, -1, false};
+                break;
+            }
+            }
+            if (std::isnan(r.lo) || std::isnan(r.hi)) r = {-INFINITY, INFINITY, 0, 0, -1, false};
+            x = r;
+        }
+        return st[0];
+    }
+
+    bool settle(Acc& a, const Range& r, uint32_t rows, const ColumnSummary* s) {
+        if (r.lo == r.hi && std::isfinite(r.lo)) {
+            a.sum += r.lo * rows; a.n += rows;
+            a.min = std::min(a.min, r.lo); a.max = std::max(a.max, r.lo);
+            return true;
+        }
+        switch (m_q.agg) {
+        case A_MIN: case A_MAX:
+            if (exact(r)) { a.min = std::min(a.min, r.lo); a.max = std::max(a.max, r.hi); a.n += rows; return true; }
+            return a.n && (m_q.agg == A_MIN ? r.lo >= a.min : r.hi <= a.max);
+        case A_AVG: case A_SUM:
+            if (!r.affine || r.var < 0 || !std::isfinite(r.a) || !std::isfinite(r.b)) return false;
+            a.sum += r.a * (s[r.var].sum / 100.0) + r.b * rows; a.n += rows;
+            return true;
+        case A_COUNT:
+            if (m_q.boolean || !std::isfinite(r.lo) || !std::isfinite(r.hi)) return false;
+            a.n += rows;
+            return true;
+        }
+        return false;
+    }
+
+    // Runs the program over rows [b, b + n) of the chunk; returns the result column.
+    const double* run(const ColumnChunk& c, uint32_t b, uint32_t n) {
+        int sp = 0;
+        for (const ExprOp& op : m_q.prog) {
+            if (op.op == X_FIELD || op.op == X_CONST) {
+                double* r = &m_regs[(size_t)sp++ * CHUNK];
+                if (op.op == X_CONST) std::fill(r, r + n, op.value);
+                else if (op.field < M_COUNT) { const int64_t* q = c.q[op.field] + b; for (uint32_t i = 0; i < n; ++i) r[i] = dequantize(q[i]); }
+                else if (!c.index) std::fill(r, r + n, identityValue(op.field, c.gpu));
+                else for (uint32_t i = 0; i < n; ++i) r[i] = identityValue(op.field, c.index[b + i]);
+                continue;
+            }
+            double* x = &m_regs[(size_t)(sp - 1) * CHUNK];
+            if (op.op == X_NEG) { for (uint32_t i = 0; i < n; ++i) x[i] = -x[i]; continue; }
+            const double* y = x;
+            x -= CHUNK; --sp;
+            switch (op.op) {
+            case X_ADD: for (uint32_t i = 0; i < n; ++i) x[i] += y[i]; break;
+            case X_SUB: for (uint32_t i = 0; i < n; ++i) x[i] -= y[i]; break;
+            case X_MUL: for (uint32_t i = 0; i < n; ++i) x[i] *= y[i]; break;
+            case X_DIV: for (uint32_t i = 0; i < n; ++i) x[i] /= y[i]; break;
+            case X_GT: for (uint32_t i = 0; i < n; ++i) x[i] = std::isunordered(x[i], y[i]) ? NAN : x[i] > y[i];  break;
+            case X_LT: for (uint32_t i = 0; i < n; ++i) x[i] = std::isunordered(x[i], y[i]) ? NAN : x[i] < y[i];  break;
+            case X_GE: for (uint32_t i = 0; i < n; ++i) x[i] = std::isunordered(x[i], y[i]) ? NAN : x[i] >= y[i]; break;
+            case X_LE: for (uint32_t i = 0; i < n; ++i) x[i] = std::isunordered(x[i], y[i]) ? NAN : x[i] <= y[i]; break;
+            case X_EQ: for (uint32_t i = 0; i < n; ++i) x[i] = std::isunordered(x[i], y[i]) ? NAN : x[i] == y[i]; break;
+            case X_NE: for (uint32_t i = 0; i < n; ++i) x[i] = std::isunordered(x[i], y[i]) ? NAN : x[i] != y[i]; break;
+            default: break;
+            }
+        }
+        return m_regs.data();
+    }
+};
+
+// Parses `text` and runs it over the in-memory history; appends the answer,
+// or the parse error, to `out` and the cost to `stats`. Returns false on a
+// parse error.
+static bool evalHistory(const std::string& text, std::string& out, std::string* stats) {
+    auto t0 = std::chrono::steady_clock::now();
+    AnalyticsQuery q;
+    std::string err;
+    if (!ExprParser(text).parse(q, err)) { out += err + "\n"; return false; }
+    AnalyticsEval eval(q);
+    int64_t from = q.overMs ? g_history.latest() - q.overMs : INT64_MIN;
+    g_history.scan(from, INT64_MAX, q.need,
+                   [&](int gpu, const ColumnSummary* s, uint32_t n) { return eval.summary(gpu, s, n); },
+                   [&](const ColumnChunk& c) { eval.rows(c); });
+    eval.report(out);
+    if (stats) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "%llu rows from summaries, %llu decoded, %.2f ms\n",
+                 (unsigned long long)eval.summarized, (unsigned long long)eval.decoded,
+                 std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        *stats += buf;
+    }
+    return true;
+}
+
+// ─── Chart decimation ───────────────────────────────────────────────────────
+// History reduced to a min/max pair per pixel column for charts, so a day in
+// 600 pixels is 600 strokes and still shows every spike. Columns sit on a
+// grid of span/width milliseconds counted from the epoch in a ring: moving
+// the window forward clears the columns that rolled in, and an update folds
+// in only the samples newer than the last one, so a frame costs the width
+// plus the new samples. A sealed segment that falls inside one column
+// contributes its summary without being decoded. Min/max rather than LTTB,
+// whose pick in each bucket depends on the next bucket's, so new samples
+// would move old points and the result could not be extended in place.
+struct ChartColumn { float min = NAN, max = NAN; };
+
+class ChartSeries {
+public:
+    ChartSeries(int gpu, int metric, int64_t spanMs, int width)
+        : m_gpu(gpu), m_metric(metric), m_spanMs(spanMs), m_width(std::max(1, width)),
+          m_colMs(std::max<int64_t>(1, spanMs / m_width)), m_cols(m_width) {}
+
+    bool is(int gpu, int metric, int64_t spanMs, int width) const {
+        return m_gpu == gpu && m_metric == metric && m_spanMs == spanMs && m_width == width;
+    }
+
+    // Brings the columns up to the newest sample in `h`.
+    void update(const HistoryStore& h) {
+        int64_t now = h.latest(), end = now / m_colMs;
+        if (now <= m_seen) return;
+        if (end - m_end >= m_width) std::fill(m_cols.begin(), m_cols.end(), ChartColumn());
+        else for (int64_t c = m_end + 1; c <= end; ++c) m_cols[c % m_width] = ChartColumn();
+        m_end = end;
+        bool need[M_COUNT] = {};
+        need[m_metric] = true;
+        int64_t from = std::max(m_seen + 1, (end - m_width + 1) * m_colMs);
+        if (m_seen == INT64_MIN)
+            h.warm(m_gpu, m_metric, from, now, [&](int64_t t0, int64_t t1, float lo, float hi) {
+                for (int64_t c = std::max(t0, from) / m_colMs; c <= (t1 - 1) / m_colMs && c <= end; ++c) { fold(c, lo); fold(c, hi); }
+            });
+        h.scanGpu(m_gpu, from, now, need,
+                  [&](const ColumnSummary* s, uint32_t n, int64_t first, int64_t last) {
+                      if (first / m_colMs != last / m_colMs) return false;
+                      if (s[m_metric].n) {
+                          fold(first / m_colMs, dequantize(s[m_metric].min));
+                          fold(first / m_colMs, dequantize(s[m_metric].max));
+                      }
+                      summarized += n;
+                      return true;
+                  },
+                  [&](const ColumnChunk& c) {
+                      const int64_t* q = c.q[m_metric];
+                      for (uint32_t i = 0; i < c.rows; ++i)
+                          if (q[i] != Q_NAN) fold(c.ts[i] / m_colMs, dequantize(q[i]));
+                      decoded += c.rows;
+                  });
+        m_seen = now;
+    }
+
+    int width() const { return m_width; }
+    int64_t spanMs() const { return m_spanMs; }
+
+    // Column `x`, 0 the oldest; both NaN where no samples fell.
+    const ChartColumn& at(int x) const { return m_cols[(m_end - m_width + 1 + x) % m_width]; }
+
+    uint64_t summarized = 0, decoded = 0;   // samples taken from summaries / decoded
+
+private:
+    int m_gpu, m_metric;
+    int64_t m_spanMs;
+    int m_width;
+    int64_t m_colMs, m_end = 0, m_seen = INT64_MIN;
+    std::vector<ChartColumn> m_cols;
+
+    void fold(int64_t col, double v) {
+        ChartColumn& c = m_cols[col % m_width];
+        if (!(c.min <= (float)v)) c.min = (float)v;
+        if (!(c.max >= (float)v)) c.max = (float)v;
+    }
+};
+
+// The last few series drawn, most recent first, so switching back to a zoom
+// level or GPU resumes its columns instead of rebuilding them.
+class ChartCache {
+public:
+    static constexpr size_t CHART_CACHE = 8;
+
+    ChartSeries& get(int gpu, int metric, int64_t spanMs, int width) {
+        auto it = std::find_if(m_series.begin(), m_series.end(),
+                               [&](const std::unique_ptr<ChartSeries>& s) { return s->is(gpu, metric, spanMs, width); });
+        std::unique_ptr<ChartSeries> s;
+        if (it != m_series.end()) { s = std::move(*it); m_series.erase(it); }
+        else {
+            s.reset(new ChartSeries(gpu, metric, spanMs, width));
+            if (m_series.size() >= CHART_CACHE) m_series.pop_back();
+        }
+        m_series.insert(m_series.begin(), std::move(s));
+        return *m_series.front();
+    }
+
+private:
+    std::vector<std::unique_ptr<ChartSeries>> m_series;
+};
+
+// ─── Fleet heatmap raster ───────────────────────────────────────────────────
+// One colored cell per GPU in a host × GPU grid, drawn into a single 32-bit
+// top-down pixel buffer (0x00RRGGBB). Values are reduced to color buckets
+// and a cell is redrawn only when its bucket changes; the union of redrawn
+// cells is kept as a dirty rectangle for the view to flush.
+enum HeatMetric { HM_UTIL, HM_TEMP, HM_MEM, HM_COUNT };
+static const char* const HEAT_METRIC_NAMES[HM_COUNT] = {"Utilization", "Temperature", "Memory"};
+
+class HeatmapRaster {
+public:
+    static constexpr int BUCKETS = 16;
+    static constexpr uint8_t B_NA = BUCKETS, B_EMPTY = BUCKETS + 1;   // stale or N/A; no GPU
+    static constexpr int HOST_GAP = 4;
+    struct Rect { int left, top, right, bottom; };
+
+    // `colors` holds BUCKETS ramp colors, then B_NA and B_EMPTY.
+    void setPalette(const uint32_t* colors) {
+        std::copy(colors, colors + BUCKETS + 2, m_palette);
+        for (int i = 0; i < m_count; ++i) fillCell(i, m_palette[m_bucket[i]]);
+        m_dirty = {0, 0, m_w, m_h};
+    }
+
+    // Sizes the grid for `gpuCount` GPUs within `maxW` x `maxH` using the
+    // largest cell that fits. Each host is a strip of `gpusPerHost` cells
+    // (0: one host); strips wrap left to right.
+    void layout(int gpuCount, int gpusPerHost, int maxW, int maxH) {
+        static const int SIZES[] = {24, 16, 12, 10, 8, 6, 5, 4, 3, 2};
+        m_count = std::max(0, gpuCount);
+        for (int s : SIZES) { m_cell = s; placeStrips(gpusPerHost, maxW); if (m_h <= maxH) break; }
+        m_px.assign((size_t)m_w * m_h, m_palette[B_EMPTY]);
+        m_bucket.assign(m_count, B_EMPTY);
+        m_dirty = {0, 0, m_w, m_h};
+    }
+
+    // Returns the number of cells redrawn. GPUs past the laid-out count are
+    // ignored; the caller lays out again when the fleet grows.
+    int update(const FleetSnapshot& snap, HeatMetric metric, const std::vector<double>& memTotal) {
+        int changed = 0, next = 0;
+        for (const auto& g : snap.gpus) {
+            if (g.index < next || g.index >= m_count) continue;
+            for (; next < g.index; ++next) changed += setBucket(next, B_EMPTY);
+            double total = g.index < (int)memTotal.size() ? memTotal[g.index] : NAN;
+            changed += setBucket(g.index, bucketOf(g, metric, total));
+            next = g.index + 1;
+        }
+        for (; next < m_count; ++next) changed += setBucket(next, B_EMPTY);
+        return changed;
+    }
+
+    // First and last cell position in the rows overlapping [y0, y1), laid out or not.
+    void cellsIn(int y0, int y1, int& first, int& last) const {
+        int pitch = m_cell + 1, row = m_stripsPerRow * m_strip;
+        first = std::max(0, y0 / pitch) * row;
+        last = (y1 + pitch - 1) / pitch * row - 1;
+    }
+
+    // GPU index under a point, or -1.
+    int hitTest(int x, int y) const {
+        int pitch = m_cell + 1;
+        if (x < 0 || y < 0 || x >= m_w || y >= m_h || y % pitch >= m_cell) return -1;
+        int col = x / m_stripW, xr = x % m_stripW;
+        if (col >= m_stripsPerRow || xr % pitch >= m_cell || xr / pitch >= m_strip) return -1;
+        int i = ((y / pitch) * m_stripsPerRow + col) * m_strip + xr / pitch;
+        return i < m_count ? i : -1;
+    }
+
+    bool takeDirty(Rect& r) {
+        if (m_dirty.left >= m_dirty.right) return false;
+        r = m_dirty; m_dirty = {INT32_MAX, INT32_MAX, 0, 0};
+        return true;
+    }
+
+    int width() const { return m_w; }
+    int height() const { return m_h; }
+    int count() const { return m_count; }
+    const uint32_t* pixels() const { return m_px.data(); }
+
+    static uint8_t bucketOf(const GpuSample& g, HeatMetric metric, double memTotal) {
+        if (g.stale) return B_NA;
+        double f;
+        switch (metric) {
+        case HM_UTIL: f = g.v[M_UTIL] / 100; break;
+        case HM_TEMP: f = (g.v[M_TEMP] - 30) / 60; break;      // 30..90 °C
+        default:      f = g.v[M_MEM_USED] / memTotal; break;
+        }
+        if (std::isnan(f)) return B_NA;
+        return (uint8_t)std::min(BUCKETS - 1, std::max(0, (int)(f * BUCKETS)));
+    }
+
+private:
+    std::vector<uint32_t> m_px;
+    std::vector<uint8_t> m_bucket;
+    uint32_t m_palette[BUCKETS + 2] = {};
+    int m_count = 0, m_cell = 8, m_w = 0, m_h = 0;
+    int m_strip = 1, m_stripW = 0, m_stripsPerRow = 1;
+    Rect m_dirty = {INT32_MAX, INT32_MAX, 0, 0};
+
+    void placeStrips(int gpusPerHost, int maxW) {
+        int pitch = m_cell + 1;
+        m_strip = std::min(gpusPerHost > 0 ? gpusPerHost : std::max(1, m_count), std::max(1, maxW / pitch));
+        m_stripW = m_strip * pitch + HOST_GAP;
+        m_stripsPerRow = std::max(1, (maxW + HOST_GAP) / m_stripW);
+        int strips = std::max(1, (m_count + m_strip - 1) / m_strip);
+        m_w = std::min(strips, m_stripsPerRow) * m_stripW - HOST_GAP;
+        m_h = (strips + m_stripsPerRow - 1) / m_stripsPerRow * pitch;
+    }
+
+    int setBucket(int i, uint8_t b) {
+        if (m_bucket[i] == b) return 0;
+        m_bucket[i] = b;
+        fillCell(i, m_palette[b]);
+        return 1;
+    }
+
+    void fillCell(int i, uint32_t color) {
+        int pitch = m_cell + 1, strip = i / m_strip;
+        int x = (strip % m_stripsPerRow) * m_stripW + (i % m_strip) * pitch;
+        int y = (strip / m_stripsPerRow) * pitch;
+        for (int r = 0; r < m_cell; ++r) std::fill_n(&m_px[(size_t)(y + r) * m_w + x], m_cell, color);
+        m_dirty.left = std::min(m_dirty.left, x);   m_dirty.top = std::min(m_dirty.top, y);
+        m_dirty.right = std::max(m_dirty.right, x + m_cell); m_dirty.bottom = std::max(m_dirty.bottom, y + m_cell);
+    }
+};
+
+// ─── Panel tiles ────────────────────────────────────────────────────────────
+// Compact per-GPU panels for grids of hundreds of GPUs, drawn into one
+// shared 32-bit pixel buffer like HeatmapRaster. update() runs on the UI
+// thread and only compares rounded display values to find the tiles that
+// changed; render() hands those to a RenderPool, whose threads draw disjoint
+// tile rectangles, so nothing is locked while drawing. Work is claimed a
+// tile row at a time to keep threads off each other's cache lines. Text uses
+// a built-in 5x7 font, scaled by whole pixels.
+
+// Runs a batch of jobs on `threads` workers plus the calling thread and
+// returns when all are done.
+class RenderPool {
+public:
+    explicit RenderPool(int threads) {
+        for (int i = 0; i < threads; ++i) m_workers.emplace_back(&RenderPool::worker, this);
+    }
+
+    ~RenderPool() {
+        { std::lock_guard<std::mutex> lk(m_mutex); m_quit = true; }
+        m_start.notify_all();
+        for (auto& t : m_workers) t.join();
+    }
+
+    int threads() const { return (int)m_workers.size() + 1; }
+
+    void run(int jobs, const std::function<void(int)>& fn) {
+        if (jobs <= 1 || m_workers.empty()) { for (int i = 0; i < jobs; ++i) fn(i); return; }
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_fn = &fn; m_jobs = jobs; m_next = 0;
+            m_busy = (int)m_workers.size();
+            ++m_gen;
+        }
+        m_start.notify_all();
+        claim(fn, jobs);
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_done.wait(lk, [this] { return m_busy == 0; });
+        m_fn = nullptr;
+    }
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_start, m_done;
+    const std::function<void(int)>* m_fn = nullptr;
+    std::atomic<int> m_next{0};
+    int m_jobs = 0, m_busy = 0;
+    uint64_t m_gen = 0;
+    bool m_quit = false;
+
+    void claim(const std::function<void(int)>& fn, int jobs) {
+        for (int i; (i = m_next.fetch_add(1, std::memory_order_relaxed)) < jobs; ) fn(i);
+    }
+
+    void worker() {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lk(m_mutex);
+        for (;;) {
+            m_start.wait(lk, [&] { return m_quit || m_gen != seen; });
+            if (m_quit) return;
+            seen = m_gen;
+            const std::function<void(int)>* fn = m_fn;
+            int jobs = m_jobs;
+            lk.unlock();
+            claim(*fn, jobs);
+            lk.lock();
+            if (--m_busy == 0) m_done.notify_one();
+        }
+    }
+};
+
+// 5x7 glyphs, one byte per row, bit 4 leftmost. Lowercase is drawn as
+// uppercase; anything else not listed as a blank.
+static const char TILE_GLYPH_CHARS[] = "#%-./:0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const uint8_t TILE_GLYPHS[][7] = {
+    {0x0A,0x0A,0x1F,0x0A,0x1F,0x0A,0x0A}, {0x18,0x19,0x02,0x04,0x08,0x13,0x03}, {0x00,0x00,0x00,0x1F,0x00,0x00,0x00},
+    {0x00,0x00,0x00,0x00,0x00,0x0C,0x0C}, {0x00,0x01,0x02,0x04,0x08,0x10,0x00}, {0x00,0x0C,0x0C,0x00,0x0C,0x0C,0x00},
+    {0x0E,0x11,0x13,0x15,0x19,0x11,0x0E}, {0x04,0x0C,0x04,0x04,0x04,0x04,0x0E}, {0x0E,0x11,0x01,0x02,0x04,0x08,0x1F},
+    {0x1F,0x02,0x04,0x02,0x01,0x11,0x0E}, {0x02,0x06,0x0A,0x12,0x1F,0x02,0x02}, {0x1F,0x10,0x1E,0x01,0x01,0x11,0x0E},
+    {0x06,0x08,0x10,0x1E,0x11,0x11,0x0E}, {0x1F,0x01,0x02,0x04,0x08,0x08,0x08}, {0x0E,0x11,0x11,0x0E,0x11,0x11,0x0E},
+    {0x0E,0x11,0x11,0x0F,0x01,0x02,0x0C}, {0x0E,0x11,0x11,0x11,0x1F,0x11,0x11}, {0x1E,0x11,0x11,0x1E,0x11,0x11,0x1E},
+    {0x0E,0x11,0x10,0x10,0x10,0x11,0x0E}, {0x1C,0x12,0x11,0x11,0x11,0x12,0x1C}, {0x1F,0x10,0x10,0x1E,0x10,0x10,0x1F},
+    {0x1F,0x10,0x10,0x1E,0x10,0x10,0x10}, {0x0E,0x11,0x10,0x17,0x11,0x11,0x0F}, {0x11,0x11,0x11,0x1F,0x11,0x11,0x11},
+    {0x0E,0x04,0x04,0x04,0x04,0x04,0x0E}, {0x07,0x02,0x02,0x02,0x02,0x12,0x0C}, {0x11,0x12,0x14,0x18,0x14,0x12,0x11},
+    {0x10,0x10,0x10,0x10,0x10,0x10,0x1F}, {0x11,0x1B,0x15,0x15,0x11,0x11,0x11}, {0x11,0x11,0x19,0x15,0x13,0x11,0x11},
+    {0x0E,0x11,0x11,0x11,0x11,0x11,0x0E}, {0x1E,0x11,0x11,0x1E,0x10,0x10,0x10}, {0x0E,0x11,0x11,0x11,0x15,0x12,0x0D},
+    {0x1E,0x11,0x11,0x1E,0x14,0x12,0x11}, {0x0F,0x10,0x10,0x0E,0x01,0x01,0x1E}, {0x1F,0x04,0x04,0x04,0x04,0x04,0x04},
+    {0x11,0x11,0x11,0x11,0x11,0x11,0x0E}, {0x11,0x11,0x11,0x11,0x11,0x0A,0x04}, {0x11,0x11,0x11,0x15,0x15,0x15,0x0A},
+    {0x11,0x11,0x0A,0x04,0x0A,0x11,0x11}, {0x11,0x11,0x11,0x0A,0x04,0x04,0x04}, {0x1F,0x01,0x02,0x04,0x08,0x10,0x1F},
+};
+
+static const uint8_t* tileGlyph(char c) {
+    static const std::array<int8_t, 128> index = [] {
+        std::array<int8_t, 128> t; t.fill(-1);
+        for (int i = 0; TILE_GLYPH_CHARS[i]; ++i) t[(unsigned char)TILE_GLYPH_CHARS[i]] = (int8_t)i;
+        for (int c = 'a'; c <= 'z'; ++c) t[c] = t[c - 'a' + 'A'];
+        return t;
+    }();
+    int i = (unsigned char)c < 128 ? index[(unsigned char)c] : -1;
+    return i < 0 ? nullptr : TILE_GLYPHS[i];
+}
+
+class TileRaster {
+public:
+    static constexpr int TILE_W = 160, TILE_H = 48, GAP = 4;   // unscaled pixels
+    static constexpr int32_t NA = INT32_MIN;
+    struct Palette { uint32_t bg, tile, text, sub, title, barBg, bar; };
+    using Rect = HeatmapRaster::Rect;
+
+    void setPalette(const Palette& p) { m_pal = p; markAll(); }
+
+    // Columns of tiles as wide as fit in `maxW`; the buffer holds every row.
+    void layout(int count, int maxW, int scale) {
+        m_scale = std::max(1, scale);
+        m_count = std::max(0, count);
+        int pitch = (TILE_W + GAP) * m_scale;
+        m_cols = std::max(1, std::min(std::max(1, m_count), (maxW + GAP * m_scale) / pitch));
+        m_rows = (m_count + m_cols - 1) / m_cols;
+        m_w = m_cols * pitch - GAP * m_scale;
+        m_h = std::max(0, m_rows * (TILE_H + GAP) * m_scale - GAP * m_scale);
+        m_px.assign((size_t)m_w * m_h, m_pal.bg);
+        m_tiles.assign(m_count, Tile());
+        m_ids.assign(m_count, nullptr);
+        m_updates = 0;
+        markAll();
+    }
+
+    // Compares the snapshot's rounded values with what each tile shows and
+    // queues the tiles that differ. Returns how many are queued.
+    int update(const FleetSnapshot& snap) {
+        if (m_updates++ % 64 == 0)
+            for (int i = 0; i < m_count; ++i) m_ids[i] = g_identities.get(i);
+        int next = 0;
+        for (const auto& g : snap.gpus) {
+            if (g.index < next || g.index >= m_count) continue;
+            for (; next < g.index; ++next) set(next, Tile());
+            Tile t;
+            t.present = true; t.stale = g.stale; t.id = m_ids[g.index];
+            for (int m = 0; m < M_COUNT; ++m) t.v[m] = std::isnan(g.v[m]) ? NA : (int32_t)std::lround(g.v[m]);
+            set(g.index, t);
+            next = g.index + 1;
+        }
+        for (; next < m_count; ++next) set(next, Tile());
+        return (int)m_dirtyTiles.size();
+    }
+
+    // Draws the queued tiles, one pool job per tile row. Each tile is queued
+    // once, so no two jobs touch the same pixels.
+    void render(RenderPool& pool) {
+        if (!std::is_sorted(m_dirtyTiles.begin(), m_dirtyTiles.end())) std::sort(m_dirtyTiles.begin(), m_dirtyTiles.end());
+        m_bands.clear();
+        for (size_t k = 0; k < m_dirtyTiles.size(); ++k)
+            if (k == 0 || m_dirtyTiles[k] / m_cols != m_dirtyTiles[k - 1] / m_cols) m_bands.push_back((int)k);
+        m_bands.push_back((int)m_dirtyTiles.size());
+        pool.run((int)m_bands.size() - 1, [this](int b) {
+            for (int k = m_bands[b]; k < m_bands[b + 1]; ++k) drawTile(m_dirtyTiles[k]);
+        });
+        m_drawn += m_dirtyTiles.size();
+        for (int i : m_dirtyTiles) m_queued[i] = 0;
+        m_dirtyTiles.clear();
+    }
+
+    bool takeDirty(Rect& r) {
+        if (m_dirty.left >= m_dirty.right) return false;
+        r = m_dirty; m_dirty = {INT32_MAX, INT32_MAX, 0, 0};
+        return true;
+    }
+
+    // First and last tile position in the rows overlapping [y0, y1), laid out or not.
+    void rowsIn(int y0, int y1, int& first, int& last) const {
+        int py = (TILE_H + GAP) * m_scale;
+        first = std::max(0, y0 / py) * m_cols;
+        last = (y1 + py - 1) / py * m_cols - 1;
+    }
+
+    // GPU index under a point, or -1.
+    int hitTest(int x, int y) const {
+        int px = (TILE_W + GAP) * m_scale, py = (TILE_H + GAP) * m_scale;
+        if (x < 0 || y < 0 || x >= m_w || y >= m_h || x % px >= TILE_W * m_scale || y % py >= TILE_H * m_scale) return -1;
+        int i = y / py * m_cols + x / px;
+        return i < m_count ? i : -1;
+    }
+
+    int width() const { return m_w; }
+    int height() const { return m_h; }
+    int count() const { return m_count; }
+    uint64_t drawn() const { return m_drawn; }
+    const uint32_t* pixels() const { return m_px.data(); }
+
+private:
+    struct Tile {
+        GpuIdentityPtr id;
+        int32_t v[M_COUNT] = {NA, NA, NA, NA, NA, NA};
+        bool present = false, stale = false;
+        bool operator==(const Tile& o) const {
+            return id == o.id && present == o.present && stale == o.stale && std::equal(v, v + M_COUNT, o.v);
+        }
+    };
+
+    std::vector<uint32_t> m_px;
+    std::vector<Tile> m_tiles;
+    std::vector<GpuIdentityPtr> m_ids;
+    std::vector<int> m_dirtyTiles, m_bands;
+    std::vector<uint8_t> m_queued;      // per tile: in m_dirtyTiles
+    Palette m_pal = {};
+    int m_count = 0, m_cols = 1, m_rows = 0, m_w = 0, m_h = 0, m_scale = 1;
+    uint64_t m_updates = 0, m_drawn = 0;
+    Rect m_dirty = {INT32_MAX, INT32_MAX, 0, 0};
+
+    void markAll() {
+        m_dirtyTiles.resize(m_count);
+        for (int i = 0; i < m_count; ++i) m_dirtyTiles[i] = i;
+        m_queued.assign(m_count, 1);
+        m_dirty = {0, 0, m_w, m_h};
+    }
+
+    void set(int i, const Tile& t) {
+        if (m_tiles[i] == t) return;
+        m_tiles[i] = t;
+        if (!m_queued[i]) { m_queued[i] = 1; m_dirtyTiles.push_back(i); }
+        int x = i % m_cols * (TILE_W + GAP) * m_scale, y = i / m_cols * (TILE_H + GAP) * m_scale;
+        m_dirty.left = std::min(m_dirty.left, x); m_dirty.top = std::min(m_dirty.top, y);
+        m_dirty.right = std::max(m_dirty.right, x + TILE_W * m_scale); m_dirty.bottom = std::max(m_dirty.bottom, y + TILE_H * m_scale);
+    }
+
+    // Drawing; coordinates are unscaled and relative to the tile at (ox, oy).
+    void fill(int ox, int oy, int x, int y, int w, int h, uint32_t c) {
+        int s = m_scale;
+        for (int r = 0; r < h * s; ++r) std::fill_n(&m_px[(size_t)(oy + y * s + r) * m_w + ox + x * s], w * s, c);
+    }
+
+    int text(int ox, int oy, int x, int y, const char* str, uint32_t c, int maxX = TILE_W - 4) {
+        int s = m_scale;
+        for (; *str && x + 5 <= maxX; ++str, x += 6) {
+            const uint8_t* g = tileGlyph(*str);
+            if (!g) continue;
+            uint32_t* row = &m_px[(size_t)(oy + y * s) * m_w + ox + x * s];
+            for (int r = 0; r < 7; ++r)
+                for (int dy = 0; dy < s; ++dy, row += m_w)
+                    for (int b = 0; b < 5; ++b)
+                        if (g[r] & (0x10 >> b)) std::fill_n(row + b * s, s, c);
+        }
+        return x;
+    }
+
+    static char* value(char* p, int32_t v, const char* unit) {
+        if (v == NA) { memcpy(p, "N/A", 3); return p + 3; }
+        p = std::to_chars(p, p + 12, v).ptr;
+        while (*unit) *p++ = *unit++;
+        return p;
+    }
+
+    void bar(int ox, int oy, int y, const char* label, int32_t used, double total, uint32_t textColor) {
+        int pct = (total > 0 && used != NA) ? std::min(100, (int)(used * 100.0 / total)) : 0;
+        text(ox, oy, 4, y, label, m_pal.sub);
+        int x = 26, w = TILE_W - 30 - x;
+        fill(ox, oy, x, y, w, 7, m_pal.barBg);
+        if (pct > 0) fill(ox, oy, x, y, std::max(1, w * pct / 100), 7, m_pal.bar);
+        char buf[16]; char* e = value(buf, (total > 0 && used != NA) ? pct : NA, "%"); *e = 0;
+        text(ox, oy, TILE_W - 4 - 6 * (int)(e - buf), y, buf, textColor, TILE_W);
+    }
+
+    void drawTile(int i) {
+        const Tile& t = m_tiles[i];
+        int ox = i % m_cols * (TILE_W + GAP) * m_scale, oy = i / m_cols * (TILE_H + GAP) * m_scale;
+        fill(ox, oy, 0, 0, TILE_W, TILE_H, t.present ? m_pal.tile : m_pal.bg);
+        if (!t.present) return;
+        uint32_t textColor = t.stale ? m_pal.sub : m_pal.text;
+        char buf[48];
+        *std::to_chars(buf, buf + 16, t.id && t.id->index >= 0 ? t.id->index : i).ptr = 0;
+        int x = text(ox, oy, 4, 4, "#", m_pal.sub);
+        x = text(ox, oy, x, 4, buf, m_pal.sub);
+        text(ox, oy, x + 6, 4, t.id ? t.id->name.c_str() : "UNKNOWN GPU", t.stale ? m_pal.sub : m_pal.title);
+
+        char* p = value(buf, t.v[M_UTIL], "%"); *p++ = ' ';
+        p = value(p, t.v[M_TEMP], "C"); *p++ = ' ';
+        p = value(p, t.v[M_FAN], "%"); *p++ = ' ';
+        p = value(p, t.v[M_CLOCK], "MHZ"); *p = 0;
+        text(ox, oy, 4, 16, buf, textColor);
+
+        bar(ox, oy, 28, "MEM", t.v[M_MEM_USED], t.id ? t.id->memTotal : NAN, textColor);
+        bar(ox, oy, 38, "PWR", t.v[M_POWER], t.id ? t.id->powerLimit : NAN, textColor);
+    }
+};
+
+// ─── Shared-memory publication ──────────────────────────────────────────────
+// Mirrors the latest snapshot into the region described by nvsmi_shm.h so
+// other local tools can read it without spawning nvidia-smi. A name has one
+// writer: on POSIX it holds an flock on the object for as long as it
+// publishes (a crashed writer's lock goes with it, so its leftover object is
+// simply taken over); on Windows the mapping must not exist yet. The region
+// holds NVSMI_SHM_MAX_GPUS; past that, the lowest indices go out and the
+// rest are dropped with one warning. A fleet publishes slots as indices,
+// since every host numbers its GPUs from 0.
+class ShmPublisher {
+public:
+    ~ShmPublisher() { close(); }
+
+    bool open(const std::string& name) {
+#ifdef _WIN32
+        std::wstring path = L"Local\\" + toW(name);
+        m_mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                       (DWORD)sizeof(nvsmi_shm_region), path.c_str());
+        if (!m_mapping) return false;
+        if (GetLastError() == ERROR_ALREADY_EXISTS) {
+            CloseHandle(m_mapping); m_mapping = NULL;
+            fprintf(stderr, "--shm: \"%s\" is published by another instance; not publishing\n", name.c_str());
+            return false;
+        }
+        m_region = (nvsmi_shm_region*)MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(nvsmi_shm_region));
+        if (!m_region) { CloseHandle(m_mapping); m_mapping = NULL; return false; }
+#else
+        m_path = "/" + name;
+        int fd = lockName(name);
+        if (fd < 0) return false;
+        void* p = MAP_FAILED;
+        if (ftruncate(fd, sizeof(nvsmi_shm_region)) == 0)
+            p = mmap(NULL, sizeof(nvsmi_shm_region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) { shm_unlink(m_path.c_str()); ::close(fd); return false; }
+        m_fd = fd;
+        m_region = (nvsmi_shm_region*)p;
+#endif
+        memset(m_region, 0, sizeof(nvsmi_shm_region));
+        m_region->version = NVSMI_SHM_VERSION;
+        m_region->header_size = (uint32_t)offsetof(nvsmi_shm_region, gpus);
+        m_region->record_size = sizeof(nvsmi_gpu_record);
+        m_region->max_gpus = NVSMI_SHM_MAX_GPUS;
+        __atomic_store_n(&m_region->magic, NVSMI_SHM_MAGIC, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    void publish(const FleetSnapshot& snap) {
+        if (!m_region) return;
+        uint32_t n = (uint32_t)std::min<size_t>(snap.gpus.size(), NVSMI_SHM_MAX_GPUS);
+        if (m_written.size() < n) m_written.resize(n);
+        if (n < snap.gpus.size() && !m_truncated) {
+            m_truncated = true;
+            fprintf(stderr, "--shm: %llu GPUs, only the first %d are published\n",
+                    (unsigned long long)snap.gpus.size(), NVSMI_SHM_MAX_GPUS);
+        }
+
+        uint64_t seq = m_region->seq;
+        __atomic_store_n(&m_region->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        m_region->tick = snap.seq;
+        m_region->timestamp_ms = snap.timestampMs;
+        m_region->gpu_count = n;
+        for (uint32_t i = 0; i < n; ++i) {
+            const GpuSample& g = snap.gpus[i];
+            nvsmi_gpu_record& r = m_region->gpus[i];
+            GpuIdentityPtr id = g_identities.get(g.index);
+            int index = g_gpusPerHost == 0 && id && id->index >= 0 ? id->index : g.index;
+            if (r.index != index || id != m_written[i]) {
+                copyField(r.uuid, id ? id->uuid : std::string());
+                copyField(r.pci_bus_id, id ? id->pciBusId : std::string());
+                copyField(r.name, id ? id->name : std::string());
+                r.memory_total = id ? id->memTotal : NAN;
+                r.power_limit = id ? id->powerLimit : NAN;
+                m_written[i] = id;
+            }
+            r.index = index;
+            r.flags = g.stale ? NVSMI_GPU_STALE : 0;
+            r.util = g.v[M_UTIL];
+            r.temperature = g.v[M_TEMP];
+            r.fan = g.v[M_FAN];
+            r.clock_graphics = g.v[M_CLOCK];
+            r.memory_used = g.v[M_MEM_USED];
+            r.power_draw = g.v[M_POWER];
+        }
+
+        __atomic_store_n(&m_region->seq, seq + 2, __ATOMIC_RELEASE);
+    }
+
+    void close() {
+        if (!m_region) return;
+#ifdef _WIN32
+        UnmapViewOfFile(m_region); CloseHandle(m_mapping); m_mapping = NULL;
+#else
+        munmap(m_region, sizeof(nvsmi_shm_region)); shm_unlink(m_path.c_str());
+        ::close(m_fd); m_fd = -1;   // unlinked before the lock goes, so no one else's name is removed
+#endif
+        m_region = nullptr;
+    }
+
+private:
+    nvsmi_shm_region* m_region = nullptr;
+    std::vector<GpuIdentityPtr> m_written;   // identity last copied into each slot
+    bool m_truncated = false;                // the warning went out
+#ifdef _WIN32
+    HANDLE m_mapping = NULL;
+#else
+    std::string m_path;
+    int m_fd = -1;                           // holds the writer's lock
+
+    // The object under m_path, created if need be and locked; -1 if another
+    // writer holds it. The lock is retried if the name was unlinked between
+    // opening and locking (the last writer closing), so it is never won on an
+    // object no reader can find.
+    int lockName(const std::string& name) {
+        for (int attempt = 0; attempt < 3; ++attempt) {
+            int fd = shm_open(m_path.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0) return -1;
+            if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+                ::close(fd);
+                fprintf(stderr, "--shm: \"%s\" is published by another instance; not publishing\n", name.c_str());
+                return -1;
+            }
+            int now = shm_open(m_path.c_str(), O_RDONLY, 0);
+            struct stat a, b;
+            bool same = now >= 0 && fstat(fd, &a) == 0 && fstat(now, &b) == 0 && a.st_ino == b.st_ino;
+            if (now >= 0) ::close(now);
+            if (same) return fd;
+            ::close(fd);
+        }
+        return -1;
+    }
+#endif
+
+    template <size_t N> static void copyField(char (&dst)[N], const std::string& src) {
+        size_t n = std::min(src.size(), N - 1);
+        memcpy(dst, src.data(), n); dst[n] = 0;
+    }
+};
+
+// ─── Frame pacing ───────────────────────────────────────────────────────────
+// Snapshots arrive at the sample rate, times the hosts behind a collector;
+// the window draws at most `fps` frames a second. A snapshot notification
+// waits for the next frame slot (a one-shot timer unless the slot is open)
+// and the frame renders whatever snapshot is latest by then, so everything
+// in between is coalesced. Slots stay on a fixed cadence, so timers that
+// fire a tick late do not lower the achieved rate. Snapshots no frame
+// showed count as skipped.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void setFps(double fps) { m_interval = std::chrono::microseconds((int64_t)(1e6 / std::max(1.0, fps))); }
+
+    // Milliseconds until the next frame slot, 0 if it is open.
+    int delayMs(Clock::time_point now) const {
+        auto d = m_next - now;
+        return d <= std::chrono::milliseconds(1) ? 0 : (int)std::chrono::ceil<std::chrono::milliseconds>(d).count();
+    }
+
+    void frame(uint64_t seq, Clock::time_point now) {
+        m_next = m_next + m_interval > now ? m_next + m_interval : now + m_interval;
+        ++m_frames;
+        if (m_seq && seq > m_seq + 1) m_skipped += seq - m_seq - 1;
+        m_seq = seq;
+    }
+
+    // At most once a second: frames per second and snapshots skipped since the last report.
+    bool report(Clock::time_point now, double& fps, uint64_t& skipped) {
+        double secs = std::chrono::duration<double>(now - m_since).count();
+        if (secs < 1) return false;
+        fps = m_frames / secs; skipped = m_skipped;
+        m_frames = m_skipped = 0; m_since = now;
+        return true;
+    }
+
+private:
+    Clock::duration m_interval = std::chrono::milliseconds(33);
+    Clock::time_point m_next{}, m_since = Clock::now();
+    uint64_t m_seq = 0, m_frames = 0, m_skipped = 0;
+};
+
+#ifdef _WIN32
+static std::wstring fmtValue(double v, int decimals, const wchar_t* unit) {
+    if (std::isnan(v)) return L"N/A";
+    wchar_t buf[32];
+    swprintf(buf, 32, L"%.*f%ls", decimals, v, unit);
+    return buf;
+}
+
+// COLORREF as a 0x00RRGGBB raster pixel.
+static uint32_t toPixel(COLORREF c) { return (GetRValue(c) << 16) | (GetGValue(c) << 8) | GetBValue(c); }
+
+// ─── GPUInfoPanel ───────────────────────────────────────────────────────────
+class GPUInfoPanel {
+public:
+    static int PANEL_HEIGHT() { return D(170); }
+    static constexpr const wchar_t* CLASS_NAME = L"GPUInfoPanelClass";
+    static bool s_registered;
+
+    static void registerClass() {
+        if (s_registered) return;
+        WNDCLASSW wc = {};
+        wc.lpfnWndProc   = panelProc;
+        wc.hInstance      = g_hInst;
+        wc.lpszClassName  = CLASS_NAME;
+        wc.hCursor        = LoadCursor(NULL, IDC_ARROW);
+        RegisterClassW(&wc);
+        s_registered = true;
+    }
+
+    GPUInfoPanel(HWND parent, int y, int w) {
+        registerClass();
+        m_hwnd = CreateWindowExW(0, CLASS_NAME, L"", WS_CHILD | WS_VISIBLE,
+                                 0, y, w, PANEL_HEIGHT(), parent, NULL, g_hInst, this);
+
+        m_fontTitle  = CreateFontW(-D(22), 0, 0, 0, FW_BOLD, 0, 0, 0, DEFAULT_CHARSET,
+                                   0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
+        m_fontNormal = CreateFontW(-D(14), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
+                                   0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
+        m_fontSmall  = CreateFontW(-D(11), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
+                                   0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
+        m_fontTiny   = CreateFontW(-D(10), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
+                                   0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
+
+        // Rolling statistics tooltip, one tool per metric; text on demand
+        m_tip = CreateWindowExW(0, TOOLTIPS_CLASSW, NULL, WS_POPUP | TTS_ALWAYSTIP | TTS_NOPREFIX,
+                                CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT,
+                                m_hwnd, NULL, g_hInst, NULL);
+        SendMessageW(m_tip, TTM_SETMAXTIPWIDTH, 0, D(420));
+        SendMessageW(m_tip, TTM_SETDELAYTIME, TTDT_AUTOPOP, 30000);
+        for (int m = 0; m < M_COUNT; ++m) {
+            TOOLINFOW ti = {};
+            ti.cbSize = TTTOOLINFOW_V2_SIZE;
+            ti.uFlags = TTF_SUBCLASS;
+            ti.hwnd = m_hwnd; ti.uId = m;
+            ti.lpszText = LPSTR_TEXTCALLBACKW;
+            SendMessageW(m_tip, TTM_ADDTOOLW, 0, (LPARAM)&ti);
+        }
+        layoutTips(w);
+    }
+
+    ~GPUInfoPanel() {
+        DeleteObject(m_fontTitle); DeleteObject(m_fontNormal);
+        DeleteObject(m_fontSmall); DeleteObject(m_fontTiny);
+        if (m_tip) DestroyWindow(m_tip);
+        if (m_hwnd) DestroyWindow(m_hwnd);
+    }
+
+    HWND hwnd() const { return m_hwnd; }
+    void reposition(int y, int w) { MoveWindow(m_hwnd, 0, y, w, PANEL_HEIGHT(), TRUE); layoutTips(w); }
+
+    void updateInfo(const GpuIdentity* id, const GpuSample& s) {
+        m_index     = s.index;
+        m_gpuModel  = id ? toW(id->name) : L"Unknown GPU";
+        m_gpuId     = L"#" + std::to_wstring(id && id->index >= 0 ? id->index : s.index);
+        m_pciBusId  = L"pci: " + (id ? toW(id->pciBusId) : std::wstring(L"N/A"));
+        m_util      = fmtValue(s.v[M_UTIL], 0, L"%");
+        m_clock     = fmtValue(s.v[M_CLOCK], 0, L"MHz");
+        m_memUsed   = fmtValue(s.v[M_MEM_USED], 0, L"M");
+        m_memTotal  = fmtValue(id ? id->memTotal : NAN, 0, L"M");
+        m_temp      = fmtValue(s.v[M_TEMP], 0, L"\u2103");
+        m_fan       = fmtValue(s.v[M_FAN], 0, L"%");
+        m_powerDraw  = fmtValue(s.v[M_POWER], 2, L"W");
+        m_powerLimit = fmtValue(id ? id->powerLimit : NAN, 2, L"W");
+
+        double mt = id ? id->memTotal : NAN, mu = s.v[M_MEM_USED];
+        m_memPct = (mt > 0 && !std::isnan(mu)) ? (int)(mu * 100.0 / mt) : 0;
+        double pl = id ? id->powerLimit : NAN, pd = s.v[M_POWER];
+        m_powerPct = (pl > 0 && !std::isnan(pd)) ? (int)(pd * 100.0 / pl) : 0;
+
+        GpuDetailPtr d = g_details.get(s.index);
+        if (d != m_detail) {
+            m_detail = d;
+            m_mig = d && d->migEnabled ? toW(describeMig(*d)) : std::wstring();
+        }
+
+        InvalidateRect(m_hwnd, NULL, FALSE);
+    }
+
+private:
+    HWND m_hwnd = NULL, m_tip = NULL;
+    HFONT m_fontTitle, m_fontNormal, m_fontSmall, m_fontTiny;
+    int m_index = -1;
+    std::wstring m_tipText;
+
+    std::wstring m_gpuModel = L"Graphics Device", m_gpuId = L"#0", m_pciBusId = L"bus: 00:00.0";
+    std::wstring m_temp = L"N/A", m_fan = L"N/A", m_util = L"N/A", m_clock = L"N/A";
+    std::wstring m_memUsed = L"N/A", m_memTotal = L"N/A";
+    std::wstring m_powerDraw = L"N/A", m_powerLimit = L"N/A";
+    int m_memPct = 0, m_powerPct = 0;
+    GpuDetailPtr m_detail;
+    std::wstring m_mig;             // MIG roll-up, empty without MIG; a click drills down
+
+    // Hover areas match onPaint's layout: the four stat cells, then the
+    // memory and power rows.
+    void layoutTips(int W) {
+        int xPad = D(10), usableW = W - 2 * xPad, statsY = D(55);
+        RECT rc[M_COUNT];
+        static const Metric cells[4] = {M_UTIL, M_TEMP, M_FAN, M_CLOCK};
+        for (int i = 0; i < 4; ++i)
+            rc[cells[i]] = {xPad + i * usableW / 4, statsY, xPad + (i + 1) * usableW / 4, statsY + D(24)};
+        rc[M_MEM_USED] = {0, D(88), W, D(126)};
+        rc[M_POWER]    = {0, D(130), W, D(168)};
+        for (int m = 0; m < M_COUNT; ++m) {
+            TOOLINFOW ti = {};
+            ti.cbSize = TTTOOLINFOW_V2_SIZE;
+            ti.hwnd = m_hwnd; ti.uId = m; ti.rect = rc[m];
+            SendMessageW(m_tip, TTM_NEWTOOLRECTW, 0, (LPARAM)&ti);
+        }
+    }
+
+    void onTipText(NMTTDISPINFOW* di) {
+        int metric = (int)di->hdr.idFrom;
+        static const int decimals[M_COUNT] = {1, 1, 1, 0, 0, 2};
+        std::vector<int> wins = g_stats.windows();
+        std::vector<WindowStats> st = g_stats.get(m_index, metric);
+        m_tipText = toW(METRIC_FIELDS[metric]);
+        for (size_t w = 0; w < st.size(); ++w) {
+            wchar_t label[16], line[160];
+            int sec = wins[w];
+            if (sec % 3600 == 0) swprintf(label, 16, L"%dh", sec / 3600);
+            else if (sec % 60 == 0) swprintf(label, 16, L"%dm", sec / 60);
+            else swprintf(label, 16, L"%ds", sec);
+            if (st[w].n == 0) { swprintf(line, 160, L"\r\n%ls\tno data", label); m_tipText += line; continue; }
+            int d = decimals[metric];
+            swprintf(line, 160, L"\r\n%ls\tmin %.*f  max %.*f  mean %.*f  sd %.*f", label,
+                     d, st[w].min, d, st[w].max, d + 1, st[w].mean, d + 1, st[w].stddev);
+            m_tipText += line;
+        }
+        for (const auto& span : QUANTILE_SPANS) {
+            QuantileSketch q = g_quantiles.get(m_index, metric, span.ms);
+            if (!q.count()) continue;
+            wchar_t line[160];
+            int d = decimals[metric];
+            swprintf(line, 160, L"\r\n%hs\tp50 %.*f  p95 %.*f  p99 %.*f", span.label,
+                     d, q.quantile(0.5), d, q.quantile(0.95), d, q.quantile(0.99));
+            m_tipText += line;
+        }
+        di->lpszText = &m_tipText[0];
+    }
+
+    void drawProgressBar(HDC hdc, int x, int y, int w, int h, int pct) {
+        HRGN clip = CreateRoundRectRgn(x, y, x + w, y + h, D(16), D(16));
+        SelectClipRgn(hdc, clip);
+
+        RECT rcBg = {x, y, x + w, y + h};
+        HBRUSH bgBr = CreateSolidBrush(g_theme.progress_bg);
+        FillRect(hdc, &rcBg, bgBr); DeleteObject(bgBr);
+
+        if (pct > 0) {
+            int cw = w * std::min(pct, 100) / 100;
+            RECT rcChunk = {x, y, x + cw, y + h};
+            HBRUSH chBr = CreateSolidBrush(g_theme.progress_chunk);
+            FillRect(hdc, &rcChunk, chBr); DeleteObject(chBr);
+        }
+        SelectClipRgn(hdc, NULL); DeleteObject(clip);
+
+        HPEN pen = CreatePen(PS_SOLID, 1, g_theme.border);
+        HPEN oldPen = (HPEN)SelectObject(hdc, pen);
+        SelectObject(hdc, GetStockObject(NULL_BRUSH));
+        RoundRect(hdc, x, y, x + w, y + h, D(16), D(16));
+        SelectObject(hdc, oldPen); DeleteObject(pen);
+
+        wchar_t buf[16]; wsprintfW(buf, L"%d%%", pct);
+        RECT rcText = {x, y, x + w, y + h};
+        SelectObject(hdc, m_fontNormal);
+        SetTextColor(hdc, g_theme.progress_text);
+        DrawTextW(hdc, buf, -1, &rcText, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+    }
+
+    void onPaint() {
+        PAINTSTRUCT ps;
+        HDC hdc = BeginPaint(m_hwnd, &ps);
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        int W = rc.right, H = rc.bottom;
+
+        HDC mem = CreateCompatibleDC(hdc);
+        HBITMAP bmp = CreateCompatibleBitmap(hdc, W, H);
+        SelectObject(mem, bmp);
+
+        // Background
+        HBRUSH bgBr = CreateSolidBrush(g_theme.bg);
+        FillRect(mem, &rc, bgBr); DeleteObject(bgBr);
+        SetBkMode(mem, TRANSPARENT);
+
+        int xPad = D(10);
+        int iconSz = D(24);
+
+        // ── Row 1: GPU model name ──
+        SelectObject(mem, m_fontTitle);
+        SetTextColor(mem, g_theme.title_text);
+        RECT r1 = {xPad, D(5), W - xPad, D(33)};
+        DrawTextW(mem, m_gpuModel.c_str(), -1, &r1, DT_LEFT | DT_SINGLELINE | DT_END_ELLIPSIS);
+
+        // ── Row 2: GPU ID + PCI bus ──
+        SelectObject(mem, m_fontSmall);
+        SetTextColor(mem, g_theme.sub_text);
+        RECT r2a = {xPad, D(35), xPad + D(30), D(49)};
+        DrawTextW(mem, m_gpuId.c_str(), -1, &r2a, DT_LEFT | DT_SINGLELINE);
+        RECT r2b = {xPad + D(32), D(35), W - xPad, D(49)};
+        DrawTextW(mem, m_pciBusId.c_str(), -1, &r2b, DT_LEFT | DT_SINGLELINE);
+        if (!m_mig.empty()) {
+            SetTextColor(mem, g_theme.progress_chunk);
+            DrawTextW(mem, m_mig.c_str(), -1, &r2b, DT_RIGHT | DT_SINGLELINE);
+        }
+
+        // ── Row 3: Stats with icons ──
+        int statsY = D(55);
+        int usableW = W - 2 * xPad;
+        struct StatItem { HBITMAP icon; const std::wstring* val; };
+        StatItem stats[] = {
+            {g_bmpGear,   &m_util},
+            {g_bmpThermo, &m_temp},
+            {g_bmpFan,    &m_fan},
+            {g_bmpWave,   &m_clock},
+        };
+
+        SelectObject(mem, m_fontNormal);
+        SetTextColor(mem, g_theme.text);
+        for (int i = 0; i < 4; ++i) {
+            int sx = xPad + i * usableW / 4;
+            drawBmp(mem, stats[i].icon, sx, statsY, iconSz);
+            RECT rs = {sx + iconSz + D(4), statsY, sx + usableW / 4, statsY + iconSz};
+            DrawTextW(mem, stats[i].val->c_str(), -1, &rs, DT_LEFT | DT_VCENTER | DT_SINGLELINE);
+        }
+
+        // ── Row 4: Memory bar ──
+        int barRowY1 = D(88);
+        int xIcon = xPad;
+        int xVal  = xPad + iconSz + D(6);
+        int wVal  = D(60);
+        int xBar  = xVal + wVal + D(8);
+        int wBar  = W - xBar - xPad;
+        int barH  = D(20);
+        int rowH  = D(38);
+
+        drawBmp(mem, g_bmpRam, xIcon, barRowY1 + (rowH - iconSz) / 2, iconSz);
+
+        SelectObject(mem, m_fontTiny);
+        SetTextColor(mem, g_theme.text);
+        RECT rmU = {xVal, barRowY1, xVal + wVal, barRowY1 + D(14)};
+        DrawTextW(mem, m_memUsed.c_str(), -1, &rmU, DT_CENTER | DT_SINGLELINE);
+        HPEN sepPen = CreatePen(PS_SOLID, 1, g_theme.sub_text);
+        HPEN oldP = (HPEN)SelectObject(mem, sepPen);
+        MoveToEx(mem, xVal, barRowY1 + D(15), NULL);
+        LineTo(mem, xVal + wVal, barRowY1 + D(15));
+        SelectObject(mem, oldP); DeleteObject(sepPen);
+        RECT rmT = {xVal, barRowY1 + D(17), xVal + wVal, barRowY1 + D(31)};
+        DrawTextW(mem, m_memTotal.c_str(), -1, &rmT, DT_CENTER | DT_SINGLELINE);
+        drawProgressBar(mem, xBar, barRowY1 + (rowH - barH) / 2, wBar, barH, m_memPct);
+
+        // ── Row 5: Power bar ──
+        int barRowY2 = D(130);
+
+        drawBmp(mem, g_bmpGauge, xIcon, barRowY2 + (rowH - iconSz) / 2, iconSz);
+
+        SelectObject(mem, m_fontTiny);
+        SetTextColor(mem, g_theme.text);
+        RECT rpD = {xVal, barRowY2, xVal + wVal, barRowY2 + D(14)};
+        DrawTextW(mem, m_powerDraw.c_str(), -1, &rpD, DT_CENTER | DT_SINGLELINE);
+        sepPen = CreatePen(PS_SOLID, 1, g_theme.sub_text);
+        oldP = (HPEN)SelectObject(mem, sepPen);
+        MoveToEx(mem, xVal, barRowY2 + D(15), NULL);
+        LineTo(mem, xVal + wVal, barRowY2 + D(15));
+        SelectObject(mem, oldP); DeleteObject(sepPen);
+        RECT rpL = {xVal, barRowY2 + D(17), xVal + wVal, barRowY2 + D(31)};
+        DrawTextW(mem, m_powerLimit.c_str(), -1, &rpL, DT_CENTER | DT_SINGLELINE);
+        drawProgressBar(mem, xBar, barRowY2 + (rowH - barH) / 2, wBar, barH, m_powerPct);
+
+        // Bottom border line
+        HPEN borderPen = CreatePen(PS_SOLID, 1, g_theme.border);
+        oldP = (HPEN)SelectObject(mem, borderPen);
+        MoveToEx(mem, 0, H - 1, NULL);
+        LineTo(mem, W, H - 1);
+        SelectObject(mem, oldP); DeleteObject(borderPen);
+
+        BitBlt(hdc, 0, 0, W, H, mem, 0, 0, SRCCOPY);
+        DeleteObject(bmp); DeleteDC(mem);
+        EndPaint(m_hwnd, &ps);
+    }
+
+    static LRESULT CALLBACK panelProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
+        GPUInfoPanel* self = nullptr;
+        if (msg == WM_NCCREATE) {
+            auto* cs = reinterpret_cast<CREATESTRUCTW*>(lp);
+            self = reinterpret_cast<GPUInfoPanel*>(cs->lpCreateParams);
+            SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(self));
+        } else {
+            self = reinterpret_cast<GPUInfoPanel*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+        }
+        switch (msg) {
+        case WM_PAINT:    if (self) self->onPaint(); return 0;
+        case WM_ERASEBKGND: return 1;
+        case WM_LBUTTONDOWN:
+            if (self && self->m_index >= 0) PostMessage(GetParent(hwnd), WM_GPU_PICK, (WPARAM)self->m_index, 0);
+            return 0;
+        case WM_NOTIFY:
+            if (self && reinterpret_cast<NMHDR*>(lp)->code == TTN_GETDISPINFOW) {
+                self->onTipText(reinterpret_cast<NMTTDISPINFOW*>(lp)); return 0;
+            }
+            break;
+        }
+        return DefWindowProcW(hwnd, msg, wp, lp);
+    }
+};
+bool GPUInfoPanel::s_registered = false;
+
+// ─── FleetHeatmap ───────────────────────────────────────────────────────────
+// Overview of a large fleet: a header line over a HeatmapRaster, flushed with
+// StretchDIBits for the dirty cells only. U / T / M pick the metric (keys are
+// forwarded by MainWindow); clicking a cell calls `onPick` with its index.
+class FleetHeatmap {
+public:
+    static constexpr const wchar_t* CLASS_NAME = L"NvSmiGuiHeatmapClass";
+    static int HEADER_HEIGHT() { return D(26); }
+
+    static void registerClass() {
+        WNDCLASSW wc = {};
+        wc.lpfnWndProc   = heatmapProc;
+        wc.hInstance      = g_hInst;
+        wc.lpszClassName  = CLASS_NAME;
+        wc.hCursor        = LoadCursor(NULL, IDC_HAND);
+        RegisterClassW(&wc);
+    }
+
+    FleetHeatmap(HWND parent, int w, std::function<void(int)> onPick) : m_onPick(std::move(onPick)) {
+        registerClass();
+        m_hwnd = CreateWindowExW(0, CLASS_NAME, L"", WS_CHILD | WS_VISIBLE,
+                                 0, 0, w, HEADER_HEIGHT(), parent, NULL, g_hInst, this);
+        m_font = CreateFontW(-D(12), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
+                             0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
+        uint32_t colors[HeatmapRaster::BUCKETS + 2];
+        for (int b = 0; b < HeatmapRaster::BUCKETS; ++b) colors[b] = rampColor(b);
+        colors[HeatmapRaster::B_NA] = toPixel(g_theme.progress_bg);
+        colors[HeatmapRaster::B_EMPTY] = toPixel(g_theme.bg);
+        m_raster.setPalette(colors);
+        m_width = w;
+    }
+
+    ~FleetHeatmap() { DeleteObject(m_font); if (m_hwnd) DestroyWindow(m_hwnd); }
+
+    HWND hwnd() const { return m_hwnd; }
+    int height() const { return HEADER_HEIGHT() + m_raster.height() + D(10); }
+
+    // The hosts on screen connect first under --hosts. The grid shrinks its
+    // cells to fit, so that is usually all of them.
+    void reportVisible() {
+        int first, last;
+        m_raster.cellsIn(0, m_viewH, first, last);
+        g_visibleHostFirst = hostOf(first); g_visibleHostLast = hostOf(last);
+    }
+
+    void setMetric(HeatMetric m) {
+        if (m == m_metric) return;
+        m_metric = m;
+        if (m_last) m_raster.update(*m_last, m_metric, m_memTotal);
+        InvalidateRect(m_hwnd, NULL, FALSE);
+    }
+
+    // Returns true when the grid was laid out again and height() changed.
+    bool update(const SnapshotPtr& snap, int maxHeight) {
+        m_last = snap;
+        int count = std::max(g_fleetSlots, snap->gpus.empty() ? 0 : snap->gpus.back().index + 1);
+        bool relayout = count > m_raster.count();
+        if (relayout) {
+            m_viewH = maxHeight - HEADER_HEIGHT() - D(10);
+            m_raster.layout(count, g_gpusPerHost, m_width - 2 * D(10), m_viewH);
+            m_hosts = hostOf(count - 1) + 1;
+            MoveWindow(m_hwnd, 0, 0, m_width, height(), FALSE);
+            reportVisible();
+        }
+        if (relayout || ++m_ticks % 64 == 0) refreshCapacity();
+        m_raster.update(*snap, m_metric, m_memTotal);
+        HeatmapRaster::Rect r;
+        if (relayout) { m_raster.takeDirty(r); InvalidateRect(m_hwnd, NULL, FALSE); }
+        else {
+            RECT hdr = {0, 0, m_width, HEADER_HEIGHT()};
+            InvalidateRect(m_hwnd, &hdr, FALSE);
+            if (m_raster.takeDirty(r)) {
+                RECT rc = {D(10) + r.left, HEADER_HEIGHT() + r.top, D(10) + r.right, HEADER_HEIGHT() + r.bottom};
+                InvalidateRect(m_hwnd, &rc, FALSE);
+            }
+        }
+        return relayout;
+    }
+
+private:
+    HWND m_hwnd = NULL;
+    HFONT m_font;
+    HeatmapRaster m_raster;
+    HeatMetric m_metric = HM_UTIL;
+    SnapshotPtr m_last;
+    std::vector<double> m_memTotal;
+    std::function<void(int)> m_onPick;
+    int m_width = 0, m_hosts = 0, m_viewH = 0;
+    unsigned m_ticks = 0;
+
+    // Cool-to-hot ramp, green through amber to red.
+    static uint32_t rampColor(int bucket) {
+        static const double STOPS[3][3] = {{0x2e, 0x9e, 0x5b}, {0xe8, 0xc1, 0x3c}, {0xd9, 0x3b, 0x2f}};
+        double t = bucket / (double)(HeatmapRaster::BUCKETS - 1) * 2;
+        int s = std::min(1, (int)t); t -= s;
+        uint32_t c = 0;
+        for (int k = 0; k < 3; ++k) c = (c << 8) | (uint32_t)std::lround(STOPS[s][k] + (STOPS[s + 1][k] - STOPS[s][k]) * t);
+        return c;
+    }
+
+    // memory.total comes from the identity table, which changes rarely.
+    void refreshCapacity() {
+        m_memTotal.assign(m_raster.count(), NAN);
+        for (int i = 0; i < m_raster.count(); ++i)
+            if (GpuIdentityPtr id = g_identities.get(i)) m_memTotal[i] = id->memTotal;
+    }
+
+    void onPaint() {
+        PAINTSTRUCT ps;
+        HDC hdc = BeginPaint(m_hwnd, &ps);
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        int x0 = D(10), y0 = HEADER_HEIGHT();
+
+        if (ps.rcPaint.top < y0) {
+            RECT hdr = {0, 0, rc.right, y0};
+            HBRUSH bg = CreateSolidBrush(g_theme.bg);
+            FillRect(hdc, &hdr, bg); DeleteObject(bg);
+            FleetAggregate a = g_fleet.fleet();
+            wchar_t text[256];
+            swprintf(text, 256, L"%hs  ·  %u GPUs on %d hosts  ·  %.1f kW  ·  mean util %.0f%%  ·  %u at %.0f°C+"
+                     L"  ·  U / T / M to switch, click a GPU for details",
+                     HEAT_METRIC_NAMES[m_metric], a.gpus, m_hosts, a.sum[M_POWER] / 1000, a.mean(M_UTIL), a.hot, HOT_TEMP);
+            HFONT old = (HFONT)SelectObject(hdc, m_font);
+            SetBkMode(hdc, TRANSPARENT); SetTextColor(hdc, g_theme.sub_text);
+            RECT tr = {x0, 0, rc.right - x0, y0};
+            DrawTextW(hdc, text, -1, &tr, DT_SINGLELINE | DT_VCENTER | DT_END_ELLIPSIS);
+            SelectObject(hdc, old);
+        }
+
+        RECT grid = {x0, y0, x0 + m_raster.width(), y0 + m_raster.height()}, part;
+        if (IntersectRect(&part, &grid, &ps.rcPaint)) {
+            BITMAPINFO bmi = {};
+            bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+            bmi.bmiHeader.biWidth = m_raster.width();
+            bmi.bmiHeader.biHeight = -m_raster.height(); // top-down
+            bmi.bmiHeader.biPlanes = 1;
+            bmi.bmiHeader.biBitCount = 32;
+            bmi.bmiHeader.biCompression = BI_RGB;
+            int w = part.right - part.left, h = part.bottom - part.top;
+            StretchDIBits(hdc, part.left, part.top, w, h, part.left - x0, part.top - y0, w, h,
+                          m_raster.pixels(), &bmi, DIB_RGB_COLORS, SRCCOPY);
+        }
+
+        // Margins around the grid
+        HBRUSH bg = CreateSolidBrush(g_theme.bg);
+        RECT side[3] = {{0, y0, x0, rc.bottom}, {grid.right, y0, rc.right, rc.bottom}, {x0, grid.bottom, grid.right, rc.bottom}};
+        for (auto& r : side) if (IntersectRect(&part, &r, &ps.rcPaint)) FillRect(hdc, &part, bg);
+        DeleteObject(bg);
+        EndPaint(m_hwnd, &ps);
+    }
+
+    static LRESULT CALLBACK heatmapProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
+        FleetHeatmap* self = nullptr;
+        if (msg == WM_NCCREATE) {
+            auto* cs = reinterpret_cast<CREATESTRUCTW*>(lp);
+            self = reinterpret_cast<FleetHeatmap*>(cs->lpCreateParams);
+            SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(self));
+        } else {
+            self = reinterpret_cast<FleetHeatmap*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+        }
+        switch (msg) {
+        case WM_PAINT: if (self) self->onPaint(); return 0;
+        case WM_ERASEBKGND: return 1;
+        case WM_LBUTTONDOWN:
+            if (self) {
+                int i = self->m_raster.hitTest((short)LOWORD(lp) - D(10), (short)HIWORD(lp) - HEADER_HEIGHT());
+                if (i >= 0 && self->m_onPick) self->m_onPick(i);
+            }
+            return 0;
+        }
+        return DefWindowProcW(hwnd, msg, wp, lp);
+    }
+};
+
+// ─── PanelGrid ──────────────────────────────────────────────────────────────
+// The fleet as a scrolling grid of TileRaster panels: a header line over the
+// raster, with changed tiles drawn on the render pool and only their union
+// flushed with StretchDIBits. The mouse wheel scrolls; clicking a tile calls
+// `onPick` with its index.
+class PanelGrid {
+public:
+    static constexpr const wchar_t* CLASS_NAME = L"NvSmiGuiPanelGridClass";
+    static int HEADER_HEIGHT() { return D(26); }
+
+    static void registerClass() {
+        WNDCLASSW wc = {};
+        wc.lpfnWndProc   = gridProc;
+        wc.hInstance      = g_hInst;
+        wc.lpszClassName  = CLASS_NAME;
+        wc.hCursor        = LoadCursor(NULL, IDC_HAND);
+        RegisterClassW(&wc);
+    }
+
+    PanelGrid(HWND parent, int w, RenderPool& pool, std::function<void(int)> onPick)
+        : m_pool(pool), m_onPick(std::move(onPick)) {
+        registerClass();
+        m_hwnd = CreateWindowExW(0, CLASS_NAME, L"", WS_CHILD | WS_VISIBLE,
+                                 0, 0, w, HEADER_HEIGHT(), parent, NULL, g_hInst, this);
+        m_font = CreateFontW(-D(12), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
+                             0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
+        m_raster.setPalette({toPixel(g_theme.bg), toPixel(g_darkMode ? RGB(0x24, 0x24, 0x24) : RGB(0xff, 0xff, 0xff)),
+                             toPixel(g_theme.text), toPixel(g_theme.sub_text), toPixel(g_theme.title_text),
+                             toPixel(g_theme.progress_bg), toPixel(g_theme.progress_chunk)});
+        m_width = w;
+    }
+
+    ~PanelGrid() { DeleteObject(m_font); if (m_hwnd) DestroyWindow(m_hwnd); }
+
+    HWND hwnd() const { return m_hwnd; }
+    int height() const { return HEADER_HEIGHT() + m_viewH + D(10); }
+
+    // Returns true when the grid was laid out again and height() changed.
+    bool update(const FleetSnapshot& snap, int maxHeight) {
+        int count = std::max(g_fleetSlots, snap.gpus.empty() ? 0 : snap.gpus.back().index + 1);
+        bool relayout = count > m_raster.count();
+        if (relayout) {
+            m_raster.layout(count, m_width - 2 * D(10), std::max(1, (int)std::lround(g_dpiScale)));
+            m_viewH = std::min(m_raster.height(), maxHeight - HEADER_HEIGHT() - D(10));
+            m_scroll = std::min(m_scroll, m_raster.height() - m_viewH);
+            MoveWindow(m_hwnd, 0, 0, m_width, height(), FALSE);
+            reportVisible();
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        int changed = m_raster.update(snap);
+        m_raster.render(m_pool);
+        m_renderUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        m_changed = changed;
+        HeatmapRaster::Rect r;
+        bool dirty = m_raster.takeDirty(r);
+        if (relayout) InvalidateRect(m_hwnd, NULL, FALSE);
+        else {
+            RECT hdr = {0, 0, m_width, HEADER_HEIGHT()};
+            InvalidateRect(m_hwnd, &hdr, FALSE);
+            if (dirty) {
+                RECT rc = {D(10) + r.left, HEADER_HEIGHT() + r.top - m_scroll, D(10) + r.right, HEADER_HEIGHT() + r.bottom - m_scroll}, part;
+                RECT view = {0, HEADER_HEIGHT(), m_width, HEADER_HEIGHT() + m_viewH};
+                if (IntersectRect(&part, &rc, &view)) InvalidateRect(m_hwnd, &part, FALSE);
+            }
+        }
+        return relayout;
+    }
+
+    // The hosts on screen connect first under --hosts.
+    void reportVisible() {
+        int first, last;
+        m_raster.rowsIn(m_scroll, m_scroll + m_viewH, first, last);
+        g_visibleHostFirst = hostOf(first); g_visibleHostLast = hostOf(last);
+    }
+
+private:
+    HWND m_hwnd = NULL;
+    HFONT m_font;
+    TileRaster m_raster;
+    RenderPool& m_pool;
+    std::function<void(int)> m_onPick;
+    int m_width = 0, m_viewH = 0, m_scroll = 0, m_changed = 0;
+    double m_renderUs = 0;
+
+    void onPaint() {
+        PAINTSTRUCT ps;
+        HDC hdc = BeginPaint(m_hwnd, &ps);
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        int x0 = D(10), y0 = HEADER_HEIGHT();
+
+        if (ps.rcPaint.top < y0) {
+            RECT hdr = {0, 0, rc.right, y0};
+            HBRUSH bg = CreateSolidBrush(g_theme.bg);
+            FillRect(hdc, &hdr, bg); DeleteObject(bg);
+            wchar_t text[256];
+            swprintf(text, 256, L"%d GPUs  ·  %d panels redrawn in %.0f µs on %d threads  ·  G for the heatmap, wheel to scroll",
+                     m_raster.count(), m_changed, m_renderUs, m_pool.threads());
+            HFONT old = (HFONT)SelectObject(hdc, m_font);
+            SetBkMode(hdc, TRANSPARENT); SetTextColor(hdc, g_theme.sub_text);
+            RECT tr = {x0, 0, rc.right - x0, y0};
+            DrawTextW(hdc, text, -1, &tr, DT_SINGLELINE | DT_VCENTER | DT_END_ELLIPSIS);
+            SelectObject(hdc, old);
+        }
+
+        RECT grid = {x0, y0, x0 + m_raster.width(), y0 + m_viewH}, part;
+        if (IntersectRect(&part, &grid, &ps.rcPaint)) {
+            BITMAPINFO bmi = {};
+            bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+            bmi.bmiHeader.biWidth = m_raster.width();
+            bmi.bmiHeader.biHeight = -m_raster.height(); // top-down
+            bmi.bmiHeader.biPlanes = 1;
+            bmi.bmiHeader.biBitCount = 32;
+            bmi.bmiHeader.biCompression = BI_RGB;
+            int w = part.right - part.left, h = part.bottom - part.top;
+            StretchDIBits(hdc, part.left, part.top, w, h, part.left - x0, part.top - y0 + m_scroll, w, h,
+                          m_raster.pixels(), &bmi, DIB_RGB_COLORS, SRCCOPY);
+        }
+
+        HBRUSH bg = CreateSolidBrush(g_theme.bg);
+        RECT side[3] = {{0, y0, x0, rc.bottom}, {grid.right, y0, rc.right, rc.bottom}, {x0, grid.bottom, grid.right, rc.bottom}};
+        for (auto& r : side) if (IntersectRect(&part, &r, &ps.rcPaint)) FillRect(hdc, &part, bg);
+        DeleteObject(bg);
+        EndPaint(m_hwnd, &ps);
+    }
+
+    void scrollBy(int dy) {
+        int s = std::max(0, std::min(m_scroll + dy, m_raster.height() - m_viewH));
+        if (s == m_scroll) return;
+        m_scroll = s;
+        reportVisible();
+        RECT view = {0, HEADER_HEIGHT(), m_width, HEADER_HEIGHT() + m_viewH};
+        InvalidateRect(m_hwnd, &view, FALSE);
+    }
+
+    static LRESULT CALLBACK gridProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
+        PanelGrid* self = nullptr;
+        if (msg == WM_NCCREATE) {
+            auto* cs = reinterpret_cast<CREATESTRUCTW*>(lp);
+            self = reinterpret_cast<PanelGrid*>(cs->lpCreateParams);
+            SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(self));
+        } else {
+            self = reinterpret_cast<PanelGrid*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+        }
+        switch (msg) {
+        case WM_PAINT: if (self) self->onPaint(); return 0;
+        case WM_ERASEBKGND: return 1;
+        case WM_MOUSEWHEEL:
+            if (self) self->scrollBy(-GET_WHEEL_DELTA_WPARAM(wp) * D(TileRaster::TILE_H + TileRaster::GAP) * 3 / WHEEL_DELTA);
+            return 0;
+        case WM_LBUTTONDOWN:
+            if (self) {
+                int i = self->m_raster.hitTest((short)LOWORD(lp) - D(10), (short)HIWORD(lp) - HEADER_HEIGHT() + self->m_scroll);
+                if (i >= 0 && self->m_onPick) self->m_onPick(i);
+            }
+            return 0;
+        }
+        return DefWindowProcW(hwnd, msg, wp, lp);
+    }
+};
+
+// ─── DetailWindow ───────────────────────────────────────────────────────────
+// Owned popup with the regular GPUInfoPanel for one GPU picked from the
+// heatmap, a history chart below it (1-5 pick the span, U / T / F / C / M / P
+// the metric) and the latest `-q -x` detail at the bottom. Closing it only
+// hides it.
+class DetailWindow {
+public:
+    static constexpr const wchar_t* CLASS_NAME = L"NvSmiGuiDetailClass";
+    static int CHART_HEIGHT() { return D(160); }
+    static int INFO_HEIGHT() { return D(64); }
+    static int MIG_ROW() { return D(20); }
+
+    static void registerClass() {
+        WNDCLASSW wc = {};
+        wc.lpfnWndProc   = detailProc;
+        wc.hInstance      = g_hInst;
+        wc.lpszClassName  = CLASS_NAME;
+        wc.hCursor        = LoadCursor(NULL, IDC_ARROW);
+        wc.hbrBackground  = CreateSolidBrush(g_theme.bg);
+        RegisterClassW(&wc);
+    }
+
+    explicit DetailWindow(HWND owner) {
+        registerClass();
+        RECT adj = {0, 0, D(480), GPUInfoPanel::PANEL_HEIGHT() + CHART_HEIGHT() + INFO_HEIGHT()};
+        AdjustWindowRectEx(&adj, WS_FIXED, FALSE, 0);
+        m_hwnd = CreateWindowExW(0, CLASS_NAME, L"", WS_FIXED, CW_USEDEFAULT, CW_USEDEFAULT,
+                                 adj.right - adj.left, adj.bottom - adj.top, owner, NULL, g_hInst, this);
+        if (g_darkMode) { BOOL useDark = TRUE; DwmSetWindowAttribute(m_hwnd, 20, &useDark, sizeof(useDark)); }
+        m_panel = new GPUInfoPanel(m_hwnd, 0, D(480));
+        m_font = CreateFontW(-D(11), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
+                             0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
+    }
+
+    ~DetailWindow() { delete m_panel; if (m_hwnd) DestroyWindow(m_hwnd); DeleteObject(m_font); }
+
+    void show(int index, const SnapshotPtr& snap) {
+        m_index = index;
+        wchar_t title[64];
+        swprintf(title, 64, L"GPU %d on host %d", g_gpusPerHost > 0 ? index % g_gpusPerHost : index, hostOf(index));
+        SetWindowTextW(m_hwnd, title);
+        if (snap) update(*snap);
+        ShowWindow(m_hwnd, SW_SHOW);
+        SetForegroundWindow(m_hwnd);
+    }
+
+    void update(const FleetSnapshot& snap) {
+        if (m_index < 0 || !IsWindowVisible(m_hwnd)) return;
+        auto it = std::lower_bound(snap.gpus.begin(), snap.gpus.end(), m_index,
+                                   [](const GpuSample& g, int i) { return g.index < i; });
+        if (it != snap.gpus.end() && it->index == m_index)
+            m_panel->updateInfo(g_identities.get(m_index).get(), *it);
+        GpuDetailPtr d = g_details.get(m_index);
+        fitMigRows(d && d->migEnabled ? (int)d->mig.size() : 0);
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        rc.top = GPUInfoPanel::PANEL_HEIGHT();
+        InvalidateRect(m_hwnd, &rc, FALSE);
+    }
+
+private:
+    static constexpr int64_t SPANS_MS[5] = {300000, 900000, 3600000, 21600000, 86400000};
+    static constexpr const wchar_t* SPAN_NAMES[5] = {L"5 min", L"15 min", L"1 h", L"6 h", L"24 h"};
+
+    HWND m_hwnd = NULL;
+    GPUInfoPanel* m_panel = nullptr;
+    HFONT m_font;
+    int m_index = -1, m_span = 2, m_metric = M_UTIL;
+    int m_migRows = 0;      // MIG instances the window is sized for
+    ChartCache m_charts;
+
+    // One painted row per MIG instance (at most 7), between the chart and
+    // the info strip; the window grows or shrinks when the count changes.
+    void fitMigRows(int rows) {
+        if (rows == m_migRows) return;
+        RECT wr; GetWindowRect(m_hwnd, &wr);
+        SetWindowPos(m_hwnd, NULL, 0, 0, wr.right - wr.left, wr.bottom - wr.top + (rows - m_migRows) * MIG_ROW(),
+                     SWP_NOMOVE | SWP_NOZORDER);
+        m_migRows = rows;
+    }
+
+    void paintMig(HDC hdc) {
+        if (m_migRows == 0) return;
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        rc.top = GPUInfoPanel::PANEL_HEIGHT() + CHART_HEIGHT();
+        rc.bottom = rc.top + m_migRows * MIG_ROW();
+        HBRUSH bg = CreateSolidBrush(g_theme.bg), barBg = CreateSolidBrush(g_theme.progress_bg),
+               bar = CreateSolidBrush(g_theme.progress_chunk);
+        FillRect(hdc, &rc, bg);
+        GpuDetailPtr d = g_details.get(m_index);
+        HFONT old = (HFONT)SelectObject(hdc, m_font);
+        SetBkMode(hdc, TRANSPARENT);
+        int pad = D(10), barX = rc.left + D(150), barW = D(160);
+        for (int i = 0; d && i < m_migRows && i < (int)d->mig.size(); ++i) {
+            const MigDevice& m = d->mig[i];
+            int y = rc.top + i * MIG_ROW();
+            wchar_t label[64], usage[64];
+            swprintf(label, 64, L"MIG %d  ·  gi %d ci %d  ·  %.0f SMs", m.index, m.gi, m.ci, m.sms);
+            swprintf(usage, 64, L"%.0f/%.0f MiB  ·  %d proc", m.memUsed, m.memTotal, m.processes);
+            SetTextColor(hdc, m.processes > 0 ? g_theme.text : g_theme.sub_text);
+            RECT tl = {rc.left + pad, y, barX - D(6), y + MIG_ROW()};
+            DrawTextW(hdc, label, -1, &tl, DT_LEFT | DT_SINGLELINE | DT_VCENTER | DT_END_ELLIPSIS);
+            RECT track = {barX, y + D(6), barX + barW, y + MIG_ROW() - D(6)};
+            FillRect(hdc, &track, barBg);
+            if (m.memTotal > 0 && !std::isnan(m.memUsed)) {
+                RECT fill = track;
+                fill.right = track.left + (int)(barW * std::min(1.0, m.memUsed / m.memTotal));
+                FillRect(hdc, &fill, bar);
+            }
+            RECT tr = {barX + barW + D(6), y, rc.right - pad, y + MIG_ROW()};
+            SetTextColor(hdc, g_theme.sub_text);
+            DrawTextW(hdc, usage, -1, &tr, DT_LEFT | DT_SINGLELINE | DT_VCENTER | DT_END_ELLIPSIS);
+        }
+        SelectObject(hdc, old);
+        DeleteObject(bg); DeleteObject(barBg); DeleteObject(bar);
+    }
+
+    RECT chartRect() const {
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        rc.top = GPUInfoPanel::PANEL_HEIGHT();
+        rc.bottom = rc.top + CHART_HEIGHT();
+        return rc;
+    }
+
+    void paintInfo(HDC hdc) {
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        rc.top = GPUInfoPanel::PANEL_HEIGHT() + CHART_HEIGHT() + m_migRows * MIG_ROW();
+        HBRUSH bg = CreateSolidBrush(g_theme.bg);
+        FillRect(hdc, &rc, bg); DeleteObject(bg);
+        GpuDetailPtr d = g_details.get(m_index);
+        std::wstring text = d ? toW(describeDetail(*d)) : std::wstring(L"No -q -x detail yet");
+        HostSample h;
+        if (g_hostMetrics.get(hostOf(m_index), h)) text = L"Host: " + toW(describeHost(h)) + L"\n" + text;
+        HFONT old = (HFONT)SelectObject(hdc, m_font);
+        SetBkMode(hdc, TRANSPARENT); SetTextColor(hdc, g_theme.sub_text);
+        InflateRect(&rc, -D(10), -D(2));
+        DrawTextW(hdc, text.c_str(), -1, &rc, DT_LEFT | DT_WORDBREAK | DT_END_ELLIPSIS);
+        SelectObject(hdc, old);
+    }
+
+    // One vertical stroke per column from its min to its max, stretched to
+    // meet the previous column so gaps between ranges stay connected.
+    void paintChart(HDC hdc) {
+        RECT rc = chartRect();
+        int W = rc.right - rc.left, H = rc.bottom - rc.top;
+        HDC mem = CreateCompatibleDC(hdc);
+        HBITMAP bmp = CreateCompatibleBitmap(hdc, W, H);
+        SelectObject(mem, bmp);
+        RECT all = {0, 0, W, H};
+        HBRUSH bg = CreateSolidBrush(g_theme.bg);
+        FillRect(mem, &all, bg); DeleteObject(bg);
+
+        int pad = D(10), top = D(22);
+        RECT plot = {pad, top, W - pad, H - D(8)};
+        ChartSeries& s = m_charts.get(m_index, m_metric, SPANS_MS[m_span], plot.right - plot.left);
+        s.update(g_history);
+        float lo = INFINITY, hi = -INFINITY;
+        for (int x = 0; x < s.width(); ++x)
+            if (!std::isnan(s.at(x).min)) { lo = std::min(lo, s.at(x).min); hi = std::max(hi, s.at(x).max); }
+
+        HBRUSH frame = CreateSolidBrush(g_theme.progress_bg);
+        FrameRect(mem, &plot, frame); DeleteObject(frame);
+        if (lo <= hi) {
+            if (hi - lo < 1) { lo -= 0.5f; hi += 0.5f; }
+            int ph = plot.bottom - plot.top - 2;
+            auto y = [&](float v) { return plot.bottom - 1 - (int)std::lround((v - lo) / (hi - lo) * (ph - 1)); };
+            HPEN pen = CreatePen(PS_SOLID, 1, g_theme.progress_chunk);
+            HPEN old = (HPEN)SelectObject(mem, pen);
+            const ChartColumn* prev = nullptr;
+            for (int x = 0; x < s.width(); ++x) {
+                const ChartColumn& c = s.at(x);
+                if (std::isnan(c.min)) { prev = nullptr; continue; }
+                float a = c.min, b = c.max;
+                if (prev) { a = std::min(a, prev->max); b = std::max(b, prev->min); }
+                MoveToEx(mem, plot.left + x, y(b), NULL);
+                LineTo(mem, plot.left + x, y(a) + 1);
+                prev = &c;
+            }
+            SelectObject(mem, old); DeleteObject(pen);
+        }
+
+        wchar_t label[160];
+        if (lo <= hi) swprintf(label, 160, L"%hs  ·  last %ls  ·  %.2f – %.2f", METRIC_FIELDS[m_metric], SPAN_NAMES[m_span], lo, hi);
+        else swprintf(label, 160, L"%hs  ·  last %ls  ·  no samples", METRIC_FIELDS[m_metric], SPAN_NAMES[m_span]);
+        HFONT oldFont = (HFONT)SelectObject(mem, m_font);
+        SetBkMode(mem, TRANSPARENT); SetTextColor(mem, g_theme.sub_text);
+        RECT tr = {pad, 0, W - pad, top};
+        DrawTextW(mem, label, -1, &tr, DT_SINGLELINE | DT_VCENTER | DT_END_ELLIPSIS);
+        SelectObject(mem, oldFont);
+
+        BitBlt(hdc, rc.left, rc.top, W, H, mem, 0, 0, SRCCOPY);
+        DeleteObject(bmp); DeleteDC(mem);
+    }
+
+    void onKey(WPARAM key) {
+        static const char METRIC_KEYS[M_COUNT] = {'U', 'T', 'F', 'C', 'M', 'P'};
+        if (key >= '1' && key <= '5') m_span = (int)(key - '1');
+        else if (const char* k = (const char*)memchr(METRIC_KEYS, (int)key, M_COUNT)) m_metric = (int)(k - METRIC_KEYS);
+        else return;
+        RECT chart = chartRect();
+        InvalidateRect(m_hwnd, &chart, FALSE);
+    }
+
+    static LRESULT CALLBACK detailProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
+        DetailWindow* self = nullptr;
+        if (msg == WM_NCCREATE) {
+            self = reinterpret_cast<DetailWindow*>(reinterpret_cast<CREATESTRUCTW*>(lp)->lpCreateParams);
+            SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(self));
+        } else {
+            self = reinterpret_cast<DetailWindow*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+        }
+        switch (msg) {
+        case WM_PAINT:
+            if (!self || self->m_index < 0) break;
+            { PAINTSTRUCT ps; HDC hdc = BeginPaint(hwnd, &ps); self->paintChart(hdc); self->paintMig(hdc); self->paintInfo(hdc); EndPaint(hwnd, &ps); }
+            return 0;
+        case WM_ERASEBKGND: return 1;
+        case WM_KEYDOWN: if (self) self->onKey(wp); return 0;
+        case WM_CLOSE: ShowWindow(hwnd, SW_HIDE); return 0;
+        }
+        return DefWindowProcW(hwnd, msg, wp, lp);
+    }
+};
+
+// ─── AnalyticsWindow ────────────────────────────────────────────────────────
+// Owned popup for analytics expressions over the in-memory history, opened
+// with E: a one-line input that runs on Enter, the answer below it.
+class AnalyticsWindow {
+public:
+    static constexpr const wchar_t* CLASS_NAME = L"NvSmiGuiAnalyticsClass";
+
+    static void registerClass() {
+        WNDCLASSW wc = {};
+        wc.lpfnWndProc   = analyticsProc;
+        wc.hInstance      = g_hInst;
+        wc.lpszClassName  = CLASS_NAME;
+        wc.hCursor        = LoadCursor(NULL, IDC_ARROW);
+        wc.hbrBackground  = CreateSolidBrush(g_theme.bg);
+        RegisterClassW(&wc);
+    }
+
+    explicit AnalyticsWindow(HWND owner) {
+        registerClass();
+        RECT adj = {0, 0, D(480), D(320)};
+        AdjustWindowRectEx(&adj, WS_FIXED, FALSE, 0);
+        m_hwnd = CreateWindowExW(0, CLASS_NAME, L"Analytics", WS_FIXED, CW_USEDEFAULT, CW_USEDEFAULT,
+                                 adj.right - adj.left, adj.bottom - adj.top, owner, NULL, g_hInst, this);
+        if (g_darkMode) { BOOL useDark = TRUE; DwmSetWindowAttribute(m_hwnd, 20, &useDark, sizeof(useDark)); }
+        m_font = CreateFontW(-D(13), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
+                             0, 0, DEFAULT_QUALITY, 0, L"Consolas");
+        m_brush = CreateSolidBrush(g_theme.bg);
+        m_input = CreateWindowExW(0, L"EDIT", L"avg(utilization.gpu) by host over 1h",
+                                  WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL,
+                                  D(8), D(8), D(464), D(24), m_hwnd, NULL, g_hInst, NULL);
+        m_output = CreateWindowExW(0, L"EDIT", L"", WS_CHILD | WS_VISIBLE | WS_VSCROLL | ES_MULTILINE | ES_READONLY,
+                                   D(8), D(40), D(464), D(272), m_hwnd, NULL, g_hInst, NULL);
+        SendMessageW(m_input, WM_SETFONT, (WPARAM)m_font, TRUE);
+        SendMessageW(m_output, WM_SETFONT, (WPARAM)m_font, TRUE);
+        SetWindowSubclass(m_input, inputProc, 0, (DWORD_PTR)this);
+    }
+
+    ~AnalyticsWindow() { if (m_hwnd) DestroyWindow(m_hwnd); DeleteObject(m_font); DeleteObject(m_brush); }
+
+    void show() {
+        ShowWindow(m_hwnd, SW_SHOW);
+        SetForegroundWindow(m_hwnd);
+        SetFocus(m_input);
+    }
+
+private:
+    HWND m_hwnd = NULL, m_input = NULL, m_output = NULL;
+    HFONT m_font;
+    HBRUSH m_brush;
+
+    void run() {
+        int n = GetWindowTextLengthW(m_input);
+        std::wstring w(n + 1, 0);
+        GetWindowTextW(m_input, &w[0], n + 1);
+        std::string text(WideCharToMultiByte(CP_UTF8, 0, w.c_str(), n, NULL, 0, NULL, NULL), 0);
+        WideCharToMultiByte(CP_UTF8, 0, w.c_str(), n, &text[0], (int)text.size(), NULL, NULL);
+        std::string out, stats;
+        evalHistory(text, out, &stats);
+        out += stats;
+        std::wstring shown;
+        for (wchar_t c : toW(out)) { if (c == L'\n') shown += L'\r'; shown += c; }
+        SetWindowTextW(m_output, shown.c_str());
+    }
+
+    static LRESULT CALLBACK inputProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp, UINT_PTR, DWORD_PTR self) {
+        if (msg == WM_KEYDOWN && wp == VK_RETURN) { reinterpret_cast<AnalyticsWindow*>(self)->run(); return 0; }
+        if (msg == WM_CHAR && wp == L'\r') return 0;   // no beep
+        return DefSubclassProc(hwnd, msg, wp, lp);
+    }
+
+    static LRESULT CALLBACK analyticsProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
+        AnalyticsWindow* self = nullptr;
+        if (msg == WM_NCCREATE) {
+            self = reinterpret_cast<AnalyticsWindow*>(reinterpret_cast<CREATESTRUCTW*>(lp)->lpCreateParams);
+            SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(self));
+        } else {
+            self = reinterpret_cast<AnalyticsWindow*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+        }
+        switch (msg) {
+        case WM_CTLCOLOREDIT: case WM_CTLCOLORSTATIC:
+            if (!self) break;
+            SetTextColor((HDC)wp, g_theme.text);
+            SetBkColor((HDC)wp, g_theme.bg);
+            return (LRESULT)self->m_brush;
+        case WM_CLOSE: ShowWindow(hwnd, SW_HIDE); return 0;
+        }
+        return DefWindowProcW(hwnd, msg, wp, lp);
+    }
+};
+
+// ─── MainWindow ─────────────────────────────────────────────────────────────
+// Refresh rate of the primary display, for --fps 0.
+static int displayRefreshRate() {
+    DEVMODEW dm = {};
+    dm.dmSize = sizeof(dm);
+    if (EnumDisplaySettingsW(NULL, ENUM_CURRENT_SETTINGS, &dm) && dm.dmDisplayFrequency > 1) return (int)dm.dmDisplayFrequency;
+    return 60;
+}
+
+class MainWindow {
+public:
+    static constexpr const wchar_t* CLASS_NAME = L"NvSmiGuiMainClass";
+
+    static void registerClass() {
+        WNDCLASSW wc = {};
+        wc.lpfnWndProc   = wndProc;
+        wc.hInstance      = g_hInst;
+        wc.lpszClassName  = CLASS_NAME;
+        wc.hCursor        = LoadCursor(NULL, IDC_ARROW);
+        wc.hbrBackground  = CreateSolidBrush(g_theme.bg);
+        RegisterClassW(&wc);
+    }
+
+    // Fleets larger than this switch to the heatmap overview.
+    static constexpr int OVERVIEW_MIN_GPUS = 16;
+
+    static constexpr UINT_PTR FRAME_TIMER = 1;
+    static constexpr int HIDDEN_POLL_MS = 250;   // recheck for visibility while nothing is drawn
+
+    MainWindow(const std::wstring& title, bool overview, int fps, bool tiles, int renderThreads)
+        : m_overview(overview), m_tiles(tiles), m_renderThreads(renderThreads), m_title(title) {
+        registerClass();
+        m_pacer.setFps(fps > 0 ? fps : displayRefreshRate());
+        m_hwnd = CreateWindowExW(0, CLASS_NAME, title.c_str(),
+                                 WS_FIXED, CW_USEDEFAULT, CW_USEDEFAULT,
+                                 D(500), D(100), NULL, NULL, g_hInst, this);
+        if (g_windowIcon) {
+            SendMessageW(m_hwnd, WM_SETICON, ICON_BIG, (LPARAM)g_windowIcon);
+            SendMessageW(m_hwnd, WM_SETICON, ICON_SMALL, (LPARAM)g_windowIcon);
+        }
+        // Dark title bar (Windows 10 1809+ / Windows 11)
         if (g_darkMode) {
             BOOL useDark = TRUE;
             // DWMWA_USE_IMMERSIVE_DARK_MODE = 20
             DwmSetWindowAttribute(m_hwnd, 20, &useDark, sizeof(useDark));
         }
+        m_hostFont = CreateFontW(-D(11), 0, 0, 0, FW_NORMAL, 0, 0, 0, DEFAULT_CHARSET,
+                                 0, 0, DEFAULT_QUALITY, 0, L"Segoe UI");
+    }
+
+    ~MainWindow() {
+        for (auto* p : m_panels) delete p;
+        delete m_heatmap; delete m_grid; delete m_pool; delete m_detail; delete m_analytics;
+        DeleteObject(m_hostFont);
+    }
+    HWND hwnd() const { return m_hwnd; }
+    void show() { ShowWindow(m_hwnd, SW_SHOW); UpdateWindow(m_hwnd); }
+    int panelCount() const { return (int)m_panels.size(); }
+    GPUInfoPanel* panel(int i) { return m_panels[i]; }
+
+    GPUInfoPanel* addNewPanel() {
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        int y = m_hostStrip + (int)m_panels.size() * GPUInfoPanel::PANEL_HEIGHT();
+        auto* p = new GPUInfoPanel(m_hwnd, y, rc.right);
+        m_panels.push_back(p);
+
+        int totalH = m_hostStrip + (int)m_panels.size() * GPUInfoPanel::PANEL_HEIGHT();
+        RECT adj = {0, 0, D(480), totalH};
+        AdjustWindowRectEx(&adj, WS_FIXED, FALSE, 0);
+        int newW = adj.right - adj.left, newH = adj.bottom - adj.top;
+        if (m_panels.size() == 1) {
+            HMONITOR hMon = MonitorFromWindow(m_hwnd, MONITOR_DEFAULTTOPRIMARY);
+            MONITORINFO mi{}; mi.cbSize = sizeof(mi); GetMonitorInfoW(hMon, &mi);
+            int cx = (mi.rcWork.left + mi.rcWork.right - newW) / 2;
+            int cy = (mi.rcWork.top + mi.rcWork.bottom - newH) / 2;
+            SetWindowPos(m_hwnd, NULL, cx, cy, newW, newH, SWP_NOZORDER);
+        } else {
+            SetWindowPos(m_hwnd, NULL, 0, 0, newW, newH, SWP_NOMOVE | SWP_NOZORDER);
+        }
+        return p;
+    }
+
+private:
+    HWND m_hwnd = NULL;
+    std::vector<GPUInfoPanel*> m_panels;
+    bool m_overview;
+    bool m_tiles, m_shownTiles = false;     // overview as a panel grid instead of the heatmap (G)
+    int m_renderThreads;
+    FleetHeatmap* m_heatmap = nullptr;
+    PanelGrid* m_grid = nullptr;
+    RenderPool* m_pool = nullptr;
+    DetailWindow* m_detail = nullptr;
+    AnalyticsWindow* m_analytics = nullptr;
+    SnapshotPtr m_last;
+    std::wstring m_title, m_shownTitle;
+    FramePacer m_pacer;
+    bool m_frameArmed = false;
+    int m_hostStrip = 0;            // height of the host metrics line above the panels, once there are any
+    HFONT m_hostFont;
+    uint64_t m_hostVersion = 0;
+    std::wstring m_hostText;
+
+    // Minimized, hidden, cloaked (another virtual desktop) or with nothing
+    // left to paint. The clip box only shows occlusion without composition;
+    // under DWM an occluded window still renders to its own surface.
+    bool obscured() const {
+        if (IsIconic(m_hwnd) || !IsWindowVisible(m_hwnd)) return true;
+        DWORD cloaked = 0;
+        if (SUCCEEDED(DwmGetWindowAttribute(m_hwnd, 14 /* DWMWA_CLOAKED */, &cloaked, sizeof(cloaked))) && cloaked) return true;
+        RECT rc;
+        HDC hdc = GetDC(m_hwnd);
+        int clip = GetClipBox(hdc, &rc);
+        ReleaseDC(m_hwnd, hdc);
+        return clip == NULLREGION;
+    }
+
+    void scheduleFrame() {
+        if (m_frameArmed) return;
+        int delay = m_pacer.delayMs(FramePacer::Clock::now());
+        if (delay == 0) { renderFrame(); return; }
+        m_frameArmed = true;
+        SetTimer(m_hwnd, FRAME_TIMER, delay, NULL);
+    }
+
+    // Leaves the snapshot untaken while obscured, so the hub stops posting
+    // until it is shown again.
+    void renderFrame() {
+        if (obscured()) { m_frameArmed = true; SetTimer(m_hwnd, FRAME_TIMER, HIDDEN_POLL_MS, NULL); return; }
+        SnapshotPtr snap = g_hub.take();
+        if (!snap) return;
+        m_last = snap;
+        if (snap->gpus.size() > (size_t)OVERVIEW_MIN_GPUS) m_overview = true;
+        if (m_overview) updateOverview(snap);
+        else updatePanels(*snap);
+
+        auto now = FramePacer::Clock::now();
+        m_pacer.frame(snap->seq, now);
+        double fps; uint64_t skipped;
+        if (m_pacer.report(now, fps, skipped)) {
+            wchar_t buf[96];
+            swprintf(buf, 96, L"  \u00b7  %.1f fps, %llu skipped", fps, (unsigned long long)skipped);
+            if (m_title + buf != m_shownTitle) { m_shownTitle = m_title + buf; SetWindowTextW(m_hwnd, m_shownTitle.c_str()); }
+        }
+    }
+
+    void updatePanels(const FleetSnapshot& snap) {
+        updateHostStrip(snap.gpus.empty() ? 0 : hostOf(snap.gpus.front().index));
+        for (const auto& g : snap.gpus) {
+            while (g.index >= panelCount()) addNewPanel();
+            panel(g.index)->updateInfo(g_identities.get(g.index).get(), g);
+        }
+    }
+
+    void showDetail(int slot) {
+        if (!m_detail) m_detail = new DetailWindow(m_hwnd);
+        m_detail->show(slot, m_last);
+    }
+
+    void updateOverview(const SnapshotPtr& snap) {
+        HMONITOR hMon = MonitorFromWindow(m_hwnd, MONITOR_DEFAULTTOPRIMARY);
+        MONITORINFO mi{}; mi.cbSize = sizeof(mi); GetMonitorInfoW(hMon, &mi);
+        int maxH = mi.rcWork.bottom - mi.rcWork.top - D(80);
+        for (auto* p : m_panels) delete p;
+        m_panels.clear();
+        auto pick = [this](int i) { showDetail(i); };
+        bool switched = m_tiles != m_shownTiles, resize = switched;
+        m_shownTiles = m_tiles;
+        if (m_tiles) {
+            if (!m_pool) {
+                int n = m_renderThreads > 0 ? m_renderThreads : (int)std::thread::hardware_concurrency();
+                m_pool = new RenderPool(std::max(1, std::min(n, 16)) - 1);
+            }
+            if (!m_grid) m_grid = new PanelGrid(m_hwnd, D(960), *m_pool, pick);
+            if (m_heatmap) ShowWindow(m_heatmap->hwnd(), SW_HIDE);
+            ShowWindow(m_grid->hwnd(), SW_SHOW);
+            resize = m_grid->update(*snap, maxH) || resize;
+            if (switched) m_grid->reportVisible();
+        } else {
+            if (!m_heatmap) m_heatmap = new FleetHeatmap(m_hwnd, D(960), pick);
+            if (m_grid) ShowWindow(m_grid->hwnd(), SW_HIDE);
+            ShowWindow(m_heatmap->hwnd(), SW_SHOW);
+            resize = m_heatmap->update(snap, maxH) || resize;
+            if (switched) m_heatmap->reportVisible();
+        }
+        if (resize) {
+            RECT adj = {0, 0, D(960), m_tiles ? m_grid->height() : m_heatmap->height()};
+            AdjustWindowRectEx(&adj, WS_FIXED, FALSE, 0);
+            int newW = adj.right - adj.left, newH = adj.bottom - adj.top;
+            SetWindowPos(m_hwnd, NULL, mi.rcWork.left + (mi.rcWork.right - mi.rcWork.left - newW) / 2,
+                         mi.rcWork.top + (mi.rcWork.bottom - mi.rcWork.top - newH) / 2, newW, newH, SWP_NOZORDER);
+        }
+        if (m_detail) m_detail->update(*snap);
+    }
+
+    void repositionPanels() {
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        for (int i = 0; i < (int)m_panels.size(); ++i)
+            m_panels[i]->reposition(m_hostStrip + i * GPUInfoPanel::PANEL_HEIGHT(), rc.right);
+    }
+
+    // The strip appears with the first host sample and grows the window by its height.
+    void updateHostStrip(int host) {
+        uint64_t v = g_hostMetrics.version();
+        HostSample h;
+        if (v == m_hostVersion || !g_hostMetrics.get(host, h)) return;
+        m_hostVersion = v;
+        m_hostText = toW(describeHost(h));
+        if (!m_hostStrip) {
+            m_hostStrip = D(22);
+            RECT wr; GetWindowRect(m_hwnd, &wr);
+            SetWindowPos(m_hwnd, NULL, 0, 0, wr.right - wr.left, wr.bottom - wr.top + m_hostStrip, SWP_NOMOVE | SWP_NOZORDER);
+            repositionPanels();
+        }
+        RECT strip; GetClientRect(m_hwnd, &strip);
+        strip.bottom = m_hostStrip;
+        InvalidateRect(m_hwnd, &strip, FALSE);
+    }
+
+    void paintHostStrip() {
+        PAINTSTRUCT ps;
+        HDC hdc = BeginPaint(m_hwnd, &ps);
+        RECT rc; GetClientRect(m_hwnd, &rc);
+        rc.bottom = m_hostStrip;
+        HBRUSH bg = CreateSolidBrush(g_theme.bg);
+        FillRect(hdc, &rc, bg); DeleteObject(bg);
+        HFONT old = (HFONT)SelectObject(hdc, m_hostFont);
+        SetBkMode(hdc, TRANSPARENT); SetTextColor(hdc, g_theme.sub_text);
+        rc.left += D(10); rc.right -= D(10);
+        DrawTextW(hdc, m_hostText.c_str(), -1, &rc, DT_SINGLELINE | DT_VCENTER | DT_END_ELLIPSIS);
+        SelectObject(hdc, old);
+        EndPaint(m_hwnd, &ps);
+    }
+
+    static LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
+        MainWindow* self = nullptr;
+        if (msg == WM_NCCREATE) {
+            auto* cs = reinterpret_cast<CREATESTRUCTW*>(lp);
+            self = reinterpret_cast<MainWindow*>(cs->lpCreateParams);
+            SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(self));
+        } else {
+            self = reinterpret_cast<MainWindow*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+        }
+        switch (msg) {
+        case WM_SIZE: if (self) self->repositionPanels(); return 0;
+        case WM_GETMINMAXINFO: {
+            auto* m = reinterpret_cast<MINMAXINFO*>(lp);
+            m->ptMinTrackSize.x = D(480); m->ptMinTrackSize.y = D(100); return 0;
+        }
+        case WM_SMI_UPDATE: if (self) self->scheduleFrame(); return 0;
+        case WM_GPU_PICK: if (self) self->showDetail((int)wp); return 0;
+        case WM_PAINT:
+            if (!self || !self->m_hostStrip) break;
+            self->paintHostStrip();
+            return 0;
+        case WM_TIMER:
+            if (self && wp == FRAME_TIMER) {
+                KillTimer(hwnd, FRAME_TIMER);
+                self->m_frameArmed = false;
+                self->renderFrame();
+            }
+            return 0;
+        case WM_KEYDOWN:
+            if (self && wp == 'E') {
+                if (!self->m_analytics) self->m_analytics = new AnalyticsWindow(hwnd);
+                self->m_analytics->show();
+            }
+            if (self && self->m_overview && wp == 'G') {
+                self->m_tiles = !self->m_tiles;
+                if (self->m_last) self->updateOverview(self->m_last);
+            }
+            if (self && self->m_heatmap && !self->m_tiles) {
+                if (wp == 'U') self->m_heatmap->setMetric(HM_UTIL);
+                else if (wp == 'T') self->m_heatmap->setMetric(HM_TEMP);
+                else if (wp == 'M') self->m_heatmap->setMetric(HM_MEM);
+            }
+            return 0;
+        case WM_CLOSE: g_running = false; DestroyWindow(hwnd); return 0;
+        case WM_DESTROY: PostQuitMessage(0); return 0;
+        }
+        return DefWindowProcW(hwnd, msg, wp, lp);
+    }
+};
+
+#endif // _WIN32
+
+// ─── Process creation ───────────────────────────────────────────────────────
+// A child whose stdout and stderr are captured through one pipe.
+struct ChildProcess {
+#ifdef _WIN32
+    HANDLE hProcess = NULL, hRead = NULL;
+#else
+    pid_t pid = -1; int fd = -1;
+#endif
+};
+
+// With captureStderr false the child's stderr is inherited, which keeps
+// binary streams (--remote-agent) free of ssh diagnostics.
+#ifdef _WIN32
+static bool startProcess(const std::string& cmdLine, ChildProcess& child, bool captureStderr = true) {
+    SECURITY_ATTRIBUTES sa = {}; sa.nLength = sizeof(sa); sa.bInheritHandle = TRUE;
+    HANDLE hRead, hWrite;
+    CreatePipe(&hRead, &hWrite, &sa, 0);
+    SetHandleInformation(hRead, HANDLE_FLAG_INHERIT, 0);
+    STARTUPINFOW si = {}; si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+    si.hStdOutput = hWrite; si.wShowWindow = SW_HIDE;
+    si.hStdError = captureStderr ? hWrite : GetStdHandle(STD_ERROR_HANDLE);
+    PROCESS_INFORMATION pi = {};
+    std::wstring cmd = toW(cmdLine);
+    BOOL ok = CreateProcessW(NULL, &cmd[0], NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+    CloseHandle(hWrite);
+    if (!ok) { CloseHandle(hRead); return false; }
+    CloseHandle(pi.hThread); child.hProcess = pi.hProcess; child.hRead = hRead; return true;
+}
+
+static long readProcess(ChildProcess& child, char* buf, size_t n) {
+    DWORD bytesRead;
+    if (!ReadFile(child.hRead, buf, (DWORD)n, &bytesRead, NULL)) return -1;
+    return (long)bytesRead;
+}
+
+static void killProcess(ChildProcess& child) { if (child.hProcess) TerminateProcess(child.hProcess, 0); }
+
+static void closeProcess(ChildProcess& child) {
+    if (child.hRead) CloseHandle(child.hRead);
+    if (child.hProcess) CloseHandle(child.hProcess);
+    child = ChildProcess();
+}
+#else
+static bool startProcess(const std::string& cmdLine, ChildProcess& child, bool captureStderr = true) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    // Other children must not hold this pipe open; dup2 clears the flag on the child's ends.
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC); fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    std::string cmd = "exec " + cmdLine;
+    pid_t pid = fork();
+    if (pid < 0) { ::close(fds[0]); ::close(fds[1]); return false; }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        if (captureStderr) dup2(fds[1], STDERR_FILENO);
+        ::close(fds[0]); ::close(fds[1]);
+        execl("/bin/sh", "sh", "-c", cmd.c_str(), (char*)NULL);
+        _exit(127);
+    }
+    ::close(fds[1]);
+    child.pid = pid; child.fd = fds[0];
+    return true;
+}
+
+static long readProcess(ChildProcess& child, char* buf, size_t n) {
+    ssize_t r;
+    do { r = read(child.fd, buf, n); } while (r < 0 && errno == EINTR && g_running);
+    return (long)r;
+}
+
+static void killProcess(ChildProcess& child) { if (child.pid > 0) kill(child.pid, SIGTERM); }
+
+static void closeProcess(ChildProcess& child) {
+    if (child.fd >= 0) ::close(child.fd);
+    if (child.pid > 0) waitpid(child.pid, NULL, 0);
+    child = ChildProcess();
+}
+#endif
+
+static ChildProcess g_smiProc;
+
+// ─── SmiReader thread ───────────────────────────────────────────────────────
+static void smiReaderThread(int intervalMs) {
+    char buffer[4096]; std::string lineBuf;
+    TickAssembler ticks(intervalMs);
+    while (g_running) {
+        long bytesRead = readProcess(g_smiProc, buffer, sizeof(buffer));
+        if (bytesRead <= 0) break;
+        auto t0 = std::chrono::steady_clock::now();
+        lineBuf.append(buffer, bytesRead);
+        size_t start = 0, pos;
+        while ((pos = lineBuf.find('\n', start)) != std::string::npos) {
+            const char* b = lineBuf.data() + start;
+            const char* e = lineBuf.data() + pos;
+            start = pos + 1;
+            GpuSample sample; int64_t ts; const char *ub, *ue;
+            if (!parseSampleLine(b, e, ts, sample, ub, ue)) continue;
+            int index = sample.index;
+            sample.index = g_registry.resolve(0, index, ub, ue);
+            GpuIdentityPtr id = g_identities.get(sample.index);
+            if (!id || id->index != index) g_identities.requestRefresh();
+            if (SnapshotPtr snap = ticks.add(ts, sample, g_identities.gpuCount())) { ++g_sourceStats.ticks; g_hub.publish(snap); }
+        }
+        lineBuf.erase(0, start);
+        g_sourceStats.add(bytesRead, t0);
+    }
+}
+
+// ─── Identity query thread ──────────────────────────────────────────────────
+// Runs the static-field query to completion at start, every 60 s, and on
+// request from the fast reader.
+static std::mutex g_identityProcMutex;
+static ChildProcess* g_identityProc = nullptr;
+
+static void identityThread(const std::string& cmdLine) {
+    do {
+        ChildProcess child;
+        if (!startProcess(cmdLine, child)) continue;
+        { std::lock_guard<std::mutex> lk(g_identityProcMutex); g_identityProc = &child; }
+
+        std::string out; char buffer[4096]; long bytesRead;
+        while ((bytesRead = readProcess(child, buffer, sizeof(buffer))) > 0)
+            out.append(buffer, bytesRead);
+
+        { std::lock_guard<std::mutex> lk(g_identityProcMutex); g_identityProc = nullptr; }
+        closeProcess(child);
+
+        std::vector<GpuIdentity> ids;
+        size_t start = 0, pos;
+        while ((pos = out.find('\n', start)) != std::string::npos) {
+            GpuIdentity id;
+            if (parseIdentityLine(out.data() + start, out.data() + pos, id)) {
+                id.slot = g_registry.resolve(0, id.index, id.uuid.data(), id.uuid.data() + id.uuid.size());
+                ids.push_back(std::move(id));
+            }
+            start = pos + 1;
+        }
+        if (g_running) g_identities.update(ids);
+    } while (g_identities.waitForRefresh(std::chrono::seconds(60)));
+}
+
+// ─── Detail query thread ────────────────────────────────────────────────────
+// `nvidia-smi -q -x` every `periodSec`: a run takes about a second and
+// prints tens of KB per GPU, so it stays off the fast loop. The XML is
+// scanned as it is read. GPUs are matched to registry slots by UUID; one the
+// fast loop has not registered yet is skipped until the next run.
+static std::mutex g_detailProcMutex;
+static ChildProcess* g_detailProc = nullptr;
+
+static void detailThread(const std::string& cmdLine, int periodSec) {
+    do {
+        ChildProcess child;
+        if (!startProcess(cmdLine, child, false)) continue;
+        { std::lock_guard<std::mutex> lk(g_detailProcMutex); g_detailProc = &child; }
+
+        std::vector<GpuDetail> ds;
+        DetailHandler handler{ds};
+        XmlScanner xml(DETAIL_PATHS, (int)(sizeof(DETAIL_PATHS) / sizeof(DETAIL_PATHS[0])));
+        std::string buf; char chunk[16384]; long bytesRead; size_t bytes = 0;
+        std::chrono::steady_clock::duration parse{};
+        while ((bytesRead = readProcess(child, chunk, sizeof(chunk))) > 0) {
+            auto t0 = std::chrono::steady_clock::now();
+            buf.append(chunk, bytesRead);
+            buf.erase(0, xml.feed(buf.data(), buf.data() + buf.size(), handler) - buf.data());
+            parse += std::chrono::steady_clock::now() - t0;
+            bytes += bytesRead;
+        }
+
+        { std::lock_guard<std::mutex> lk(g_detailProcMutex); g_detailProc = nullptr; }
+        closeProcess(child);
+
+        for (auto& d : ds) { d.index = g_registry.find(0, d.uuid); attachMigProcesses(d); }
+        if (g_running && !ds.empty())
+            g_details.update(ds, bytes, std::chrono::duration<double, std::milli>(parse).count());
+    } while (g_details.wait(std::chrono::seconds(periodSec)));
+}
+
+// ─── Stream merge ───────────────────────────────────────────────────────────
+// Puts samples from many sources, each stamped by its own clock, into one
+// stream in time order on this machine's clock. A source's offset is the
+// least (arrival - source time) among its last OFFSET_WINDOW samples: the
+// sample that travelled fastest shows the clocks' difference best (NTP's
+// minimum filter), and the window lets the estimate follow drift and steps.
+// Corrected times never go backwards within a source. A k-way merge over a
+// heap of source heads releases everything up to a watermark, which the
+// caller keeps a reorder window behind the present. A sample whose corrected
+// time is already behind what was released is late: it is counted against
+// its source and dropped rather than slipped in out of order.
+// Not thread-safe; the owner locks.
+class StreamMerger {
+public:
+    static constexpr int OFFSET_WINDOW = 256;
+    struct Item { int64_t ts; int source; GpuSample sample; };
+
+    void configure(int sources) { m_src = std::vector<Source>(sources); m_heap.clear(); m_frontier = INT64_MIN; }
+
+    // `ts` by the source's clock, `arrivalMs` by ours. Returns false if late.
+    bool push(int source, int64_t ts, int64_t arrivalMs, const GpuSample& sample) {
+        Source& s = m_src[source];
+        int64_t obs = arrivalMs - ts;
+        while (!s.offsets.empty() && s.offsets.back().second >= obs) s.offsets.pop_back();
+        s.offsets.emplace_back(s.seen, obs);
+        if (s.offsets.front().first + OFFSET_WINDOW <= s.seen) s.offsets.pop_front();
+        ++s.seen;
+        int64_t t = std::max(ts + s.offsets.front().second, s.last);
+        s.last = t;
+        ++m_pushed;
+        if (t < m_frontier) {
+            ++s.late; ++m_late;
+            s.worstLateMs = std::max(s.worstLateMs, m_frontier - t);
+            return false;
+        }
+        if (s.queue.empty()) { m_heap.push_back({t, source}); std::push_heap(m_heap.begin(), m_heap.end(), later); }
+        s.queue.push_back({t, source, sample});
+        return true;
+    }
+
+    // Hands every held sample with ts <= watermark to fn(const Item&), oldest first.
+    template <typename Fn>
+    void drain(int64_t watermark, Fn&& fn) {
+        while (!m_heap.empty() && m_heap.front().ts <= watermark) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), later);
+            int source = m_heap.back().source;
+            m_heap.pop_back();
+            Source& s = m_src[source];
+            m_frontier = std::max(m_frontier, s.queue.front().ts);
+            fn(s.queue.front());
+            s.queue.pop_front();
+            if (!s.queue.empty()) { m_heap.push_back({s.queue.front().ts, source}); std::push_heap(m_heap.begin(), m_heap.end(), later); }
+        }
+    }
+
+    // Current estimate of the source's clock offset, ours minus theirs, ms.
+    int64_t offset(int source) const {
+        const Source& s = m_src[source];
+        return s.offsets.empty() ? 0 : s.offsets.front().second;
+    }
+
+    void print(FILE* f, const std::vector<std::string>& names) const {
+        if (!m_pushed) return;
+        int64_t lo = INT64_MAX, hi = INT64_MIN, worst = 0;
+        int worstSource = -1;
+        for (size_t i = 0; i < m_src.size(); ++i) {
+            if (m_src[i].offsets.empty()) continue;
+            lo = std::min(lo, offset((int)i)); hi = std::max(hi, offset((int)i));
+            if (m_src[i].late && m_src[i].worstLateMs >= worst) { worst = m_src[i].worstLateMs; worstSource = (int)i; }
+        }
+        fprintf(f, "merge: %llu samples, %llu late and dropped; clock offsets %lld .. %lld ms\n", (unsigned long long)m_pushed,
+                (unsigned long long)m_late, (long long)lo, (long long)hi);
+        if (worstSource >= 0)
+            fprintf(f, "  latest: %s, %llu samples, up to %lld ms behind\n", worstSource < (int)names.size() ? names[worstSource].c_str() : "?",
+                    (unsigned long long)m_src[worstSource].late, (long long)worst);
+    }
+
+private:
+    struct Source {
+        std::deque<std::pair<uint64_t, int64_t>> offsets;   // (sample number, arrival - ts), increasing
+        std::deque<Item> queue;                             // corrected, in order
+        uint64_t seen = 0, late = 0;
+        int64_t last = INT64_MIN, worstLateMs = 0;
+    };
+    struct Head { int64_t ts; int source; };
+
+    std::vector<Source> m_src;
+    std::vector<Head> m_heap;           // one per source with samples held
+    int64_t m_frontier = INT64_MIN;     // newest time released
+    uint64_t m_pushed = 0, m_late = 0;
+
+    static bool later(const Head& a, const Head& b) { return a.ts > b.ts || (a.ts == b.ts && a.source > b.source); }
+};
+
+// ─── Fleet connections ──────────────────────────────────────────────────────
+// `--hosts`: one nvidia-smi loop per host over ssh, merged into one fleet.
+// Starting every ssh at once swamps this machine and the bastion with
+// handshakes; starting them in turn takes minutes. The scheduler keeps at
+// most `limit` hosts in their handshake (launched, no sample yet), spaces
+// launches `staggerMs` apart, and takes hosts on screen before the rest in
+// list order. A host that fails or drops is retried with doubling backoff.
+// Samples go through a StreamMerger, and a fleet snapshot is cut for every
+// interval of corrected time the merge releases, a reorder window behind
+// the present, from whichever hosts are up: the first hosts show while the
+// rest connect. Host h holds slots h * G to h * G + G - 1 (G from
+// --gpus-per-host), as for the simulator; its GPUs take them by their
+// registry `local`, so a renumbered GPU keeps its slot. GPUs past the first G
+// on a host have no slot: their lines are counted, not shown.
+// Each host's identities come from its own IDENTITY_FIELDS query, run when
+// its first sample arrives, every IDENTITY_REFRESH_S while it is up, and when
+// it reports a GPU whose identity is unknown or renumbered (at most one per
+// 5 s). The query is one more ssh, so the `limit` applies to these as well.
+class FleetConnector {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int FIRST_SAMPLE_TIMEOUT_S = 30;
+    static constexpr int MAX_BACKOFF_S = 60;
+    static constexpr int IDENTITY_REFRESH_S = 60;
+
+    struct Options { int limit = 10, staggerMs = 25, intervalMs = 300, gpusPerHost = 8, windowMs = 600; bool report = false; };
+
+    // `cmds[h]` runs host h's sampling loop and `idCmds[h]`, if given, its
+    // identity query.
+    void configure(const std::vector<std::string>& names, const std::vector<std::string>& cmds,
+                   const std::vector<std::string>& idCmds, const Options& o) {
+        m_opt = o;
+        m_hosts = std::vector<Host>(names.size());
+        for (size_t h = 0; h < names.size(); ++h) {
+            m_hosts[h].name = names[h]; m_hosts[h].cmd = cmds[h];
+            if (h < idCmds.size()) m_hosts[h].idCmd = idCmds[h];
+        }
+        m_merge.configure((int)names.size());
+        m_start = Clock::now();
+    }
+
+    // Scheduler and publisher; returns when the session ends.
+    void run() {
+        auto nextLaunch = m_start, nextPublish = m_start + std::chrono::milliseconds(m_opt.intervalMs);
+        std::unique_lock<std::mutex> lk(m_mutex);
+        while (!m_stop && g_running) {
+            auto now = Clock::now();
+            for (size_t h = 0; h < m_hosts.size(); ++h) settle((int)h, now);
+            while (m_connecting < m_opt.limit && now >= nextLaunch) {
+                int h = pick(now);
+                if (h < 0) break;
+                launch(h, now);
+                nextLaunch = now + std::chrono::milliseconds(m_opt.staggerMs);
+            }
+            for (size_t h = 0; h < m_hosts.size() && m_connecting + m_querying < m_opt.limit; ++h) query((int)h, now);
+            if (m_opt.report && !m_reported && settled()) { m_reported = true; printStartup(stderr); }
+            if (now >= nextPublish) {
+                nextPublish = std::max(nextPublish + std::chrono::milliseconds(m_opt.intervalMs), now);
+                std::vector<SnapshotPtr> snaps;
+                advance(wallMs() - m_opt.windowMs, snaps);
+                lk.unlock();
+                for (auto& snap : snaps) { ++g_sourceStats.ticks; g_hub.publish(snap); }
+                lk.lock();
+                continue;
+            }
+            m_cv.wait_until(lk, wakeAt(now, nextLaunch, nextPublish));
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_stop = true;
+            for (auto& host : m_hosts) { killProcess(host.proc); killProcess(host.idProc); }
+        }
+        m_cv.notify_all();
+        for (auto& host : m_hosts) {
+            if (host.reader.joinable()) host.reader.join();
+            if (host.idReader.joinable()) host.idReader.join();
+            closeProcess(host.proc);
+            closeProcess(host.idProc);
+        }
+    }
+
+    void print(FILE* f) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (m_hosts.empty()) return;
+        int up = 0;
+        for (const auto& host : m_hosts) up += host.state == UP;
+        fprintf(f, "fleet: %zu hosts, %d up, %llu failed attempts; limit %d, stagger %d ms\n", m_hosts.size(), up,
+                (unsigned long long)m_failures, m_opt.limit, m_opt.staggerMs);
+        printStartup(f);
+        for (const auto& host : m_hosts)
+            if (host.overflow)
+                fprintf(f, "fleet: %s has %d GPUs, %d shown; %llu lines dropped (raise --gpus-per-host)\n", host.name.c_str(),
+                        host.devices, m_opt.gpusPerHost, (unsigned long long)host.overflow);
+        std::vector<std::string> names;
+        for (const auto& host : m_hosts) names.push_back(host.name);
+        m_merge.print(f, names);
+    }
+
+private:
+    enum State { QUEUED, CONNECTING, UP, BACKOFF };
+    struct Host {
+        std::string name, cmd, idCmd;
+        State state = QUEUED;
+        ChildProcess proc, idProc;
+        std::thread reader, idReader;
+        bool exited = false;            // the reader saw the loop end
+        bool querying = false, queried = false;     // identity query running; done, to be reaped
+        Clock::time_point idDue = Clock::time_point::max(), idLast{};   // next identity query; start of the last
+        int attempts = 0, firstAttempts = 0;     // since last up; to the first sample
+        Clock::time_point launched, retryAt;
+        double waitMs = -1, firstMs = -1;   // from start: launch, first sample (first success)
+        std::vector<GpuSample> gpus;    // latest released per local slot
+        int64_t lastMs = INT64_MIN;     // corrected time of the newest of them
+        int devices = 0;                // registered on the host
+        uint64_t overflow = 0;          // lines from GPUs past the first G
+    };
+
+    Options m_opt;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<Host> m_hosts;
+    Clock::time_point m_start;
+    int m_connecting = 0, m_querying = 0;
+    StreamMerger m_merge;
+    int64_t m_tick = INT64_MIN;         // start of the interval being filled, corrected time
+    uint64_t m_seq = 0, m_failures = 0;
+    bool m_stop = false, m_reported = false;
+
+    static double msSince(Clock::time_point t0, Clock::time_point t) { return std::chrono::duration<double, std::milli>(t - t0).count(); }
+
+    // Next publish, or the next launch if a host could take a free slot then.
+    Clock::time_point wakeAt(Clock::time_point now, Clock::time_point nextLaunch, Clock::time_point nextPublish) const {
+        Clock::time_point t = nextPublish;
+        if (m_connecting >= m_opt.limit) return t;
+        for (const auto& host : m_hosts) {
+            if (host.state == QUEUED) return std::min(t, std::max(nextLaunch, now));
+            if (host.state == BACKOFF) t = std::min(t, std::max(nextLaunch, host.retryAt));
+        }
+        return t;
+    }
+
+    bool ready(const Host& host, Clock::time_point now) const {
+        return host.state == QUEUED || (host.state == BACKOFF && now >= host.retryAt);
+    }
+
+    // On-screen hosts first, then list order.
+    int pick(Clock::time_point now) const {
+        int first = g_visibleHostFirst, last = std::min(g_visibleHostLast.load(), (int)m_hosts.size() - 1);
+        for (int h = std::max(0, first); first >= 0 && h <= last; ++h) if (ready(m_hosts[h], now)) return h;
+        for (size_t h = 0; h < m_hosts.size(); ++h) if (ready(m_hosts[h], now)) return (int)h;
+        return -1;
+    }
+
+    void launch(int h, Clock::time_point now) {
+        Host& host = m_hosts[h];
+        ++host.attempts;
+        host.launched = now;
+        if (host.waitMs < 0) host.waitMs = msSince(m_start, now);
+        if (!startProcess(host.cmd, host.proc)) { fail(host, now); return; }
+        host.state = CONNECTING;
+        host.exited = false;
+        ++m_connecting;
+        host.reader = std::thread(&FleetConnector::readLoop, this, h);
+    }
+
+    // Starts host h's identity query if it is up and one is due.
+    void query(int h, Clock::time_point now) {
+        Host& host = m_hosts[h];
+        if (host.idCmd.empty() || host.querying || host.state != UP || now < host.idDue) return;
+        host.idLast = now;
+        host.idDue = now + std::chrono::seconds(IDENTITY_REFRESH_S);
+        if (!startProcess(host.idCmd, host.idProc)) return;
+        host.querying = true;
+        ++m_querying;
+        host.idReader = std::thread(&FleetConnector::identityLoop, this, h);
+    }
+
+    void fail(Host& host, Clock::time_point now) {
+        ++m_failures;
+        host.state = BACKOFF;
+        host.retryAt = now + std::chrono::seconds(std::min(MAX_BACKOFF_S, 1 << std::max(0, std::min(host.attempts - 1, 6))));
+    }
+
+    // Reaps a loop that ended and gives up on a handshake that hangs.
+    void settle(int h, Clock::time_point now) {
+        Host& host = m_hosts[h];
+        if (host.queried) {
+            host.queried = host.querying = false;
+            --m_querying;
+            if (host.idReader.joinable()) host.idReader.join();
+            closeProcess(host.idProc);
+        }
+        if (host.state == CONNECTING && !host.exited && now - host.launched > std::chrono::seconds(FIRST_SAMPLE_TIMEOUT_S))
+            killProcess(host.proc);
+        if (!host.exited) return;
+        host.exited = false;
+        if (host.reader.joinable()) host.reader.join();
+        closeProcess(host.proc);
+        if (host.state == CONNECTING) --m_connecting;
+        else host.attempts = 0;         // it was up: start the backoff over
+        fail(host, now);
+    }
+
+    bool settled() const {
+        for (const auto& host : m_hosts) if (host.firstMs < 0 && (host.state == QUEUED || host.state == CONNECTING)) return false;
+        return true;
+    }
+
+    static int64_t wallMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Releases the merge up to `watermark`, cutting a snapshot each time the
+    // samples cross into the next interval and once the watermark has passed
+    // the interval being filled.
+    void advance(int64_t watermark, std::vector<SnapshotPtr>& out) {
+        int64_t iv = m_opt.intervalMs;
+        m_merge.drain(watermark, [&](const StreamMerger::Item& it) {
+            int64_t tick = it.ts - it.ts % iv;
+            if (tick != m_tick) {
+                if (m_tick != INT64_MIN) if (SnapshotPtr snap = assemble(m_tick)) out.push_back(snap);
+                m_tick = tick;
+            }
+            Host& host = m_hosts[it.source];
+            int local = it.sample.index - it.source * m_opt.gpusPerHost;
+            if (local >= (int)host.gpus.size()) host.gpus.resize(local + 1);
+            host.gpus[local] = it.sample;
+            host.lastMs = it.ts;
+        });
+        int64_t tick = watermark - watermark % iv;
+        if (m_tick != INT64_MIN && tick > m_tick) {
+            if (SnapshotPtr snap = assemble(m_tick)) out.push_back(snap);
+            m_tick = tick;
+        }
+    }
+
+    // GPUs of hosts silent for two intervals are stale, and dropped after
+    // MAX_STALE_TICKS intervals, as TickAssembler does for one host.
+    SnapshotPtr assemble(int64_t tick) {
+        auto snap = std::make_shared<FleetSnapshot>();
+        snap->seq = ++m_seq;
+        snap->timestampMs = tick;
+        int64_t staleAfter = m_opt.intervalMs * 2, dropAfter = (int64_t)m_opt.intervalMs * TickAssembler::MAX_STALE_TICKS;
+        for (auto& host : m_hosts) {
+            if (host.gpus.empty()) continue;
+            if (tick - host.lastMs > dropAfter) { host.gpus.clear(); continue; }
+            bool stale = tick - host.lastMs > staleAfter;
+            for (const auto& g : host.gpus) {
+                if (g.index < 0) continue;
+                snap->gpus.push_back(g);
+                snap->gpus.back().stale = stale;
+            }
+        }
+        if (snap->gpus.empty()) return nullptr;
+        return snap;
+    }
+
+    void readLoop(int h) {
+        Host& host = m_hosts[h];
+        ChildProcess proc;
+        { std::lock_guard<std::mutex> lk(m_mutex); proc = host.proc; }
+        char buffer[4096]; std::string lineBuf;
+        while (g_running) {
+            long bytesRead = readProcess(proc, buffer, sizeof(buffer));
+            if (bytesRead <= 0) break;
+            auto t0 = Clock::now();
+            int64_t arrival = wallMs();
+            lineBuf.append(buffer, bytesRead);
+            size_t start = 0, pos;
+            std::lock_guard<std::mutex> lk(m_mutex);
+            while ((pos = lineBuf.find('\n', start)) != std::string::npos) {
+                const char* b = lineBuf.data() + start;
+                const char* e = lineBuf.data() + pos;
+                start = pos + 1;
+                GpuSample sample; int64_t ts; const char *ub, *ue;
+                if (!parseSampleLine(b, e, ts, sample, ub, ue) || sample.index < 0) continue;
+                int local, index = sample.index;
+                g_registry.resolve(h, index, ub, ue, &local);
+                host.devices = std::max(host.devices, local + 1);
+                if (local >= m_opt.gpusPerHost) {
+                    if (!host.overflow++)
+                        fprintf(stderr, "%s: more than %d GPUs, the rest are not shown (raise --gpus-per-host)\n",
+                                host.name.c_str(), m_opt.gpusPerHost);
+                    continue;
+                }
+                sample.index = h * m_opt.gpusPerHost + local;
+                m_merge.push(h, ts >= 0 ? ts : arrival, arrival, sample);
+                GpuIdentityPtr id = g_identities.get(sample.index);
+                if (!id || id->index != index) host.idDue = std::min(host.idDue, host.idLast + std::chrono::seconds(5));
+                if (host.state == CONNECTING) {
+                    host.state = UP;
+                    host.idDue = t0;
+                    if (host.firstMs < 0) { host.firstMs = msSince(m_start, t0); host.firstAttempts = host.attempts; }
+                    --m_connecting;
+                    m_cv.notify_all();
+                }
+            }
+            lineBuf.erase(0, start);
+            g_sourceStats.add(bytesRead, t0);
+        }
+        std::lock_guard<std::mutex> lk(m_mutex);
+        host.exited = true;
+        m_cv.notify_all();
+    }
+
+    // Runs host h's identity query to the end; its GPUs take their slots as
+    // in readLoop, and those past the first G are skipped.
+    void identityLoop(int h) {
+        Host& host = m_hosts[h];
+        ChildProcess proc;
+        { std::lock_guard<std::mutex> lk(m_mutex); proc = host.idProc; }
+        std::string out; char buffer[4096]; long bytesRead;
+        while ((bytesRead = readProcess(proc, buffer, sizeof(buffer))) > 0) out.append(buffer, bytesRead);
+
+        std::vector<GpuIdentity> ids;
+        size_t start = 0, pos;
+        while ((pos = out.find('\n', start)) != std::string::npos) {
+            GpuIdentity id; int local;
+            if (parseIdentityLine(out.data() + start, out.data() + pos, id)) {
+                g_registry.resolve(h, id.index, id.uuid.data(), id.uuid.data() + id.uuid.size(), &local);
+                if (local < m_opt.gpusPerHost) { id.slot = h * m_opt.gpusPerHost + local; ids.push_back(std::move(id)); }
+            }
+            start = pos + 1;
+        }
+        if (g_running && !ids.empty()) g_identities.update(ids);
+        std::lock_guard<std::mutex> lk(m_mutex);
+        host.queried = true;
+        m_cv.notify_all();
+    }
+
+    // Time to first sample across hosts, from the start of the session: the
+    // part spent queued behind the limit, and the handshake itself.
+    void printStartup(FILE* f) const {
+        std::vector<double> first, wait, handshake;
+        for (const auto& host : m_hosts) {
+            if (host.firstMs < 0) continue;
+            first.push_back(host.firstMs); wait.push_back(host.waitMs); handshake.push_back(host.firstMs - host.waitMs);
+        }
+        if (first.empty()) { fprintf(f, "fleet: no host has answered yet\n"); return; }
+        for (auto* v : {&first, &wait, &handshake}) std::sort(v->begin(), v->end());
+        auto pct = [](const std::vector<double>& v, double p) { return v[std::min(v.size() - 1, (size_t)(p * v.size()))]; };
+        fprintf(f, "fleet: first sample from %zu/%zu hosts, p50 %.0f ms, p99 %.0f ms, last %.0f ms "
+                "(queued p50 %.0f ms, handshake p50 %.0f ms, p99 %.0f ms)\n", first.size(), m_hosts.size(),
+                pct(first, 0.5), pct(first, 0.99), first.back(), pct(wait, 0.5), pct(handshake, 0.5), pct(handshake, 0.99));
+        std::vector<const Host*> slow;
+        for (const auto& host : m_hosts) if (host.firstMs >= 0) slow.push_back(&host);
+        size_t n = std::min<size_t>(3, slow.size());
+        std::partial_sort(slow.begin(), slow.begin() + n, slow.end(), [](const Host* a, const Host* b) { return a->firstMs > b->firstMs; });
+        for (size_t i = 0; i < n; ++i)
+            fprintf(f, "  slowest: %s at %.0f ms, %d attempt%s\n", slow[i]->name.c_str(), slow[i]->firstMs,
+                    slow[i]->firstAttempts, slow[i]->firstAttempts == 1 ? "" : "s");
+    }
+};
+
+static FleetConnector g_connector;
+
+// ─── Synthetic source ───────────────────────────────────────────────────────
+// MIG topology for the simulator: each GPU's seven A100 slices split into
+// `instances` GPU instances of one compute instance each, as evenly as the
+// profiles allow, with memory and resident processes that wander.
+static void simulateMig(std::vector<GpuDetail>& ds, int n, int instances, std::mt19937& rng) {
+    static const double SLICE_SMS = 14, SLICE_MIB = 9728;
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    if (ds.empty()) {
+        ds.resize(n);
+        for (int i = 0; i < n; ++i) {
+            GpuDetail& d = ds[i];
+            char buf[64];
+            snprintf(buf, sizeof(buf), "GPU-5140a7ed-0000-0000-0000-%012d", i);
+            d.index = i; d.uuid = buf; d.migEnabled = true;
+            for (int k = 0, gi = 1; k < instances; ++k) {
+                int slices = 7 / instances + (k < 7 % instances);
+                MigDevice m;
+                m.index = k; m.gi = gi; m.ci = 0;
+                m.sms = SLICE_SMS * slices; m.memTotal = SLICE_MIB * slices; m.memUsed = 0;
+                d.mig.push_back(m);
+                gi += slices;
+            }
+        }
+    }
+    for (auto& d : ds) {
+        d.processes.clear();
+        for (auto& m : d.mig) {
+            m.memUsed = std::round(std::min(m.memTotal, std::max(0.0, m.memUsed + (uni(rng) - 0.45) * m.memTotal / 4)));
+            int procs = m.memUsed > m.memTotal / 8 ? 1 + (int)(uni(rng) * 2) : 0;
+            for (int p = 0; p < procs; ++p) {
+                GpuProcessInfo pi;
+                pi.pid = 10000 + d.index * 100 + m.gi * 10 + p; pi.gi = m.gi; pi.ci = m.ci;
+                pi.type = "C"; pi.name = "python3"; pi.memUsed = std::round(m.memUsed / procs);
+                d.processes.push_back(pi);
+            }
+        }
+        attachMigProcesses(d);
+    }
+}
+
+// Stand-in for nvidia-smi: `n` GPUs doing a bounded random walk, published
+// once per interval. Deterministic seed so runs are comparable. With
+// `backfillDays` the ticks of that many past days are generated as fast as
+// the sinks take them, and the source ends when it reaches the present.
+// With `mig` instances per GPU, a MIG detail is published every `detailSec`.
+static void simulateThread(int n, int intervalMs, int backfillDays, int mig, int detailSec) {
+    std::vector<GpuIdentity> ids(n);
+    for (int i = 0; i < n; ++i) {
+        char buf[64];
+        ids[i].index = ids[i].slot = i; ids[i].count = n;
+        snprintf(buf, sizeof(buf), "GPU-5140a7ed-0000-0000-0000-%012d", i); ids[i].uuid = buf;
+        snprintf(buf, sizeof(buf), "00000000:%02X:00.0", (i + 1) & 0xff); ids[i].pciBusId = buf;
+        ids[i].name = "Simulated GPU";
+        ids[i].memTotal = 81920; ids[i].powerLimit = 400;
+    }
+    g_identities.update(ids);
+
+    static const double LO[M_COUNT] = {0, 30, 30, 210, 0, 50};
+    static const double HI[M_COUNT] = {100, 85, 100, 1980, 81920, 400};
+    static const double STEP[M_COUNT] = {8, 1, 2, 60, 1024, 15};
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uni(-1.0, 1.0);
+    std::vector<GpuSample> cur(n);
+    for (int i = 0; i < n; ++i) {
+        cur[i].index = i;
+        for (int m = 0; m < M_COUNT; ++m) cur[i].v[m] = LO[m] + (HI[m] - LO[m]) * (0.5 + 0.5 * uni(rng));
+    }
+
+    std::vector<GpuDetail> migState;
+    int64_t nextDetail = 0;
+
+    uint64_t seq = 0;
+    auto next = std::chrono::steady_clock::now();
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    int64_t simTs = now - backfillDays * 86400000LL;
+    while (g_running && (backfillDays <= 0 || simTs < now)) {
+        auto snap = std::make_shared<FleetSnapshot>();
+        snap->seq = ++seq;
+        snap->timestampMs = backfillDays > 0 ? (simTs += intervalMs)
+                          : std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::system_clock::now().time_since_epoch()).count();
+        for (auto& g : cur) {
+            for (int m = 0; m < M_COUNT; ++m) {
+                double v = g.v[m] + STEP[m] * uni(rng);
+                g.v[m] = std::round(std::min(HI[m], std::max(LO[m], v)) * (m == M_POWER ? 100 : 1))
+                       / (m == M_POWER ? 100 : 1);
+            }
+        }
+        snap->gpus = cur;
+        if (mig > 0 && snap->timestampMs >= nextDetail) {
+            simulateMig(migState, n, mig, rng);
+            std::vector<GpuDetail> ds = migState;
+            g_details.update(ds, 0, 0);
+            nextDetail = snap->timestampMs + std::max(1, detailSec) * 1000LL;
+        }
+        ++g_sourceStats.ticks;
+        g_hub.publish(snap);
+        if (backfillDays > 0) continue;
+        next += std::chrono::milliseconds(intervalMs);
+        std::this_thread::sleep_until(next);
+    }
+}
+
+// ─── Sockets ────────────────────────────────────────────────────────────────
+#ifdef _WIN32
+using socket_t = SOCKET;
+static const socket_t BAD_SOCKET = INVALID_SOCKET;
+static const int SEND_FLAGS = 0;
+static void netInit() { WSADATA d; WSAStartup(MAKEWORD(2, 2), &d); }
+static void closeSocket(socket_t s) { closesocket(s); }
+static void setNonBlocking(socket_t s) { u_long on = 1; ioctlsocket(s, FIONBIO, &on); }
+static bool wouldBlock() { int e = WSAGetLastError(); return e == WSAEWOULDBLOCK || e == WSAETIMEDOUT; }
+static void setRecvTimeout(socket_t s, int ms) { DWORD t = ms; setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&t, sizeof(t)); }
+#else
+using socket_t = int;
+static const socket_t BAD_SOCKET = -1;
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+static void netInit() {}
+static void closeSocket(socket_t s) { ::close(s); }
+static void setNonBlocking(socket_t s) { fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK); }
+static bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static void setRecvTimeout(socket_t s, int ms) {
+    timeval t; t.tv_sec = ms / 1000; t.tv_usec = (ms % 1000) * 1000;
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
+}
+#endif
+
+// "[host:]port" -> first matching address; host defaults to loopback.
+static addrinfo* resolveEndpoint(const std::string& spec, bool passive, int socktype = SOCK_STREAM) {
+    auto colon = spec.rfind(':');
+    std::string host = (colon == std::string::npos) ? "127.0.0.1" : spec.substr(0, colon);
+    std::string port = (colon == std::string::npos) ? spec : spec.substr(colon + 1);
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC; hints.ai_socktype = socktype;
+    if (passive) hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0) return nullptr;
+    return res;
+}
+
+static socket_t listenOn(const std::string& spec) {
+    addrinfo* ai = resolveEndpoint(spec, true);
+    if (!ai) return BAD_SOCKET;
+    socket_t s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (s != BAD_SOCKET) {
+        int on = 1; setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+        if (bind(s, ai->ai_addr, (int)ai->ai_addrlen) != 0 || listen(s, 64) != 0) { closeSocket(s); s = BAD_SOCKET; }
+    }
+    freeaddrinfo(ai);
+    return s;
+}
+
+static socket_t connectTo(const std::string& spec) {
+    addrinfo* ai = resolveEndpoint(spec, false);
+    if (!ai) return BAD_SOCKET;
+    socket_t s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (s != BAD_SOCKET && connect(s, ai->ai_addr, (int)ai->ai_addrlen) != 0) { closeSocket(s); s = BAD_SOCKET; }
+    freeaddrinfo(ai);
+    if (s != BAD_SOCKET) { int on = 1; setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on)); }
+    return s;
+}
+
+// Streams the same bytes to every client of a server. send() queues a
+// tick's bytes on each client and writes what the socket takes; the rest
+// goes out from watch()/drain() in the server's select loop as the socket
+// drains. Clients that fall more than MAX_PENDING behind are closed rather
+// than buffered without bound. Not locked: the owner holds its own mutex.
+class ClientFanout {
+public:
+    static constexpr size_t MAX_PENDING = 4 << 20;
+
+    // Takes `s` with its first bytes; false (and closed) if it cannot take them.
+    bool add(socket_t s, std::string first) {
+        Client c{s, std::move(first)};
+        if (!flush(c)) { closeSocket(s); return false; }
+        m_clients.push_back(std::move(c));
+        return true;
+    }
+
+    // Returns the number of clients dropped.
+    size_t send(const std::string& bytes) {
+        size_t dropped = 0;
+        for (size_t i = 0; i < m_clients.size(); ) {
+            m_clients[i].pending += bytes;
+            if (flush(m_clients[i])) ++i;
+            else { drop(i); ++dropped; }
+        }
+        return dropped;
+    }
+
+    // Adds the clients with bytes pending to `wr`; returns the highest socket.
+    socket_t watch(fd_set& wr, socket_t top) const {
+        for (const auto& c : m_clients) if (!c.pending.empty()) { FD_SET(c.sock, &wr); top = std::max(top, c.sock); }
+        return top;
+    }
+
+    // Writes to the clients select() found writable; returns the number dropped.
+    size_t drain(const fd_set& wr) {
+        size_t dropped = 0;
+        for (size_t i = 0; i < m_clients.size(); ) {
+            Client& c = m_clients[i];
+            if (c.pending.empty() || !FD_ISSET(c.sock, &wr) || flush(c)) ++i;
+            else { drop(i); ++dropped; }
+        }
+        return dropped;
+    }
+
+    void closeAll() {
+        for (auto& c : m_clients) closeSocket(c.sock);
+        m_clients.clear();
+    }
+
+    bool empty() const { return m_clients.empty(); }
+
+private:
+    struct Client { socket_t sock; std::string pending; };
+    std::vector<Client> m_clients;
+
+    void drop(size_t i) { closeSocket(m_clients[i].sock); m_clients.erase(m_clients.begin() + i); }
+
+    // Returns false if the client is gone or hopelessly behind.
+    static bool flush(Client& c) {
+        size_t sent = 0;
+        while (sent < c.pending.size()) {
+            int n = (int)::send(c.sock, c.pending.data() + sent, (int)std::min<size_t>(c.pending.size() - sent, 1 << 20), SEND_FLAGS);
+            if (n > 0) { sent += n; continue; }
+            if (n < 0 && wouldBlock()) break;
+            return false;
+        }
+        c.pending.erase(0, sent);
+        return c.pending.size() <= MAX_PENDING;
+    }
+};
+
+// ─── Wire format ────────────────────────────────────────────────────────────
+// Frames are `u32 length, u8 type, payload`; everything inside the payload
+// is a LEB128 varint (signed values zigzagged). Metrics and identity numbers
+// travel as fixed-point hundredths, which is nvidia-smi's own precision.
+//   KEY:   seq, ts, count, then per GPU: slot, flags, identity, every metric
+//   DELTA: seq - prev seq, ts - prev ts, count, then per changed GPU:
+//          slot, flags, [identity], u8 metric mask, masked metrics as
+//          differences against the previous frame
+//   HOST:  host, ts, metric count, metrics, NUMA node count, node CPU %
+// GPUs are identified by DeviceRegistry slot; an identity is uuid, pci, name,
+// count, memory.total, power limit and nvidia-smi's index + 1 (0: none).
+// Identity travels only in keyframes and when the interned record changes;
+// a GPU that disappears is sent once with GF_GONE. The encoder emits a
+// keyframe every KEYFRAME_INTERVAL ticks so a stream can be joined late.
+// Host metrics go out whenever the host table changes.
+enum FrameType : uint8_t { FRAME_KEY = 1, FRAME_DELTA = 2, FRAME_HOST = 3 };
+enum : uint8_t { GF_STALE = 1, GF_IDENTITY = 2, GF_GONE = 4 };
+static const uint32_t MAX_FRAME = 16 << 20;
+static const int KEYFRAME_INTERVAL = 100;
+
+struct ByteWriter {
+    std::string& out;
+    void u8(uint8_t v) { out.push_back((char)v); }
+    void uv(uint64_t v) {
+        while (v >= 0x80) { out.push_back((char)(v | 0x80)); v >>= 7; }
+        out.push_back((char)v);
+    }
+    void sv(int64_t v) { uv(((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+    void str(const std::string& s) { uv(s.size()); out.append(s); }
+    void identity(const GpuIdentity& id) {
+        str(id.uuid); str(id.pciBusId); str(id.name);
+        uv((uint64_t)id.count); sv(quantize(id.memTotal)); sv(quantize(id.powerLimit));
+        uv((uint64_t)(id.index + 1));
+    }
+};
+
+struct ByteReader {
+    const char* p; const char* end; bool ok = true;
+    uint8_t u8() {
+        if (p >= end) { ok = false; return 0; }
+        return (uint8_t)*p++;
+    }
+    uint64_t uv() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = u8();
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false; return 0;
+    }
+    int64_t sv() { uint64_t u = uv(); return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+    std::string str() {
+        uint64_t n = uv();
+        if ((uint64_t)(end - p) < n) { ok = false; p = end; return {}; }
+        std::string s(p, (size_t)n); p += n; return s;
+    }
+    void identity(GpuIdentity& id) {
+        id.uuid = str(); id.pciBusId = str(); id.name = str();
+        id.count = (int)uv(); id.memTotal = dequantize(sv()); id.powerLimit = dequantize(sv());
+        id.index = (int)uv() - 1;
+    }
+};
+
+// Differences wrap rather than overflow, so the NaN sentinel round-trips.
+static int64_t qdiff(int64_t a, int64_t b) { return (int64_t)((uint64_t)a - (uint64_t)b); }
+static int64_t qadd(int64_t a, int64_t d) { return (int64_t)((uint64_t)a + (uint64_t)d); }
+
+// The fleet as the previous tick left it, quantized and sorted by index, for
+// writers that send only what changed. advance() walks a snapshot against it,
+// calling onGpu(cur, prev) for every GPU (prev null when it is new) and
+// onGone(slot) for every GPU that disappeared, then keeps the snapshot.
+struct StateSlot { int index; bool stale; GpuIdentityPtr id; int64_t q[M_COUNT]; };
+
+class StateDiffer {
+public:
+    const std::vector<StateSlot>& state() const { return m_state; }
+
+    template <class OnGpu, class OnGone>
+    void advance(const FleetSnapshot& snap, OnGpu&& onGpu, OnGone&& onGone) {
+        m_next.clear();
+        size_t j = 0;
+        for (const auto& g : snap.gpus) {
+            while (j < m_state.size() && m_state[j].index < g.index) onGone(m_state[j++]);
+            const StateSlot* prev = (j < m_state.size() && m_state[j].index == g.index) ? &m_state[j++] : nullptr;
+            StateSlot cur; cur.index = g.index; cur.stale = g.stale; cur.id = g_identities.get(g.index);
+            for (int m = 0; m < M_COUNT; ++m) cur.q[m] = quantize(g.v[m]);
+            m_next.push_back(cur);
+            onGpu(m_next.back(), prev);
+        }
+        while (j < m_state.size()) onGone(m_state[j++]);
+        m_state.swap(m_next);
+    }
+
+private:
+    std::vector<StateSlot> m_state;   // sorted by index
+    std::vector<StateSlot> m_next;    // scratch, reused across ticks
+};
+
+// Encodes snapshots against the state of the previous one.
+class FrameEncoder {
+public:
+    // Full state as of the last encoded tick.
+    void keyframe(std::string& out) const {
+        size_t at = begin(out, FRAME_KEY);
+        ByteWriter w{out};
+        w.uv(m_seq); w.sv(m_ts); w.uv(m_state.state().size());
+        for (const auto& sl : m_state.state()) {
+            w.uv((uint64_t)sl.index);
+            w.u8((uint8_t)((sl.stale ? GF_STALE : 0) | GF_IDENTITY));
+            w.identity(sl.id ? *sl.id : GpuIdentity());
+            for (int64_t q : sl.q) w.sv(q);
+        }
+        finish(out, at);
+    }
+
+    // Every host in g_hostMetrics, if it changed since `version`.
+    static void hosts(uint64_t& version, std::string& out) {
+        uint64_t v = g_hostMetrics.version();
+        if (v == version) return;
+        version = v;
+        for (const HostSample& h : g_hostMetrics.all()) {
+            size_t at = begin(out, FRAME_HOST);
+            ByteWriter w{out};
+            w.uv((uint64_t)h.host); w.sv(h.ts); w.uv(H_COUNT);
+            for (double x : h.v) w.sv(quantize(x));
+            w.uv(h.nodeCpu.size());
+            for (double x : h.nodeCpu) w.sv(quantize(x));
+            finish(out, at);
+        }
+    }
+
+    // Advances the state to `snap` and appends either the changes since the
+    // previous call or, on the first call and every KEYFRAME_INTERVAL ticks,
+    // a keyframe.
+    void encode(const FleetSnapshot& snap, std::string& out) {
+        bool key = (m_sinceKey++ % KEYFRAME_INTERVAL) == 0;
+        size_t at = key ? 0 : begin(out, FRAME_DELTA);
+        uint64_t count = 0;
+        m_body.clear();
+        ByteWriter bw{m_body};
+
+        m_state.advance(snap, [&](const StateSlot& cur, const StateSlot* prev) {
+            if (key) return;
+            uint8_t flags = (cur.stale ? GF_STALE : 0) | ((!prev || prev->id != cur.id) ? GF_IDENTITY : 0);
+            uint8_t mask = 0;
+            for (int m = 0; m < M_COUNT; ++m)
+                if (!prev || prev->q[m] != cur.q[m]) mask |= (uint8_t)(1 << m);
+            if (prev && !mask && flags == (prev->stale ? GF_STALE : 0)) return;
+            bw.uv((uint64_t)cur.index); bw.u8(flags);
+            if (flags & GF_IDENTITY) bw.identity(cur.id ? *cur.id : GpuIdentity());
+            bw.u8(mask);
+            for (int m = 0; m < M_COUNT; ++m)
+                if (mask & (1 << m)) bw.sv(qdiff(cur.q[m], prev ? prev->q[m] : 0));
+            ++count;
+        }, [&](const StateSlot& gone) { bw.uv((uint64_t)gone.index); bw.u8(GF_GONE); ++count; });
+
+        uint64_t dSeq = snap.seq - m_seq;
+        int64_t dTs = snap.timestampMs - m_ts;
+        m_seq = snap.seq; m_ts = snap.timestampMs;
+        if (key) { keyframe(out); return; }
+
+        ByteWriter w{out};
+        w.uv(dSeq); w.sv(dTs); w.uv(count);
+        out += m_body;
+        finish(out, at);
+    }
+
+private:
+    StateDiffer m_state;
+    std::string m_body;
+    uint64_t m_seq = 0;
+    int64_t m_ts = -1;
+    uint64_t m_sinceKey = 0;
+
+    static size_t begin(std::string& out, FrameType t) {
+        size_t at = out.size(); out.append(4, '\0'); out.push_back((char)t); return at;
+    }
+    static void finish(std::string& out, size_t at) {
+        uint32_t len = (uint32_t)(out.size() - at - 4);
+        memcpy(&out[at], &len, sizeof(len));
+    }
+};
+
+// Rebuilds snapshots from a frame stream; identities go to g_identities.
+class FrameDecoder {
+public:
+    // Returns false if the stream is malformed.
+    bool feed(const char* data, size_t n, const std::function<void(SnapshotPtr)>& onSnapshot) {
+        m_buf.append(data, n);
+        size_t off = 0;
+        while (m_buf.size() - off >= 5) {
+            uint32_t len; memcpy(&len, m_buf.data() + off, 4);
+            if (len == 0 || len > MAX_FRAME) return false;
+            if (m_buf.size() - off - 4 < len) break;
+            ByteReader r{m_buf.data() + off + 5, m_buf.data() + off + 4 + len};
+            uint8_t type = (uint8_t)m_buf[off + 4];
+            off += 4 + len;
+            if (type == FRAME_DELTA && !m_haveKey) continue;   // joined mid-stream
+            if (type == FRAME_HOST) { if (!host(r)) return false; continue; }
+            SnapshotPtr snap = apply(type, r);
+            if (!snap) return false;
+            onSnapshot(snap);
+        }
+        m_buf.erase(0, off);
+        return true;
+    }
+
+private:
+    struct Slot { GpuSample sample; int64_t q[M_COUNT]; };
+    std::string m_buf;
+    std::vector<Slot> m_gpus;   // sorted by index
+    uint64_t m_seq = 0;
+    int64_t m_ts = -1;
+    bool m_haveKey = false;
+
+    // Host metrics go to g_hostMetrics. Metrics past H_COUNT, from a newer
+    // writer, are skipped.
+    static bool host(ByteReader& r) {
+        HostSample h;
+        h.host = (int)r.uv(); h.ts = r.sv();
+        uint64_t n = r.uv();
+        for (uint64_t i = 0; i < n && r.ok; ++i) { double x = dequantize(r.sv()); if (i < H_COUNT) h.v[i] = x; }
+        uint64_t nodes = r.uv();
+        for (uint64_t i = 0; i < nodes && r.ok && i < 4096; ++i) h.nodeCpu.push_back(dequantize(r.sv()));
+        if (!r.ok) return false;
+        g_hostMetrics.update(h);
+        return true;
+    }
+
+    SnapshotPtr apply(uint8_t type, ByteReader& r) {
+        if (type != FRAME_KEY && type != FRAME_DELTA) return nullptr;
+        bool key = (type == FRAME_KEY);
+        if (key) { m_gpus.clear(); m_haveKey = true; m_seq = r.uv(); m_ts = r.sv(); }
+        else { m_seq += r.uv(); m_ts += r.sv(); }
+        uint64_t count = r.uv();
+        std::vector<GpuIdentity> ids;
+        for (uint64_t i = 0; i < count && r.ok; ++i) {
+            int index = (int)r.uv(); uint8_t flags = r.u8();
+            auto it = std::lower_bound(m_gpus.begin(), m_gpus.end(), index,
+                                       [](const Slot& s, int idx) { return s.sample.index < idx; });
+            if (flags & GF_GONE) { if (it != m_gpus.end() && it->sample.index == index) m_gpus.erase(it); continue; }
+            if (it == m_gpus.end() || it->sample.index != index) {
+                it = m_gpus.insert(it, Slot());
+                it->sample.index = index;
+                std::fill(std::begin(it->q), std::end(it->q), 0);
+            }
+            it->sample.stale = (flags & GF_STALE) != 0;
+            if (flags & GF_IDENTITY) { GpuIdentity id; r.identity(id); id.slot = index; ids.push_back(std::move(id)); }
+            uint8_t mask = key ? (uint8_t)((1 << M_COUNT) - 1) : r.u8();
+            for (int m = 0; m < M_COUNT; ++m) {
+                if (!(mask & (1 << m))) continue;
+                it->q[m] = key ? r.sv() : qadd(it->q[m], r.sv());
+                it->sample.v[m] = dequantize(it->q[m]);
+            }
+        }
+        if (!r.ok) return nullptr;
+        if (!ids.empty()) g_identities.update(ids);
+
+        auto snap = std::make_shared<FleetSnapshot>();
+        snap->seq = m_seq; snap->timestampMs = m_ts;
+        snap->gpus.reserve(m_gpus.size());
+        for (const auto& sl : m_gpus) snap->gpus.push_back(sl.sample);
+        return snap;
+    }
+};
+
+// ─── Collector ──────────────────────────────────────────────────────────────
+// Serves the session's snapshots to any number of viewers (--connect). Each
+// tick is encoded once and the same bytes go to every client through a
+// ClientFanout; new clients get a keyframe first.
+class Collector {
+public:
+    bool start(const std::string& spec) {
+        m_listen = listenOn(spec);
+        if (m_listen == BAD_SOCKET) return false;
+        m_acceptThread = std::thread(&Collector::acceptLoop, this);
+        return true;
+    }
+
+    void publish(const FleetSnapshot& snap) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_frame.clear();
+        m_enc.encode(snap, m_frame);
+        FrameEncoder::hosts(m_hostVersion, m_frame);
+        m_clients.send(m_frame);
+    }
+
+    void stop() {
+        if (m_listen == BAD_SOCKET) return;
+        m_stop = true;
+        if (m_acceptThread.joinable()) m_acceptThread.join();
+        closeSocket(m_listen); m_listen = BAD_SOCKET;
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_clients.closeAll();
+    }
+
+private:
+    std::mutex m_mutex;
+    FrameEncoder m_enc;
+    std::string m_frame;
+    ClientFanout m_clients;
+    uint64_t m_hostVersion = 0;
+    socket_t m_listen = BAD_SOCKET;
+    std::thread m_acceptThread;
+    std::atomic<bool> m_stop{false};
+
+    // Accepts viewers and sends the rest of any frame that publish() left
+    // pending as the socket drains, rather than a tick later.
+    void acceptLoop() {
+        while (!m_stop && g_running) {
+            fd_set rd, wr; FD_ZERO(&rd); FD_ZERO(&wr); FD_SET(m_listen, &rd);
+            socket_t top;
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                top = m_clients.watch(wr, m_listen);
+            }
+            timeval tv; tv.tv_sec = 0; tv.tv_usec = 250000;
+            if (select((int)top + 1, &rd, &wr, NULL, &tv) <= 0) continue;
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                m_clients.drain(wr);
+            }
+            if (!FD_ISSET(m_listen, &rd)) continue;
+            socket_t s = accept(m_listen, NULL, NULL);
+            if (s == BAD_SOCKET) continue;
+            int on = 1; setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+            setNonBlocking(s);
+            std::lock_guard<std::mutex> lk(m_mutex);
+            std::string first;
+            m_enc.keyframe(first);
+            uint64_t none = 0;
+            FrameEncoder::hosts(none, first);
+            m_clients.add(s, std::move(first));
+        }
     }
+};
 
-    ~MainWindow() { for (auto* p : m_panels) delete p; }
-    HWND hwnd() const { return m_hwnd; }
-    void show() { ShowWindow(m_hwnd, SW_SHOW); UpdateWindow(m_hwnd); }
-    int panelCount() const { return (int)m_panels.size(); }
-    GPUInfoPanel* panel(int i) { return m_panels[i]; }
+// ─── Frame stream sources ───────────────────────────────────────────────────
+// Feeds a frame stream to the hub. Publishing is excluded from the decode time.
+static bool feedFrames(FrameDecoder& dec, const char* data, size_t n) {
+    std::vector<SnapshotPtr> snaps;
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = dec.feed(data, n, [&](SnapshotPtr snap) { snaps.push_back(std::move(snap)); });
+    g_sourceStats.add(n, t0);
+    for (auto& snap : snaps) { ++g_sourceStats.ticks; g_hub.publish(snap); }
+    return ok;
+}
 
-    GPUInfoPanel* addNewPanel() {
-        RECT rc; GetClientRect(m_hwnd, &rc);
-        int y = (int)m_panels.size() * GPUInfoPanel::PANEL_HEIGHT();
-        auto* p = new GPUInfoPanel(m_hwnd, y, rc.right);
-        m_panels.push_back(p);
+// Reads a collector's frame stream instead of running nvidia-smi.
+static void viewerThread(const std::string& spec) {
+    socket_t s = connectTo(spec);
+    if (s == BAD_SOCKET) return;
+    setRecvTimeout(s, 500);
+    FrameDecoder dec; char buffer[16384];
+    while (g_running) {
+        int n = (int)recv(s, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            if (!feedFrames(dec, buffer, n)) break;
+        } else if (n == 0 || !wouldBlock()) break;
+    }
+    closeSocket(s);
+}
 
-        int totalH = (int)m_panels.size() * GPUInfoPanel::PANEL_HEIGHT();
-        RECT adj = {0, 0, D(480), totalH};
-        AdjustWindowRectEx(&adj, WS_FIXED, FALSE, 0);
-        int newW = adj.right - adj.left, newH = adj.bottom - adj.top;
-        if (m_panels.size() == 1) {
-            HMONITOR hMon = MonitorFromWindow(m_hwnd, MONITOR_DEFAULTTOPRIMARY);
-            MONITORINFO mi{}; mi.cbSize = sizeof(mi); GetMonitorInfoW(hMon, &mi);
-            int cx = (mi.rcWork.left + mi.rcWork.right - newW) / 2;
-            int cy = (mi.rcWork.top + mi.rcWork.bottom - newH) / 2;
-            SetWindowPos(m_hwnd, NULL, cx, cy, newW, newH, SWP_NOZORDER);
-        } else {
-            SetWindowPos(m_hwnd, NULL, 0, 0, newW, newH, SWP_NOMOVE | SWP_NOZORDER);
+// Reads the frame stream of `--agent` running at the other end of g_smiProc.
+static void agentReaderThread() {
+    FrameDecoder dec; char buffer[16384];
+    while (g_running) {
+        long n = readProcess(g_smiProc, buffer, sizeof(buffer));
+        if (n <= 0 || !feedFrames(dec, buffer, n)) break;
+    }
+}
+
+// ─── Agent ──────────────────────────────────────────────────────────────────
+// `--agent`: sample locally and write the frame stream to stdout, for a
+// viewer that launched this binary over ssh with --remote-agent.
+static bool writeStdout(const std::string& buf) {
+#ifdef _WIN32
+    HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD written;
+    return h && WriteFile(h, buf.data(), (DWORD)buf.size(), &written, NULL) && written == buf.size();
+#else
+    size_t off = 0;
+    while (off < buf.size()) {
+        ssize_t n = write(STDOUT_FILENO, buf.data() + off, buf.size() - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        off += n;
+    }
+    return true;
+#endif
+}
+
+class AgentWriter {
+public:
+    void publish(const FleetSnapshot& snap) {
+        m_buf.clear();
+        m_enc.encode(snap, m_buf);
+        FrameEncoder::hosts(m_hostVersion, m_buf);
+        if (!writeStdout(m_buf)) { g_running = false; killProcess(g_smiProc); }   // viewer went away
+    }
+
+private:
+    FrameEncoder m_enc;
+    std::string m_buf;
+    uint64_t m_hostVersion = 0;
+};
+
+// ─── Metrics export ─────────────────────────────────────────────────────────
+// `--export influx://host:port` or `statsd://host:port`: each tick's changed
+// samples as Influx line protocol or StatsD gauges over UDP, packed into
+// datagrams of at most `mtu` bytes. The sink only diffs against the previous
+// tick and queues the changes; a background thread formats and sends, so a
+// slow or absent receiver never holds up the reader. The queue keeps
+// EXPORT_QUEUE ticks and drops the oldest when full, counting the drops.
+// Every EXPORT_REFRESH ticks all values go out, so a receiver that missed
+// a datagram converges.
+class MetricExporter {
+public:
+    static constexpr size_t EXPORT_QUEUE = 64;
+    static constexpr uint64_t EXPORT_REFRESH = 100;
+
+    bool start(const std::string& spec, const std::string& hostname, size_t mtu) {
+        size_t sep = spec.find("://");
+        std::string scheme = sep == std::string::npos ? "" : spec.substr(0, sep);
+        if (scheme != "influx" && scheme != "statsd") { fprintf(stderr, "--export: expected influx:// or statsd://\n"); return false; }
+        m_influx = scheme == "influx";
+        addrinfo* ai = resolveEndpoint(spec.substr(sep + 3), false, SOCK_DGRAM);
+        if (!ai) return false;
+        m_sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (m_sock != BAD_SOCKET && connect(m_sock, ai->ai_addr, (int)ai->ai_addrlen) != 0) { closeSocket(m_sock); m_sock = BAD_SOCKET; }
+        freeaddrinfo(ai);
+        if (m_sock == BAD_SOCKET) return false;
+        m_mtu = std::max<size_t>(mtu, 256);
+        m_datagram.reserve(m_mtu);
+        // Influx tag values escape ' ', ',' and '='; StatsD names use '.' as separator.
+        for (char c : hostname.empty() ? std::string("localhost") : hostname) {
+            if (m_influx && (c == ' ' || c == ',' || c == '=')) m_host += '\\';
+            m_host += (!m_influx && (c == '.' || c == ':' || c == '|')) ? '_' : c;
+            if (m_host.size() >= 64) break;     // keeps a line inside format()'s buffer
         }
-        return p;
+        m_thread = std::thread(&MetricExporter::run, this);
+        return true;
+    }
+
+    // Sink: queues the samples that changed since the previous tick.
+    void publish(const FleetSnapshot& snap) {
+        bool all = m_ticks++ % EXPORT_REFRESH == 0;
+        std::unique_lock<std::mutex> lk(m_mutex);
+        Tick t;
+        if (!m_free.empty()) { t = std::move(m_free.back()); m_free.pop_back(); }
+        lk.unlock();
+        t.ts = snapshotTimeMs(snap);
+        t.values.clear();
+        for (const auto& g : snap.gpus) {
+            if (g.stale || g.index < 0) continue;
+            if (g.index >= (int)m_prev.size()) m_prev.resize(g.index + 1, Prev());
+            Prev& p = m_prev[g.index];
+            for (int m = 0; m < M_COUNT; ++m) {
+                int64_t q = quantize(g.v[m]);
+                if (q == Q_NAN || (!all && q == p.q[m])) continue;
+                p.q[m] = q;
+                t.values.push_back({g.index, m, q});
+            }
+        }
+        if (t.values.empty()) { lk.lock(); m_free.push_back(std::move(t)); return; }
+        lk.lock();
+        if (m_queue.size() >= EXPORT_QUEUE) { m_free.push_back(std::move(m_queue.front())); m_queue.pop_front(); ++m_dropped; }
+        m_queue.push_back(std::move(t));
+        m_cv.notify_one();
+    }
+
+    void stop() {
+        if (!m_thread.joinable()) return;
+        { std::lock_guard<std::mutex> lk(m_mutex); m_stop = true; m_cv.notify_all(); }
+        m_thread.join();
+        closeSocket(m_sock); m_sock = BAD_SOCKET;
+    }
+
+    void print(FILE* f) const {
+        if (!m_ticks) return;
+        fprintf(f, "export: %llu ticks, %llu lines in %llu datagrams (%.0f bytes each), %llu ticks dropped, %llu send errors\n",
+                (unsigned long long)m_ticks, (unsigned long long)m_lines, (unsigned long long)m_datagrams,
+                m_datagrams ? (double)m_bytes / m_datagrams : 0.0, (unsigned long long)m_dropped, (unsigned long long)m_errors);
     }
 
 private:
-    HWND m_hwnd = NULL;
-    std::vector<GPUInfoPanel*> m_panels;
+    struct Value { int gpu; int metric; int64_t q; };
+    struct Tick { int64_t ts = 0; std::vector<Value> values; };
+    struct Prev { int64_t q[M_COUNT]; Prev() { std::fill(q, q + M_COUNT, Q_NAN); } };
 
-    void repositionPanels() {
-        RECT rc; GetClientRect(m_hwnd, &rc);
-        for (int i = 0; i < (int)m_panels.size(); ++i)
-            m_panels[i]->reposition(i * GPUInfoPanel::PANEL_HEIGHT(), rc.right);
+    socket_t m_sock = BAD_SOCKET;
+    bool m_influx = true;
+    size_t m_mtu = 1400;
+    std::string m_host, m_datagram;
+    std::vector<Prev> m_prev;                   // reader thread only
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Tick> m_queue;
+    std::vector<Tick> m_free;                   // drained ticks, reused for their capacity
+    bool m_stop = false;
+    std::thread m_thread;
+    uint64_t m_ticks = 0, m_dropped = 0;
+    uint64_t m_lines = 0, m_datagrams = 0, m_bytes = 0, m_errors = 0;   // sender thread
+
+    void run() {
+        std::vector<Tick> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(m_mutex);
+                m_cv.wait(lk, [&] { return m_stop || !m_queue.empty(); });
+                if (m_queue.empty()) break;
+                for (auto& t : batch) m_free.push_back(std::move(t));
+                batch.clear();
+                while (!m_queue.empty()) { batch.push_back(std::move(m_queue.front())); m_queue.pop_front(); }
+            }
+            for (const Tick& t : batch) format(t);
+            flush();
+        }
     }
 
-    static LRESULT CALLBACK wndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
-        MainWindow* self = nullptr;
-        if (msg == WM_NCCREATE) {
-            auto* cs = reinterpret_cast<CREATESTRUCTW*>(lp);
-            self = reinterpret_cast<MainWindow*>(cs->lpCreateParams);
-            SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(self));
-        } else {
-            self = reinterpret_cast<MainWindow*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    void format(const Tick& t) {
+        char line[512];
+        for (size_t i = 0; i < t.values.size(); ) {
+            char* p = line;
+            if (m_influx) {
+                // nvidia_smi,host=H,gpu=N field=v,... <ns>, one line per GPU
+                int gpu = t.values[i].gpu;
+                p += snprintf(p, 128, "nvidia_smi,host=%s,gpu=%d ", m_host.c_str(), gpu);
+                for (bool first = true; i < t.values.size() && t.values[i].gpu == gpu; ++i, first = false) {
+                    if (!first) *p++ = ',';
+                    size_t n = strlen(METRIC_FIELDS[t.values[i].metric]);
+                    memcpy(p, METRIC_FIELDS[t.values[i].metric], n); p += n;
+                    *p++ = '=';
+                    p = formatHundredths(p, t.values[i].q);
+                }
+                *p++ = ' ';
+                p = std::to_chars(p, p + 24, t.ts).ptr;
+                memcpy(p, "000000\n", 7); p += 7;
+            } else {
+                // nvsmi.H.gpuN.field:v|g
+                const Value& v = t.values[i++];
+                p += snprintf(p, 192, "nvsmi.%s.gpu%d.%s:", m_host.c_str(), v.gpu, METRIC_FIELDS[v.metric]);
+                p = formatHundredths(p, v.q);
+                memcpy(p, "|g\n", 3); p += 3;
+            }
+            size_t n = p - line;
+            if (m_datagram.size() + n > m_mtu) flush();
+            m_datagram.append(line, n);
+            ++m_lines;
         }
-        switch (msg) {
-        case WM_SIZE: if (self) self->repositionPanels(); return 0;
-        case WM_GETMINMAXINFO: {
-            auto* m = reinterpret_cast<MINMAXINFO*>(lp);
-            m->ptMinTrackSize.x = D(480); m->ptMinTrackSize.y = D(100); return 0;
+    }
+
+    void flush() {
+        if (m_datagram.empty()) return;
+        if (send(m_sock, m_datagram.data(), (int)m_datagram.size(), SEND_FLAGS) < 0) ++m_errors;
+        ++m_datagrams; m_bytes += m_datagram.size();
+        m_datagram.clear();
+    }
+};
+
+// ─── Web dashboard ──────────────────────────────────────────────────────────
+// `--web [addr:]port`: a static page that draws the panels in a browser, fed
+// by one Server-Sent Events stream per tab. Each tick is turned into one
+// `delta` event holding only the fields that changed and the same bytes go
+// to every client, so a tab costs a send, not an encode. A new stream
+// starts with a `full` event. Streams go through a ClientFanout; a dropped
+// one makes the browser reconnect and get a fresh `full`.
+//   full:  {"host":H,"gpus":[{"i":N,"st":0|1,"id":{...},"v":[v0..v5]},...]}
+//   delta: {"seq":S,"g":[[N,st,{"m":v,...}],...],"id":{"N":{...}},"gone":[N,...]}
+// Values are METRIC_FIELDS order, null for N/A; "id" carries name, uuid,
+// pci, mem (total MiB), pl (power limit W) and n (nvidia-smi's index).
+static const char WEB_PAGE[] = R"HTML(<!doctype html>
+<html><head><meta charset="utf-8"><title>GPU Status</title>
+<style>
+body{font:13px "Segoe UI",sans-serif;background:#f0f5f9;color:#333;margin:0;padding:8px}
+@media(prefers-color-scheme:dark){body{background:#191919;color:#e0e0e0}.bar{background:#3c3c3c!important}.sub{color:#a0a0a0!important}}
+h1{font-size:14px;font-weight:normal;margin:4px 2px 8px}
+#grid{display:grid;grid-template-columns:repeat(auto-fill,minmax(380px,1fr));gap:8px}
+.p{border:1px solid #c9d6df;border-radius:4px;padding:8px 10px}.p.st{opacity:.5}
+.n{font-size:18px;font-weight:bold;white-space:nowrap;overflow:hidden;text-overflow:ellipsis}
+.sub{color:#666;font-size:11px;margin-bottom:6px}
+.c{display:grid;grid-template-columns:repeat(4,1fr);margin-bottom:6px}.c b{font-size:15px;display:block}
+.r{display:flex;align-items:center;gap:8px;margin-top:3px}.r span{width:150px;font-size:11px}
+.bar{flex:1;height:12px;background:#c9d6df;border-radius:2px;overflow:hidden}.bar div{height:100%;background:#0078d4}
+</style></head><body><h1 id="h">connecting…</h1><div id="grid"></div>
+<script>
+const F=["util","temp","fan","clock","mem","power"],U=["%","℃","%","MHz","M","W"],P={};
+let host="";
+function fmt(v,m){return v==null?"N/A":(m==5?v.toFixed(2):Math.round(v))+U[m]}
+function panel(i){
+  let p=P[i];if(p)return p;
+  const e=document.createElement("div");e.className="p";
+  e.innerHTML='<div class="n"></div><div class="sub"></div><div class="c">'+[0,1,2,3].map(m=>'<div><b class="v'+m+'"></b>'+F[m]+'</div>').join("")+
+    '</div><div class="r"><span class="v4"></span><div class="bar"><div class="b4"></div></div></div><div class="r"><span class="v5"></span><div class="bar"><div class="b5"></div></div></div>';
+  const g=document.getElementById("grid"),after=[...g.children].find(c=>+c.dataset.i>i);e.dataset.i=i;g.insertBefore(e,after||null);
+  p=P[i]={e,v:[null,null,null,null,null,null],id:{},q:m=>e.querySelector(m)};return p;
+}
+function draw(p,i,ms){
+  if(ms.has("id")){p.q(".n").textContent=p.id.name||"Unknown GPU";p.q(".sub").textContent="#"+(p.id.n>=0?p.id.n:i)+"  ·  pci: "+(p.id.pci||"N/A")}
+  for(const m of ms){if(m==="id")continue;if(m<4)p.q(".v"+m).textContent=fmt(p.v[m],m)}
+  if(ms.has(4)||ms.has("id")){const t=p.id.mem;p.q(".v4").textContent="Memory "+fmt(p.v[4],4)+" / "+(t==null?"N/A":Math.round(t)+"M");p.q(".b4").style.width=(t>0&&p.v[4]!=null?Math.min(100,p.v[4]*100/t):0)+"%"}
+  if(ms.has(5)||ms.has("id")){const l=p.id.pl;p.q(".v5").textContent="Power "+fmt(p.v[5],5)+" / "+(l==null?"N/A":l.toFixed(2)+"W");p.q(".b5").style.width=(l>0&&p.v[5]!=null?Math.min(100,p.v[5]*100/l):0)+"%"}
+}
+function ids(o){for(const k in o){const p=panel(+k);p.id=o[k];draw(p,+k,new Set(["id"]))}}
+const es=new EventSource("events");
+es.addEventListener("full",ev=>{
+  const d=JSON.parse(ev.data);host=d.host;document.getElementById("grid").innerHTML="";for(const k in P)delete P[k];
+  for(const g of d.gpus){const p=panel(g.i);p.v=g.v;p.id=g.id;p.e.classList.toggle("st",!!g.st);draw(p,g.i,new Set(["id",0,1,2,3,4,5]))}
+  document.getElementById("h").textContent="GPU Status on "+host+"  ·  "+d.gpus.length+" GPUs";
+});
+es.addEventListener("delta",ev=>{
+  const d=JSON.parse(ev.data);if(d.id)ids(d.id);
+  for(const [i,st,v] of d.g){const p=panel(i),ms=new Set();for(const m in v){p.v[m]=v[m];ms.add(+m)}p.e.classList.toggle("st",!!st);draw(p,i,ms)}
+  for(const i of d.gone||[]){if(P[i]){P[i].e.remove();delete P[i]}}
+});
+es.onerror=()=>{document.getElementById("h").textContent="reconnecting…"};
+</script></body></html>
+)HTML";
+
+class WebDashboard {
+public:
+    bool start(const std::string& spec, const std::string& hostname) {
+        m_host = hostname;
+        m_listen = listenOn(spec);
+        if (m_listen == BAD_SOCKET) return false;
+        m_acceptThread = std::thread(&WebDashboard::acceptLoop, this);
+        return true;
+    }
+
+    // Sink: advances the state and sends the changes to every stream.
+    void publish(const FleetSnapshot& snap) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lk(m_mutex);
+        bool encode = !m_clients.empty();
+        m_event.clear();
+        m_ids.clear();
+        if (encode) { m_event = "event: delta\ndata: {\"seq\":"; m_event += std::to_string(snap.seq); m_event += ",\"g\":["; }
+        size_t changed = 0;
+        std::string gone;
+        m_state.advance(snap, [&](const StateSlot& cur, const StateSlot* prev) {
+            if (!encode) return;
+            if (!prev || prev->id != cur.id) {
+                if (!m_ids.empty()) m_ids += ',';
+                m_ids += '"'; m_ids += std::to_string(cur.index); m_ids += "\":"; appendIdentity(m_ids, cur.id.get());
+            }
+            bool first = true;
+            for (int m = 0; m < M_COUNT; ++m) {
+                if (prev && prev->q[m] == cur.q[m]) continue;
+                if (first) {
+                    m_event += changed++ ? ",[" : "[";
+                    appendIndex(m_event, cur.index, false); m_event += cur.stale ? ",1,{" : ",0,{";
+                    first = false;
+                } else m_event += ',';
+                m_event += '"'; m_event += (char)('0' + m); m_event += "\":"; appendValue(m_event, cur.q[m]);
+            }
+            if (first && prev && prev->stale != cur.stale) {
+                m_event += changed++ ? ",[" : "["; appendIndex(m_event, cur.index, false); m_event += cur.stale ? ",1,{" : ",0,{";
+                first = false;
+            }
+            if (!first) m_event += "}]";
+        }, [&](const StateSlot& sl) { if (encode) appendIndex(gone, sl.index); });
+        if (!encode) return;
+        m_event += ']';
+        if (!m_ids.empty()) { m_event += ",\"id\":{"; m_event += m_ids; m_event += '}'; }
+        if (!gone.empty()) { m_event += ",\"gone\":["; m_event += gone; m_event += ']'; }
+        m_event += "}\n\n";
+        m_dropped += m_clients.send(m_event);
+        ++m_ticks; m_eventBytes += m_event.size();
+        m_publishNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    void stop() {
+        if (m_listen == BAD_SOCKET) return;
+        m_stop = true;
+        if (m_acceptThread.joinable()) m_acceptThread.join();
+        closeSocket(m_listen); m_listen = BAD_SOCKET;
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_clients.closeAll();
+    }
+
+    void print(FILE* f) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (m_listen == BAD_SOCKET && !m_served) return;
+        fprintf(f, "web: %llu streams served, %llu dropped, %llu encoded ticks, %.0f bytes and %.1f us per tick\n",
+                (unsigned long long)m_served, (unsigned long long)m_dropped, (unsigned long long)m_ticks,
+                m_ticks ? (double)m_eventBytes / m_ticks : 0.0, m_ticks ? m_publishNs / 1e3 / m_ticks : 0.0);
+    }
+
+private:
+    struct Request { socket_t sock; std::string buf; std::chrono::steady_clock::time_point since; };
+
+    std::mutex m_mutex;
+    std::string m_host, m_event, m_ids;
+    StateDiffer m_state;
+    ClientFanout m_clients;
+    socket_t m_listen = BAD_SOCKET;
+    std::thread m_acceptThread;
+    std::atomic<bool> m_stop{false};
+    uint64_t m_served = 0, m_dropped = 0, m_ticks = 0, m_eventBytes = 0, m_publishNs = 0;
+
+    static void appendIndex(std::string& out, int index, bool comma = true) {
+        if (comma && !out.empty()) out += ',';
+        char buf[16];
+        out.append(buf, std::to_chars(buf, buf + sizeof(buf), index).ptr);
+    }
+
+    static void appendValue(std::string& out, int64_t q) {
+        if (q == Q_NAN) { out += "null"; return; }
+        char buf[24];
+        out.append(buf, formatHundredths(buf, q));
+    }
+
+    static void appendString(std::string& out, const std::string& s) {
+        out += '"';
+        for (unsigned char c : s) {
+            if (c == '"' || c == '\\') { out += '\\'; out += (char)c; }
+            else if (c < 0x20) { char buf[8]; snprintf(buf, sizeof(buf), "\\u%04x", c); out += buf; }
+            else out += (char)c;
         }
-        case WM_SMI_UPDATE: {
-            if (!self) break;
-            int idx = (int)wp;
-            SmiData* data = reinterpret_cast<SmiData*>(lp);
-            if (idx >= self->panelCount()) self->addNewPanel();
-            if (idx < self->panelCount()) self->panel(idx)->updateInfo(*data);
-            delete data; return 0;
+        out += '"';
+    }
+
+    static void appendIdentity(std::string& out, const GpuIdentity* id) {
+        if (!id) { out += "{}"; return; }
+        out += "{\"name\":"; appendString(out, id->name);
+        out += ",\"uuid\":"; appendString(out, id->uuid);
+        out += ",\"pci\":"; appendString(out, id->pciBusId);
+        out += ",\"mem\":"; appendValue(out, quantize(id->memTotal));
+        out += ",\"pl\":"; appendValue(out, quantize(id->powerLimit));
+        out += ",\"n\":"; appendIndex(out, id->index, false);
+        out += '}';
+    }
+
+    // The whole state as a `full` event; called with m_mutex held.
+    void full(std::string& out) const {
+        out += "event: full\ndata: {\"host\":"; appendString(out, m_host); out += ",\"gpus\":[";
+        const std::vector<StateSlot>& state = m_state.state();
+        for (size_t i = 0; i < state.size(); ++i) {
+            const StateSlot& sl = state[i];
+            out += i ? ",{\"i\":" : "{\"i\":"; appendIndex(out, sl.index, false);
+            out += sl.stale ? ",\"st\":1,\"id\":" : ",\"st\":0,\"id\":"; appendIdentity(out, sl.id.get());
+            out += ",\"v\":[";
+            for (int m = 0; m < M_COUNT; ++m) { if (m) out += ','; appendValue(out, sl.q[m]); }
+            out += "]}";
         }
-        case WM_CLOSE: g_running = false; DestroyWindow(hwnd); return 0;
-        case WM_DESTROY: PostQuitMessage(0); return 0;
+        out += "]}\n\n";
+    }
+
+    // The page is small enough for the socket buffer; a slow reader gets a second.
+    static void sendAll(socket_t s, const std::string& data) {
+        size_t off = 0;
+        for (int waits = 0; off < data.size() && waits < 4; ) {
+            int n = (int)send(s, data.data() + off, (int)(data.size() - off), SEND_FLAGS);
+            if (n > 0) { off += n; continue; }
+            if (n < 0 && !wouldBlock()) return;
+            fd_set wr; FD_ZERO(&wr); FD_SET(s, &wr);
+            timeval tv; tv.tv_sec = 0; tv.tv_usec = 250000;
+            select((int)s + 1, NULL, &wr, NULL, &tv);
+            ++waits;
         }
-        return DefWindowProcW(hwnd, msg, wp, lp);
+    }
+
+    // "GET /path HTTP/1.1": the page, the event stream, or 404.
+    void route(Request& r) {
+        size_t sp = r.buf.find(' '), sp2 = sp == std::string::npos ? sp : r.buf.find(' ', sp + 1);
+        std::string path = sp2 == std::string::npos ? "" : r.buf.substr(sp + 1, sp2 - sp - 1);
+        if (r.buf.compare(0, 4, "GET ") == 0 && path == "/events") {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            std::string first = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                                "Connection: keep-alive\r\n\r\nretry: 2000\n\n";
+            full(first);
+            if (m_clients.add(r.sock, std::move(first))) ++m_served;
+            return;
+        }
+        bool page = r.buf.compare(0, 4, "GET ") == 0 && (path == "/" || path == "/index.html");
+        std::string body = page ? WEB_PAGE : "not found\n";
+        std::string resp = std::string(page ? "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8"
+                                            : "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain")
+                         + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        sendAll(r.sock, resp);
+        closeSocket(r.sock);
+    }
+
+    // Accepts connections and reads their request headers; answered
+    // requests either close or join the streams. Also sends the rest of
+    // any stream that publish() left pending.
+    void acceptLoop() {
+        std::vector<Request> reading;
+        char buf[4096];
+        while (!m_stop && g_running) {
+            fd_set rd, wr; FD_ZERO(&rd); FD_ZERO(&wr); FD_SET(m_listen, &rd);
+            socket_t top = m_listen;
+            for (const auto& r : reading) { FD_SET(r.sock, &rd); top = std::max(top, r.sock); }
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                top = m_clients.watch(wr, top);
+            }
+            timeval tv; tv.tv_sec = 0; tv.tv_usec = 250000;
+            if (select((int)top + 1, &rd, &wr, NULL, &tv) < 0) continue;
+            {
+                // What a tick left pending goes out as the socket drains, not a tick later.
+                std::lock_guard<std::mutex> lk(m_mutex);
+                m_dropped += m_clients.drain(wr);
+            }
+            auto now = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < reading.size(); ) {
+                Request& r = reading[i];
+                bool done = false, bad = now - r.since > std::chrono::seconds(5);
+                if (FD_ISSET(r.sock, &rd)) {
+                    int n = (int)recv(r.sock, buf, sizeof(buf), 0);
+                    if (n > 0) r.buf.append(buf, n);
+                    else if (n == 0 || !wouldBlock()) bad = true;
+                    done = r.buf.find("\r\n\r\n") != std::string::npos;
+                    bad = bad || r.buf.size() > 16384;
+                }
+                if (done) route(r);
+                else if (bad) closeSocket(r.sock);
+                if (done || bad) { reading[i] = std::move(reading.back()); reading.pop_back(); }
+                else ++i;
+            }
+            if (FD_ISSET(m_listen, &rd) && reading.size() < 256) {
+                socket_t s = accept(m_listen, NULL, NULL);
+                if (s == BAD_SOCKET) continue;
+                int on = 1; setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+                setNonBlocking(s);
+                reading.push_back({s, {}, now});
+            }
+        }
+        for (auto& r : reading) closeSocket(r.sock);
     }
 };
 
-// ─── SmiReader thread ───────────────────────────────────────────────────────
-static void smiReaderThread(const std::vector<std::string>& fields, HWND hwnd, HANDLE hPipe) {
-    char buffer[4096]; std::string lineBuf; DWORD bytesRead;
-    while (g_running) {
-        if (!ReadFile(hPipe, buffer, sizeof(buffer) - 1, &bytesRead, NULL) || bytesRead == 0) break;
-        buffer[bytesRead] = '\0';
-        lineBuf += buffer;
-        size_t pos;
-        while ((pos = lineBuf.find('\n')) != std::string::npos) {
-            std::string line = lineBuf.substr(0, pos);
-            lineBuf = lineBuf.substr(pos + 1);
-            line = trim(line);
-            if (line.empty()) continue;
-            std::vector<std::string> values; std::stringstream ss(line); std::string tok;
-            while (std::getline(ss, tok, ',')) values.push_back(trim(tok));
-            auto* data = new SmiData();
-            for (size_t i = 0; i < fields.size() && i < values.size(); ++i)
-                (*data)[fields[i]] = values[i];
-            int idx = -1;
-            try { idx = std::stoi((*data)["index"]); } catch (...) { delete data; continue; }
-            PostMessage(hwnd, WM_SMI_UPDATE, (WPARAM)idx, (LPARAM)data);
+// ─── Sample log ─────────────────────────────────────────────────────────────
+// `--record PATH` appends every non-stale sample to a columnar log and keeps
+// a sparse block index next to it in PATH.idx; `--query PATH` answers time
+// range questions from the index without decoding the whole log.
+//
+// Log:   "NVSMILOG", u32 version, u32 gpusPerHost, then blocks. A block holds
+//        up to LOG_BLOCK_ROWS rows (one GPU sample each, in arrival order)
+//        stored column by column: timestamps as zigzag varint differences
+//        from the previous row (the first from the block's firstTs), GPU
+//        indices as varints, and each metric as zigzag varint differences in
+//        hundredths against the same GPU's previous row in the block.
+// Index: "NVSMIIDX", u32 version, u32 entry size, then one LogBlockEntry per
+//        block in time order: where its columns are, its time span, a bitmask
+//        of GPU indices (bit index % 64) and min/max per metric. A block is
+//        written before its entry, so a crash loses at most the open block.
+// Times are as recorded: nvidia-smi's local clock, or UTC for --simulate.
+static const char LOG_MAGIC[8] = {'N', 'V', 'S', 'M', 'I', 'L', 'O', 'G'};
+static const char IDX_MAGIC[8] = {'N', 'V', 'S', 'M', 'I', 'I', 'D', 'X'};
+static const uint32_t LOG_VERSION = 1;
+static const uint32_t LOG_BLOCK_ROWS = 4096;
+static const int64_t LOG_BLOCK_SPAN_MS = 15 * 60000;   // quiet hosts still get fresh blocks
+enum { LC_TS, LC_INDEX, LC_METRIC0, LC_COUNT = LC_METRIC0 + M_COUNT };
+
+struct LogBlockEntry {
+    uint64_t offset;                  // of the block in the log
+    uint32_t rows;
+    uint32_t colEnd[LC_COUNT];        // column c spans [colEnd[c-1], colEnd[c]) from offset
+    int64_t firstTs, lastTs;
+    uint64_t gpuMask;
+    float min[M_COUNT], max[M_COUNT]; // NaN if the block has no value
+};
+
+static bool seekFile(FILE* f, uint64_t off) {
+#ifdef _WIN32
+    return _fseeki64(f, (int64_t)off, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)off, SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t fileSize(FILE* f) {
+#ifdef _WIN32
+    _fseeki64(f, 0, SEEK_END); return (uint64_t)_ftelli64(f);
+#else
+    fseeko(f, 0, SEEK_END); return (uint64_t)ftello(f);
+#endif
+}
+
+static bool readAt(FILE* f, uint64_t off, void* buf, size_t n) {
+    return seekFile(f, off) && fread(buf, 1, n, f) == n;
+}
+
+class LogRecorder {
+public:
+    ~LogRecorder() { close(); }
+
+    // Appends to an existing log and index, or creates both.
+    bool open(const std::string& path, int gpusPerHost) {
+        std::string idxPath = path + ".idx";
+        m_log = fopen(path.c_str(), "r+b");
+        m_idx = fopen(idxPath.c_str(), "r+b");
+        if (m_log && m_idx) {
+            char magic[8]; uint32_t hdr[2];
+            if (!readAt(m_log, 0, magic, 8) || memcmp(magic, LOG_MAGIC, 8) != 0
+                || fread(hdr, 4, 2, m_log) != 2 || hdr[0] != LOG_VERSION
+                || !readAt(m_idx, 0, magic, 8) || memcmp(magic, IDX_MAGIC, 8) != 0
+                || fread(hdr, 4, 2, m_idx) != 2 || hdr[0] != LOG_VERSION || hdr[1] != sizeof(LogBlockEntry)) {
+                fprintf(stderr, "%s: not a sample log of this version\n", path.c_str());
+                close(); return false;
+            }
+            // Blocks past the last index entry were never committed.
+            uint64_t entries = (fileSize(m_idx) - 16) / sizeof(LogBlockEntry);
+            LogBlockEntry last;
+            m_end = 16;
+            if (entries && readAt(m_idx, 16 + (entries - 1) * sizeof(LogBlockEntry), &last, sizeof(last)))
+                m_end = last.offset + last.colEnd[LC_COUNT - 1];
+            seekFile(m_idx, 16 + entries * sizeof(LogBlockEntry));
+            return true;
+        }
+        close();
+        m_log = fopen(path.c_str(), "w+b");
+        m_idx = fopen(idxPath.c_str(), "w+b");
+        if (!m_log || !m_idx) { fprintf(stderr, "%s: cannot create\n", path.c_str()); close(); return false; }
+        uint32_t hdr[2] = {LOG_VERSION, (uint32_t)gpusPerHost};
+        fwrite(LOG_MAGIC, 1, 8, m_log); fwrite(hdr, 4, 2, m_log);
+        hdr[1] = sizeof(LogBlockEntry);
+        fwrite(IDX_MAGIC, 1, 8, m_idx); fwrite(hdr, 4, 2, m_idx);
+        m_end = 16;
+        return true;
+    }
+
+    void add(const FleetSnapshot& snap) {
+        if (!m_log) return;
+        int64_t ts = snapshotTimeMs(snap);
+        if (m_rows && (m_rows >= LOG_BLOCK_ROWS || ts - m_e.firstTs >= LOG_BLOCK_SPAN_MS)) flush();
+        for (const auto& g : snap.gpus) {
+            if (g.stale || g.index < 0) continue;
+            if (m_rows == 0) beginBlock(ts);
+            ByteWriter{m_col[LC_TS]}.sv(ts - m_prevTs);
+            ByteWriter{m_col[LC_INDEX]}.uv((uint64_t)g.index);
+            if (g.index >= (int)m_prev.size()) m_prev.resize(g.index + 1, std::vector<int64_t>(M_COUNT, 0));
+            for (int m = 0; m < M_COUNT; ++m) {
+                int64_t q = quantize(g.v[m]);
+                ByteWriter{m_col[LC_METRIC0 + m]}.sv(qdiff(q, m_prev[g.index][m]));
+                m_prev[g.index][m] = q;
+                if (std::isnan(g.v[m])) continue;
+                float x = (float)g.v[m];
+                if (!(m_e.min[m] <= x)) m_e.min[m] = x;   // NaN-initialized
+                if (!(m_e.max[m] >= x)) m_e.max[m] = x;
+            }
+            m_prevTs = ts;
+            m_e.lastTs = ts;
+            m_e.gpuMask |= 1ull << (g.index & 63);
+            ++m_rows; ++m_written;
+        }
+    }
+
+    void print(FILE* f) const {
+        fprintf(f, "record: %llu rows in %llu blocks, %llu bytes\n", (unsigned long long)m_written,
+                (unsigned long long)m_blocks, (unsigned long long)m_bytes);
+    }
+
+    void close() {
+        if (m_log && m_rows) flush();
+        if (m_log) fclose(m_log);
+        if (m_idx) fclose(m_idx);
+        m_log = m_idx = nullptr;
+    }
+
+private:
+    FILE* m_log = nullptr;
+    FILE* m_idx = nullptr;
+    uint64_t m_end = 0;
+    uint32_t m_rows = 0;
+    uint64_t m_written = 0, m_blocks = 0, m_bytes = 0;   // this session
+    int64_t m_prevTs = 0;
+    LogBlockEntry m_e;
+    std::string m_col[LC_COUNT];
+    std::vector<std::vector<int64_t>> m_prev;   // per GPU, per metric, quantized
+
+    // Block-local state only, so a block decodes on its own.
+    void beginBlock(int64_t ts) {
+        m_e = LogBlockEntry();
+        m_e.firstTs = m_e.lastTs = m_prevTs = ts;
+        for (int m = 0; m < M_COUNT; ++m) m_e.min[m] = m_e.max[m] = NAN;
+        for (auto& p : m_prev) std::fill(p.begin(), p.end(), 0);
+    }
+
+    void flush() {
+        m_e.offset = m_end;
+        m_e.rows = m_rows;
+        uint32_t at = 0;
+        seekFile(m_log, m_end);
+        for (int c = 0; c < LC_COUNT; ++c) {
+            fwrite(m_col[c].data(), 1, m_col[c].size(), m_log);
+            at += (uint32_t)m_col[c].size();
+            m_e.colEnd[c] = at;
+            m_col[c].clear();
         }
+        fflush(m_log);
+        fwrite(&m_e, sizeof(m_e), 1, m_idx);
+        fflush(m_idx);
+        m_end += at;
+        m_rows = 0;
+        ++m_blocks; m_bytes += at;
     }
+};
+
+// ─── Log queries ────────────────────────────────────────────────────────────
+// "YYYY/MM/DD HH:MM:SS.mmm" for a recorded timestamp (civil_from_days).
+static void formatTimestamp(int64_t ms, char* buf, size_t n) {
+    int64_t days = (ms >= 0 ? ms : ms - 86399999) / 86400000, rem = ms - days * 86400000;
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = (unsigned)(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t y = (int64_t)yoe + era * 400;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153, d = doy - (153 * mp + 2) / 5 + 1, mo = mp < 10 ? mp + 3 : mp - 9;
+    snprintf(buf, n, "%04lld/%02u/%02u %02d:%02d:%02d.%03d", (long long)(y + (mo <= 2)), mo, d,
+             (int)(rem / 3600000), (int)(rem / 60000 % 60), (int)(rem / 1000 % 60), (int)(rem % 1000));
 }
 
-// ─── Process creation ───────────────────────────────────────────────────────
-static HANDLE startProcess(const std::wstring& cmdLine, HANDLE* hStdoutRead) {
-    SECURITY_ATTRIBUTES sa = {}; sa.nLength = sizeof(sa); sa.bInheritHandle = TRUE;
-    HANDLE hRead, hWrite;
-    CreatePipe(&hRead, &hWrite, &sa, 0);
-    SetHandleInformation(hRead, HANDLE_FLAG_INHERIT, 0);
-    STARTUPINFOW si = {}; si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-    si.hStdOutput = hWrite; si.hStdError = hWrite; si.wShowWindow = SW_HIDE;
-    PROCESS_INFORMATION pi = {};
-    std::wstring cmd = cmdLine;
-    BOOL ok = CreateProcessW(NULL, &cmd[0], NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
-    CloseHandle(hWrite);
-    if (!ok) { CloseHandle(hRead); *hStdoutRead = NULL; return NULL; }
-    CloseHandle(pi.hThread); *hStdoutRead = hRead; return pi.hProcess;
+// Quantized value as nvidia-smi would print it with two decimals.
+static void appendHundredths(std::string& out, int64_t q) {
+    if (q == Q_NAN) { out += "[N/A]"; return; }
+    if (q < 0) { out += '-'; q = -q; }
+    char frac[4] = {'.', (char)('0' + q / 10 % 10), (char)('0' + q % 10), 0};
+    out += std::to_string(q / 100); out += frac;
+}
+
+// A full timestamp ("2026/10/19 02:10", seconds optional), a time of day
+// ("02:10") on the same day as `dayOf`, or milliseconds since 1970.
+static int64_t parseTimeArg(const std::string& s, int64_t dayOf) {
+    int f[7] = {}; int n = 0;
+    for (const char* p = s.c_str(); *p && n < 7; ) {
+        if (*p < '0' || *p > '9') { ++p; continue; }
+        long long v = 0;
+        while (*p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+        if (n == 0 && v > 99999) return (int64_t)v;
+        f[n++] = (int)v;
+    }
+    if (n >= 5) { std::string full = s + (n == 5 ? ":00" : ""); return scanTimestamp(full.data(), full.data() + full.size()); }
+    if (n >= 2) {
+        int64_t day = (dayOf >= 0 ? dayOf : dayOf - 86399999) / 86400000 * 86400000;
+        return day + ((f[0] * 60 + f[1]) * 60 + f[2]) * 1000LL;
+    }
+    return -1;
+}
+
+// FIELD>VALUE or FIELD<VALUE.
+struct LogPredicate { int metric; bool greater; double value; };
+
+struct LogQuery {
+    std::string path;
+    std::string from, to;        // parseTimeArg syntax
+    int host = -1, gpu = -1;
+    std::vector<LogPredicate> where;
+    std::vector<int> fields;     // metrics to print, default all
+};
+
+// Read side of the sample log: index entries are read on demand and blocks
+// are decoded column by column, only for the metrics asked for.
+class LogReader {
+public:
+    // One decoded block; metric columns not asked for are left empty.
+    struct Rows { std::vector<int64_t> ts; std::vector<int> index; std::vector<int64_t> q[M_COUNT]; };
+
+    ~LogReader() { close(); }
+
+    bool open(const std::string& path) {
+        m_log = fopen(path.c_str(), "rb");
+        m_idx = fopen((path + ".idx").c_str(), "rb");
+        char magic[8]; uint32_t hdr[2] = {}, ihdr[2] = {};
+        if (!m_log || !m_idx || !readAt(m_log, 0, magic, 8) || memcmp(magic, LOG_MAGIC, 8) != 0 || fread(hdr, 4, 2, m_log) != 2
+            || !readAt(m_idx, 0, magic, 8) || memcmp(magic, IDX_MAGIC, 8) != 0 || fread(ihdr, 4, 2, m_idx) != 2
+            || hdr[0] != LOG_VERSION || ihdr[0] != LOG_VERSION || ihdr[1] != sizeof(LogBlockEntry)) {
+            fprintf(stderr, "%s: not a sample log of this version\n", path.c_str());
+            close(); return false;
+        }
+        m_gpusPerHost = (int)hdr[1];
+        m_blocks = (fileSize(m_idx) - 16) / sizeof(LogBlockEntry);
+        return true;
+    }
+
+    void close() {
+        if (m_log) fclose(m_log);
+        if (m_idx) fclose(m_idx);
+        m_log = m_idx = nullptr;
+    }
+
+    int gpusPerHost() const { return m_gpusPerHost; }
+    uint64_t blocks() const { return m_blocks; }
+    uint64_t bytesRead() const { return m_bytes; }
+    bool entry(uint64_t i, LogBlockEntry& e) { return readAt(m_idx, 16 + i * sizeof(e), &e, sizeof(e)); }
+    int64_t latest() { LogBlockEntry e; return m_blocks && entry(m_blocks - 1, e) ? e.lastTs : 0; }
+
+    // First block that can reach `from`; lastTs is non-decreasing.
+    uint64_t firstReaching(int64_t from) {
+        uint64_t lo = 0, hi = m_blocks; LogBlockEntry e;
+        while (lo < hi) {
+            uint64_t mid = (lo + hi) / 2;
+            if (entry(mid, e) && e.lastTs < from) lo = mid + 1; else hi = mid;
+        }
+        return lo;
+    }
+
+    bool decode(const LogBlockEntry& e, const bool* need, Rows& out) {
+        m_buf.resize(e.colEnd[LC_INDEX]);
+        bool ok = readAt(m_log, e.offset, &m_buf[0], m_buf.size());
+        m_bytes += m_buf.size();
+        ByteReader rm[M_COUNT] = {};
+        for (int m = 0; m < M_COUNT && ok; ++m) {
+            uint32_t cb = e.colEnd[LC_METRIC0 + m - 1], ce = need[m] ? e.colEnd[LC_METRIC0 + m] : cb;
+            m_col[m].resize(ce - cb);
+            if (ce > cb) ok = readAt(m_log, e.offset + cb, &m_col[m][0], ce - cb);
+            m_bytes += ce - cb;
+            rm[m] = ByteReader{m_col[m].data(), m_col[m].data() + m_col[m].size()};
+        }
+        if (!ok) return false;
+        ByteReader rt{m_buf.data(), m_buf.data() + e.colEnd[LC_TS]};
+        ByteReader ri{m_buf.data() + e.colEnd[LC_TS], m_buf.data() + m_buf.size()};
+        for (auto& p : m_prev) std::fill(p.begin(), p.end(), 0);
+        out.ts.resize(e.rows); out.index.resize(e.rows);
+        for (int m = 0; m < M_COUNT; ++m) out.q[m].resize(need[m] ? e.rows : 0);
+
+        int64_t ts = e.firstTs;
+        for (uint32_t r = 0; r < e.rows; ++r) {
+            ts += rt.sv();
+            int index = (int)ri.uv();
+            if (!rt.ok || !ri.ok || index < 0) return false;
+            if (index >= (int)m_prev.size()) m_prev.resize(index + 1, std::vector<int64_t>(M_COUNT, 0));
+            out.ts[r] = ts; out.index[r] = index;
+            for (int m = 0; m < M_COUNT; ++m)
+                if (need[m]) out.q[m][r] = m_prev[index][m] = qadd(m_prev[index][m], rm[m].sv());
+        }
+        return true;
+    }
+
+private:
+    FILE* m_log = nullptr;
+    FILE* m_idx = nullptr;
+    int m_gpusPerHost = 0;
+    uint64_t m_blocks = 0, m_bytes = 0;
+    std::string m_buf, m_col[M_COUNT];
+    std::vector<std::vector<int64_t>> m_prev;   // per GPU, per metric, quantized
+};
+
+// Prints matching rows as CSV to `out`; returns rows printed, or -1.
+static long runLogQuery(const LogQuery& q, FILE* out, bool stats) {
+    auto t0 = std::chrono::steady_clock::now();
+    LogReader log;
+    if (!log.open(q.path)) return -1;
+    int gpusPerHost = log.gpusPerHost();
+    int64_t latest = log.latest();
+    int64_t from = q.from.empty() ? INT64_MIN : parseTimeArg(q.from, latest);
+    int64_t to = q.to.empty() ? INT64_MAX : parseTimeArg(q.to, q.from.empty() ? latest : from);
+    int gpu = q.gpu < 0 ? -1 : q.host >= 0 && gpusPerHost > 0 ? q.host * gpusPerHost + q.gpu : q.gpu;
+    std::vector<int> fields = q.fields;
+    if (fields.empty()) for (int m = 0; m < M_COUNT; ++m) fields.push_back(m);
+    bool need[M_COUNT] = {};
+    for (int m : fields) need[m] = true;
+    for (const auto& p : q.where) need[p.metric] = true;
+
+    fprintf(out, "timestamp,%sindex", gpusPerHost > 0 ? "host," : "");
+    for (int m : fields) fprintf(out, ",%s", METRIC_FIELDS[m]);
+    fputc('\n', out);
+
+    long printed = 0; uint64_t scanned = 0, skipped = 0;
+    LogBlockEntry e;
+    LogReader::Rows rows;
+    std::string line;
+    for (uint64_t b = log.firstReaching(from); b < log.blocks() && log.entry(b, e) && e.firstTs <= to; ++b) {
+        bool skip = gpu >= 0 && !(e.gpuMask & (1ull << (gpu & 63)));
+        for (const auto& p : q.where)
+            if (p.greater ? !(e.max[p.metric] > p.value) : !(e.min[p.metric] < p.value)) skip = true;
+        if (skip) { ++skipped; continue; }
+        ++scanned;
+        if (!log.decode(e, need, rows)) break;
+
+        for (uint32_t r = 0; r < e.rows; ++r) {
+            int64_t ts = rows.ts[r];
+            int index = rows.index[r];
+            if (ts < from || ts > to || (gpu >= 0 && index != gpu)) continue;
+            bool match = true;
+            for (const auto& p : q.where) {
+                double v = dequantize(rows.q[p.metric][r]);
+                if (p.greater ? !(v > p.value) : !(v < p.value)) match = false;
+            }
+            if (!match) continue;
+            char tsBuf[64];
+            formatTimestamp(ts, tsBuf, sizeof(tsBuf));
+            line = tsBuf;
+            if (gpusPerHost > 0) { line += ','; line += std::to_string(index / gpusPerHost); }
+            line += ','; line += std::to_string(gpusPerHost > 0 ? index % gpusPerHost : index);
+            for (int m : fields) { line += ','; appendHundredths(line, rows.q[m][r]); }
+            line += '\n';
+            fwrite(line.data(), 1, line.size(), out);
+            ++printed;
+        }
+    }
+    if (stats)
+        fprintf(stderr, "query: %ld rows, %llu of %llu blocks decoded (%llu skipped by index), %llu bytes read, %.2f ms\n",
+                printed, (unsigned long long)scanned, (unsigned long long)log.blocks(), (unsigned long long)skipped,
+                (unsigned long long)log.bytesRead(),
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    return printed;
+}
+
+// Runs an analytics expression over a sample log, limited by --from/--to as
+// well as `over`. Returns 0, or 1 on error.
+static int runLogEval(const LogQuery& lq, const std::string& text, FILE* out, bool stats) {
+    auto t0 = std::chrono::steady_clock::now();
+    AnalyticsQuery q;
+    std::string err;
+    if (!ExprParser(text).parse(q, err)) { fprintf(stderr, "--eval: %s\n", err.c_str()); return 1; }
+    if (q.identity) { fprintf(stderr, "--eval: memory.total and enforced.power.limit are not recorded in sample logs\n"); return 1; }
+    LogReader log;
+    if (!log.open(lq.path)) return 1;
+    if (g_gpusPerHost <= 0) g_gpusPerHost = log.gpusPerHost();
+    int64_t latest = log.latest();
+    int64_t from = lq.from.empty() ? INT64_MIN : parseTimeArg(lq.from, latest);
+    int64_t to = lq.to.empty() ? INT64_MAX : parseTimeArg(lq.to, lq.from.empty() ? latest : from);
+    if (q.overMs) from = std::max(from, std::min(to, latest) - q.overMs);
+
+    AnalyticsEval eval(q);
+    LogBlockEntry e;
+    LogReader::Rows rows;
+    std::vector<int64_t> cols[M_COUNT + 1];
+    std::vector<int> index;
+    for (uint64_t b = log.firstReaching(from); b < log.blocks() && log.entry(b, e) && e.firstTs <= to; ++b) {
+        bool inside = e.firstTs >= from && e.lastTs <= to;
+        if (inside && eval.bounds(e.min, e.max, e.rows)) continue;
+        if (!log.decode(e, q.need, rows)) break;
+        ColumnChunk c;
+        c.rows = e.rows; c.ts = rows.ts.data(); c.index = rows.index.data();
+        for (int m = 0; m < M_COUNT; ++m) if (q.need[m]) c.q[m] = rows.q[m].data();
+        if (!inside) {
+            // Keep the rows in range; arrival order need not be time order.
+            index.clear(); cols[M_COUNT].clear();
+            for (int m = 0; m < M_COUNT; ++m) cols[m].clear();
+            for (uint32_t r = 0; r < e.rows; ++r) {
+                if (rows.ts[r] < from || rows.ts[r] > to) continue;
+                index.push_back(rows.index[r]); cols[M_COUNT].push_back(rows.ts[r]);
+                for (int m = 0; m < M_COUNT; ++m) if (q.need[m]) cols[m].push_back(rows.q[m][r]);
+            }
+            c.rows = (uint32_t)index.size(); c.ts = cols[M_COUNT].data(); c.index = index.data();
+            for (int m = 0; m < M_COUNT; ++m) if (q.need[m]) c.q[m] = cols[m].data();
+        }
+        eval.rows(c);
+    }
+    std::string report;
+    eval.report(report);
+    fputs(report.c_str(), out);
+    if (stats)
+        fprintf(stderr, "eval: %llu rows from the index, %llu decoded, %llu bytes read, %.2f ms\n",
+                (unsigned long long)eval.summarized, (unsigned long long)eval.decoded, (unsigned long long)log.bytesRead(),
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    return 0;
 }
 
 // ─── Command line parsing ───────────────────────────────────────────────────
+#ifdef _WIN32
 static bool isSystemDarkMode() {
     HKEY hKey; DWORD val = 1, size = sizeof(val);
     if (RegOpenKeyExW(HKEY_CURRENT_USER,
@@ -533,92 +7086,411 @@ static bool isSystemDarkMode() {
     }
     return val == 0; // 0 = dark, 1 = light
 }
+#endif
 
 // theme: 0=auto, 1=force dark, 2=force light
-struct AppArgs { std::string host, user, sshArgs; int port = 22; int theme = 0; };
+struct AppArgs {
+    std::string host, user, sshArgs;
+    int port = 22; int theme = 0;
+    bool headless = false;
+    std::string shmName;          // empty = no shared-memory publication
+    std::string collect;          // [addr:]port to serve viewers on
+    std::string connect;          // [host:]port of a collector to view
+    int simulate = 0;             // synthetic GPUs instead of nvidia-smi
+    int gpusPerHost = 0;          // host grouping for fleet views, 0 = one host
+    bool overview = false;        // start in the heatmap overview
+    int fps = 30;                 // repaint cap, 0 = display refresh rate
+    int intervalMs = 300;         // sampling interval; down to 10 for high-rate capture
+    bool agent = false;           // write frames to stdout (implies headless)
+    std::string remoteAgent;      // path of this binary on the host, run with --agent
+    bool stats = false;           // print source statistics on exit
+    std::vector<int> windows = {10, 60, 600};   // rolling statistics windows, seconds
+    double historyHours = 1;      // in-memory history retention
+    int simDays = 0;              // --simulate: generate this much history, unpaced, then exit
+    int simMig = 0;               // --simulate: MIG instances per GPU, 0 = MIG off
+    std::string record;           // sample log to append to
+    LogQuery query;               // --query: answer from a sample log and exit
+    std::string eval;             // analytics expression, over --query's log or the history at exit
+    int detailSec = 30;           // `nvidia-smi -q -x` cadence, 0 = off
+    bool hostMetrics = true;      // sample this host's /proc and /sys next to local GPUs
+    std::string procRoot;         // stands in for "/" when reading /proc and /sys
+    std::string exportSpec;       // influx://host:port or statsd://host:port
+    int exportMtu = 1400;         // largest export datagram, bytes
+    std::string web;              // [addr:]port to serve the browser dashboard on
+    bool tiles = false;           // overview as a grid of compact panels instead of the heatmap
+    int renderThreads = 0;        // panel grid render threads, 0 = one per core
+    std::vector<std::string> hosts;   // --hosts: ssh to each, merged into one fleet
+    int connectLimit = 10;        // --hosts: handshakes in flight at once (sshd MaxStartups starts dropping past 10)
+    int connectStaggerMs = 25;    // --hosts: least time between two launches
+    int reorderWindowMs = 0;      // --hosts: how long the merge holds samples back, 0 = two intervals
+    std::string historyDir;       // history files; default: the user's state directory, for live sources
+    bool historyFile = true;      // --no-history-file turns them off
+    std::string error;            // a rejected flag value; the program exits with it
+};
+
+static std::vector<std::string> splitList(const std::string& v) {
+    std::vector<std::string> out; size_t b = 0;
+    while (b < v.size()) {
+        size_t e = v.find(',', b); if (e == std::string::npos) e = v.size();
+        out.push_back(v.substr(b, e - b));
+        b = e + 1;
+    }
+    return out;
+}
+
+// `--hosts a,b,c` or `--hosts @FILE`, one host per line, # comments.
+static std::vector<std::string> readHostList(const std::string& v) {
+    if (v.empty() || v[0] != '@') return splitList(v);
+    std::vector<std::string> out;
+    FILE* f = fopen(v.c_str() + 1, "r");
+    if (!f) { fprintf(stderr, "--hosts: cannot read %s\n", v.c_str() + 1); return out; }
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        std::string h = line;
+        h.erase(std::min(h.find('#'), h.size()));
+        h.erase(0, h.find_first_not_of(" \t\r\n"));
+        h.erase(h.find_last_not_of(" \t\r\n") + 1);
+        if (!h.empty()) out.push_back(h);
+    }
+    fclose(f);
+    return out;
+}
 
-static AppArgs parseArgs(int argc, wchar_t** argv) {
+static AppArgs parseArgs(const std::vector<std::string>& argv) {
     AppArgs a;
+    int argc = (int)argv.size();
     for (int i = 1; i < argc; ++i) {
-        std::wstring arg = argv[i];
-        auto nextVal = [&]() -> std::string {
-            if (i + 1 < argc) {
-                std::wstring v = argv[++i];
-                int n = WideCharToMultiByte(CP_UTF8, 0, v.c_str(), -1, NULL, 0, NULL, NULL);
-                std::string s(n, 0); WideCharToMultiByte(CP_UTF8, 0, v.c_str(), -1, &s[0], n, NULL, NULL);
-                s.resize(n - 1); return s;
-            } return "";
-        };
-        if (arg == L"-H" || arg == L"--host") a.host = nextVal();
-        else if (arg == L"-p" || arg == L"--port") { auto v = nextVal(); a.port = v.empty() ? 22 : std::stoi(v); }
-        else if (arg == L"-u" || arg == L"--user") a.user = nextVal();
-        else if (arg == L"--ssh-args") a.sshArgs = nextVal();
-        else if (arg == L"--dark") a.theme = 1;
-        else if (arg == L"--light") a.theme = 2;
+        const std::string& arg = argv[i];
+        auto nextVal = [&]() -> std::string { return (i + 1 < argc) ? argv[++i] : ""; };
+        if (arg == "-H" || arg == "--host") a.host = nextVal();
+        else if (arg == "-p" || arg == "--port") { auto v = nextVal(); a.port = v.empty() ? 22 : std::stoi(v); }
+        else if (arg == "-u" || arg == "--user") a.user = nextVal();
+        else if (arg == "--ssh-args") a.sshArgs = nextVal();
+        else if (arg == "--hosts") a.hosts = readHostList(nextVal());
+        else if (arg == "--connect-limit") a.connectLimit = std::max(1, atoi(nextVal().c_str()));
+        else if (arg == "--connect-stagger") a.connectStaggerMs = std::max(0, atoi(nextVal().c_str()));
+        else if (arg == "--reorder-window") a.reorderWindowMs = std::max(0, atoi(nextVal().c_str()));
+        else if (arg == "--dark") a.theme = 1;
+        else if (arg == "--light") a.theme = 2;
+        else if (arg == "--headless") a.headless = true;
+        else if (arg == "--shm") a.shmName = NVSMI_SHM_DEFAULT_NAME;
+        else if (arg == "--shm-name") a.shmName = nextVal();
+        else if (arg == "--collect") a.collect = nextVal();
+        else if (arg == "--connect") a.connect = nextVal();
+        else if (arg == "--simulate") {
+            // N GPUs, or HOSTSxGPUS
+            auto v = nextVal(); size_t x = v.find('x');
+            long long n = v.empty() ? 8 : atoll(v.c_str());
+            if (x != std::string::npos) { a.gpusPerHost = atoi(v.c_str() + x + 1); n = a.gpusPerHost > 0 ? n * a.gpusPerHost : 0; }
+            a.simulate = (int)std::max(0LL, std::min(n, 1000000LL));
+            if (n <= 0 || n > 1000000) a.error = "--simulate: expected N or HOSTSxGPUS, 1 to 1000000 GPUs in all, got \"" + v + "\"";
+        }
+        else if (arg == "--gpus-per-host") a.gpusPerHost = atoi(nextVal().c_str());
+        else if (arg == "--overview") a.overview = true;
+        else if (arg == "--tiles") a.tiles = true;
+        else if (arg == "--render-threads") a.renderThreads = std::max(0, atoi(nextVal().c_str()));
+        else if (arg == "--fps") a.fps = std::max(0, atoi(nextVal().c_str()));
+        else if (arg == "--interval") { int ms = atoi(nextVal().c_str()); if (ms > 0) a.intervalMs = std::max(10, ms); }
+        else if (arg == "--agent") a.agent = a.headless = true;
+        else if (arg == "--remote-agent") a.remoteAgent = nextVal();
+        else if (arg == "--stats") a.stats = true;
+        else if (arg == "--windows") {
+            a.windows.clear();
+            for (const auto& w : splitList(nextVal())) if (atoi(w.c_str()) > 0) a.windows.push_back(atoi(w.c_str()));
+            if (a.windows.empty()) a.windows = {10, 60, 600};
+        }
+        else if (arg == "--history") { double h = atof(nextVal().c_str()); if (h > 0) a.historyHours = h; }
+        else if (arg == "--history-dir") a.historyDir = nextVal();
+        else if (arg == "--no-history-file") a.historyFile = false;
+        else if (arg == "--sim-days") a.simDays = atoi(nextVal().c_str());
+        else if (arg == "--mig") a.simMig = std::max(0, std::min(7, atoi(nextVal().c_str())));
+        else if (arg == "--record") a.record = nextVal();
+        else if (arg == "--query") { a.query.path = nextVal(); a.headless = true; }
+        else if (arg == "--eval") a.eval = nextVal();
+        else if (arg == "--export") a.exportSpec = nextVal();
+        else if (arg == "--web") a.web = nextVal();
+        else if (arg == "--export-mtu") a.exportMtu = atoi(nextVal().c_str());
+        else if (arg == "--no-host-metrics") a.hostMetrics = false;
+        else if (arg == "--proc-root") a.procRoot = nextVal();
+        else if (arg == "--detail-interval") a.detailSec = std::max(0, atoi(nextVal().c_str()));
+        else if (arg == "--from") a.query.from = nextVal();
+        else if (arg == "--to") a.query.to = nextVal();
+        else if (arg == "--gpu") {
+            // GPU index, or HOST:GPU
+            std::string v = nextVal(); size_t c = v.find(':');
+            if (c != std::string::npos) a.query.host = atoi(v.c_str());
+            a.query.gpu = atoi(v.c_str() + (c == std::string::npos ? 0 : c + 1));
+        }
+        else if (arg == "--fields") {
+            for (const auto& f : splitList(nextVal())) if (metricByName(f) >= 0) a.query.fields.push_back(metricByName(f));
+        }
+        else if (arg == "--where") {
+            // FIELD>VALUE,FIELD<VALUE,...
+            for (const auto& c : splitList(nextVal())) {
+                size_t op = c.find_first_of("<>");
+                int m = op == std::string::npos ? -1 : metricByName(c.substr(0, op));
+                if (m >= 0) a.query.where.push_back({m, c[op] == '>', atof(c.c_str() + op + 1)});
+                else fprintf(stderr, "--where: ignoring \"%s\"\n", c.c_str());
+            }
+        }
     }
     return a;
 }
 
+// ─── Session ────────────────────────────────────────────────────────────────
+// Everything between argument parsing and the UI: the source (nvidia-smi
+// loop plus identity thread, a collector, or the simulator) and the sinks.
+// Shared by the GUI and headless entry points.
+
+struct Session {
+    std::string hostname;
+    std::vector<std::string> hostNames;     // by host number, for per-host files
+    std::thread reader, idReader, detailReader;
+    ShmPublisher shm;
+    Collector collector;
+    AgentWriter agent;
+    LogRecorder recorder;
+    MetricExporter exporter;
+    WebDashboard web;
+#ifndef _WIN32
+    HostSampler hostSampler;
+#endif
+};
+
+// `localGpus`: the GPUs are in this machine, so its host metrics belong
+// next to them (always with --proc-root, which is for fixtures).
+static void startSinks(const AppArgs& args, Session& s, bool localGpus) {
+#ifndef _WIN32
+    if (args.hostMetrics && (localGpus || !args.procRoot.empty()) && s.hostSampler.open(args.procRoot, 0))
+        g_hub.addSink([&s](const FleetSnapshot& snap) { s.hostSampler.tick(snapshotTimeMs(snap)); });
+#else
+    (void)localGpus;
+#endif
+    if (!args.agent) {
+        g_stats.configure(args.windows, args.intervalMs);
+        g_history.configure((int64_t)(args.historyHours * 3600000));
+        // Live sources persist by default; the simulator and viewers only when asked.
+        bool live = args.simulate == 0 && args.connect.empty();
+        std::string dir = args.historyDir.empty() && live ? defaultHistoryDir() : args.historyDir;
+        if (args.historyFile && !dir.empty())
+            g_history.persist(dir, s.hostNames.empty() ? std::vector<std::string>{s.hostname} : s.hostNames, args.hosts.empty());
+        g_hub.addSink([](const FleetSnapshot& snap) {
+            g_stats.add(snap); g_quantiles.add(snap); g_fleet.apply(snap); g_history.add(snap);
+        });
+    }
+    if (!args.shmName.empty() && s.shm.open(args.shmName))
+        g_hub.addSink([&s](const FleetSnapshot& snap) { s.shm.publish(snap); });
+    if (!args.collect.empty() && s.collector.start(args.collect))
+        g_hub.addSink([&s](const FleetSnapshot& snap) { s.collector.publish(snap); });
+    if (args.agent)
+        g_hub.addSink([&s](const FleetSnapshot& snap) { s.agent.publish(snap); });
+    if (!args.record.empty() && s.recorder.open(args.record, g_gpusPerHost))
+        g_hub.addSink([&s](const FleetSnapshot& snap) { s.recorder.add(snap); });
+    if (!args.exportSpec.empty() && s.exporter.start(args.exportSpec, s.hostname, args.exportMtu))
+        g_hub.addSink([&s](const FleetSnapshot& snap) { s.exporter.publish(snap); });
+    if (!args.web.empty() && s.web.start(args.web, s.hostname))
+        g_hub.addSink([&s](const FleetSnapshot& snap) { s.web.publish(snap); });
+}
+
+// Command prefix that runs the rest on `host` ([user@]name) over ssh.
+static std::string sshPrefix(const AppArgs& args, const std::string& host, std::string& hostname) {
+    std::string username = args.user;
+    if (host.find('@') != std::string::npos && username.empty()) {
+        auto at = host.rfind('@');
+        username = host.substr(0, at); hostname = host.substr(at + 1);
+    } else hostname = host;
+    std::string prefix = "ssh -p " + std::to_string(args.port) + " -o BatchMode=yes -o ConnectTimeout=10";
+    if (!args.sshArgs.empty()) prefix += " " + args.sshArgs;
+    return prefix + " " + (username.empty() ? hostname : username + "@" + hostname) + " ";
+}
+
+static bool startSession(const AppArgs& args, Session& s) {
+    if (!args.collect.empty() || !args.connect.empty() || !args.exportSpec.empty() || !args.web.empty()) netInit();
+    g_gpusPerHost = std::max(0, args.gpusPerHost);
+    if (args.simulate > 0) {
+        s.hostname = "simulator";
+        for (int h = 0; g_gpusPerHost > 0 && h * g_gpusPerHost < args.simulate; ++h) s.hostNames.push_back("simulator-" + std::to_string(h));
+        startSinks(args, s, false);
+        s.reader = std::thread(simulateThread, args.simulate, args.intervalMs, args.simDays, args.simMig, args.detailSec);
+        return true;
+    }
+    if (!args.connect.empty()) {
+        s.hostname = args.connect;
+        startSinks(args, s, false);
+        s.reader = std::thread(viewerThread, args.connect);
+        return true;
+    }
+
+    std::string qf = "timestamp,index,uuid";
+    for (const char* f : METRIC_FIELDS) { qf += ","; qf += f; }
+
+    std::string loop = "nvidia-smi --query-gpu=" + qf + " --format=csv,noheader,nounits -lms " + std::to_string(args.intervalMs);
+    if (!args.hosts.empty()) {
+        if (g_gpusPerHost == 0) g_gpusPerHost = 8;
+        std::vector<std::string> names, cmds, idCmds;
+        for (const auto& h : args.hosts) {
+            std::string name, prefix = sshPrefix(args, h, name);
+            cmds.push_back(prefix + loop);
+            idCmds.push_back(prefix + "nvidia-smi --query-gpu=" + IDENTITY_FIELDS + " --format=csv,noheader,nounits");
+            names.push_back(name);
+        }
+        FleetConnector::Options o;
+        o.limit = args.connectLimit; o.staggerMs = args.connectStaggerMs;
+        o.intervalMs = args.intervalMs; o.gpusPerHost = g_gpusPerHost; o.report = args.stats;
+        o.windowMs = args.reorderWindowMs > 0 ? args.reorderWindowMs : 2 * args.intervalMs;
+        g_connector.configure(names, cmds, idCmds, o);
+        g_fleetSlots = (int)names.size() * g_gpusPerHost;
+        s.hostname = std::to_string(names.size()) + " hosts";
+        s.hostNames = names;
+        startSinks(args, s, false);
+        s.reader = std::thread(&FleetConnector::run, &g_connector);
+        return true;
+    }
+
+    std::string prefix;
+    if (!args.host.empty()) {
+        prefix = sshPrefix(args, args.host, s.hostname);
+    } else {
+        char hostBuf[256] = {};
+#ifdef _WIN32
+        DWORD hostSz = sizeof(hostBuf);
+        GetComputerNameA(hostBuf, &hostSz);
+#else
+        gethostname(hostBuf, sizeof(hostBuf) - 1);
+#endif
+        s.hostname = hostBuf;
+    }
+    if (!args.remoteAgent.empty()) {
+        if (!startProcess(prefix + args.remoteAgent + " --agent", g_smiProc, false)) return false;
+        startSinks(args, s, false);
+        s.reader = std::thread(agentReaderThread);
+        return true;
+    }
+
+    std::string cmdLine = prefix + loop;
+    std::string idCmdLine = prefix + "nvidia-smi --query-gpu=" + IDENTITY_FIELDS + " --format=csv,noheader,nounits";
+
+    if (!startProcess(cmdLine, g_smiProc)) return false;
+    startSinks(args, s, args.host.empty());
+
+    s.idReader = std::thread(identityThread, idCmdLine);
+    s.reader = std::thread(smiReaderThread, args.intervalMs);
+    if (args.detailSec > 0) s.detailReader = std::thread(detailThread, prefix + "nvidia-smi -q -x", args.detailSec);
+    return true;
+}
+
+static void stopSession(Session& s) {
+    g_running = false;
+    killProcess(g_smiProc);
+    if (s.reader.joinable()) s.reader.join();
+    closeProcess(g_smiProc);
+    g_connector.stop();
+    g_identities.stop();
+    {
+        std::lock_guard<std::mutex> lk(g_identityProcMutex);
+        if (g_identityProc) killProcess(*g_identityProc);
+    }
+    if (s.idReader.joinable()) s.idReader.join();
+    g_details.stop();
+    {
+        std::lock_guard<std::mutex> lk(g_detailProcMutex);
+        if (g_detailProc) killProcess(*g_detailProc);
+    }
+    if (s.detailReader.joinable()) s.detailReader.join();
+    s.collector.stop();
+    s.shm.close();
+    s.recorder.close();
+    s.exporter.stop();
+    s.web.stop();
+}
+
+// Runs until the nvidia-smi loop ends (or a signal on POSIX).
+static int runHeadless(const AppArgs& args) {
+    if (!args.error.empty()) { fprintf(stderr, "%s\n", args.error.c_str()); return 2; }
+    if (!args.query.path.empty() && !args.eval.empty()) return runLogEval(args.query, args.eval, stdout, args.stats);
+    if (!args.query.path.empty()) return runLogQuery(args.query, stdout, args.stats) < 0 ? 1 : 0;
+    Session s;
+    if (!startSession(args, s)) { fprintf(stderr, "Failed to start nvidia-smi.\n"); return 1; }
+    if (s.reader.joinable()) s.reader.join();
+    stopSession(s);
+    if (args.stats) {
+        g_sourceStats.print(stderr); g_hub.print(stderr); g_connector.print(stderr);
+        g_details.print(stderr); g_registry.print(stderr);
+#ifndef _WIN32
+        s.hostSampler.print(stderr);
+#endif
+        for (const HostSample& h : g_hostMetrics.all()) fprintf(stderr, "host %d: %s\n", h.host, describeHost(h).c_str());
+        if (!args.record.empty()) s.recorder.print(stderr);
+        s.exporter.print(stderr); s.web.print(stderr);
+        g_quantiles.print(stderr); g_fleet.print(stderr); g_history.print(stderr);
+    }
+    if (!args.eval.empty()) {
+        std::string out, stats;
+        bool ok = evalHistory(args.eval, out, &stats);
+        fputs(out.c_str(), ok ? stdout : stderr);
+        if (args.stats) fprintf(stderr, "eval: %s", stats.c_str());
+        if (!ok) return 1;
+    }
+    return 0;
+}
+
 // ─── Entry point ────────────────────────────────────────────────────────────
+#ifdef _WIN32
 int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, int) {
     g_hInst = hInst;
+    int argc; LPWSTR* wargv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    std::vector<std::string> argv;
+    for (int i = 0; i < argc; ++i) {
+        int n = WideCharToMultiByte(CP_UTF8, 0, wargv[i], -1, NULL, 0, NULL, NULL);
+        std::string s(n, 0); WideCharToMultiByte(CP_UTF8, 0, wargv[i], -1, &s[0], n, NULL, NULL);
+        s.resize(n - 1); argv.push_back(s);
+    }
+    LocalFree(wargv);
+    AppArgs args = parseArgs(argv);
+    if (args.headless) return runHeadless(args);
+    if (!args.error.empty()) { MessageBoxW(NULL, toW(args.error).c_str(), L"Error", MB_OK | MB_ICONERROR); return 2; }
+
     SetProcessDPIAware();
     HDC hScr = GetDC(NULL);
     g_dpiScale = GetDeviceCaps(hScr, LOGPIXELSY) / 96.0f;
     ReleaseDC(NULL, hScr);
-    int argc; LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
-    AppArgs args = parseArgs(argc, argv); LocalFree(argv);
     g_darkMode = (args.theme == 1) ? true : (args.theme == 2) ? false : isSystemDarkMode();
     g_theme = g_darkMode ? THEME_DARK : THEME_LIGHT;
 
+    INITCOMMONCONTROLSEX icc = {sizeof(icc), ICC_WIN95_CLASSES};
+    InitCommonControlsEx(&icc);
     initIcons();
 
-    std::vector<std::string> fields = {
-        "index","count","pci.bus_id","name","uuid","memory.used","memory.total",
-        "temperature.gpu","power.draw","enforced.power.limit","clocks.current.graphics",
-        "fan.speed","utilization.gpu"
-    };
-    std::string qf; for (size_t i = 0; i < fields.size(); ++i) { if (i) qf += ","; qf += fields[i]; }
-
-    wchar_t hostBuf[256] = {}; DWORD hostSz = 256;
-    GetComputerNameW(hostBuf, &hostSz);
-    std::wstring hostname = hostBuf;
-
-    std::wstring cmdLine;
-    std::string sshHostname, sshUsername = args.user;
-    if (!args.host.empty()) {
-        if (args.host.find('@') != std::string::npos && sshUsername.empty()) {
-            auto at = args.host.rfind('@');
-            sshUsername = args.host.substr(0, at); sshHostname = args.host.substr(at + 1);
-        } else sshHostname = args.host;
-        hostname = toW(sshHostname);
-        std::string cmd = "ssh -p " + std::to_string(args.port) + " -o BatchMode=yes -o ConnectTimeout=10";
-        if (!args.sshArgs.empty()) cmd += " " + args.sshArgs;
-        cmd += " " + (sshUsername.empty() ? sshHostname : sshUsername + "@" + sshHostname);
-        cmd += " nvidia-smi --query-gpu=" + qf + " --format=csv,noheader,nounits -lms 300";
-        cmdLine = toW(cmd);
-    } else {
-        cmdLine = toW("nvidia-smi --query-gpu=" + qf + " --format=csv,noheader,nounits -lms 300");
-    }
-
-    HANDLE hStdoutRead = NULL;
-    g_hProcess = startProcess(cmdLine, &hStdoutRead);
-    if (!g_hProcess) {
+    Session s;
+    if (!startSession(args, s)) {
         MessageBoxW(NULL, L"Failed to start nvidia-smi.\nMake sure nvidia-smi is in PATH.",
                      L"Error", MB_OK | MB_ICONERROR);
         cleanupIcons(); return 1;
     }
 
-    MainWindow mw(L"GPU Status on " + hostname);
+    MainWindow mw(L"GPU Status on " + toW(s.hostname), args.overview || args.tiles, args.fps, args.tiles, args.renderThreads);
+    HWND hwnd = mw.hwnd();
+    g_hub.keepExtremes();
+    g_hub.setNotify([hwnd] { PostMessage(hwnd, WM_SMI_UPDATE, 0, 0); });
     mw.show();
-    std::thread reader(smiReaderThread, fields, mw.hwnd(), hStdoutRead);
 
     MSG msg;
     while (GetMessageW(&msg, NULL, 0, 0)) { TranslateMessage(&msg); DispatchMessageW(&msg); }
 
-    g_running = false;
-    TerminateProcess(g_hProcess, 0); CloseHandle(g_hProcess); CloseHandle(hStdoutRead);
-    if (reader.joinable()) reader.join();
+    stopSession(s);
     cleanupIcons();
     return 0;
 }
+#elif !defined(NVSMI_NO_MAIN)   // tests/ compiles this file into the test binary
+static void onSignal(int) {
+    g_running = false;
+    killProcess(g_smiProc);
+}
+
+int main(int argc, char** argv) {
+    AppArgs args = parseArgs(std::vector<std::string>(argv, argv + argc));
+    signal(SIGINT, onSignal); signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    return runHeadless(args);
+}
+#endif
@@ -0,0 +1,186 @@
+/*
+ * nvsmi_shm.h  —  reader for the shared-memory GPU state published by
+ * nvidia-smi-gui (`--shm`, GUI or `--headless`).
+ *
+ * Header-only C. Include it, then:
+ *
+ *     nvsmi_shm_reader r;
+ *     nvsmi_shm_snapshot s;
+ *     if (nvsmi_shm_open(&r, NVSMI_SHM_DEFAULT_NAME) == 0) {
+ *         if (nvsmi_shm_read(&r, &s) == 0) { ... s.gpus[0].util ... }
+ *         nvsmi_shm_close(&r);
+ *     }
+ *
+ * The region holds the latest tick only and is guarded by a seqlock: the
+ * writer makes `seq` odd while updating and even when done; readers copy and
+ * retry if `seq` moved. Readers never block the writer. There is one writer
+ * per name; a second instance asked to publish under it refuses.
+ *
+ * Limits: at most NVSMI_SHM_MAX_GPUS (64) GPUs are published. A larger
+ * fleet is cut to the 64 lowest indices and the writer warns once on
+ * stderr. `index` is nvidia-smi's index on a single host; for a fleet
+ * (`--hosts`) it is the fleet slot, host * GPUs-per-host + local index,
+ * because nvidia-smi's indices repeat from host to host. `uuid` identifies
+ * a GPU either way.
+ *
+ * Linux: POSIX shm object "/<name>" (link with -lrt on glibc < 2.34).
+ * Windows: file mapping "Local\<name>".
+ */
+#ifndef NVSMI_SHM_H
+#define NVSMI_SHM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NVSMI_SHM_MAGIC        0x4D53564Eu   /* "NVSM" */
+#define NVSMI_SHM_VERSION      1u
+#define NVSMI_SHM_MAX_GPUS     64
+#define NVSMI_SHM_DEFAULT_NAME "nvidia-smi-gui"
+
+#define NVSMI_GPU_STALE        0x1u          /* no report in the latest tick */
+
+/* Metric values are NaN when nvidia-smi reports N/A or Not Supported. */
+typedef struct {
+    int32_t  index;             /* see "Limits" above */
+    uint32_t flags;
+    char     uuid[48];
+    char     pci_bus_id[32];
+    char     name[96];
+    double   memory_total;      /* MiB */
+    double   power_limit;       /* W, enforced */
+    double   util;              /* % */
+    double   temperature;       /* C */
+    double   fan;               /* % */
+    double   clock_graphics;    /* MHz */
+    double   memory_used;       /* MiB */
+    double   power_draw;        /* W */
+} nvsmi_gpu_record;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;       /* offsetof(nvsmi_shm_region, gpus) */
+    uint32_t record_size;       /* sizeof(nvsmi_gpu_record) */
+    uint32_t max_gpus;
+    uint32_t gpu_count;
+    uint64_t seq;               /* seqlock; odd while a write is in progress */
+    uint64_t tick;              /* snapshot sequence number from the source */
+    int64_t  timestamp_ms;      /* source clock, ms since 1970 */
+    nvsmi_gpu_record gpus[NVSMI_SHM_MAX_GPUS];
+} nvsmi_shm_region;
+
+typedef struct {
+    uint64_t tick;
+    int64_t  timestamp_ms;
+    uint32_t gpu_count;
+    nvsmi_gpu_record gpus[NVSMI_SHM_MAX_GPUS];
+} nvsmi_shm_snapshot;
+
+typedef struct {
+    nvsmi_shm_region* region;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+} nvsmi_shm_reader;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#if defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+/* ARM reorders loads: a plain load followed by dmb ish (0xB) is an acquire,
+ * as in MSVC's own <atomic>. */
+static __inline uint64_t nvsmi__load_acquire(const uint64_t* p) { uint64_t v = (uint64_t)__iso_volatile_load64((const volatile __int64*)p); __dmb(0xB); return v; }
+static __inline void nvsmi__fence_acquire(void) { __dmb(0xB); }
+#else
+/* x86 and x64 keep loads in order; only the compiler has to be held back. */
+static __inline uint64_t nvsmi__load_acquire(const uint64_t* p) { uint64_t v = *(volatile const uint64_t*)p; _ReadWriteBarrier(); return v; }
+static __inline void nvsmi__fence_acquire(void) { _ReadWriteBarrier(); }
+#endif
+#else
+static inline uint64_t nvsmi__load_acquire(const uint64_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static inline void nvsmi__fence_acquire(void) { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+#endif
+
+static inline void nvsmi_shm_close(nvsmi_shm_reader* r) {
+#ifdef _WIN32
+    if (r->region) UnmapViewOfFile(r->region);
+    if (r->mapping) CloseHandle(r->mapping);
+    r->mapping = NULL;
+#else
+    if (r->region) munmap(r->region, sizeof(nvsmi_shm_region));
+#endif
+    r->region = NULL;
+}
+
+/* Returns 0 on success, -1 if the region does not exist or is incompatible. */
+static inline int nvsmi_shm_open(nvsmi_shm_reader* r, const char* name) {
+    const nvsmi_shm_region* h;
+    r->region = NULL;
+#ifdef _WIN32
+    char path[256];
+    snprintf(path, sizeof(path), "Local\\%s", name);
+    r->mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, path);
+    if (!r->mapping) return -1;
+    r->region = (nvsmi_shm_region*)MapViewOfFile(r->mapping, FILE_MAP_READ, 0, 0, sizeof(nvsmi_shm_region));
+    if (!r->region) { CloseHandle(r->mapping); return -1; }
+#else
+    char path[256];
+    int fd;
+    void* p;
+    snprintf(path, sizeof(path), "/%s", name);
+    fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0) return -1;
+    p = mmap(NULL, sizeof(nvsmi_shm_region), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    r->region = (nvsmi_shm_region*)p;
+#endif
+    h = r->region;
+    if (h->magic != NVSMI_SHM_MAGIC || h->version != NVSMI_SHM_VERSION
+        || h->record_size != sizeof(nvsmi_gpu_record) || h->max_gpus != NVSMI_SHM_MAX_GPUS) {
+        nvsmi_shm_close(r);
+        return -1;
+    }
+    return 0;
+}
+
+/* Copies a consistent snapshot. Returns 0 on success, -1 if the writer kept
+ * the region busy for every attempt (only possible under extreme contention). */
+static inline int nvsmi_shm_read(const nvsmi_shm_reader* r, nvsmi_shm_snapshot* out) {
+    const nvsmi_shm_region* h = r->region;
+    int attempt;
+    for (attempt = 0; attempt < 1000; ++attempt) {
+        uint64_t s1 = nvsmi__load_acquire(&h->seq), s2;
+        uint32_t n;
+        if (s1 & 1) continue;
+        n = h->gpu_count;
+        if (n > NVSMI_SHM_MAX_GPUS) n = NVSMI_SHM_MAX_GPUS;
+        out->tick = h->tick;
+        out->timestamp_ms = h->timestamp_ms;
+        out->gpu_count = n;
+        memcpy(out->gpus, h->gpus, n * sizeof(nvsmi_gpu_record));
+        nvsmi__fence_acquire();
+        s2 = nvsmi__load_acquire(&h->seq);
+        if (s1 == s2) return 0;
+    }
+    return -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NVSMI_SHM_H */
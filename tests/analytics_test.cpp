@@ -0,0 +1,138 @@
+// Analytics expressions against a row-by-row evaluation of the same
+// samples, and their cost over a day of a large fleet.
+
+#include <map>
+
+struct AnalyticsRow { int64_t ts; int gpu; double v[M_COUNT]; };
+
+// "label: value" lines, or one bare value, from AnalyticsEval::report.
+static std::map<std::string, double> analyticsAnswer(const std::string& text) {
+    std::map<std::string, double> out;
+    for (size_t b = 0; b < text.size(); ) {
+        size_t e = text.find('\n', b), c = text.find(':', b);
+        std::string line = text.substr(b, e - b);
+        if (c < e) out[text.substr(b, c - b)] = atof(text.c_str() + c + 1);
+        else if (line != "no data") out[""] = atof(line.c_str());
+        b = e == std::string::npos ? text.size() : e + 1;
+    }
+    return out;
+}
+
+TEST(analytics_matches_row_scan) {
+    const int G = 4, GPUS = 16;
+    g_gpusPerHost = G;
+    g_history.configure(INT64_MAX / 4);
+    SimFleet sim(GPUS, 31);
+    sim.identify();
+    std::mt19937 rng(8);
+    std::vector<AnalyticsRow> rows;
+    for (int t = 0; t < 3000; ++t) {                     // ~11 sealed segments per GPU and a head
+        FleetSnapshot s = sim.next();
+        for (auto& g : s.gpus) {
+            if (rng() % 50 == 0) g.v[rng() % M_COUNT] = NAN;
+            g.stale = rng() % 200 == 0;
+            if (g.stale) continue;
+            AnalyticsRow r{s.timestampMs, g.index, {}};
+            for (int m = 0; m < M_COUNT; ++m) r.v[m] = dequantize(quantize(g.v[m]));
+            rows.push_back(r);
+        }
+        g_history.add(s);
+    }
+    int64_t latest = g_history.latest();
+
+    struct Case {
+        const char* text; Aggregate agg; GroupBy by; int64_t overMs; bool boolean;
+        std::function<double(const AnalyticsRow&)> fn;   // NaN: row left out
+    };
+    std::vector<Case> cases = {
+        {"avg(utilization.gpu) by host over 10m", A_AVG, G_HOST, 600000, false, [](const AnalyticsRow& r) { return r.v[M_UTIL]; }},
+        {"max(power.draw / enforced.power.limit)", A_MAX, G_NONE, 0, false, [](const AnalyticsRow& r) { return r.v[M_POWER] / 400; }},
+        {"count(temperature.gpu > 80)", A_COUNT, G_NONE, 0, true,
+         [](const AnalyticsRow& r) { return std::isnan(r.v[M_TEMP]) ? NAN : (double)(r.v[M_TEMP] > 80); }},
+        {"count(temperature.gpu > 80) by gpu over 5m", A_COUNT, G_GPU, 300000, true,
+         [](const AnalyticsRow& r) { return std::isnan(r.v[M_TEMP]) ? NAN : (double)(r.v[M_TEMP] > 80); }},
+        {"min(temperature.gpu * 2 - 3) by gpu", A_MIN, G_GPU, 0, false, [](const AnalyticsRow& r) { return r.v[M_TEMP] * 2 - 3; }},
+        {"sum(memory.total - memory.used) over 1h", A_SUM, G_NONE, 3600000, false, [](const AnalyticsRow& r) { return 81920 - r.v[M_MEM_USED]; }},
+        {"count(fan) by host", A_COUNT, G_HOST, 0, false, [](const AnalyticsRow& r) { return r.v[M_FAN]; }},
+        {"avg(util > 50)", A_AVG, G_NONE, 0, true,
+         [](const AnalyticsRow& r) { return std::isnan(r.v[M_UTIL]) ? NAN : (double)(r.v[M_UTIL] > 50); }},
+        {"max(clocks - util) by host", A_MAX, G_HOST, 0, false, [](const AnalyticsRow& r) { return r.v[M_CLOCK] - r.v[M_UTIL]; }},
+        {"avg(-power.draw)", A_AVG, G_NONE, 0, false, [](const AnalyticsRow& r) { return -r.v[M_POWER]; }},
+    };
+    for (const Case& c : cases) {
+        std::map<std::string, AnalyticsEval::Acc> acc;
+        for (const auto& r : rows) {
+            if (c.overMs && r.ts < latest - c.overMs) continue;
+            double x = c.fn(r);
+            if (std::isnan(x)) continue;
+            std::string label = c.by == G_HOST ? "host " + std::to_string(r.gpu / G) : c.by == G_GPU ? "gpu " + std::to_string(r.gpu) : "";
+            AnalyticsEval::Acc& a = acc[label];
+            a.sum += x; a.min = std::min(a.min, x); a.max = std::max(a.max, x); ++a.n;
+        }
+        std::string out;
+        REQUIRE(evalHistory(c.text, out, nullptr));
+        std::map<std::string, double> got = analyticsAnswer(out);
+        CHECK_EQ(got.size(), acc.size());
+        for (const auto& kv : acc) {
+            const AnalyticsEval::Acc& a = kv.second;
+            double want = c.agg == A_AVG ? a.sum / a.n : c.agg == A_MIN ? a.min : c.agg == A_MAX ? a.max
+                        : c.agg == A_SUM || c.boolean ? a.sum : (double)a.n;
+            auto it = got.find(kv.first);
+            if (it == got.end() || !(std::fabs(it->second - want) <= 1e-5 * std::max(1.0, std::fabs(want)))) {
+                fprintf(stderr, "%s [%s]: got %s, want %.6g\n", c.text, kv.first.c_str(), out.c_str(), want);
+                ++g_testFailures;
+            }
+        }
+    }
+    std::string out;
+    CHECK(!evalHistory("median(util)", out, nullptr));
+    CHECK(!evalHistory("avg(util) over 5x", out, nullptr));
+    CHECK(!evalHistory("avg(nosuchfield)", out, nullptr));
+}
+
+// Traces for 1,000 GPUs at 300 ms over NVSMI_BENCH_HOURS (default 2; 24 for
+// the full day, which needs ~2.5 GB): each query from segment summaries as
+// it runs, and decoding every segment, which must give the same answer.
+BENCH(analytics) {
+    const char* env = getenv("NVSMI_BENCH_HOURS");
+    const int GPUS = 1000, HOURS = env ? std::max(1, atoi(env)) : 2, TICKS = HOURS * 12000;
+    g_gpusPerHost = 8;
+    g_history.configure(INT64_MAX / 4);
+    SimFleet sim(GPUS, 50);
+    sim.identify();
+    std::vector<GpuTrace> traces;
+    for (int g = 0; g < GPUS; ++g) traces.emplace_back(1000 + g);
+    FleetSnapshot s;
+    s.gpus.resize(GPUS);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int t = 0; t < TICKS; ++t) {
+        for (int g = 0; g < GPUS; ++g) { s.gpus[g].index = g; traces[g].next(s.timestampMs, s.gpus[g].v); }
+        s.seq = t + 1;
+        s.timestampMs = traces[0].ts;
+        g_history.add(s);
+    }
+    char what[128];
+    snprintf(what, sizeof(what), "load %d h of %d GPUs", HOURS, GPUS);
+    report(what, secondsSince(t0), "s");
+    for (const char* text : {"avg(utilization.gpu) by host", "max(power.draw / enforced.power.limit)",
+                             "count(temperature.gpu > 80)", "avg(utilization.gpu) by host over 1h",
+                             "count(power.draw > 300) by gpu"}) {
+        std::string fast, slow;
+        t0 = std::chrono::steady_clock::now();
+        REQUIRE(evalHistory(text, fast, nullptr));
+        double ms = secondsSince(t0) * 1e3;
+        AnalyticsQuery q;
+        std::string err;
+        REQUIRE(ExprParser(text).parse(q, err));
+        AnalyticsEval eval(q);
+        t0 = std::chrono::steady_clock::now();
+        g_history.scan(q.overMs ? g_history.latest() - q.overMs : INT64_MIN, INT64_MAX, q.need,
+                       [](int, const ColumnSummary*, uint32_t) { return false; },
+                       [&](const ColumnChunk& c) { eval.rows(c); });
+        eval.report(slow);
+        double allMs = secondsSince(t0) * 1e3;
+        snprintf(what, sizeof(what), "%s (decode-all %.0f ms)", text, allMs);
+        report(what, ms, "ms");
+        CHECK(fast == slow);
+    }
+}
@@ -0,0 +1,121 @@
+// Chart decimation: columns kept up to date tick by tick against a rebuild
+// and against the raw samples, and what a frame costs as the history grows.
+
+// Min/max per column of the raw samples, for the columns `series` shows.
+static std::vector<ChartColumn> rawColumns(const HistoryStore& h, int gpu, int metric, int64_t spanMs, int width) {
+    int64_t colMs = std::max<int64_t>(1, spanMs / width), end = h.latest() / colMs, first = end - width + 1;
+    std::vector<HistoryPoint> pts;
+    h.read(gpu, metric, first * colMs, h.latest(), pts);
+    std::vector<ChartColumn> cols(width);
+    for (const auto& p : pts) {
+        if (std::isnan(p.v)) continue;
+        ChartColumn& c = cols[p.ts / colMs - first];
+        if (!(c.min <= (float)p.v)) c.min = (float)p.v;
+        if (!(c.max >= (float)p.v)) c.max = (float)p.v;
+    }
+    return cols;
+}
+
+static bool sameColumn(const ChartColumn& a, const ChartColumn& b) {
+    auto same = [](float x, float y) { return x == y || (std::isnan(x) && std::isnan(y)); };
+    return same(a.min, b.min) && same(a.max, b.max);
+}
+
+// Two hours of one GPU at 300 ms, with a spike and a dip that end up in
+// sealed segments and half a minute of N/A. A series updated every few
+// ticks, one built once at the end and the raw samples agree on every
+// column, at a zoom where a column holds whole segments (an hour in 12 five-
+// minute columns, so their summaries are used) and one where it does not.
+TEST(chart_incremental_matches_rebuild) {
+    HistoryStore h;
+    h.configure(INT64_MAX / 4);
+    SimFleet sim(1, 12);
+    const int64_t SPANS[] = {3600000, 600000};
+    const int WIDTHS[] = {12, 60};
+    std::vector<std::unique_ptr<ChartSeries>> live;
+    for (int k = 0; k < 2; ++k) live.emplace_back(new ChartSeries(0, M_UTIL, SPANS[k], WIDTHS[k]));
+    for (int t = 0; t < 24000; ++t) {
+        FleetSnapshot s = sim.next();
+        if (t == 20000) s.gpus[0].v[M_UTIL] = 250;       // inside a segment sealed by the end
+        if (t == 21000) s.gpus[0].v[M_UTIL] = -40;
+        if (t >= 22000 && t < 22100) s.gpus[0].v[M_UTIL] = NAN;
+        h.add(s);
+        if (t % 7 == 0) for (auto& c : live) c->update(h);
+    }
+    for (auto& c : live) c->update(h);
+
+    for (size_t k = 0; k < live.size(); ++k) {
+        ChartSeries fresh(0, M_UTIL, SPANS[k], WIDTHS[k]);
+        fresh.update(h);
+        std::vector<ChartColumn> raw = rawColumns(h, 0, M_UTIL, SPANS[k], WIDTHS[k]);
+        int differ = 0, rebuilt = 0, empty = 0;
+        float hi = -1e9f, lo = 1e9f;
+        for (int x = 0; x < WIDTHS[k]; ++x) {
+            differ += !sameColumn(live[k]->at(x), raw[x]);
+            rebuilt += !sameColumn(live[k]->at(x), fresh.at(x));
+            empty += std::isnan(raw[x].min);
+            if (!std::isnan(raw[x].max)) { hi = std::max(hi, raw[x].max); lo = std::min(lo, raw[x].min); }
+        }
+        CHECK_EQ(differ, 0);
+        CHECK_EQ(rebuilt, 0);
+        if (k == 0) {
+            CHECK_EQ(empty, 0);
+            CHECK_EQ(hi, 250.0f); CHECK_EQ(lo, -40.0f);
+            CHECK(fresh.summarized > 0);                 // the spikes came from segment summaries
+        } else {
+            CHECK(empty >= 2 && empty <= 4);             // the N/A stretch, in 10 s columns
+            CHECK_EQ(fresh.summarized, (uint64_t)0);     // a column is narrower than a segment
+        }
+        printf("span %lld s: %llu samples summarized, %llu decoded\n", (long long)SPANS[k] / 1000,
+               (unsigned long long)fresh.summarized, (unsigned long long)fresh.decoded);
+    }
+}
+
+// The cache hands back the same series for the same view and keeps the
+// CHART_CACHE most recently drawn.
+TEST(chart_cache_keeps_recent_series) {
+    ChartCache cache;
+    ChartSeries* first = &cache.get(0, M_UTIL, 3600000, 600);
+    CHECK(&cache.get(0, M_UTIL, 3600000, 600) == first);
+    CHECK(&cache.get(0, M_UTIL, 3600000, 601) != first);
+    CHECK(&cache.get(0, M_TEMP, 3600000, 600) != first);
+    for (int gpu = 1; gpu < (int)ChartCache::CHART_CACHE - 2; ++gpu) cache.get(gpu, M_UTIL, 3600000, 600);
+    CHECK(&cache.get(0, M_UTIL, 3600000, 600) == first);    // eighth distinct view: still cached
+    for (int gpu = 10; gpu < 10 + (int)ChartCache::CHART_CACHE; ++gpu) cache.get(gpu, M_UTIL, 3600000, 600);
+    ChartSeries& again = cache.get(0, M_UTIL, 3600000, 600);
+    CHECK_EQ(again.decoded + again.summarized, (uint64_t)0);   // evicted and rebuilt from scratch
+}
+
+// The 24 h chart of one GPU at 300 ms, at three widths, over 6 h and 24 h
+// of history. A cold build costs the width plus one summary per sealed
+// segment; the update after each new tick costs the new sample and any
+// column that rolls in, whatever the width or the samples held.
+BENCH(chart_series) {
+    const int64_t DAY = 86400000;
+    for (int hours : {6, 24}) {
+        HistoryStore h;
+        h.configure(INT64_MAX / 4);
+        SimFleet sim(1, 4);
+        int ticks = hours * 3600 * 1000 / 300;
+        for (int t = 0; t < ticks; ++t) h.add(sim.next());
+        for (int width : {300, 600, 1200}) {
+            ChartSeries series(0, M_UTIL, DAY, width);
+            auto t0 = std::chrono::steady_clock::now();
+            series.update(h);
+            double cold = secondsSince(t0);
+            const int UPDATES = 20000;
+            double total = 0;
+            for (int u = 0; u < UPDATES; ++u) {
+                h.add(sim.next());
+                auto t1 = std::chrono::steady_clock::now();
+                series.update(h);
+                total += secondsSince(t1);
+            }
+            char what[96];
+            snprintf(what, sizeof(what), "%d h held, width %d: cold 24 h build", hours, width);
+            report(what, cold * 1e3, "ms");
+            snprintf(what, sizeof(what), "%d h held, width %d: update per tick", hours, width);
+            report(what, total / UPDATES * 1e6, "us");
+        }
+    }
+}
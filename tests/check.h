@@ -0,0 +1,127 @@
+// Minimal test harness for the Linux test binary. TEST(name) and BENCH(name)
+// register cases that ctest runs one per process by name; CHECK failures are
+// printed and counted, REQUIRE failures also end the case. Benchmarks print
+// their figures with report() and check only that the work was done right.
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct TestCase { const char* name; void (*fn)(); bool bench; };
+
+static std::vector<TestCase>& testCases() { static std::vector<TestCase> v; return v; }
+static int g_testFailures = 0;
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, void (*fn)(), bool bench) { testCases().push_back({name, fn, bench}); }
+};
+
+#define TEST(name) \
+    static void test_##name(); \
+    static TestRegistrar reg_##name(#name, test_##name, false); \
+    static void test_##name()
+
+#define BENCH(name) \
+    static void bench_##name(); \
+    static TestRegistrar reg_bench_##name("bench_" #name, bench_##name, true); \
+    static void bench_##name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++g_testFailures; } } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        auto va_ = (a); auto vb_ = (b); \
+        if (!(va_ == vb_)) { \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %s vs %s\n", __FILE__, __LINE__, #a, #b, \
+                    testShow(va_).c_str(), testShow(vb_).c_str()); \
+            ++g_testFailures; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol) \
+    do { \
+        double va_ = (a), vb_ = (b); \
+        if (!(std::fabs(va_ - vb_) <= (tol))) { \
+            fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s, %s) failed: %.17g vs %.17g\n", __FILE__, __LINE__, #a, #b, #tol, va_, vb_); \
+            ++g_testFailures; \
+        } \
+    } while (0)
+
+#define REQUIRE(cond) \
+    do { if (!(cond)) { fprintf(stderr, "%s:%d: REQUIRE(%s) failed\n", __FILE__, __LINE__, #cond); ++g_testFailures; return; } } while (0)
+
+template <typename T> static std::string testShow(const T& v) { return std::to_string(v); }
+static std::string testShow(const std::string& v) { return "\"" + v + "\""; }
+static std::string testShow(const char* v) { return v ? "\"" + std::string(v) + "\"" : "null"; }
+
+// Benchmark figures, one per line: "name: value unit".
+static void report(const char* what, double value, const char* unit) { printf("%s: %.4g %s\n", what, value, unit); fflush(stdout); }
+
+static double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// What a component's print(FILE*, ...) writes, for tests that check its counters.
+template <typename T, typename... Args> static std::string printed(T& component, const Args&... args) {
+    char* buf = nullptr; size_t len = 0;
+    FILE* f = open_memstream(&buf, &len);
+    component.print(f, args...);
+    fclose(f);
+    std::string s(buf, len);
+    free(buf);
+    return s;
+}
+
+// A scratch directory under the build tree, emptied first.
+static std::string scratchDir(const char* name) {
+    std::string dir = std::string("scratch-") + name;
+    std::string cmd = "rm -rf '" + dir + "' && mkdir -p '" + dir + "'";
+    if (system(cmd.c_str()) != 0) fprintf(stderr, "cannot create %s\n", dir.c_str());
+    return dir;
+}
+
+// Files under tests/fixtures; NVSMI_FIXTURES is set by tests/CMakeLists.txt.
+static std::string fixturePath(const char* name) { return std::string(NVSMI_FIXTURES) + "/" + name; }
+
+// A whole file, empty if it cannot be read.
+static std::string readFile(const std::string& path) {
+    std::string out;
+    if (FILE* f = fopen(path.c_str(), "rb")) {
+        char buf[65536]; size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+        fclose(f);
+    } else fprintf(stderr, "missing %s\n", path.c_str());
+    return out;
+}
+
+static std::string readFixture(const char* name) { return readFile(fixturePath(name)); }
+
+// `nvsmi_tests NAME...` runs the named cases, `--list` names them all, and no
+// arguments runs every test (not the benchmarks).
+static int runTests(int argc, char** argv) {
+    std::vector<const TestCase*> run;
+    if (argc > 1 && !strcmp(argv[1], "--list")) {
+        for (const auto& t : testCases()) printf("%s\n", t.name);
+        return 0;
+    }
+    for (int i = 1; i < argc; ++i) {
+        const TestCase* found = nullptr;
+        for (const auto& t : testCases()) if (!strcmp(t.name, argv[i])) found = &t;
+        if (!found) { fprintf(stderr, "no test named %s\n", argv[i]); return 2; }
+        run.push_back(found);
+    }
+    if (argc <= 1) for (const auto& t : testCases()) if (!t.bench) run.push_back(&t);
+    for (const TestCase* t : run) {
+        int before = g_testFailures;
+        auto t0 = std::chrono::steady_clock::now();
+        t->fn();
+        fprintf(stderr, "%s %s (%.2f s)\n", g_testFailures == before ? "PASS" : "FAIL", t->name, secondsSince(t0));
+    }
+    return g_testFailures ? 1 : 0;
+}
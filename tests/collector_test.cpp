@@ -0,0 +1,303 @@
+// Wire format and collector: round trips through FrameEncoder/FrameDecoder,
+// viewers over loopback TCP, and frames against the CSV loop as a transport.
+
+#include <time.h>
+
+// What a snapshot looks like after a trip through the wire: hundredths.
+static bool sameOnWire(const FleetSnapshot& sent, const FleetSnapshot& got) {
+    if (sent.seq != got.seq || sent.timestampMs != got.timestampMs || sent.gpus.size() != got.gpus.size()) return false;
+    for (size_t i = 0; i < sent.gpus.size(); ++i) {
+        const GpuSample& a = sent.gpus[i]; const GpuSample& b = got.gpus[i];
+        if (a.index != b.index || a.stale != b.stale) return false;
+        for (int m = 0; m < M_COUNT; ++m)
+            if (quantize(a.v[m]) != quantize(b.v[m])) return false;
+    }
+    return true;
+}
+
+// Port for a test's listener, distinct per process so parallel runs don't clash.
+static std::string testPort(int offset) { return "127.0.0.1:" + std::to_string(20000 + (getpid() * 7 + offset) % 20000); }
+
+// Every snapshot comes back, through keyframes and deltas, with GPUs going
+// NaN, stale, missing and back, and the stream cut at arbitrary points.
+TEST(frames_round_trip) {
+    SimFleet sim(50, 7);
+    std::mt19937 rng(11);
+    FrameEncoder enc;
+    FrameDecoder dec;
+    std::string wire;
+    std::vector<FleetSnapshot> sent;
+    for (int t = 0; t < 400; ++t) {
+        FleetSnapshot s = sim.next();
+        std::vector<GpuSample> kept;
+        for (auto& g : s.gpus) {
+            if (rng() % 50 == 0) continue;                       // missing this tick
+            if (rng() % 40 == 0) g.v[rng() % M_COUNT] = NAN;     // N/A
+            g.stale = rng() % 30 == 0;
+            kept.push_back(g);
+        }
+        s.gpus = kept;
+        enc.encode(s, wire);
+        sent.push_back(s);
+    }
+    std::vector<SnapshotPtr> got;
+    for (size_t at = 0; at < wire.size(); ) {
+        size_t n = std::min(wire.size() - at, (size_t)(1 + rng() % 700));
+        REQUIRE(dec.feed(wire.data() + at, n, [&](SnapshotPtr p) { got.push_back(p); }));
+        at += n;
+    }
+    REQUIRE(got.size() == sent.size());
+    int mismatched = 0;
+    for (size_t i = 0; i < sent.size(); ++i) mismatched += !sameOnWire(sent[i], *got[i]);
+    CHECK_EQ(mismatched, 0);
+    printf("frames: %zu ticks of 50 GPUs in %zu bytes\n", sent.size(), wire.size());
+}
+
+TEST(frames_reject_bad_length) {
+    FrameDecoder dec;
+    std::string bad(4, '\0'); bad.push_back((char)FRAME_KEY);
+    CHECK(!dec.feed(bad.data(), bad.size(), [](SnapshotPtr) {}));
+    FrameDecoder dec2;
+    uint32_t huge = MAX_FRAME + 1;
+    std::string big((const char*)&huge, 4); big.push_back((char)FRAME_DELTA);
+    CHECK(!dec2.feed(big.data(), big.size(), [](SnapshotPtr) {}));
+}
+
+// A viewer: decodes a collector's stream and keeps the latest snapshot.
+struct TestViewer {
+    std::thread thread;
+    std::mutex mutex;
+    SnapshotPtr last;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<bool> paused{false};   // connected but not reading
+    bool decode = true;
+    int rcvbuf = 0;
+
+    void start(const std::string& spec) {
+        thread = std::thread([this, spec] {
+            socket_t s = connectTo(spec);
+            if (s == BAD_SOCKET) return;
+            if (rcvbuf) setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, sizeof(rcvbuf));
+            setRecvTimeout(s, 100);
+            FrameDecoder dec; char buf[65536];
+            while (!stop) {
+                if (paused) { std::this_thread::sleep_for(std::chrono::milliseconds(5)); continue; }
+                int n = (int)recv(s, buf, sizeof(buf), 0);
+                if (n > 0) {
+                    bytes += n;
+                    if (decode) dec.feed(buf, n, [&](SnapshotPtr p) { std::lock_guard<std::mutex> lk(mutex); last = p; });
+                } else if (n == 0 || !wouldBlock()) break;
+            }
+            closeSocket(s);
+        });
+    }
+
+    uint64_t seq() { std::lock_guard<std::mutex> lk(mutex); return last ? last->seq : 0; }
+    void join() { stop = true; if (thread.joinable()) thread.join(); }
+};
+
+static bool waitFor(const std::function<bool()>& done, double seconds) {
+    auto t0 = std::chrono::steady_clock::now();
+    while (!done()) {
+        if (secondsSince(t0) > seconds) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+// Viewers joining before the first tick and midway all end on the last
+// snapshot; the late ones start from a keyframe.
+TEST(collector_serves_early_and_late_viewers) {
+    std::string spec = testPort(1);
+    Collector col;
+    REQUIRE(col.start(spec));
+    SimFleet sim(64, 3);
+    std::vector<std::unique_ptr<TestViewer>> viewers;
+    for (int v = 0; v < 8; ++v) { viewers.emplace_back(new TestViewer); viewers.back()->start(spec); }
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));   // accepted on the collector's poll
+    FleetSnapshot s;
+    for (int t = 0; t < 150; ++t) {
+        if (t == 75) for (int v = 0; v < 4; ++v) { viewers.emplace_back(new TestViewer); viewers.back()->start(spec); }
+        if (t == 75) std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        s = sim.next();
+        col.publish(s);
+    }
+    for (auto& v : viewers) CHECK(waitFor([&] { return v->seq() == s.seq; }, 5));
+    for (auto& v : viewers) {
+        std::lock_guard<std::mutex> lk(v->mutex);
+        CHECK(v->last && sameOnWire(s, *v->last));
+    }
+    for (auto& v : viewers) v->join();
+    col.stop();
+}
+
+// A tick bigger than the socket buffers, with no tick after it: what
+// publish() could not send must still arrive as the viewer drains. 100,000
+// GPUs make a keyframe of about 4.5 MB, more than Linux's 4 MB send buffer
+// ceiling yet leaving less than MAX_PENDING behind.
+TEST(collector_drains_frames_larger_than_the_socket_buffer) {
+    std::string spec = testPort(2);
+    Collector col;
+    REQUIRE(col.start(spec));
+    TestViewer v;
+    v.rcvbuf = 16384; v.paused = true;
+    v.start(spec);
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    SimFleet sim(100000, 9);
+    FleetSnapshot s = sim.next();
+    std::string frame;
+    FrameEncoder().encode(s, frame);
+    col.publish(s);
+    v.paused = false;
+    CHECK(waitFor([&] { return v.seq() == s.seq; }, 5));
+    {
+        std::lock_guard<std::mutex> lk(v.mutex);
+        CHECK(v.last && sameOnWire(s, *v.last));
+    }
+    printf("collector: one %zu-byte tick drained after publish returned\n", frame.size());
+    v.join();
+    col.stop();
+}
+
+TEST(parse_simulate_values) {
+    auto parse = [](std::vector<std::string> v) { v.insert(v.begin(), "nvidia-smi-gui"); return parseArgs(v); };
+    AppArgs a = parse({"--simulate", "12"});
+    CHECK_EQ(a.simulate, 12); CHECK(a.error.empty());
+    a = parse({"--simulate", "3x5"});
+    CHECK_EQ(a.simulate, 15); CHECK_EQ(a.gpusPerHost, 5); CHECK(a.error.empty());
+    a = parse({"--simulate"});
+    CHECK_EQ(a.simulate, 8);
+    for (const char* bad : {"abc", "0", "-2", "0x8", "4x0", "4xabc", "2x99999999"}) {
+        a = parse({"--simulate", bad});
+        CHECK(!a.error.empty());
+        CHECK(a.simulate >= 0);
+    }
+}
+
+static double threadCpuSeconds() {
+    timespec t; clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Collector CPU per tick of 1,000 GPUs as viewers are added: the encode is
+// done once, so only the send per viewer is added.
+BENCH(collector_fanout) {
+    SimFleet sim(1000, 5);
+    FleetSnapshot warm = sim.next();
+    for (int viewers : {0, 1, 10, 50}) {
+        std::string spec = testPort(10 + viewers);
+        Collector col;
+        REQUIRE(col.start(spec));
+        col.publish(warm);
+        std::vector<std::unique_ptr<TestViewer>> vs;
+        for (int v = 0; v < viewers; ++v) { vs.emplace_back(new TestViewer); vs.back()->decode = false; vs.back()->start(spec); }
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        const int TICKS = 200;
+        std::vector<FleetSnapshot> ticks;
+        for (int t = 0; t < TICKS; ++t) ticks.push_back(sim.next());
+        double cpu0 = threadCpuSeconds();
+        for (const auto& s : ticks) col.publish(s);
+        double cpu = threadCpuSeconds() - cpu0;
+        char what[64]; snprintf(what, sizeof(what), "collector cpu per tick, %d viewers", viewers);
+        report(what, cpu / TICKS * 1e6, "us");
+        for (auto& v : vs) v->join();
+        col.stop();
+    }
+    std::vector<FleetSnapshot> ticks;
+    for (int t = 0; t < 200; ++t) ticks.push_back(sim.next());
+    FrameEncoder enc; std::string out;
+    double cpu0 = threadCpuSeconds();
+    for (const auto& s : ticks) { out.clear(); enc.encode(s, out); }
+    report("encode per tick of 1000 GPUs", (threadCpuSeconds() - cpu0) / 200 * 1e6, "us");
+    report("delta frame", (double)out.size(), "bytes");
+}
+
+// Writes `data` into a pipe from another thread and hands what the read end
+// gets to `consume`; returns the reading thread's CPU seconds.
+static double throughPipe(const std::string& data, const std::function<void(const char*, size_t)>& consume) {
+    int fds[2];
+    if (pipe(fds) != 0) return 0;
+    std::thread writer([&] {
+        for (size_t off = 0; off < data.size(); ) {
+            ssize_t n = write(fds[1], data.data() + off, std::min<size_t>(data.size() - off, 65536));
+            if (n <= 0) break;
+            off += n;
+        }
+        ::close(fds[1]);
+    });
+    double cpu0 = threadCpuSeconds();
+    char buf[16384]; ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) consume(buf, (size_t)n);
+    double cpu = threadCpuSeconds() - cpu0;
+    writer.join();
+    ::close(fds[0]);
+    return cpu;
+}
+
+// One 8-GPU host at 300 ms for an hour, carried both ways through a pipe:
+// the CSV loop nvidia-smi prints (parseSampleLine and TickAssembler on the
+// viewer) and --agent frames (FrameDecoder). Bytes per host per hour and
+// viewer CPU per tick, including the reads.
+BENCH(transport_csv_vs_frames) {
+    const int GPUS = 8, INTERVAL = 300, TICKS = 3600 * 1000 / INTERVAL;
+    SimFleet sim(GPUS, 17, 1700000000000LL, INTERVAL);
+    sim.identify();
+    std::vector<FleetSnapshot> ticks;
+    for (int t = 0; t < TICKS; ++t) ticks.push_back(sim.next());
+
+    std::string csv, frames;
+    FrameEncoder enc;
+    uint64_t hostVersion = 0;
+    for (const auto& s : ticks) {
+        char ts[64], line[256];
+        formatTimestamp(s.timestampMs, ts, sizeof(ts));
+        for (const auto& g : s.gpus) {
+            GpuIdentityPtr id = g_identities.get(g.index);
+            snprintf(line, sizeof(line), "%s, %d, %s, %.0f, %.0f, %.0f, %.0f, %.0f, %.2f\n", ts, g.index, id->uuid.c_str(),
+                     g.v[M_UTIL], g.v[M_TEMP], g.v[M_FAN], g.v[M_CLOCK], g.v[M_MEM_USED], g.v[M_POWER]);
+            csv += line;
+        }
+        enc.encode(s, frames);
+        FrameEncoder::hosts(hostVersion, frames);
+    }
+
+    TickAssembler assembler(INTERVAL);
+    std::string pending;
+    std::vector<SnapshotPtr> fromCsv;
+    double csvCpu = throughPipe(csv, [&](const char* data, size_t n) {
+        pending.append(data, n);
+        size_t start = 0, pos;
+        while ((pos = pending.find('\n', start)) != std::string::npos) {
+            GpuSample sample; int64_t ts; const char *ub, *ue;
+            if (parseSampleLine(pending.data() + start, pending.data() + pos, ts, sample, ub, ue))
+                if (SnapshotPtr snap = assembler.add(ts, sample, GPUS)) fromCsv.push_back(snap);
+            start = pos + 1;
+        }
+        pending.erase(0, start);
+    });
+
+    FrameDecoder dec;
+    std::vector<SnapshotPtr> fromFrames;
+    bool ok = true;
+    double frameCpu = throughPipe(frames, [&](const char* data, size_t n) {
+        ok = dec.feed(data, n, [&](SnapshotPtr snap) { fromFrames.push_back(snap); }) && ok;
+    });
+
+    REQUIRE(ok);
+    REQUIRE(fromFrames.size() == ticks.size());
+    REQUIRE(fromCsv.size() >= ticks.size() - 1);        // the last tick closes with the next
+    CHECK(sameOnWire(ticks.back(), *fromFrames.back()));
+    int differ = 0;
+    for (size_t t = 0; t + 1 < ticks.size(); ++t)
+        for (int g = 0; g < GPUS; ++g)
+            for (int m = 0; m < M_COUNT; ++m)
+                differ += quantize(ticks[t].gpus[g].v[m]) != quantize(fromCsv[t]->gpus[g].v[m]);
+    CHECK_EQ(differ, 0);
+
+    report("csv: bytes per host per hour", (double)csv.size(), "bytes");
+    report("frames: bytes per host per hour", (double)frames.size(), "bytes");
+    report("csv: viewer cpu per tick", csvCpu / TICKS * 1e9, "ns");
+    report("frames: viewer cpu per tick", frameCpu / TICKS * 1e9, "ns");
+    report("frames vs csv, bytes", (double)csv.size() / frames.size(), "x smaller");
+}
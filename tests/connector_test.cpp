@@ -0,0 +1,125 @@
+// Fleet connections through stand-in ssh loops (tests/fixtures/fake-smi.sh):
+// GPUs keep their slots and identities through renumbering, hosts with too
+// many GPUs are counted, hosts on screen connect first, and the time to
+// first sample across 200 hosts.
+
+static std::string fakeSmi(const std::string& args) { return "sh '" + fixturePath("fake-smi.sh") + "' " + args; }
+
+// Collects the snapshots the connector publishes.
+struct HubTap {
+    std::mutex mutex;
+    std::vector<FleetSnapshot> snaps;
+    HubTap() { g_hub.addSink([this](const FleetSnapshot& s) { std::lock_guard<std::mutex> lk(mutex); snaps.push_back(s); }); }
+};
+
+// Host 0 swaps its GPUs' indices after five rounds, host 1 has ten GPUs
+// for eight slots, host 2 has one. Every GPU stays in its slot, and the
+// two past the eighth are counted, not shown. Each host's identity query
+// fills the identities of its shown slots.
+TEST(fleet_slots_follow_uuids) {
+    HubTap tap;
+    FleetConnector conn;
+    FleetConnector::Options o;
+    o.intervalMs = 100; o.windowMs = 200; o.gpusPerHost = 8;
+    const int LOOPS = 20;
+    conn.configure({"swap", "big", "one"},
+                   {fakeSmi("swap " + std::to_string(LOOPS)), fakeSmi("big " + std::to_string(LOOPS)), fakeSmi("one " + std::to_string(LOOPS))},
+                   {fakeSmi("ids swap"), fakeSmi("ids big"), fakeSmi("ids one")}, o);
+    std::thread run(&FleetConnector::run, &conn);
+    CHECK(waitFor([&] { return printed(conn).find("big has 10 GPUs, 8 shown; 40 lines dropped") != std::string::npos; }, 10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));    // past the reorder window
+    conn.stop();
+    run.join();
+
+    std::lock_guard<std::mutex> lk(tap.mutex);
+    REQUIRE(!tap.snaps.empty());
+    int wrong = 0, seen[17] = {};
+    for (const auto& s : tap.snaps)
+        for (const auto& g : s.gpus) {
+            if (g.index < 0 || g.index > 16) { ++wrong; continue; }
+            ++seen[g.index];
+            double want = g.index < 2 ? g.index * 10 : g.index < 16 ? (g.index - 8) * 5 : 20;
+            if (g.index == 2 || (g.index > 2 && g.index < 8) || g.v[M_UTIL] != want) ++wrong;
+        }
+    CHECK_EQ(wrong, 0);
+    for (int i : {0, 1, 8, 15, 16}) CHECK(seen[i] > 0);
+    std::string uuid;
+    CHECK(g_registry.uuidAt(0, 0, uuid) && uuid == "GPU-swap-a");
+    CHECK(g_registry.uuidAt(1, 9, uuid) && uuid == "GPU-big-9");
+    CHECK(printed(g_registry).find("13 registered, 0 without an index, 2 renumbered") != std::string::npos);
+    int named = 0;
+    for (int slot = 0; slot < 24; ++slot) {
+        GpuIdentityPtr id = g_identities.get(slot);
+        if (!id) continue;
+        ++named;
+        CHECK_EQ(id->slot, slot);
+        CHECK_EQ(id->name, "Fake " + id->uuid.substr(4));
+    }
+    CHECK_EQ(named, 2 + 8 + 1);
+    GpuIdentityPtr a = g_identities.get(0), b = g_identities.get(1), big = g_identities.get(15), one = g_identities.get(16);
+    REQUIRE(a && b && big && one);
+    CHECK_EQ(a->uuid, "GPU-swap-a"); CHECK_EQ(b->uuid, "GPU-swap-b");
+    CHECK_EQ(big->uuid, "GPU-big-7"); CHECK_EQ(big->count, 10); CHECK_EQ(big->memTotal, 1000.0); CHECK_EQ(big->powerLimit, 100.0);
+    CHECK_EQ(one->pciBusId, "00000000:01:00.0");
+    CHECK(std::isnan(one->memTotal) && std::isnan(one->powerLimit));
+    printf("%s", printed(conn).c_str());
+}
+
+// With hosts 12 to 15 on screen, they are launched first, in order, and
+// then the rest in list order. One handshake at a time keeps the order in
+// which the loops start the order in which they were launched.
+TEST(fleet_launches_visible_hosts_first) {
+    std::string dir = scratchDir("launch-order");
+    std::vector<std::string> names, cmds;
+    for (int h = 0; h < 20; ++h) {
+        names.push_back("host" + std::to_string(h));
+        cmds.push_back("env FAKE_SMI_LOG='" + dir + "/order' " + fakeSmi(names.back() + " 1"));
+    }
+    FleetConnector conn;
+    FleetConnector::Options o;
+    o.limit = 1; o.staggerMs = 0; o.intervalMs = 100; o.windowMs = 200;
+    conn.configure(names, cmds, {}, o);
+    g_visibleHostFirst = 12; g_visibleHostLast = 15;
+    std::thread run(&FleetConnector::run, &conn);
+    CHECK(waitFor([&] { return printed(conn).find("first sample from 20/20 hosts") != std::string::npos; }, 30));
+    conn.stop();
+    run.join();
+    g_visibleHostFirst = -1; g_visibleHostLast = -1;
+
+    std::string want;
+    for (int h : {12, 13, 14, 15}) want += names[h] + "\n";
+    for (int h = 0; h < 20; ++h) if (h < 12 || h > 15) want += names[h] + "\n";
+    CHECK_EQ(readFile(dir + "/order"), want);
+}
+
+// Time to first sample from 200 hosts whose handshakes take 0.1 to 1 s,
+// with 10 and with 50 in flight at once.
+BENCH(fleet_startup) {
+    for (int limit : {10, 50}) {
+        FleetConnector conn;
+        FleetConnector::Options o;
+        o.limit = limit;
+        std::vector<std::string> names, cmds;
+        for (int h = 0; h < 200; ++h) {
+            char delay[16];
+            snprintf(delay, sizeof(delay), "%.2f", 0.1 + (h * 37 % 91) / 100.0);
+            names.push_back("host" + std::to_string(h));
+            cmds.push_back(fakeSmi(names.back() + " 100000 " + delay));
+        }
+        conn.configure(names, cmds, {}, o);
+        std::thread run(&FleetConnector::run, &conn);
+        CHECK(waitFor([&] { return printed(conn).find("first sample from 200/200 hosts") != std::string::npos; }, 120));
+        std::string stats = printed(conn);
+        conn.stop();
+        run.join();
+        printf("limit %d\n%s", limit, stats.c_str());
+        double p50 = 0, p99 = 0;
+        const char* at = strstr(stats.c_str(), "p50 ");
+        if (at) sscanf(at, "p50 %lf ms, p99 %lf ms", &p50, &p99);
+        char what[64];
+        snprintf(what, sizeof(what), "limit %d: first sample p50", limit);
+        report(what, p50, "ms");
+        snprintf(what, sizeof(what), "limit %d: first sample p99", limit);
+        report(what, p99, "ms");
+    }
+}
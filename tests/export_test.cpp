@@ -0,0 +1,190 @@
+// Metrics export against a UDP listener on loopback: every line parsed back
+// into the values the exporter was given.
+
+#include <set>
+#include <sstream>
+
+// Binds 127.0.0.1 on a free port and collects datagrams on a thread.
+struct UdpListener {
+    socket_t sock = BAD_SOCKET;
+    int port = 0;
+    std::thread thread;
+    std::mutex mutex;
+    std::vector<std::string> datagrams;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> count{0}, bytes{0};
+    bool keep = true;
+
+    bool start() {
+        sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sock == BAD_SOCKET) return false;
+        int rcvbuf = 32 << 20;
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        sockaddr_in a = {};
+        a.sin_family = AF_INET; a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(a);
+        if (bind(sock, (sockaddr*)&a, sizeof(a)) != 0 || getsockname(sock, (sockaddr*)&a, &len) != 0) return false;
+        port = ntohs(a.sin_port);
+        setRecvTimeout(sock, 50);
+        thread = std::thread([this] {
+            char buf[65536];
+            while (!stop) {
+                int n = (int)recv(sock, buf, sizeof(buf), 0);
+                if (n <= 0) continue;
+                ++count; bytes += n;
+                if (keep) { std::lock_guard<std::mutex> lk(mutex); datagrams.emplace_back(buf, n); }
+            }
+        });
+        return true;
+    }
+
+    void join() { stop = true; if (thread.joinable()) thread.join(); closeSocket(sock); }
+};
+
+static int metricByField(const std::string& name) {
+    for (int m = 0; m < M_COUNT; ++m) if (name == METRIC_FIELDS[m]) return m;
+    return -1;
+}
+
+// Ticks arrive slower than the sender drains, so nothing is dropped and the
+// listener's last value of every field is the last snapshot's. Datagrams
+// never exceed the MTU and never split a line.
+TEST(export_influx_over_loopback) {
+    UdpListener udp;
+    REQUIRE(udp.start());
+    MetricExporter exp;
+    const size_t MTU = 512;
+    REQUIRE(exp.start("influx://127.0.0.1:" + std::to_string(udp.port), "rack 1,a=b", MTU));
+    SimFleet sim(40, 21);
+    FleetSnapshot s;
+    std::set<int64_t> stamps;
+    for (int t = 0; t < 150; ++t) {
+        s = sim.next();
+        if (t % 7 == 3) s.gpus[t % 40].stale = true;     // skipped, not zeroed
+        stamps.insert(s.timestampMs);
+        exp.publish(s);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    exp.stop();
+    CHECK(waitFor([&] { std::lock_guard<std::mutex> lk(udp.mutex); return !udp.datagrams.empty(); }, 2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    udp.join();
+
+    std::map<std::pair<int, int>, int64_t> last;
+    int badLines = 0, oversize = 0;
+    const std::string prefix = "nvidia_smi,host=rack\\ 1\\,a\\=b,gpu=";
+    for (const std::string& d : udp.datagrams) {
+        oversize += d.size() > MTU;
+        if (d.empty() || d.back() != '\n') { ++badLines; continue; }
+        for (size_t at = 0; at < d.size(); ) {
+            size_t end = d.find('\n', at);
+            std::string line = d.substr(at, end - at);
+            at = end + 1;
+            if (line.compare(0, prefix.size(), prefix) != 0) { ++badLines; continue; }
+            size_t sp = line.find(' ', prefix.size()), sp2 = line.rfind(' ');
+            if (sp == std::string::npos || sp2 == sp) { ++badLines; continue; }
+            int gpu = atoi(line.c_str() + prefix.size());
+            int64_t ns = std::stoll(line.substr(sp2 + 1));
+            if (ns % 1000000 || !stamps.count(ns / 1000000)) ++badLines;
+            std::stringstream fields(line.substr(sp + 1, sp2 - sp - 1));
+            std::string kv;
+            while (std::getline(fields, kv, ',')) {
+                size_t eq = kv.find('=');
+                int m = eq == std::string::npos ? -1 : metricByField(kv.substr(0, eq));
+                if (m < 0) { ++badLines; continue; }
+                last[{gpu, m}] = quantize(atof(kv.c_str() + eq + 1));
+            }
+        }
+    }
+    CHECK_EQ(badLines, 0);
+    CHECK_EQ(oversize, 0);
+    int wrong = 0;
+    for (const auto& g : s.gpus)
+        for (int m = 0; m < M_COUNT; ++m) {
+            auto it = last.find({g.index, m});
+            wrong += it == last.end() || (!g.stale && it->second != quantize(g.v[m]));
+        }
+    CHECK_EQ(wrong, 0);
+    std::string stats = printed(exp);
+    CHECK(stats.find(" 0 ticks dropped, 0 send errors") != std::string::npos);
+    printf("%s", stats.c_str());
+}
+
+// StatsD names use '.' as separator, so the hostname's dots become '_'.
+TEST(export_statsd_names) {
+    UdpListener udp;
+    REQUIRE(udp.start());
+    MetricExporter exp;
+    REQUIRE(exp.start("statsd://127.0.0.1:" + std::to_string(udp.port), "node7.example.com", 1400));
+    SimFleet sim(2, 4);
+    FleetSnapshot s = sim.next();
+    s.gpus[1].v[M_POWER] = 312.5;
+    s.gpus[0].v[M_FAN] = NAN;                              // N/A is left out
+    exp.publish(s);
+    exp.stop();
+    CHECK(waitFor([&] { std::lock_guard<std::mutex> lk(udp.mutex); return !udp.datagrams.empty(); }, 2));
+    udp.join();
+    REQUIRE(udp.datagrams.size() == 1);
+    const std::string& d = udp.datagrams[0];
+    CHECK(d.find("nvsmi.node7_example_com.gpu1.power.draw:312.5|g\n") != std::string::npos);
+    CHECK(d.find("nvsmi.node7_example_com.gpu0.fan.speed:") == std::string::npos);
+    CHECK_EQ((int)std::count(d.begin(), d.end(), '\n'), 2 * M_COUNT - 1);
+}
+
+// No listener at all: publishing still returns at once, and the queue stays
+// bounded by dropping the oldest ticks.
+TEST(export_never_blocks_the_reader) {
+    MetricExporter exp;
+    REQUIRE(exp.start("statsd://127.0.0.1:9", "h", 1400));
+    SimFleet sim(1000, 8);
+    std::vector<FleetSnapshot> ticks;
+    for (int t = 0; t < 400; ++t) ticks.push_back(sim.next());
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto& s : ticks) exp.publish(s);
+    double perTick = secondsSince(t0) / ticks.size();
+    exp.stop();
+    CHECK(perTick < 0.01);
+    printf("export: %.0f us per publish of 1000 GPUs; %s", perTick * 1e6, printed(exp).c_str());
+}
+
+// Lines per second through to a loopback listener, every value changing
+// every tick, at the default MTU and at jumbo frames. Ticks come every
+// 0.5 ms, faster than the sender keeps up at 1,000 GPUs, so the rate is the
+// sender's ceiling and the stats line shows what the queue dropped.
+BENCH(export_throughput) {
+    for (size_t mtu : {(size_t)1400, (size_t)8192}) {
+        for (const char* scheme : {"influx", "statsd"}) {
+            UdpListener udp;
+            udp.keep = false;
+            REQUIRE(udp.start());
+            MetricExporter exp;
+            REQUIRE(exp.start(std::string(scheme) + "://127.0.0.1:" + std::to_string(udp.port), "bench-host", mtu));
+            SimFleet sim(1000, 2);
+            std::vector<FleetSnapshot> ticks;
+            for (int t = 0; t < 200; ++t) ticks.push_back(sim.next());
+            auto t0 = std::chrono::steady_clock::now();
+            double publish = 0;
+            for (const auto& s : ticks) {
+                auto p0 = std::chrono::steady_clock::now();
+                exp.publish(s);
+                publish += secondsSince(p0);
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+            exp.stop();
+            double secs = secondsSince(t0);
+            std::string stats = printed(exp);
+            unsigned long long lines = 0, datagrams = 0;
+            sscanf(stats.c_str(), "export: %*u ticks, %llu lines in %llu datagrams", &lines, &datagrams);
+            waitFor([&] { return udp.count >= datagrams; }, 2);
+            udp.join();
+            printf("%s", stats.c_str());
+            char what[96];
+            snprintf(what, sizeof(what), "%s mtu %zu: lines per second", scheme, mtu);
+            report(what, lines / secs, "");
+            snprintf(what, sizeof(what), "%s mtu %zu: publish per tick of 1000 GPUs", scheme, mtu);
+            report(what, publish / ticks.size() * 1e6, "us");
+            snprintf(what, sizeof(what), "%s mtu %zu: datagrams received", scheme, mtu);
+            report(what, 100.0 * udp.count / std::max<unsigned long long>(datagrams, 1), "%");
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#!/bin/sh
+# Stand-in for `ssh HOST nvidia-smi --query-gpu=... -lms N` in the fleet
+# tests: after DELAY seconds (the handshake), LOOPS rounds of CSV lines,
+# 100 ms apart, for a host of the given kind, then silence until killed.
+# Timestamps are left empty, so lines are placed by arrival.
+#   swap   two GPUs that trade indices after five rounds; util 0 and 10
+#   big    ten GPUs, util 5 * index
+#   other  one GPU
+# With FAKE_SMI_LOG set, KIND is appended to that file at start.
+# `ids KIND` stands in for the host's IDENTITY_FIELDS query instead: one
+# line per GPU of that kind, as numbered before any swap, then exit.
+# `hotplug PHASE` and `ids hotplug PHASE` stand in for a single host whose
+# GPU-hp-1 falls off the bus and comes back: five rounds, one second apart
+# on the source clock, then exit. Phase 0 lists GPU 3 first, phase 1 has
+# lost GPU-hp-1 and renumbered the rest, phase 2 has it back. GPU-hp-U
+# always reports util 10 * (U + 1).
+kind=$1 loops=$2
+[ -n "$FAKE_SMI_LOG" ] && echo "$kind" >> "$FAKE_SMI_LOG"
+hotplug() {   # index:U pairs of phase $1
+    case $1 in 0) echo "3:3 0:0 1:1 2:2" ;; 1) echo "0:0 1:2 2:3" ;; *) echo "0:0 1:1 2:2 3:3" ;; esac
+}
+if [ "$kind" = hotplug ]; then
+    i=0
+    while [ "$i" -lt 5 ]; do
+        for p in $(hotplug "$loops"); do
+            printf '2026/01/01 00:00:%02d.000, %s, GPU-hp-%s, %d, 40, 30, 1500, 1000, 100\n' \
+                $((loops * 5 + i)) "${p%:*}" "${p#*:}" $(((${p#*:} + 1) * 10))
+        done
+        i=$((i + 1))
+    done
+    exit 0
+fi
+if [ "$kind" = ids ]; then
+    case $loops in
+    swap) echo "0, 2, GPU-swap-a, 00000000:01:00.0, Fake swap-a, 1000, 100"
+          echo "1, 2, GPU-swap-b, 00000000:02:00.0, Fake swap-b, 1000, 100" ;;
+    big)  g=0
+          while [ "$g" -lt 10 ]; do echo "$g, 10, GPU-big-$g, 00000000:1$g:00.0, Fake big-$g, 1000, 100"; g=$((g + 1)); done ;;
+    hotplug)
+          set -- $(hotplug "$3")
+          for p; do echo "${p%:*}, $#, GPU-hp-${p#*:}, 00000000:0$((${p#*:} + 1)):00.0, Fake hp-${p#*:}, 1000, 100"; done ;;
+    *)    echo "0, 1, GPU-$loops-0, 00000000:01:00.0, Fake $loops-0, [N/A], [Not Supported]" ;;
+    esac
+    exit 0
+fi
+sleep "${3:-0}"
+i=0
+while [ "$i" -lt "$loops" ]; do
+    case $kind in
+    swap)
+        if [ "$i" -lt 5 ]; then a=0 b=1; else a=1 b=0; fi
+        echo ", $a, GPU-swap-a, 0, 40, 30, 1500, 1000, 100"
+        echo ", $b, GPU-swap-b, 10, 41, 30, 1500, 1000, 100"
+        ;;
+    big)
+        g=0
+        while [ "$g" -lt 10 ]; do echo ", $g, GPU-big-$g, $((g * 5)), 50, 30, 1500, 1000, 100"; g=$((g + 1)); done
+        ;;
+    *)
+        echo ", 0, GPU-$kind-0, 20, 40, 30, 1500, 1000, 100"
+        ;;
+    esac
+    i=$((i + 1))
+    sleep 0.1
+done
+exec sleep 600
@@ -0,0 +1,90 @@
+// Fleet store: incremental aggregates against a brute-force sum of the
+// latest snapshot, with host sizes that leave columns unaligned.
+
+static double fleetScalarSum(const double* p, size_t n, uint32_t& count) {
+    double s = 0; count = 0;
+    for (size_t i = 0; i < n; ++i) if (!std::isnan(p[i])) { s += p[i]; ++count; }
+    return s;
+}
+
+// Every start offset and length, so the SIMD loop sees 8-byte-aligned
+// pointers and odd tails; a misaligned aligned-load would fault here.
+TEST(sum_column_any_alignment) {
+    AlignedVector<double> buf(64);
+    std::mt19937 rng(2);
+    for (auto& x : buf) x = rng() % 7 == 0 ? NAN : (double)(rng() % 100);
+    for (size_t b = 0; b < 9; ++b)
+        for (size_t n = 0; n + b <= buf.size(); ++n) {
+            double sum; uint32_t count, hot, want;
+            sumColumn(buf.data() + b, n, sum, count, 80, &hot);
+            CHECK_EQ(sum, fleetScalarSum(buf.data() + b, n, want));
+            CHECK_EQ(count, want);
+        }
+}
+
+// Three hosts of three GPUs, GPUs going missing and NaN, past a resync:
+// host and fleet aggregates equal a sum over the latest snapshot.
+TEST(fleet_store_odd_hosts) {
+    const int G = 3, HOSTS = 3;
+    g_gpusPerHost = G;
+    SimFleet sim(G * HOSTS, 10);
+    sim.identify();
+    FleetStore store;
+    std::mt19937 rng(4);
+    int bad = 0;
+    for (unsigned t = 0; t < FleetStore::RESYNC_TICKS * 2 + 100; ++t) {
+        FleetSnapshot s = sim.next();
+        std::vector<GpuSample> kept;
+        for (auto& g : s.gpus) {
+            if (rng() % 20 == 0) continue;
+            if (rng() % 10 == 0) g.v[rng() % M_COUNT] = NAN;
+            kept.push_back(g);
+        }
+        s.gpus = kept;
+        store.apply(s);
+        if (t % 37) continue;
+        std::vector<FleetAggregate> want(HOSTS + 1);
+        for (const auto& g : s.gpus)
+            for (FleetAggregate* a : {&want[hostOf(g.index)], &want[HOSTS]}) {
+                ++a->gpus;
+                double col[C_COUNT];
+                std::copy(g.v, g.v + M_COUNT, col);
+                col[C_MEM_FREE] = 81920 - g.v[M_MEM_USED];
+                for (int c = 0; c < C_COUNT; ++c)
+                    if (!std::isnan(col[c])) { a->sum[c] += col[c]; ++a->n[c]; }
+                a->hot += g.v[M_TEMP] >= HOT_TEMP;
+            }
+        CHECK_EQ(store.hostCount(), HOSTS);
+        for (int h = 0; h <= HOSTS; ++h) {
+            FleetAggregate got = h < HOSTS ? store.host(h) : store.fleet();
+            bool same = got.gpus == want[h].gpus && got.hot == want[h].hot;
+            for (int c = 0; c < C_COUNT; ++c)
+                same = same && got.n[c] == want[h].n[c] && std::fabs(got.sum[c] - want[h].sum[c]) <= 1e-9 * std::max(1.0, std::fabs(want[h].sum[c]));
+            bad += !same;
+        }
+        CHECK(store.verify() < 1e-9);
+    }
+    CHECK_EQ(bad, 0);
+}
+
+// Per tick at 10,000 GPUs: applying a snapshot's deltas, and the SIMD full
+// recompute that verifies them.
+BENCH(fleet_store) {
+    const int GPUS = 10000;
+    g_gpusPerHost = 8;
+    SimFleet sim(GPUS, 13);
+    sim.identify();
+    std::vector<FleetSnapshot> ticks;
+    for (int t = 0; t < 200; ++t) ticks.push_back(sim.next());
+    FleetStore store;
+    store.apply(ticks[0]);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < 5; ++r)
+        for (const auto& s : ticks) store.apply(s);
+    report("apply per tick, 10000 GPUs", secondsSince(t0) * 1e6 / (5.0 * ticks.size()), "us");
+    t0 = std::chrono::steady_clock::now();
+    double drift = 0;
+    for (int r = 0; r < 20; ++r) drift = std::max(drift, store.verify());
+    report("full recompute of 1250 hosts and the fleet", secondsSince(t0) * 1e6 / 20, "us");
+    CHECK(drift < 1e-9);
+}
@@ -0,0 +1,139 @@
+// Compressed history: bit-exact round trips through sealed segments, and
+// size and decode speed on GPU-like traces.
+
+// 300 ms samples with a few ms of jitter; utilization in plateaus with jumps,
+// slow integer temperature, clock steps, memory plateaus, power jitter in
+// hundredths. Every 97th utilization is N/A, and one gap of a minute.
+struct GpuTrace {
+    std::mt19937 rng;
+    int64_t ts = 1700000000000LL;
+    double util = 0, temp = 45, clock = 1410, mem = 1024, power = 250;
+    uint64_t n = 0;
+
+    explicit GpuTrace(uint32_t seed) : rng(seed) {}
+
+    void next(int64_t& t, double* v) {
+        ts += 300 + (int)(rng() % 7) - 3 + (++n == 5000 ? 60000 : 0);
+        if (rng() % 400 == 0) util = rng() % 3 == 0 ? 0 : 100 - rng() % 5;
+        if (rng() % 30 == 0) temp = std::min(85.0, std::max(35.0, temp + (util > 50 ? 1 : -1)));
+        if (rng() % 200 == 0) clock = util > 50 ? 1980 : 210 + 15 * (rng() % 20);
+        if (rng() % 500 == 0) mem = 1024 + 512 * (rng() % 150);
+        power = (util > 50 ? 320 : 80) + (rng() % 1200) / 100.0 - 6;
+        t = ts;
+        v[M_UTIL] = n % 97 == 0 ? NAN : util; v[M_TEMP] = temp; v[M_FAN] = 30 + temp / 3;
+        v[M_CLOCK] = clock; v[M_MEM_USED] = mem; v[M_POWER] = power;
+    }
+};
+
+TEST(gorilla_round_trip) {
+    GpuHistory h;
+    GpuTrace trace(3);
+    std::vector<int64_t> ts;
+    std::vector<std::array<double, M_COUNT>> vs;
+    const int N = 10 * (int)GpuHistory::HISTORY_SEGMENT + 77;   // sealed segments and a head
+    for (int i = 0; i < N; ++i) {
+        int64_t t; std::array<double, M_COUNT> v;
+        trace.next(t, v.data());
+        if (i == 1000) v[M_POWER] = -0.01;                       // sign flips in the XOR
+        if (i == 1001) v[M_MEM_USED] = 9e7;
+        ts.push_back(t); vs.push_back(v); h.add(t, v.data());
+    }
+    CHECK_EQ(h.samples(), (size_t)N);
+    for (int m = 0; m < M_COUNT; ++m) {
+        std::vector<HistoryPoint> got;
+        h.read(m, INT64_MIN, INT64_MAX, got);
+        REQUIRE(got.size() == (size_t)N);
+        int bad = 0;
+        for (int i = 0; i < N; ++i)
+            bad += got[i].ts != ts[i] || quantize(got[i].v) != quantize(vs[i][m]);
+        CHECK_EQ(bad, 0);
+    }
+
+    // A range starting and ending mid-segment.
+    std::vector<HistoryPoint> part;
+    h.read(M_POWER, ts[300], ts[1900], part);
+    REQUIRE(part.size() == 1601);
+    CHECK_EQ(part.front().ts, ts[300]); CHECK_EQ(part.back().ts, ts[1900]);
+
+    // scan(): whole segments summarized, or decoded to the same rows.
+    bool need[M_COUNT] = {true, false, false, false, false, true};
+    int64_t sumQ = 0, rows = 0, viaSummary = 0;
+    for (bool useSummary : {false, true}) {
+        int64_t s = 0, r = 0;
+        h.scan(0, ts[100], ts[N - 50], need,
+               [&](const ColumnSummary* cs, uint32_t count, int64_t, int64_t) {
+                   if (!useSummary) return false;
+                   s += cs[M_POWER].sum; r += count; viaSummary += count;
+                   return true;
+               },
+               [&](const ColumnChunk& c) {
+                   CHECK(c.q[M_UTIL] && c.q[M_POWER] && !c.q[M_TEMP]);
+                   for (uint32_t i = 0; i < c.rows; ++i) s += c.q[M_POWER][i];
+                   r += c.rows;
+               });
+        if (!useSummary) { sumQ = s; rows = r; continue; }
+        CHECK_EQ(s, sumQ); CHECK_EQ(r, rows);
+    }
+    CHECK_EQ(rows, (int64_t)N - 149);
+    CHECK(viaSummary > 0);
+
+    h.trim(ts[3 * GpuHistory::HISTORY_SEGMENT]);
+    CHECK_EQ(h.samples(), (size_t)N - 3 * GpuHistory::HISTORY_SEGMENT);
+}
+
+// The bucket edges of the timestamp code and arbitrary XORs of values.
+TEST(gorilla_bit_codes) {
+    std::vector<int64_t> dods = {0, 1, -1, 63, 64, -64, -65, 255, 256, -256, -257, 2047, 2048, -2048, -2049,
+                                 INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN};
+    std::mt19937_64 rng(9);
+    std::vector<uint64_t> vals = {0, 0, 1, ~0ull, 1ull << 63, 12345, 12345, 12346};
+    for (int i = 0; i < 1000; ++i) vals.push_back(rng() >> (rng() % 64));
+    BitWriter w;
+    for (int64_t d : dods) putTimestamp(w, d);
+    XorState ws;
+    for (uint64_t v : vals) putValue(w, ws, v);
+    std::vector<uint64_t> bits = w.take();
+    BitReader r(bits);
+    for (int64_t d : dods) CHECK_EQ(getTimestamp(r), d);
+    XorState rs;
+    int bad = 0;
+    for (uint64_t v : vals) bad += getValue(r, rs) != v;
+    CHECK_EQ(bad, 0);
+}
+
+// Bytes per sample (timestamp and 6 metrics, against 56 as doubles) and
+// decode rate, for 8 GPUs x 6 h of traces and for the simulator's random
+// walk, which is close to a worst case.
+BENCH(gorilla) {
+    const int GPUS = 8, N = 6 * 3600 * 10 / 3;
+    std::vector<GpuHistory> traced(GPUS), walked(GPUS);
+    SimFleet sim(GPUS, 17);
+    for (int g = 0; g < GPUS; ++g) {
+        GpuTrace trace(100 + g);
+        double v[M_COUNT]; int64_t t;
+        for (int i = 0; i < N; ++i) { trace.next(t, v); traced[g].add(t, v); }
+    }
+    for (int i = 0; i < N; ++i) {
+        FleetSnapshot s = sim.next();
+        for (const auto& g : s.gpus) walked[g.index].add(s.timestampMs, g.v);
+    }
+    for (auto* set : {&traced, &walked}) {
+        size_t bytes = 0;
+        for (const auto& h : *set) bytes += h.bytes();
+        char what[64];
+        snprintf(what, sizeof(what), "%s, bytes per sample", set == &traced ? "traces" : "random walk");
+        report(what, bytes / (double)(GPUS * N), "B");
+    }
+    std::vector<HistoryPoint> out;
+    auto t0 = std::chrono::steady_clock::now();
+    size_t points = 0;
+    for (int rep = 0; rep < 3; ++rep)
+        for (const auto& h : traced)
+            for (int m = 0; m < M_COUNT; ++m) { out.clear(); h.read(m, INT64_MIN, INT64_MAX, out); points += out.size(); }
+    report("decode, one metric at a time", points / secondsSince(t0) / 1e6, "M points/s");
+    CHECK_EQ(points, (size_t)3 * GPUS * M_COUNT * N);
+    int64_t from = 1700000000000LL + 3 * 3600000LL;
+    t0 = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < 1000; ++rep) { out.clear(); traced[rep % GPUS].read(M_POWER, from, from + 600000, out); }
+    report("read a 10 min range", secondsSince(t0) * 1e6 / 1000, "us");
+}
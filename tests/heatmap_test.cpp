@@ -0,0 +1,119 @@
+// Fleet heatmap raster: bucket changes redraw only their cells, clicks map
+// back to GPUs, and a 10,000-cell repaint fits in a frame.
+
+static void heatPalette(HeatmapRaster& h) {
+    uint32_t colors[HeatmapRaster::BUCKETS + 2];
+    for (int b = 0; b < HeatmapRaster::BUCKETS + 2; ++b) colors[b] = 0x010101u * (uint32_t)(b + 1);
+    h.setPalette(colors);
+}
+
+// The color at the center of GPU i's cell, found through hitTest.
+static bool heatCellCenter(const HeatmapRaster& h, int i, int& x, int& y) {
+    for (y = 0; y < h.height(); ++y)
+        for (x = 0; x < h.width(); ++x)
+            if (h.hitTest(x, y) == i) {
+                int x1 = x, y1 = y;
+                while (x1 + 1 < h.width() && h.hitTest(x1 + 1, y) == i) ++x1;
+                while (y1 + 1 < h.height() && h.hitTest(x, y1 + 1) == i) ++y1;
+                x = (x + x1) / 2; y = (y + y1) / 2;
+                return true;
+            }
+    return false;
+}
+
+TEST(heatmap_redraws_changed_buckets) {
+    HeatmapRaster h;
+    heatPalette(h);
+    h.layout(100, 8, 400, 400);
+    REQUIRE(h.width() <= 400 && h.height() <= 400);
+    HeatmapRaster::Rect r = {};
+    CHECK(h.takeDirty(r));
+
+    SimFleet sim(100, 4);
+    FleetSnapshot s = sim.next();
+    for (auto& g : s.gpus) g.v[M_UTIL] = 50;
+    std::vector<double> memTotal(100, 81920);
+    CHECK_EQ(h.update(s, HM_UTIL, memTotal), 100);      // from B_EMPTY
+    CHECK(h.takeDirty(r));
+    CHECK_EQ(h.update(s, HM_UTIL, memTotal), 0);
+    CHECK(!h.takeDirty(r));
+
+    s.gpus[37].v[M_UTIL] = 51;                           // same bucket
+    CHECK_EQ(h.update(s, HM_UTIL, memTotal), 0);
+    s.gpus[37].v[M_UTIL] = 99;
+    s.gpus[60].stale = true;
+    CHECK_EQ(h.update(s, HM_UTIL, memTotal), 2);
+    int x, y;
+    REQUIRE(heatCellCenter(h, 37, x, y));
+    CHECK_EQ(h.pixels()[(size_t)y * h.width() + x], 0x010101u * (HeatmapRaster::BUCKETS - 1 + 1));
+    CHECK(h.takeDirty(r));
+    CHECK(r.left <= x && x < r.right && r.top <= y && y < r.bottom);
+    REQUIRE(heatCellCenter(h, 60, x, y));
+    CHECK_EQ(h.pixels()[(size_t)y * h.width() + x], 0x010101u * (HeatmapRaster::B_NA + 1));
+
+    s.gpus.erase(s.gpus.begin() + 10);                   // gone this tick
+    CHECK_EQ(h.update(s, HM_UTIL, memTotal), 1);
+    REQUIRE(heatCellCenter(h, 10, x, y));
+    CHECK_EQ(h.pixels()[(size_t)y * h.width() + x], 0x010101u * (HeatmapRaster::B_EMPTY + 1));
+}
+
+// Every cell is hit by exactly its own GPU, hosts stay in whole strips,
+// and the gaps hit nothing.
+TEST(heatmap_hit_test_covers_cells) {
+    HeatmapRaster h;
+    heatPalette(h);
+    h.layout(30, 7, 300, 300);
+    std::vector<int> area(30);
+    int gaps = 0;
+    for (int y = 0; y < h.height(); ++y)
+        for (int x = 0; x < h.width(); ++x) {
+            int i = h.hitTest(x, y);
+            if (i < 0) ++gaps; else ++area[i];
+        }
+    for (int a : area) CHECK_EQ(a, area[0]);
+    CHECK(area[0] > 0 && gaps > 0);
+    CHECK_EQ(h.hitTest(-1, 0), -1);
+    CHECK_EQ(h.hitTest(h.width(), 0), -1);
+    int x5, y5, x6, y6, x7, y7;
+    REQUIRE(heatCellCenter(h, 5, x5, y5) && heatCellCenter(h, 6, x6, y6) && heatCellCenter(h, 7, x7, y7));
+    CHECK_EQ(y6, y5);
+    CHECK(y7 != y6 || x7 - x6 > x6 - x5);                // host 1 starts a new strip
+    int first, last;
+    h.cellsIn(y7, y7 + 1, first, last);                  // the row holding GPU 7
+    CHECK(first <= 7 && 7 <= last);
+    for (int i = 0; i < 30; ++i) {
+        int x, y;
+        REQUIRE(heatCellCenter(h, i, x, y));
+        CHECK_EQ(i >= first && i <= last, std::abs(y - y7) < 1);
+    }
+}
+
+// Per tick of 10,000 simulated GPUs at 1920x1080: the update that finds and
+// redraws the cells whose bucket changed, and a full repaint (palette change).
+BENCH(heatmap) {
+    const int GPUS = 10000, TICKS = 200;
+    SimFleet sim(GPUS, 6);
+    std::vector<FleetSnapshot> ticks;
+    for (int t = 0; t < TICKS; ++t) ticks.push_back(sim.next());
+    std::vector<double> memTotal(GPUS, 81920);
+    for (HeatMetric metric : {HM_UTIL, HM_TEMP}) {
+        HeatmapRaster h;
+        heatPalette(h);
+        h.layout(GPUS, 8, 1920, 1080);
+        h.update(ticks[0], metric, memTotal);
+        long changed = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int t = 1; t < TICKS; ++t) changed += h.update(ticks[t], metric, memTotal);
+        char what[80];
+        snprintf(what, sizeof(what), "update, %s, %.0f cells redrawn of %d", HEAT_METRIC_NAMES[metric],
+                 changed / (double)(TICKS - 1), GPUS);
+        report(what, secondsSince(t0) * 1e6 / (TICKS - 1), "us");
+        if (metric == HM_UTIL) {
+            t0 = std::chrono::steady_clock::now();
+            for (int r = 0; r < 20; ++r) heatPalette(h);
+            snprintf(what, sizeof(what), "full repaint, %dx%d", h.width(), h.height());
+            report(what, secondsSince(t0) * 1e6 / 20, "us");
+            report("frame budget", 1e6 / 60, "us");
+        }
+    }
+}
@@ -0,0 +1,229 @@
+// History file: buckets read back after a reopen, torn and corrupted
+// records rejected one at a time, kill -9 mid-write, and warm start cost.
+
+#include <signal.h>
+
+static const int64_t HIST_T0 = 1700000040000LL;    // a whole minute
+
+static double histValue(int64_t ts, int m, int salt = 0) { return (double)((ts / 1000 * 7 + m * 13 + salt) % 101); }
+
+struct HistBucket {
+    int64_t start, end; float lo, hi;
+    bool operator==(const HistBucket& o) const { return start == o.start && end == o.end && lo == o.lo && hi == o.hi; }
+};
+
+static std::vector<HistBucket> histRead(const HistoryFile& f, int e, int m) {
+    std::vector<HistBucket> out;
+    f.read(e, m, INT64_MAX, 0, INT64_MAX, [&](int64_t s, int64_t en, float lo, float hi) { out.push_back({s, en, lo, hi}); });
+    return out;
+}
+
+// What read() should give for samples at `ts`: the newest RING[1] minute
+// buckets that start before the oldest of the newest RING[0] 5 s buckets,
+// then those.
+static std::vector<HistBucket> histExpected(const std::vector<int64_t>& ts, int m, int salt = 0) {
+    std::map<int64_t, HistBucket> tier[HistoryFile::TIERS];
+    for (int64_t t : ts)
+        for (int k = 0; k < HistoryFile::TIERS; ++k) {
+            int64_t b = t - t % HistoryFile::BUCKET_MS[k];
+            float v = (float)histValue(t, m, salt);
+            auto it = tier[k].find(b);
+            if (it == tier[k].end()) tier[k][b] = {b, b + HistoryFile::BUCKET_MS[k], v, v};
+            else { it->second.lo = std::min(it->second.lo, v); it->second.hi = std::max(it->second.hi, v); }
+        }
+    for (int k = 0; k < HistoryFile::TIERS; ++k)
+        while (tier[k].size() > HistoryFile::RING[k]) tier[k].erase(tier[k].begin());
+    int64_t fineStart = tier[0].empty() ? INT64_MAX : tier[0].begin()->first;
+    std::vector<HistBucket> out;
+    for (const auto& b : tier[1]) if (b.first < fineStart) out.push_back(b.second);
+    for (const auto& b : tier[0]) out.push_back(b.second);
+    return out;
+}
+
+static void histAdd(HistoryFile& f, int e, int64_t ts, int salt = 0) {
+    double v[M_COUNT];
+    for (int m = 0; m < M_COUNT; ++m) v[m] = histValue(ts, m, salt);
+    f.add(e, ts, v);
+}
+
+// Two hours of two GPUs at 1 s, reopened: nothing parsed, every bucket
+// back, and samples after the reopen fold into the bucket that was open.
+TEST(history_reopens_where_it_stopped) {
+    std::string path = scratchDir("history") + "/host.hist";
+    std::vector<int64_t> ts;
+    for (int64_t t = HIST_T0; t < HIST_T0 + 7198000; t += 1000) ts.push_back(t);   // stops mid-bucket
+    {
+        HistoryFile f;
+        REQUIRE(f.open(path));
+        CHECK(printed(f).find("(new file)") != std::string::npos);
+        int a = f.entryFor("GPU-a", true), b = f.entryFor("GPU-b", true);
+        REQUIRE(a >= 0 && b >= 0 && a != b);
+        for (int64_t t : ts) { histAdd(f, a, t); histAdd(f, b, t, 50); }
+        HistoryFile other;
+        CHECK(!other.open(path));                           // one writer per file
+    }
+    HistoryFile f;
+    REQUIRE(f.open(path));
+    std::string stats = printed(f);
+    CHECK(stats.find("2 GPUs, " + std::to_string(2 * (720 + 120)) + " buckets restored, 0 rejected, opened") != std::string::npos);
+    int a = f.entryFor("GPU-a", false), b = f.entryFor("GPU-b", false);
+    REQUIRE(a >= 0 && b >= 0);
+    CHECK_EQ(f.entryFor("GPU-c", false), -1);
+    int wrong = 0;
+    for (int m = 0; m < M_COUNT; ++m) {
+        wrong += histRead(f, a, m) != histExpected(ts, m);
+        wrong += histRead(f, b, m) != histExpected(ts, m, 50);
+    }
+    CHECK_EQ(wrong, 0);
+    for (int64_t t = ts.back() + 1000; t < HIST_T0 + 7300000; t += 1000) { ts.push_back(t); histAdd(f, a, t); }
+    for (int m = 0; m < M_COUNT; ++m) wrong += histRead(f, a, m) != histExpected(ts, m);
+    CHECK_EQ(wrong, 0);
+    printf("%s", stats.c_str());
+}
+
+// Offset of the only record in `file` whose bucket start is `bucket`.
+static size_t histRecordAt(const std::string& file, int64_t bucket) {
+    size_t found = std::string::npos;
+    int hits = 0;
+    for (size_t at = 0; (at = file.find(std::string((const char*)&bucket, 8), at)) != std::string::npos; ++at)
+        if (at >= 8 && at % 8 == 0) { found = at - 8; ++hits; }
+    return hits == 1 ? found : std::string::npos;
+}
+
+// A record left odd (a write that never finished) and one whose payload
+// changed (torn by a power cut) are each rejected alone; the ring around
+// them stands, and the next sample for the unfinished bucket rewrites it.
+TEST(history_rejects_torn_records) {
+    std::string path = scratchDir("history_torn") + "/host.hist";
+    std::vector<int64_t> ts;
+    for (int64_t t = HIST_T0; t < HIST_T0 + 1800000 - 22000; t += 1000) ts.push_back(t);
+    {
+        HistoryFile f;
+        REQUIRE(f.open(path));
+        int e = f.entryFor("GPU-a", true);
+        for (int64_t t : ts) histAdd(f, e, t);
+    }
+    int64_t newest = ts.back() - ts.back() % 5000, middle = HIST_T0 + 600000 + 5000;
+    REQUIRE(newest % 60000 && middle % 60000);
+    std::string file;
+    {
+        FILE* in = fopen(path.c_str(), "rb");
+        REQUIRE(in);
+        char buf[65536];
+        for (size_t n; (n = fread(buf, 1, sizeof(buf), in)) > 0; ) file.append(buf, n);
+        fclose(in);
+    }
+    size_t torn = histRecordAt(file, newest), bad = histRecordAt(file, middle);
+    REQUIRE(torn != std::string::npos && bad != std::string::npos);
+    {
+        FILE* out = fopen(path.c_str(), "r+b");
+        REQUIRE(out);
+        uint64_t seq;
+        memcpy(&seq, &file[torn], 8);
+        seq |= 1;
+        fseek(out, (long)torn, SEEK_SET); fwrite(&seq, 8, 1, out);
+        fseek(out, (long)bad + 24, SEEK_SET); fputc(file[bad + 24] ^ 0x40, out);
+        fclose(out);
+    }
+
+    HistoryFile f;
+    REQUIRE(f.open(path));
+    CHECK(printed(f).find(" 1 GPUs, " + std::to_string(356 + 30 - 2) + " buckets restored, 2 rejected,") != std::string::npos);
+    int e = f.entryFor("GPU-a", false);
+    REQUIRE(e >= 0);
+    std::vector<HistBucket> want = histExpected(ts, M_TEMP);
+    want.erase(std::remove_if(want.begin(), want.end(), [&](const HistBucket& b) {
+        return b.end - b.start == 5000 && (b.start == newest || b.start == middle); }), want.end());
+    CHECK(histRead(f, e, M_TEMP) == want);
+
+    int64_t t = newest + 4000;
+    histAdd(f, e, t);
+    std::vector<HistBucket> got = histRead(f, e, M_TEMP);
+    REQUIRE(!got.empty());
+    float v = (float)histValue(t, M_TEMP);
+    CHECK(got.back() == (HistBucket{newest, newest + 5000, v, v}));
+}
+
+// A writer in another process killed at random points, 40 times over the
+// same file: every reopen succeeds, loses at most one record per ring, and
+// every bucket it returns holds a prefix of that bucket's samples.
+TEST(history_survives_kill_9) {
+    std::string path = scratchDir("history_kill") + "/host.hist";
+    std::mt19937 rng(6);
+    uint64_t rejected = 0, buckets = 0;
+    int bad = 0;
+    for (int round = 0; round < 40; ++round) {
+        int64_t start = HIST_T0 + round * 7200000LL;
+        pid_t pid = fork();
+        if (pid == 0) {
+            HistoryFile f;
+            if (!f.open(path)) _exit(1);
+            int e = f.entryFor("GPU-k", true);
+            for (int64_t t = start; ; t += 1000) histAdd(f, e, t);
+        }
+        REQUIRE(pid > 0);
+        std::this_thread::sleep_for(std::chrono::microseconds(2000 + rng() % 20000));
+        kill(pid, SIGKILL);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        CHECK(WIFSIGNALED(status));
+
+        HistoryFile f;
+        REQUIRE(f.open(path));
+        unsigned long long restored = 0, rej = 0;
+        std::string stats = printed(f);
+        sscanf(stats.c_str() + stats.find("GPUs, ") + 6, "%llu buckets restored, %llu rejected", &restored, &rej);
+        CHECK(rej <= (unsigned long long)HistoryFile::TIERS);
+        rejected += rej; buckets += restored;
+        int e = f.entryFor("GPU-k", false);
+        if (e < 0) { CHECK_EQ(round, 0); continue; }      // killed while claiming the entry
+        for (int m = 0; m < M_COUNT; ++m)
+            for (const HistBucket& b : histRead(f, e, m)) {
+                bool prefix = false;
+                float lo = INFINITY, hi = -INFINITY;
+                for (int64_t t = b.start; t < b.end && !prefix; t += 1000) {
+                    float v = (float)histValue(t, m);
+                    lo = std::min(lo, v); hi = std::max(hi, v);
+                    prefix = lo == b.lo && hi == b.hi;
+                }
+                bad += !prefix;
+            }
+    }
+    CHECK_EQ(bad, 0);
+    printf("history: 40 kills, %llu records rejected over %llu restored\n", (unsigned long long)rejected, (unsigned long long)buckets);
+}
+
+// A full file (64 GPUs, six hours at 1 s): the cost of a sample, of a warm
+// start, and of reading a GPU's six hours back for a chart.
+BENCH(history_file) {
+    std::string path = scratchDir("history_bench") + "/host.hist";
+    const int GPUS = HistoryFile::ENTRIES;
+    {
+        HistoryFile f;
+        REQUIRE(f.open(path));
+        std::vector<int> e(GPUS);
+        for (int g = 0; g < GPUS; ++g) e[g] = f.entryFor("GPU-" + std::to_string(g), true);
+        auto t0 = std::chrono::steady_clock::now();
+        int64_t samples = 0;
+        for (int64_t t = HIST_T0; t < HIST_T0 + 6 * 3600000LL; t += 1000)
+            for (int g = 0; g < GPUS; ++g, ++samples) histAdd(f, e[g], t, g);
+        report("add per GPU sample", secondsSince(t0) * 1e9 / samples, "ns");
+    }
+    for (int rep = 0; rep < 3; ++rep) {
+        auto t0 = std::chrono::steady_clock::now();
+        HistoryFile f;
+        REQUIRE(f.open(path));
+        double openMs = secondsSince(t0) * 1e3;
+        int e = f.entryFor("GPU-7", false);
+        t0 = std::chrono::steady_clock::now();
+        size_t n = 0;
+        for (int m = 0; m < M_COUNT; ++m) n += histRead(f, e, m).size();
+        double readUs = secondsSince(t0) * 1e6 / M_COUNT;
+        if (rep == 2) {
+            printf("%s", printed(f).c_str());
+            report("warm start (open and recover 64 GPUs)", openMs, "ms");
+            report("read six hours of one metric", readUs, "us");
+            report("buckets per metric", (double)n / M_COUNT, "");
+        }
+    }
+}
@@ -0,0 +1,91 @@
+// Host metrics from a fixture directory standing in for /proc and /sys:
+// tests/fixtures/proc-root has two NUMA nodes of two CPUs, sda and nvme0n1
+// (plus a loop device and partitions that must not count), eth0, ib0 and lo.
+
+static bool writeFile(const std::string& path, const std::string& s) {
+    FILE* f = fopen(path.c_str(), "w");      // same inode: the sampler's descriptors see it
+    if (!f) return false;
+    fwrite(s.data(), 1, s.size(), f);
+    fclose(f);
+    return true;
+}
+
+// One second later: node 0 fully busy, node 1 idle (partly iowait), 11 MiB
+// received and 1 MiB sent off lo, 1 MiB read from sda and 2 MiB written to
+// nvme0n1. /proc/stat outgrows the sampler's 16 KB buffer.
+static bool advanceProcRoot(const std::string& root) {
+    std::string stat =
+        "cpu  1200 0 1000 8150 50 0 0 0 0 0\n"
+        "cpu0 350 0 250 2000 0 0 0 0 0 0\n"
+        "cpu1 350 0 250 2000 0 0 0 0 0 0\n"
+        "cpu2 250 0 250 2100 0 0 0 0 0 0\n"
+        "cpu3 250 0 250 2050 50 0 0 0 0 0\n"
+        "intr 123999";
+    for (int i = 0; i < 8000; ++i) stat += " 0";
+    stat += "\nctxt 987999\n";
+    return writeFile(root + "/proc/stat", stat)
+        && writeFile(root + "/proc/net/dev",
+            "Inter-|   Receive                                                |  Transmit\n"
+            " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+            "    lo: 199999999   1000    0    0    0     0          0         0 199999999    1000    0    0    0     0       0          0\n"
+            "  eth0: 1010485760 800000    0    0    0     0          0       100 501048576 400000    0    0    0     0       0          0\n"
+            "  ib0:  3048576    2000    0    0    0     0          0         0  3000000    3000    0    0    0     0       0          0\n")
+        && writeFile(root + "/proc/diskstats",
+            "   7       0 loop0 100 0 88000 10 0 0 0 0 0 10 10 0 0 0 0\n"
+            "   8       0 sda 5000 10 402048 3000 2000 20 300000 4000 0 5000 7000 0 0 0 0\n"
+            "   8       1 sda1 4000 10 392048 2900 1900 20 290000 3900 0 4900 6800 0 0 0 0\n"
+            " 259       0 nvme0n1 9000 0 800000 1000 7000 0 604096 2000 0 2500 3000 0 0 0 0\n"
+            " 259       1 nvme0n1p1 8000 0 790000 900 6900 0 594096 1900 0 2400 2900 0 0 0 0\n");
+}
+
+TEST(host_sampler_fixture) {
+    std::string root = scratchDir("proc_root");
+    REQUIRE(system(("cp -r '" + fixturePath("proc-root") + "/.' '" + root + "/'").c_str()) == 0);
+    HostSampler s;
+    REQUIRE(s.open(root, 3));
+    HostSample h;
+    CHECK(!s.sample(1000, h));                           // primes the rates
+    CHECK_EQ(h.host, 3);
+    CHECK_EQ(h.v[H_MEM_TOTAL], 64000.0);
+    CHECK_EQ(h.v[H_MEM_USED], 48000.0);
+    CHECK_EQ(h.v[H_LOAD], 3.25);
+    CHECK(std::isnan(h.v[H_CPU]));
+
+    REQUIRE(advanceProcRoot(root));
+    REQUIRE(s.sample(2000, h));
+    CHECK_NEAR(h.v[H_CPU], 50, 1e-9);
+    REQUIRE(h.nodeCpu.size() == 2);
+    CHECK_NEAR(h.nodeCpu[0], 100, 1e-9);
+    CHECK_NEAR(h.nodeCpu[1], 0, 1e-9);
+    CHECK_NEAR(h.v[H_NET_RX], 11264, 1e-9);
+    CHECK_NEAR(h.v[H_NET_TX], 1024, 1e-9);
+    CHECK_NEAR(h.v[H_DISK_READ], 1024, 1e-9);
+    CHECK_NEAR(h.v[H_DISK_WRITE], 2048, 1e-9);
+    CHECK(describeHost(h).find("node1 0%") != std::string::npos);
+
+    // Nothing moved since: rates drop to zero, CPU has no time to divide.
+    REQUIRE(s.sample(3000, h));
+    CHECK_EQ(h.v[H_NET_RX], 0.0);
+    CHECK_EQ(h.v[H_DISK_WRITE], 0.0);
+    CHECK(std::isnan(h.v[H_CPU]));
+}
+
+TEST(host_sampler_missing_files) {
+    HostSampler s;
+    CHECK(!s.open(scratchDir("proc_empty"), 0));
+}
+
+// Cost of a sample from this machine's /proc and /sys, and from the fixture.
+BENCH(host_sampler) {
+    std::string fixture = scratchDir("proc_bench");
+    REQUIRE(system(("cp -r '" + fixturePath("proc-root") + "/.' '" + fixture + "/'").c_str()) == 0);
+    for (const std::string& root : {std::string(""), fixture}) {
+        HostSampler s;
+        REQUIRE(s.open(root, 0));
+        HostSample h;
+        const int N = 5000;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) s.sample(1000 + i * 300, h);
+        report(root.empty() ? "sample /proc" : "sample fixture", secondsSince(t0) * 1e6 / N, "us");
+    }
+}
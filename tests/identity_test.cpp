@@ -0,0 +1,94 @@
+// GPU identities: parsing nvidia-smi's identity query, the interned table
+// every consumer shares, and how often it lets the reader ask for a refresh.
+
+static GpuIdentity identityLine(const char* line) {
+    GpuIdentity id;
+    id.index = -2;
+    parseIdentityLine(line, line + strlen(line), id);
+    return id;
+}
+
+// IDENTITY_FIELDS as nvidia-smi prints them, including what it prints for
+// fields a board does not have.
+TEST(identity_line_parses_na_fields) {
+    GpuIdentity a = identityLine("3, 4, GPU-5a1e2c7d, 00000000:41:00.0, NVIDIA A100-SXM4-80GB, 81920, 400.00\r");
+    CHECK_EQ(a.index, 3); CHECK_EQ(a.count, 4);
+    CHECK_EQ(a.uuid, std::string("GPU-5a1e2c7d"));
+    CHECK_EQ(a.pciBusId, std::string("00000000:41:00.0"));
+    CHECK_EQ(a.name, std::string("NVIDIA A100-SXM4-80GB"));
+    CHECK_EQ(a.memTotal, 81920.0); CHECK_EQ(a.powerLimit, 400.0);
+
+    GpuIdentity b = identityLine("0, [N/A], GPU-0f, 00000000:01:00.0, Quadro P620, [N/A], [Not Supported]");
+    CHECK_EQ(b.index, 0); CHECK_EQ(b.count, 0);
+    CHECK_EQ(b.name, std::string("Quadro P620"));
+    CHECK(std::isnan(b.memTotal)); CHECK(std::isnan(b.powerLimit));
+
+    GpuIdentity c = identityLine("1, 2, GPU-1f");                  // a short line keeps the defaults
+    CHECK_EQ(c.uuid, std::string("GPU-1f"));
+    CHECK(c.name.empty()); CHECK(std::isnan(c.memTotal));
+
+    GpuIdentity d;
+    const char* bad = "[N/A], 2, GPU-2f, 00000000:02:00.0, Tesla T4, 15360, 70.00";
+    CHECK(!parseIdentityLine(bad, bad + strlen(bad), d));          // no index, no record
+}
+
+// A refresh replaces only the records that changed; a consumer holding the
+// old record keeps seeing it whole.
+TEST(identity_table_interns_unchanged_gpus) {
+    IdentityTable t;
+    CHECK_EQ(t.gpuCount(), 0);
+    CHECK(t.get(0) == nullptr);
+    std::vector<GpuIdentity> ids(3);
+    for (int i = 0; i < 3; ++i) {
+        ids[i].slot = i; ids[i].index = i; ids[i].count = 3;
+        ids[i].uuid = "GPU-" + std::to_string(i); ids[i].name = "Tesla T4";
+        ids[i].memTotal = 15360; ids[i].powerLimit = 70;
+    }
+    ids[2].powerLimit = NAN;                                        // [N/A] compares equal to itself
+    t.update(ids);
+    CHECK_EQ(t.gpuCount(), 3);
+    GpuIdentityPtr before[3] = {t.get(0), t.get(1), t.get(2)};
+
+    ids[1].powerLimit = 60;
+    t.update(ids);
+    CHECK(t.get(0) == before[0]);
+    CHECK(t.get(1) != before[1]);
+    CHECK(t.get(2) == before[2]);
+    CHECK_EQ(before[1]->powerLimit, 70.0);
+    CHECK_EQ(t.get(1)->powerLimit, 60.0);
+
+    std::vector<GpuIdentity> late(1, ids[0]);
+    late[0].slot = 5; late[0].count = 6;
+    t.update(late);                                                 // other slots stay as they were
+    CHECK(t.get(0) == before[0]);
+    CHECK(t.get(4) == nullptr);
+    CHECK_EQ(t.get(5)->count, 6);
+    CHECK_EQ(t.gpuCount(), 3);                                      // from the first record held
+    CHECK(t.get(-1) == nullptr);
+}
+
+// A refresh asked for right after one is held until 5 s after it, and one
+// not asked for waits the whole interval; stop() ends any wait.
+TEST(identity_refresh_is_rate_limited) {
+    IdentityTable t;
+    t.update({});
+    t.requestRefresh();
+    t.requestRefresh();
+    auto t0 = std::chrono::steady_clock::now();
+    CHECK(t.waitForRefresh(std::chrono::seconds(60)));
+    double held = secondsSince(t0);
+    CHECK(held > 4.9 && held < 5.5);
+
+    t.update({});
+    t0 = std::chrono::steady_clock::now();
+    CHECK(t.waitForRefresh(std::chrono::seconds(1)));
+    double idle = secondsSince(t0);
+    CHECK(idle > 0.9 && idle < 1.5);
+
+    std::thread stopper([&] { std::this_thread::sleep_for(std::chrono::milliseconds(100)); t.stop(); });
+    t0 = std::chrono::steady_clock::now();
+    CHECK(!t.waitForRefresh(std::chrono::seconds(60)));
+    CHECK(secondsSince(t0) < 1.0);
+    stopper.join();
+    printf("identity: refresh held %.2f s, idle wait %.2f s\n", held, idle);
+}
@@ -0,0 +1,183 @@
+// Sample log: queries through the block index against a scan of what was
+// recorded, appending across sessions, and query latency over a month.
+
+// Records `ticks` snapshots of `gpus` simulated GPUs into dir/name and
+// returns them; every 7th GPU sample is stale, every 11th has an N/A.
+static std::vector<FleetSnapshot> recordLog(const std::string& path, int gpus, int ticks, int intervalMs, int gpusPerHost) {
+    SimFleet sim(gpus, 21, 1700000000000LL, intervalMs);
+    LogRecorder rec;
+    std::vector<FleetSnapshot> out;
+    if (!rec.open(path, gpusPerHost)) return out;
+    int n = 0;
+    for (int t = 0; t < ticks; ++t) {
+        FleetSnapshot s = sim.next();
+        for (auto& g : s.gpus) {
+            ++n;
+            g.stale = n % 7 == 0;
+            if (n % 11 == 0) g.v[n % M_COUNT] = NAN;
+        }
+        rec.add(s);
+        out.push_back(s);
+    }
+    return out;
+}
+
+// What runLogQuery prints, from the snapshots themselves.
+static std::string expectedRows(const std::vector<FleetSnapshot>& snaps, const LogQuery& q, int64_t from, int64_t to, int gpusPerHost) {
+    std::string out;
+    int gpu = q.gpu < 0 ? -1 : q.host * gpusPerHost + q.gpu;
+    for (const auto& s : snaps)
+        for (const auto& g : s.gpus) {
+            int64_t ts = snapshotTimeMs(s);
+            if (g.stale || ts < from || ts > to || (gpu >= 0 && g.index != gpu)) continue;
+            bool match = true;
+            for (const auto& p : q.where) {
+                double v = dequantize(quantize(g.v[p.metric]));
+                if (p.greater ? !(v > p.value) : !(v < p.value)) match = false;
+            }
+            if (!match) continue;
+            char tsBuf[64];
+            formatTimestamp(ts, tsBuf, sizeof(tsBuf));
+            out += tsBuf; out += ',' + std::to_string(g.index / gpusPerHost) + ',' + std::to_string(g.index % gpusPerHost);
+            for (int m : q.fields) { out += ','; appendHundredths(out, quantize(g.v[m])); }
+            out += '\n';
+        }
+    return out;
+}
+
+static std::string queryOutput(const LogQuery& q, long& rows) {
+    FILE* f = tmpfile();
+    rows = runLogQuery(q, f, false);
+    std::string s(fileSize(f), '\0');
+    if (!s.empty()) { rewind(f); s.resize(fread(&s[0], 1, s.size(), f)); }
+    fclose(f);
+    size_t header = s.find('\n');
+    return header == std::string::npos ? s : s.substr(header + 1);
+}
+
+// Time ranges that start and end inside blocks, a GPU filter and a
+// predicate: the rows printed are exactly the recorded ones that match.
+TEST(log_query_matches_scan) {
+    std::string path = scratchDir("log_query") + "/samples.log";
+    const int G = 4;
+    std::vector<FleetSnapshot> snaps = recordLog(path, 12, 6000, 300, G);
+    REQUIRE(!snaps.empty());
+    int64_t t0 = snapshotTimeMs(snaps.front()), t1 = snapshotTimeMs(snaps.back());
+
+    struct Case { int64_t from, to; int host, gpu; std::vector<LogPredicate> where; };
+    std::vector<Case> cases = {
+        {t0, t1, -1, -1, {}},
+        {t0 + 123456, t0 + 654321, 1, 3, {}},
+        {t0 + 900000, t1 - 100000, -1, -1, {{M_UTIL, true, 80}}},
+        {t0, t1, 2, 0, {{M_TEMP, false, 50}, {M_POWER, true, 100}}},
+        {t1 + 1, t1 + 1000, -1, -1, {}},
+    };
+    for (const Case& c : cases) {
+        LogQuery q;
+        q.path = path;
+        q.from = std::to_string(c.from); q.to = std::to_string(c.to);
+        q.host = c.host; q.gpu = c.gpu; q.where = c.where;
+        q.fields = {M_UTIL, M_TEMP, M_POWER};
+        long rows;
+        std::string got = queryOutput(q, rows), want = expectedRows(snaps, q, c.from, c.to, G);
+        CHECK_EQ(rows, (long)std::count(want.begin(), want.end(), '\n'));
+        CHECK(got == want);
+    }
+}
+
+// The index skips blocks whose min/max or GPU mask rule them out, and a
+// decode reads only the columns asked for.
+TEST(log_index_skips_blocks) {
+    std::string path = scratchDir("log_index") + "/samples.log";
+    REQUIRE(!recordLog(path, 8, 20000, 300, 8).empty());
+    LogReader log;
+    REQUIRE(log.open(path));
+    REQUIRE(log.blocks() > 10);
+    LogBlockEntry e;
+    uint64_t ruledOut = 0;
+    for (uint64_t b = 0; b < log.blocks(); ++b) {
+        REQUIRE(log.entry(b, e));
+        CHECK(e.firstTs <= e.lastTs);
+        CHECK_EQ(e.gpuMask, (uint64_t)0xff);
+        if (b) { LogBlockEntry p; log.entry(b - 1, p); CHECK(p.lastTs <= e.firstTs); }
+        ruledOut += !(e.max[M_TEMP] > 84);
+    }
+    CHECK(ruledOut > 0);
+    CHECK_EQ(log.firstReaching(INT64_MIN), (uint64_t)0);
+    CHECK_EQ(log.firstReaching(INT64_MAX), log.blocks());
+
+    REQUIRE(log.entry(log.blocks() / 2, e));
+    CHECK_EQ(log.firstReaching(e.lastTs), log.blocks() / 2);
+    bool all[M_COUNT] = {true, true, true, true, true, true}, one[M_COUNT] = {true};
+    LogReader::Rows rows;
+    uint64_t before = log.bytesRead();
+    REQUIRE(log.decode(e, all, rows));
+    uint64_t full = log.bytesRead() - before;
+    before = log.bytesRead();
+    REQUIRE(log.decode(e, one, rows));
+    CHECK_EQ(rows.q[M_UTIL].size(), (size_t)e.rows);
+    CHECK(rows.q[M_TEMP].empty());
+    CHECK(log.bytesRead() - before < full / 2);
+}
+
+// A second session appends; both sessions' rows come back in order.
+TEST(log_appends_across_sessions) {
+    std::string path = scratchDir("log_append") + "/samples.log";
+    SimFleet sim(4, 30);
+    std::vector<FleetSnapshot> snaps;
+    for (int session = 0; session < 2; ++session) {
+        LogRecorder rec;
+        REQUIRE(rec.open(path, 4));
+        for (int t = 0; t < 5000; ++t) { snaps.push_back(sim.next()); rec.add(snaps.back()); }
+    }
+    LogQuery q;
+    q.path = path; q.fields = {M_UTIL, M_MEM_USED};
+    long rows;
+    std::string got = queryOutput(q, rows);
+    CHECK_EQ(rows, 2L * 5000 * 4);
+    CHECK(got == expectedRows(snaps, q, INT64_MIN, INT64_MAX, 4));
+}
+
+// A month of 8 GPUs at 1 s (20.7 million rows): a half-hour window on one
+// GPU, the same with a predicate, and month-long scans the index prunes.
+BENCH(log_query) {
+    std::string path = scratchDir("log_bench") + "/month.log";
+    auto t0 = std::chrono::steady_clock::now();
+    const int TICKS = 30 * 86400;
+    {
+        SimFleet sim(8, 40, 1700000000000LL, 1000);
+        LogRecorder rec;
+        REQUIRE(rec.open(path, 8));
+        for (int t = 0; t < TICKS; ++t) rec.add(sim.next());
+    }
+    report("record a month", secondsSince(t0), "s");
+    FILE* f = fopen(path.c_str(), "rb");
+    REQUIRE(f);
+    report("log size", fileSize(f) / 1048576.0, "MiB");
+    fclose(f);
+
+    int64_t start = 1700000000000LL + 12 * 86400000LL + 2 * 3600000LL + 600000;   // day 13, 02:10
+    struct Case { const char* what; int64_t from, to; int gpu; std::vector<LogPredicate> where; std::vector<int> fields; };
+    std::vector<Case> cases = {
+        {"30 min, GPU 3", start, start + 1800000, 3, {}, {}},
+        {"30 min, GPU 3, util>90", start, start + 1800000, 3, {{M_UTIL, true, 90}}, {M_UTIL}},
+        {"month, temp>99", INT64_MIN, INT64_MAX, -1, {{M_TEMP, true, 99}}, {M_TEMP}},
+        {"month, GPU 3, util only", INT64_MIN, INT64_MAX, 3, {}, {M_UTIL}},
+    };
+    for (const Case& c : cases) {
+        LogQuery q;
+        q.path = path; q.gpu = c.gpu; q.where = c.where; q.fields = c.fields;
+        if (c.from != INT64_MIN) { q.from = std::to_string(c.from); q.to = std::to_string(c.to); }
+        FILE* out = fopen("/dev/null", "w");
+        long rows = 0;
+        t0 = std::chrono::steady_clock::now();
+        const int REPS = 5;
+        for (int r = 0; r < REPS; ++r) rows = runLogQuery(q, out, false);
+        fclose(out);
+        char what[96]; snprintf(what, sizeof(what), "query %s (%ld rows)", c.what, rows);
+        report(what, secondsSince(t0) * 1e3 / REPS, "ms");
+        CHECK(rows >= 0);
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".idx").c_str());
+}
@@ -0,0 +1,166 @@
+// Stream merge: skewed clocks and jittery delivery in, one stream in true
+// time order out; late samples counted, offsets tracked through a step; the
+// cost per sample at 500 streams.
+
+static const int64_t MERGE_T0 = 1700000000000LL;
+
+// A sample as a host sends it: its clock's time, when it reached us, and
+// (for the checks) when it really happened, carried in v[0].
+struct MergeEvent { int64_t arrival, ts; int source; GpuSample sample; };
+
+static int64_t mergeTruth(const GpuSample& s) { return MERGE_T0 + (int64_t)s.v[0]; }
+
+// `sources` hosts sampling `gpus` GPUs every `intervalMs` for `ticks`
+// ticks, each with a clock up to 5 s off and a delivery delay of 2 ms plus
+// an exponential tail of mean `jitterMs`. Sorted by arrival.
+static std::vector<MergeEvent> mergeEvents(int sources, int gpus, int ticks, int intervalMs, double jitterMs, uint32_t seed,
+                                           std::vector<int64_t>* skews = nullptr) {
+    std::mt19937 rng(seed);
+    std::exponential_distribution<double> jitter(1.0 / jitterMs);
+    std::vector<MergeEvent> ev;
+    std::vector<int64_t> skew(sources), phase(sources);
+    for (int s = 0; s < sources; ++s) { skew[s] = (int64_t)(rng() % 10001) - 5000; phase[s] = rng() % intervalMs; }
+    for (int t = 0; t < ticks; ++t)
+        for (int s = 0; s < sources; ++s) {
+            int64_t truth = MERGE_T0 + (int64_t)t * intervalMs + phase[s];
+            int64_t arrival = truth + 2 + (int64_t)jitter(rng);
+            for (int g = 0; g < gpus; ++g) {
+                MergeEvent e{arrival, truth + skew[s], s, GpuSample()};
+                e.sample.index = g;
+                e.sample.v[0] = (double)(truth - MERGE_T0);
+                ev.push_back(e);
+            }
+        }
+    std::stable_sort(ev.begin(), ev.end(), [](const MergeEvent& a, const MergeEvent& b) { return a.arrival < b.arrival; });
+    if (skews) *skews = skew;
+    return ev;
+}
+
+// Feeds events in arrival order, draining to `windowMs` behind the latest
+// arrival every `stepMs` as FleetConnector does, then everything. Returns
+// what came out; `late` counts pushes refused.
+static std::vector<StreamMerger::Item> mergeRun(StreamMerger& mg, const std::vector<MergeEvent>& ev, int windowMs, int stepMs,
+                                                int* late = nullptr) {
+    std::vector<StreamMerger::Item> out;
+    auto take = [&](const StreamMerger::Item& it) { out.push_back(it); };
+    int64_t nextDrain = ev.empty() ? 0 : ev[0].arrival;
+    for (const auto& e : ev) {
+        if (e.arrival >= nextDrain) { mg.drain(e.arrival - windowMs, take); nextDrain = e.arrival + stepMs; }
+        bool ok = mg.push(e.source, e.ts, e.arrival, e.sample);
+        if (late) *late += !ok;
+    }
+    mg.drain(INT64_MAX, take);
+    return out;
+}
+
+// 50 hosts with clocks seconds apart: the merged stream is complete, in
+// corrected time order, and in true time order to within the delivery
+// jitter; each offset estimate is the skew plus the 2 ms minimum delay.
+TEST(merge_orders_skewed_streams) {
+    std::vector<int64_t> skew;
+    std::vector<MergeEvent> ev = mergeEvents(50, 4, 300, 300, 3, 7, &skew);
+    StreamMerger mg;
+    mg.configure(50);
+    int late = 0;
+    std::vector<StreamMerger::Item> out = mergeRun(mg, ev, 100, 50, &late);
+    CHECK_EQ(late, 0);
+    CHECK_EQ(out.size(), ev.size());
+    int backwards = 0, misordered = 0;
+    int64_t worst = 0;
+    for (size_t i = 1; i < out.size(); ++i) {
+        backwards += out[i].ts < out[i - 1].ts;
+        int64_t behind = mergeTruth(out[i - 1].sample) - mergeTruth(out[i].sample);
+        worst = std::max(worst, behind);
+        misordered += behind > 0;
+    }
+    CHECK_EQ(backwards, 0);
+    CHECK(worst <= 5);
+    int offBy = 0;
+    for (int s = 0; s < 50; ++s) offBy += std::llabs(mg.offset(s) - (2 - skew[s])) > 1;
+    CHECK_EQ(offBy, 0);
+
+    // The same events by source clock in arrival order, as before the merge.
+    int64_t arrivalWorst = 0;
+    for (size_t i = 1; i < ev.size(); ++i) arrivalWorst = std::max(arrivalWorst, ev[i - 1].ts - ev[i].ts);
+    printf("merge: %zu samples, %d pairs out of true order, by at most %lld ms; by source clock in arrival order, %lld ms\n",
+           out.size(), misordered, (long long)worst, (long long)arrivalWorst);
+}
+
+// A sample delivered further behind than the reorder window is refused,
+// counted against its source and named in print(); the stream stays ordered.
+TEST(merge_counts_late_samples) {
+    StreamMerger mg;
+    mg.configure(3);
+    std::vector<StreamMerger::Item> out;
+    auto take = [&](const StreamMerger::Item& it) { out.push_back(it); };
+    GpuSample g;
+    for (int k = 0; k < 10; ++k)
+        for (int s = 0; s < 3; ++s)
+            if (s != 1 || k < 6) CHECK(mg.push(s, MERGE_T0 + k * 300, MERGE_T0 + k * 300 + 2, g));
+    mg.drain(MERGE_T0 + 9 * 300 + 2, take);
+    CHECK_EQ(out.size(), (size_t)26);
+    CHECK(!mg.push(1, MERGE_T0 + 1800, MERGE_T0 + 3000, g));       // 1.2 s in transit: its time has been released
+    CHECK(mg.push(2, MERGE_T0 + 3000, MERGE_T0 + 3002, g));
+    mg.drain(INT64_MAX, take);
+    CHECK_EQ(out.size(), (size_t)27);
+    int backwards = 0;
+    for (size_t i = 1; i < out.size(); ++i) backwards += out[i].ts < out[i - 1].ts;
+    CHECK_EQ(backwards, 0);
+    std::string stats = printed(mg, std::vector<std::string>{"a", "b", "c"});
+    CHECK(stats.find("28 samples, 1 late and dropped") != std::string::npos);
+    CHECK(stats.find("latest: b, 1 samples, up to 900 ms behind") != std::string::npos);
+}
+
+// A host's clock steps 2 s ahead: its corrected times hold still rather
+// than run backwards, and once the step's samples fill the offset window
+// the estimate has followed it.
+TEST(merge_follows_a_clock_step) {
+    StreamMerger mg;
+    mg.configure(1);
+    GpuSample g;
+    int64_t last = INT64_MIN;
+    int backwards = 0;
+    std::vector<int64_t> offsets;
+    for (int k = 0; k < 2 * StreamMerger::OFFSET_WINDOW; ++k) {
+        int64_t truth = MERGE_T0 + k * 300, ts = truth + (k < 100 ? 0 : 2000);
+        mg.push(0, ts, truth + 2 + k % 5, g);
+        mg.drain(INT64_MAX, [&](const StreamMerger::Item& it) { backwards += it.ts < last; last = it.ts; });
+        offsets.push_back(mg.offset(0));
+    }
+    CHECK_EQ(backwards, 0);
+    CHECK_EQ(offsets[99], (int64_t)2);
+    CHECK_EQ(offsets[100], (int64_t)-1998);         // a step ahead lowers the minimum at once
+    CHECK_EQ(offsets.back(), (int64_t)-1998);
+
+    StreamMerger back;                                // a step behind waits out the window
+    back.configure(1);
+    for (int k = 0; k < 2 * StreamMerger::OFFSET_WINDOW; ++k) {
+        int64_t truth = MERGE_T0 + k * 300, ts = truth - (k < 100 ? 0 : 2000);
+        back.push(0, ts, truth + 2, g);
+        offsets[k] = back.offset(0);
+    }
+    CHECK_EQ(offsets[100 + StreamMerger::OFFSET_WINDOW - 2], (int64_t)2);
+    CHECK_EQ(offsets[100 + StreamMerger::OFFSET_WINDOW], (int64_t)2002);
+}
+
+// Cost per sample of push and drain at 50 and 500 hosts of 8 GPUs, ticks
+// every 300 ms with 3 ms mean jitter, drained every 50 ms as the connector
+// does; and the order it buys over arrival order.
+BENCH(stream_merge) {
+    for (int sources : {50, 500}) {
+        std::vector<MergeEvent> ev = mergeEvents(sources, 8, 100000 / sources, 300, 3, 11);
+        StreamMerger mg;
+        mg.configure(sources);
+        auto t0 = std::chrono::steady_clock::now();
+        int late = 0;
+        std::vector<StreamMerger::Item> out = mergeRun(mg, ev, 100, 50, &late);
+        double ns = secondsSince(t0) * 1e9 / ev.size();
+        int64_t worst = 0;
+        for (size_t i = 1; i < out.size(); ++i) worst = std::max(worst, mergeTruth(out[i - 1].sample) - mergeTruth(out[i].sample));
+        char what[96];
+        snprintf(what, sizeof(what), "%d hosts: push and drain per sample (%zu samples, %d late)", sources, ev.size(), late);
+        report(what, ns, "ns");
+        snprintf(what, sizeof(what), "%d hosts: worst inversion of true order", sources);
+        report(what, (double)worst, "ms");
+    }
+}
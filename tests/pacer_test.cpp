@@ -0,0 +1,109 @@
+// Frame pacing: MainWindow's scheduleFrame/renderFrame loop on a simulated
+// clock, and on the real one with a snapshot source far above the cap.
+
+// Snapshots every `arriveUs`; the frame timer fires up to `lateUs` late, as
+// Win32 timers do. Returns frames drawn; fps and skipped as the pacer reports.
+static uint64_t simulatePacer(double cap, int arriveUs, int lateUs, double seconds, double& fps, uint64_t& skipped) {
+    using C = FramePacer::Clock;
+    C::time_point t0 = C::now();
+    FramePacer pacer;
+    pacer.setFps(cap);
+    std::mt19937 rng(1);
+    uint64_t seq = 0, frames = 0;
+    bool armed = false;
+    C::time_point timer{}, end = t0 + std::chrono::microseconds((int64_t)(seconds * 1e6));
+    C::time_point arrive = t0;
+    auto render = [&](C::time_point now) { pacer.frame(seq, now); ++frames; };
+    while (true) {
+        C::time_point now = armed && timer < arrive ? timer : arrive;
+        if (now >= end) break;
+        if (armed && timer <= arrive) { armed = false; render(now); continue; }
+        ++seq;
+        arrive += std::chrono::microseconds(arriveUs);
+        if (armed) continue;
+        int delay = pacer.delayMs(now);
+        if (delay == 0) { render(now); continue; }
+        armed = true;
+        timer = now + std::chrono::milliseconds(delay) + std::chrono::microseconds(lateUs ? rng() % lateUs : 0);
+    }
+    fps = 0; skipped = 0;
+    pacer.report(end, fps, skipped);
+    return frames;
+}
+
+TEST(pacer_caps_and_coalesces) {
+    double fps; uint64_t skipped;
+    // 1,000 snapshots a second (10 hosts at 100 ms) against a 30 fps cap,
+    // with timers up to 10 ms late: the cap holds, nothing is lost to lateness.
+    uint64_t frames = simulatePacer(30, 1000, 10000, 10, fps, skipped);
+    CHECK(fps <= 30.05 && fps >= 29.5);
+    CHECK(frames + skipped <= 10000 && frames + skipped > 9950);   // all but those after the last frame
+    // 60 fps with the default 15.6 ms timer resolution.
+    simulatePacer(60, 1000, 15600, 10, fps, skipped);
+    CHECK(fps <= 60.05 && fps >= 58);
+    // A source slower than the cap draws every snapshot at once.
+    frames = simulatePacer(60, 100000, 15600, 10, fps, skipped);
+    CHECK_EQ(frames, (uint64_t)100);
+    CHECK_EQ(skipped, (uint64_t)0);
+    CHECK_NEAR(fps, 10, 0.01);
+}
+
+TEST(pacer_reports_once_a_second) {
+    FramePacer pacer;
+    auto t0 = FramePacer::Clock::now();
+    double fps; uint64_t skipped;
+    pacer.frame(1, t0);
+    pacer.frame(5, t0 + std::chrono::milliseconds(100));
+    CHECK(!pacer.report(t0 + std::chrono::milliseconds(500), fps, skipped));
+    REQUIRE(pacer.report(t0 + std::chrono::milliseconds(1001), fps, skipped));
+    CHECK_EQ(skipped, (uint64_t)3);
+    CHECK(fps > 1.9 && fps < 2.1);
+    CHECK(!pacer.report(t0 + std::chrono::milliseconds(1500), fps, skipped));
+}
+
+// Real time: a thread publishing 1,000 snapshots a second and a "window"
+// that sleeps on the pacer's delay as the frame timer, 2 s per cap.
+BENCH(frame_pacer) {
+    for (double cap : {30.0, 60.0, 144.0}) {
+        std::mutex mutex;
+        std::condition_variable posted;
+        uint64_t latest = 0;
+        std::atomic<bool> stop{false};
+        std::thread source([&] {
+            auto next = std::chrono::steady_clock::now();
+            while (!stop) {
+                next += std::chrono::milliseconds(1);
+                std::this_thread::sleep_until(next);
+                { std::lock_guard<std::mutex> lk(mutex); ++latest; }
+                posted.notify_one();
+            }
+        });
+        FramePacer pacer;
+        pacer.setFps(cap);
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t seen = 0, frames = 0;
+        double worstLateMs = 0;
+        while (secondsSince(t0) < 2) {
+            { std::unique_lock<std::mutex> lk(mutex); posted.wait(lk, [&] { return latest != seen; }); }
+            auto now = FramePacer::Clock::now();
+            int delay = pacer.delayMs(now);
+            if (delay) {
+                auto due = now + std::chrono::milliseconds(delay);
+                std::this_thread::sleep_until(due);
+                worstLateMs = std::max(worstLateMs, std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - due).count());
+            }
+            { std::lock_guard<std::mutex> lk(mutex); seen = latest; }
+            pacer.frame(seen, FramePacer::Clock::now());
+            ++frames;
+        }
+        double fps = 0; uint64_t skipped = 0;
+        pacer.report(FramePacer::Clock::now(), fps, skipped);
+        stop = true;
+        source.join();
+        char what[96];
+        snprintf(what, sizeof(what), "cap %.0f fps: %llu snapshots skipped, timer up to %.1f ms late, achieved",
+                 cap, (unsigned long long)skipped, worstLateMs);
+        report(what, fps, "fps");
+        CHECK(fps <= cap + 0.5 + 0.01);   // the first frame draws at once: one over the cap in 2 s
+    }
+}
@@ -0,0 +1,106 @@
+// The device registry on the single-host path: nvidia-smi's CSV through
+// smiReaderThread and its identity query through identityThread, while a GPU
+// falls off the bus and comes back.
+
+// Allocations made by the calling thread, for the paths that promise none.
+// GCC takes the replacement pair's free() for a mismatch with operator new.
+static thread_local uint64_t t_allocations = 0;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void* operator new(size_t n) {
+    ++t_allocations;
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+#pragma GCC diagnostic pop
+
+static int hotplugSlot(int u) { return g_registry.find(0, "GPU-hp-" + std::to_string(u)); }
+
+// One phase of fake-smi.sh's hotplug host: its CSV, then its identity query.
+static void hotplugPhase(int phase) {
+    REQUIRE(startProcess(fakeSmi("hotplug " + std::to_string(phase)), g_smiProc, false));
+    smiReaderThread(1000);
+    closeProcess(g_smiProc);
+    identityThread(fakeSmi("ids hotplug " + std::to_string(phase)));   // one query: the table is stopped
+}
+
+// GPU 3 reports first, so it takes slot 0. GPU-hp-1 then disappears and
+// the GPUs after it move down an index, and it comes back. Each GPU keeps
+// its slot throughout: every snapshot, the identity table, the statistics
+// and the history show its own readings there, and only its identity's
+// index follows nvidia-smi. Resolving known devices, renumbered or not,
+// allocates nothing.
+TEST(registry_follows_uuids_across_hotplug) {
+    HubTap tap;
+    g_stats.configure({60}, 1000);
+    g_history.configure(INT64_MAX / 4);
+    g_hub.addSink([](const FleetSnapshot& snap) { g_stats.add(snap); g_history.add(snap); });
+    g_identities.stop();
+
+    const int INDEX[3][4] = {{0, 1, 2, 3}, {0, -1, 1, 2}, {0, 1, 2, 3}};   // by phase and U
+    for (int phase = 0; phase < 3; ++phase) {
+        hotplugPhase(phase);
+        if (phase == 0) {
+            CHECK_EQ(hotplugSlot(3), 0);
+            for (int u = 0; u < 3; ++u) CHECK_EQ(hotplugSlot(u), u + 1);
+        }
+        for (int u = 0; u < 4; ++u) {
+            GpuIdentityPtr id = g_identities.get(hotplugSlot(u));
+            REQUIRE(id);
+            CHECK_EQ(id->uuid, "GPU-hp-" + std::to_string(u));
+            if (INDEX[phase][u] >= 0) CHECK_EQ(id->index, INDEX[phase][u]);
+        }
+    }
+    CHECK_EQ(g_registry.size(), 4);
+    CHECK(printed(g_registry).find("4 registered, 0 without an index") != std::string::npos);
+
+    double util[4];                                              // by slot
+    for (int u = 0; u < 4; ++u) util[hotplugSlot(u)] = 10.0 * (u + 1);
+    int wrong = 0, snaps = 0, withoutHp1 = 0;
+    {
+        std::lock_guard<std::mutex> lk(tap.mutex);
+        for (const auto& s : tap.snaps) {
+            ++snaps;
+            withoutHp1 += s.gpus.size() == 3;
+            for (const auto& g : s.gpus) wrong += g.index < 0 || g.index > 3 || g.v[M_UTIL] != util[g.index];
+        }
+    }
+    CHECK_EQ(wrong, 0);
+    CHECK(snaps >= 12);
+    CHECK(withoutHp1 >= 4);
+
+    for (int slot = 0; slot < 4; ++slot) {
+        std::vector<WindowStats> w = g_stats.get(slot, M_UTIL);
+        REQUIRE(w.size() == 1);
+        CHECK_EQ(w[0].min, util[slot]); CHECK_EQ(w[0].max, util[slot]);
+        std::vector<HistoryPoint> pts;
+        g_history.read(slot, M_UTIL, 0, g_history.latest(), pts);
+        int off = 0;
+        for (const auto& p : pts) off += p.v != util[slot];
+        CHECK_EQ(off, 0);
+        CHECK(pts.size() >= (slot == hotplugSlot(1) ? 8u : 12u));
+    }
+
+    // The steady path, and a renumbering there and back: no allocation.
+    std::string uuids[4];
+    int slots[4];
+    for (int u = 0; u < 4; ++u) { uuids[u] = "GPU-hp-" + std::to_string(u); slots[u] = hotplugSlot(u); }
+    uint64_t before = t_allocations;
+    int moved = 0;
+    for (int round = 0; round < 1000; ++round)
+        for (int phase = 1; phase < 3; ++phase)
+            for (int u = 0; u < 4; ++u) {
+                if (INDEX[phase][u] < 0) continue;
+                const std::string& id = uuids[u];
+                moved += g_registry.resolve(0, INDEX[phase][u], id.data(), id.data() + id.size()) != slots[u];
+            }
+    CHECK_EQ(moved, 0);
+    CHECK_EQ(t_allocations - before, (uint64_t)0);
+    const char* fresh = "GPU-hp-4";
+    before = t_allocations;
+    CHECK_EQ(g_registry.resolve(0, 4, fresh, fresh + strlen(fresh)), 4);
+    CHECK(t_allocations > before);                               // a new device does, and is counted
+    printf("registry: %d snapshots, %d without GPU-hp-1\n", snaps, withoutHp1);
+}
@@ -0,0 +1,87 @@
+// Rolling window statistics against a brute-force rescan.
+
+// What the windows should hold after the sample at `now`: every sample newer
+// than now - span, as the float the ring stores.
+static WindowStats rescan(const std::vector<std::pair<int64_t, float>>& xs, int64_t now, int64_t spanMs) {
+    WindowStats r;
+    double sum = 0, sq = 0;
+    auto in = [&](const std::pair<int64_t, float>& x) { return x.first > now - spanMs && x.first <= now && !std::isnan(x.second); };
+    for (const auto& x : xs) {
+        if (!in(x)) continue;
+        if (!r.n || x.second < r.min) r.min = x.second;
+        if (!r.n || x.second > r.max) r.max = x.second;
+        sum += x.second; ++r.n;
+    }
+    if (!r.n) return r;
+    r.mean = sum / r.n;
+    for (const auto& x : xs) if (in(x)) sq += (x.second - r.mean) * (x.second - r.mean);   // two passes: exact reference
+    r.stddev = std::sqrt(sq / r.n);
+    return r;
+}
+
+// Irregular spacing (never faster than the interval), NaN gaps, plateaus
+// and steps, checked after every sample for every metric and window.
+TEST(rolling_matches_rescan) {
+    const std::vector<int> windows = {2, 10, 60};
+    RollingStats rs(windows, 300);
+    std::mt19937 rng(3);
+    std::vector<std::vector<std::pair<int64_t, float>>> hist(M_COUNT);
+    int64_t ts = 1000000;
+    double worst = 0;
+    int bad = 0;
+    for (int i = 0; i < 5000; ++i) {
+        ts += 300 + rng() % 400;
+        double v[M_COUNT];
+        for (int m = 0; m < M_COUNT; ++m) {
+            v[m] = (i / 200 % 2 ? 50.0 : 5.0) * (m + 1) + (rng() % 100) / 10.0;   // steps with noise
+            if (rng() % 25 == 0) v[m] = NAN;
+            hist[m].push_back({ts, (float)v[m]});
+        }
+        rs.add(ts, v);
+        for (int m = 0; m < M_COUNT; ++m)
+            for (size_t w = 0; w < windows.size(); ++w) {
+                WindowStats got = rs.get(m, w), want = rescan(hist[m], ts, windows[w] * 1000LL);
+                if (got.n != want.n) { ++bad; continue; }
+                if (!want.n) continue;
+                if (got.min != want.min || got.max != want.max) ++bad;
+                // Relative to the data's magnitude; variance rather than stddev, whose
+                // sqrt turns a rounding-level variance at n = 1 into 1e-8.
+                double scale = 1 + want.mean * want.mean;
+                worst = std::max({worst, std::fabs(got.mean - want.mean) / std::sqrt(scale),
+                                  std::fabs(got.stddev * got.stddev - want.stddev * want.stddev) / scale});
+            }
+    }
+    CHECK_EQ(bad, 0);
+    CHECK(worst < 1e-12);
+    printf("rolling: largest relative mean/variance difference %.3g\n", worst);
+}
+
+// Samples faster than the interval evict early instead of growing the ring:
+// a 10 s window at 300 ms holds at most 10000 / 300 * 5/4 + 8 samples.
+TEST(rolling_memory_is_bounded) {
+    RollingStats rs({10}, 300);
+    double v[M_COUNT] = {1, 2, 3, 4, 5, 6};
+    for (int i = 0; i < 100000; ++i) rs.add(1000000 + i, v);
+    CHECK(rs.get(M_UTIL, 0).n <= 10000 / 300 * 5 / 4 + 8);
+    CHECK(rs.get(M_UTIL, 0).n > 0);
+}
+
+// Cost per GPU sample, all metrics and windows, at 1,000 GPUs; the longer
+// windows cost the same, since nothing is rescanned.
+BENCH(rolling_stats) {
+    SimFleet sim(1000, 9);
+    std::vector<FleetSnapshot> ticks;
+    for (int t = 0; t < 600; ++t) ticks.push_back(sim.next());
+    for (const std::vector<int>& windows : {std::vector<int>{10, 60, 600}, std::vector<int>{100, 600, 6000}}) {
+        StatsTable table;
+        table.configure(windows, 300);
+        auto t0 = std::chrono::steady_clock::now();
+        for (int rep = 0; rep < 3; ++rep)
+            for (const auto& s : ticks) table.add(s);
+        double ns = secondsSince(t0) * 1e9 / (3.0 * ticks.size() * 1000);
+        char what[96];
+        snprintf(what, sizeof(what), "per GPU sample, %d metrics x windows %d/%d/%d s", M_COUNT, windows[0], windows[1], windows[2]);
+        report(what, ns, "ns");
+        CHECK(table.get(0, M_UTIL).size() == 3);
+    }
+}
@@ -0,0 +1,132 @@
+// Shared-memory publication: readers in other processes, through
+// nvsmi_shm.h, against a writer publishing as fast as it can.
+
+#include <sys/wait.h>
+
+// Every value of GPU i in tick k is derived from k and i, so a torn copy
+// shows as a record that disagrees with its snapshot's tick.
+static FleetSnapshot shmSnapshot(uint64_t k, int gpus) {
+    FleetSnapshot s;
+    s.seq = k; s.timestampMs = (int64_t)k * 10;
+    for (int i = 0; i < gpus; ++i) {
+        GpuSample g; g.index = i;
+        for (int m = 0; m < M_COUNT; ++m) g.v[m] = (double)(k * 64 + i * 8 + m);
+        s.gpus.push_back(g);
+    }
+    return s;
+}
+
+static bool shmConsistent(const nvsmi_shm_snapshot& s, int gpus) {
+    if ((int)s.gpu_count != gpus || s.timestamp_ms != (int64_t)s.tick * 10) return false;
+    for (int i = 0; i < gpus; ++i) {
+        const nvsmi_gpu_record& r = s.gpus[i];
+        double base = (double)(s.tick * 64 + i * 8);
+        if (r.index != i || r.util != base + M_UTIL || r.temperature != base + M_TEMP || r.fan != base + M_FAN
+            || r.clock_graphics != base + M_CLOCK || r.memory_used != base + M_MEM_USED || r.power_draw != base + M_POWER)
+            return false;
+    }
+    return true;
+}
+
+// Four reader processes copy snapshots for as long as the writer runs and
+// exit non-zero if any copy was torn or went back in time.
+TEST(shm_readers_see_whole_ticks) {
+    const char* name = "nvsmi-test-shm";
+    const int GPUS = 64, READERS = 4;
+    ShmPublisher pub;
+    REQUIRE(pub.open(name));
+    pub.publish(shmSnapshot(1, GPUS));
+
+    std::vector<pid_t> readers;
+    for (int r = 0; r < READERS; ++r) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            nvsmi_shm_reader rd;
+            if (nvsmi_shm_open(&rd, name) != 0) _exit(3);
+            static nvsmi_shm_snapshot s;
+            uint64_t last = 0, copies = 0;
+            auto t0 = std::chrono::steady_clock::now();
+            while (secondsSince(t0) < 1.0) {
+                if (nvsmi_shm_read(&rd, &s) != 0) continue;
+                if (!shmConsistent(s, GPUS) || s.tick < last) _exit(1);
+                last = s.tick; ++copies;
+            }
+            nvsmi_shm_close(&rd);
+            _exit(copies > 0 ? 0 : 4);
+        }
+        readers.push_back(pid);
+    }
+
+    uint64_t k = 2;
+    auto t0 = std::chrono::steady_clock::now();
+    while (secondsSince(t0) < 1.2) pub.publish(shmSnapshot(k++, GPUS));
+    for (pid_t pid : readers) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        CHECK(WIFEXITED(status));
+        CHECK_EQ(WEXITSTATUS(status), 0);
+    }
+    printf("shm: %llu ticks published under %d readers\n", (unsigned long long)k - 2, READERS);
+    pub.close();
+}
+
+// A second writer under the same name is refused and leaves the first alone;
+// the name goes when its writer closes.
+TEST(shm_one_writer_per_name) {
+    const char* name = "nvsmi-test-shm-owner";
+    ShmPublisher first, second;
+    REQUIRE(first.open(name));
+    first.publish(shmSnapshot(7, 2));
+    CHECK(!second.open(name));
+
+    nvsmi_shm_reader rd;
+    static nvsmi_shm_snapshot s;
+    REQUIRE(nvsmi_shm_open(&rd, name) == 0);
+    CHECK(nvsmi_shm_read(&rd, &s) == 0);
+    CHECK_EQ(s.tick, (uint64_t)7);
+    CHECK(shmConsistent(s, 2));
+    nvsmi_shm_close(&rd);
+
+    first.close();
+    CHECK(nvsmi_shm_open(&rd, name) != 0);
+    CHECK(second.open(name));
+    second.close();
+}
+
+// A fleet of nine 8-GPU hosts: the region takes the first 64 slots, warns
+// once, and publishes slots rather than nvidia-smi's per-host indices,
+// which would repeat.
+TEST(shm_fleet_publishes_slots_and_truncates) {
+    const char* name = "nvsmi-test-shm-fleet";
+    const int GPUS = 72;
+    g_gpusPerHost = 8;
+    std::vector<GpuIdentity> ids(GPUS);
+    for (int i = 0; i < GPUS; ++i) { ids[i].slot = i; ids[i].index = i % 8; ids[i].uuid = "GPU-" + std::to_string(i); }
+    g_identities.update(ids);
+
+    fflush(stderr);
+    FILE* err = tmpfile();
+    int saved = dup(2);
+    dup2(fileno(err), 2);
+    ShmPublisher pub;
+    REQUIRE(pub.open(name));
+    for (uint64_t k = 1; k <= 3; ++k) pub.publish(shmSnapshot(k, GPUS));
+    fflush(stderr);
+    dup2(saved, 2); close(saved);
+    std::string warned(4096, '\0');
+    rewind(err);
+    warned.resize(fread(&warned[0], 1, warned.size(), err));
+    fclose(err);
+
+    nvsmi_shm_reader rd;
+    static nvsmi_shm_snapshot s;
+    REQUIRE(nvsmi_shm_open(&rd, name) == 0);
+    REQUIRE(nvsmi_shm_read(&rd, &s) == 0);
+    CHECK_EQ(s.gpu_count, (uint32_t)NVSMI_SHM_MAX_GPUS);
+    CHECK(shmConsistent(s, NVSMI_SHM_MAX_GPUS));      // r.index == slot
+    CHECK_EQ(std::string(s.gpus[9].uuid), std::string("GPU-9"));
+    nvsmi_shm_close(&rd);
+    pub.close();
+
+    CHECK_EQ(warned, std::string("--shm: 72 GPUs, only the first 64 are published\n"));
+}
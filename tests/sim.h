@@ -0,0 +1,51 @@
+// Snapshot generator for tests and benchmarks: the simulator's bounded random
+// walk (see simulateThread), seeded, without the thread or the hub.
+#pragma once
+
+class SimFleet {
+public:
+    SimFleet(int gpus, uint32_t seed = 42, int64_t startMs = 1700000000000LL, int intervalMs = 300)
+        : m_rng(seed), m_ts(startMs), m_intervalMs(intervalMs), m_cur(gpus) {
+        for (int i = 0; i < gpus; ++i) {
+            m_cur[i].index = i;
+            for (int m = 0; m < M_COUNT; ++m) m_cur[i].v[m] = LO[m] + (HI[m] - LO[m]) * (0.5 + 0.5 * m_uni(m_rng));
+        }
+    }
+
+    // Registers the GPUs' identities with g_identities, as the simulator does.
+    void identify() const {
+        std::vector<GpuIdentity> ids(m_cur.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            char buf[64];
+            ids[i].index = ids[i].slot = (int)i; ids[i].count = (int)ids.size();
+            snprintf(buf, sizeof(buf), "GPU-5140a7ed-0000-0000-0000-%012zu", i); ids[i].uuid = buf;
+            ids[i].name = "Simulated GPU"; ids[i].memTotal = 81920; ids[i].powerLimit = 400;
+        }
+        g_identities.update(ids);
+    }
+
+    FleetSnapshot next() {
+        for (auto& g : m_cur)
+            for (int m = 0; m < M_COUNT; ++m) {
+                double v = g.v[m] + STEP[m] * m_uni(m_rng);
+                g.v[m] = std::round(std::min(HI[m], std::max(LO[m], v)) * (m == M_POWER ? 100 : 1)) / (m == M_POWER ? 100 : 1);
+            }
+        FleetSnapshot s;
+        s.seq = ++m_seq; s.timestampMs = (m_ts += m_intervalMs);
+        s.gpus = m_cur;
+        return s;
+    }
+
+    int64_t timestampMs() const { return m_ts; }
+
+private:
+    static constexpr double LO[M_COUNT] = {0, 30, 30, 210, 0, 50};
+    static constexpr double HI[M_COUNT] = {100, 85, 100, 1980, 81920, 400};
+    static constexpr double STEP[M_COUNT] = {8, 1, 2, 60, 1024, 15};
+    std::mt19937 m_rng;
+    std::uniform_real_distribution<double> m_uni{-1.0, 1.0};
+    uint64_t m_seq = 0;
+    int64_t m_ts;
+    int m_intervalMs;
+    std::vector<GpuSample> m_cur;
+};
@@ -0,0 +1,107 @@
+// Quantile sketches against the sorted samples they summarize.
+
+// The sample a quantile query should land near: the same rank quantile() uses.
+static double exactQuantile(std::vector<double> xs, double q) {
+    std::sort(xs.begin(), xs.end());
+    return xs[(size_t)(q * (double)(xs.size() - 1))];
+}
+
+static const double SKETCH_QS[] = {0, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 1};
+
+// Relative error of every quantile stays within ALPHA, across shapes that
+// span a few bins (constant, clamped utilization) to many (heavy tail), with
+// zeros mixed in; below MIN_VALUE the error is absolute.
+TEST(sketch_within_alpha) {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> uni(0, 100);
+    std::lognormal_distribution<double> tail(3, 2);
+    std::vector<std::function<double()>> shapes = {
+        [&] { return uni(rng); },
+        [&] { return tail(rng); },
+        [&] { return 42.0; },
+        [&] { double x = uni(rng); return x < 30 ? 0.0 : x > 90 ? 100.0 : x; },
+        [&] { return uni(rng) < 50 ? 1e-4 * uni(rng) : 1e4 + uni(rng); },
+    };
+    double worst = 0;
+    for (size_t s = 0; s < shapes.size(); ++s) {
+        QuantileSketch q;
+        std::vector<double> xs;
+        for (int i = 0; i < 100000; ++i) { double x = shapes[s](); xs.push_back(x); q.add(x); }
+        q.add(NAN);
+        CHECK_EQ(q.count(), (uint64_t)xs.size());
+        for (double p : SKETCH_QS) {
+            double want = exactQuantile(xs, p), got = q.quantile(p);
+            if (want < QuantileSketch::MIN_VALUE) { CHECK(std::fabs(got - want) < QuantileSketch::MIN_VALUE); continue; }
+            double err = std::fabs(got - want) / want;
+            if (!(err <= QuantileSketch::ALPHA + 1e-12))
+                fprintf(stderr, "shape %zu p%g: %.6g vs %.6g\n", s, p * 100, got, want);
+            worst = std::max(worst, err);
+        }
+    }
+    CHECK(worst <= QuantileSketch::ALPHA + 1e-12);
+    printf("sketch: largest relative error %.4f (bound %.2f)\n", worst, QuantileSketch::ALPHA);
+}
+
+// Merging per-GPU sketches gives exactly the sketch of all their samples.
+TEST(sketch_merge_is_exact) {
+    SimFleet sim(16, 8);
+    QuantileSketch whole, merged, parts[16];
+    for (int t = 0; t < 2000; ++t)
+        for (const auto& g : sim.next().gpus) { whole.add(g.v[M_UTIL]); parts[g.index].add(g.v[M_UTIL]); }
+    for (int i = 15; i >= 0; --i) merged.merge(parts[i]);
+    CHECK_EQ(merged.count(), whole.count());
+    for (double p : SKETCH_QS) CHECK_EQ(merged.quantile(p), whole.quantile(p));
+    QuantileSketch empty;
+    CHECK(std::isnan(empty.quantile(0.5)));
+    merged.merge(empty);
+    CHECK_EQ(merged.quantile(0.5), whole.quantile(0.5));
+}
+
+// A span query covers the slots reaching back that far: a day of hourly
+// samples answers the 24 h span, a week falls through to the daily tier,
+// and older samples age out.
+TEST(sketch_history_spans) {
+    SketchHistory h;
+    const int64_t HOUR = 3600000LL, t0 = 1700000000000LL / (86400000LL) * 86400000LL;
+    double v[M_COUNT] = {};
+    for (int64_t hr = 0; hr < 24 * 10; ++hr) {
+        v[M_UTIL] = hr < 24 * 9 ? 10 : 90;     // the last day runs hot
+        h.add(t0 + hr * HOUR, v);
+    }
+    int64_t now = h.latest();
+    QuantileSketch day, week;
+    h.collect(M_UTIL, 86400000LL - HOUR, now, day);
+    h.collect(M_UTIL, 7 * 86400000LL, now, week);
+    CHECK_EQ(day.count(), (uint64_t)24);
+    CHECK_NEAR(day.quantile(0.5), 90, 90 * QuantileSketch::ALPHA);
+    CHECK(week.count() >= 7 * 24 && week.count() <= 8 * 24);
+    CHECK_NEAR(week.quantile(0.5), 10, 10 * QuantileSketch::ALPHA);
+    CHECK_NEAR(week.quantile(0.95), 90, 90 * QuantileSketch::ALPHA);
+}
+
+// Insert cost and size: an hour of one metric at 300 ms, per sketch, and a
+// fleet-wide query merging 1,000 GPUs' sketches.
+BENCH(sketch) {
+    SimFleet sim(1000, 12);
+    std::vector<FleetSnapshot> ticks;
+    for (int t = 0; t < 200; ++t) ticks.push_back(sim.next());
+    std::vector<QuantileSketch> qs(1000 * M_COUNT);
+    auto t0 = std::chrono::steady_clock::now();
+    const int REPS = 60;   // 12,000 samples a sketch: an hour at 300 ms
+    for (int r = 0; r < REPS; ++r)
+        for (const auto& s : ticks)
+            for (const auto& g : s.gpus)
+                for (int m = 0; m < M_COUNT; ++m) qs[g.index * M_COUNT + m].add(g.v[m]);
+    report("insert", secondsSince(t0) * 1e9 / ((double)REPS * ticks.size() * 1000 * M_COUNT), "ns");
+    size_t bytes[M_COUNT] = {};
+    for (size_t i = 0; i < qs.size(); ++i) bytes[i % M_COUNT] += qs[i].bytes();
+    for (int m = 0; m < M_COUNT; ++m) {
+        char what[64]; snprintf(what, sizeof(what), "bytes per sketch, %s, 1 h", METRIC_FIELDS[m]);
+        report(what, bytes[m] / 1000.0, "B");
+    }
+    t0 = std::chrono::steady_clock::now();
+    QuantileSketch fleet;
+    for (int i = 0; i < 1000; ++i) fleet.merge(qs[i * M_COUNT + M_UTIL]);
+    report("merge 1000 GPUs' sketches", secondsSince(t0) * 1e6, "us");
+    CHECK_EQ(fleet.count(), (uint64_t)REPS * ticks.size() * 1000);
+}
@@ -0,0 +1,34 @@
+// The program is one translation unit with internal linkage throughout, so
+// the tests are compiled into it rather than linked against it: this file
+// includes main.cpp without its entry point, then every *_test.cpp.
+
+#define NVSMI_NO_MAIN
+#include "../main.cpp"
+
+#include "check.h"
+#include "sim.h"
+
+#include "shm_test.cpp"
+#include "identity_test.cpp"
+#include "collector_test.cpp"
+#include "rolling_test.cpp"
+#include "sketch_test.cpp"
+#include "heatmap_test.cpp"
+#include "fleet_test.cpp"
+#include "log_test.cpp"
+#include "gorilla_test.cpp"
+#include "analytics_test.cpp"
+#include "pacer_test.cpp"
+#include "xml_test.cpp"
+#include "host_test.cpp"
+#include "export_test.cpp"
+#include "web_test.cpp"
+#include "tiles_test.cpp"
+#include "connector_test.cpp"
+#include "registry_test.cpp"
+#include "history_test.cpp"
+#include "merge_test.cpp"
+#include "tick_test.cpp"
+#include "chart_test.cpp"
+
+int main(int argc, char** argv) { return runTests(argc, argv); }
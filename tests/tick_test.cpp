@@ -0,0 +1,166 @@
+// Tick assembly from per-GPU lines, and the hub handing ticks to the UI
+// and the sinks: take() never waits for a sink, every tick reaches the
+// sample log, and a frame shows a spike between frames until it expires.
+
+static GpuSample tickSample(int index, double util) {
+    GpuSample g; g.index = index;
+    for (int m = 0; m < M_COUNT; ++m) g.v[m] = util + m;
+    return g;
+}
+
+static std::vector<int> tickIndices(const FleetSnapshot& s) {
+    std::vector<int> out;
+    for (const auto& g : s.gpus) out.push_back(g.index);
+    return out;
+}
+
+TEST(tick_closes_on_repeated_index) {
+    TickAssembler ta(300);
+    CHECK(!ta.add(1000, tickSample(2, 5), 0));
+    CHECK(!ta.add(1010, tickSample(0, 5), 0));
+    CHECK(!ta.add(1020, tickSample(1, 5), 0));
+    SnapshotPtr s = ta.add(1030, tickSample(2, 6), 0);    // GPU 2 again: the next loop
+    REQUIRE(s);
+    CHECK_EQ(s->seq, (uint64_t)1);
+    CHECK_EQ(s->timestampMs, (int64_t)1000);
+    CHECK(tickIndices(*s) == std::vector<int>({0, 1, 2}));
+    CHECK_EQ(s->gpus[2].v[M_UTIL], 5.0);
+    s = ta.add(1300, tickSample(0, 7), 0);
+    REQUIRE(s);
+    CHECK_EQ(s->timestampMs, (int64_t)1030);
+}
+
+TEST(tick_closes_on_late_timestamp) {
+    TickAssembler ta(300);                                 // late: more than 150 ms past the tick start
+    CHECK(!ta.add(1000, tickSample(0, 1), 0));
+    CHECK(!ta.add(1150, tickSample(1, 1), 0));
+    SnapshotPtr s = ta.add(1151, tickSample(2, 1), 0);
+    REQUIRE(s);
+    CHECK(tickIndices(*s) == std::vector<int>({0, 1}));
+    s = ta.add(1160, tickSample(2, 2), 0);                 // GPU 2 opened the tick it now repeats
+    REQUIRE(s);
+    CHECK_EQ(s->timestampMs, (int64_t)1151);
+    CHECK_EQ(s->gpus.size(), (size_t)3);                    // 0 and 1 carried over
+    CHECK(s->gpus[0].stale && s->gpus[1].stale && !s->gpus[2].stale);
+    CHECK(!ta.add(-1, tickSample(1, 2), 0));               // no timestamp: never late
+}
+
+TEST(tick_closes_on_expected_count) {
+    TickAssembler ta(300);
+    CHECK(!ta.add(1000, tickSample(1, 1), 3));
+    CHECK(!ta.add(1000, tickSample(0, 1), 3));
+    SnapshotPtr s = ta.add(1000, tickSample(2, 1), 3);     // without waiting for the next loop
+    REQUIRE(s);
+    CHECK(tickIndices(*s) == std::vector<int>({0, 1, 2}));
+    CHECK(!ta.add(1300, tickSample(0, 2), 3));
+}
+
+// A GPU that stops reporting is carried, stale with its last values, for
+// MAX_STALE_TICKS ticks and then dropped; when it reports again it is back.
+TEST(tick_carries_missing_gpus_then_drops_them) {
+    TickAssembler ta(300);
+    ta.add(0, tickSample(0, 1), 3); ta.add(0, tickSample(1, 42), 3);
+    REQUIRE(ta.add(0, tickSample(2, 1), 3));
+    for (int t = 1; t <= TickAssembler::MAX_STALE_TICKS + 1; ++t) {
+        ta.add(t * 300, tickSample(0, t), 2);
+        SnapshotPtr s = ta.add(t * 300, tickSample(2, t), 2);
+        REQUIRE(s);
+        if (t <= TickAssembler::MAX_STALE_TICKS) {
+            REQUIRE(tickIndices(*s) == std::vector<int>({0, 1, 2}));
+            CHECK(s->gpus[1].stale && !s->gpus[0].stale);
+            CHECK_EQ(s->gpus[1].v[M_UTIL], 42.0);
+        } else {
+            CHECK(tickIndices(*s) == std::vector<int>({0, 2}));
+        }
+    }
+    ta.add(9000, tickSample(0, 1), 3); ta.add(9000, tickSample(1, 9), 3);
+    SnapshotPtr s = ta.add(9000, tickSample(2, 1), 3);
+    REQUIRE(s);
+    CHECK(tickIndices(*s) == std::vector<int>({0, 1, 2}));
+    CHECK(!s->gpus[1].stale);
+}
+
+// A slow sink holds up the reader, not the UI: take() returns the tick the
+// sink is still busy with.
+TEST(hub_take_does_not_wait_for_sinks) {
+    SnapshotHub hub;
+    std::atomic<bool> inSink{false};
+    hub.addSink([&](const FleetSnapshot&) { inSink = true; std::this_thread::sleep_for(std::chrono::milliseconds(300)); });
+    auto snap = std::make_shared<FleetSnapshot>();
+    snap->seq = 7;
+    std::thread reader([&] { hub.publish(snap); });
+    REQUIRE(waitFor([&] { return inSink.load(); }, 2));
+    auto t0 = std::chrono::steady_clock::now();
+    SnapshotPtr got = hub.take();
+    double waited = secondsSince(t0);
+    reader.join();
+    CHECK(got && got->seq == 7);
+    CHECK(waited < 0.1);
+}
+
+// 8 simulated GPUs at 50 ms through g_hub into a LogRecorder, with the UI's
+// extremes reduction on and a take() every 100 ms: the log has a row for
+// every GPU of every tick published.
+TEST(hub_records_every_tick) {
+    std::string path = scratchDir("hub_record") + "/samples.log";
+    LogRecorder rec;
+    REQUIRE(rec.open(path, 8));
+    std::atomic<uint64_t> ticks{0};
+    g_hub.keepExtremes();
+    g_hub.addSink([&](const FleetSnapshot& s) { rec.add(s); ticks += !s.gpus.empty(); });
+    std::thread source(simulateThread, 8, 50, 0, 0, 0);
+    for (int frame = 0; frame < 15; ++frame) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        g_hub.take();
+    }
+    g_running = false;
+    source.join();
+    g_running = true;
+    rec.close();
+
+    CHECK(ticks >= 20);
+    CHECK_EQ(ticks.load(), g_sourceStats.ticks.load());
+    LogQuery q;
+    q.path = path; q.fields = {M_UTIL};
+    long rows;
+    queryOutput(q, rows);
+    CHECK_EQ(rows, (long)(ticks * 8));
+    printf("hub: %llu ticks, %ld rows\n", (unsigned long long)ticks.load(), rows);
+}
+
+// With keepExtremes(), a spike between two takes is what the next take
+// shows, then the reading it fell back to; a spike more than a second old
+// is dropped from the reduction.
+TEST(hub_take_shows_spikes_between_frames) {
+    SnapshotHub hub;
+    hub.keepExtremes();
+    uint64_t seq = 0;
+    auto publish = [&](double util) {
+        auto s = std::make_shared<FleetSnapshot>();
+        s->seq = ++seq;
+        s->gpus = {tickSample(0, 50), tickSample(1, util)};
+        hub.publish(s);
+    };
+    publish(50);
+    SnapshotPtr shown = hub.take();
+    REQUIRE(shown);
+    CHECK_EQ(shown->gpus[1].v[M_UTIL], 50.0);
+
+    publish(50); publish(95); publish(50); publish(51);
+    shown = hub.take();
+    REQUIRE(shown);
+    CHECK_EQ(shown->seq, (uint64_t)5);
+    CHECK_EQ(shown->gpus[1].v[M_UTIL], 95.0);
+    CHECK_EQ(shown->gpus[0].v[M_UTIL], 50.0);
+
+    publish(95); publish(52);
+    shown = hub.take();
+    CHECK_EQ(shown->gpus[1].v[M_UTIL], 52.0);             // furthest from the 95 shown
+
+    publish(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    publish(53);
+    shown = hub.take();
+    CHECK_EQ(shown->seq, (uint64_t)9);
+    CHECK_EQ(shown->gpus[1].v[M_UTIL], 53.0);             // the dip expired
+}
@@ -0,0 +1,111 @@
+// Panel tiles on the render pool: the pixels a pool of threads draws are the
+// pixels one thread draws, tick after tick, and the cost as panels grow.
+
+static const TileRaster::Palette TILE_PALETTE = {0x101010, 0x202020, 0xE0E0E0, 0x808080, 0xFFFFFF, 0x404040, 0x0078D4};
+
+// A fleet tick with GPUs going N/A, stale and missing now and then.
+static FleetSnapshot tileTick(SimFleet& sim, std::mt19937& rng) {
+    FleetSnapshot s = sim.next();
+    std::vector<GpuSample> kept;
+    for (auto& g : s.gpus) {
+        if (rng() % 60 == 0) continue;
+        if (rng() % 40 == 0) g.v[rng() % M_COUNT] = NAN;
+        g.stale = rng() % 50 == 0;
+        kept.push_back(g);
+    }
+    s.gpus = kept;
+    return s;
+}
+
+static bool samePixels(const TileRaster& a, const TileRaster& b) {
+    return a.width() == b.width() && a.height() == b.height()
+        && std::equal(a.pixels(), a.pixels() + (size_t)a.width() * a.height(), b.pixels());
+}
+
+// Incremental renders on 1 and 4 threads agree after every tick, including
+// ticks that follow a palette change (every tile queued, some changed again),
+// and both equal a raster drawn once from the last tick.
+TEST(tiles_parallel_matches_serial) {
+    const int PANELS = 300;
+    SimFleet sim(PANELS, 17);
+    sim.identify();
+    RenderPool serial(0), parallel(3);
+    TileRaster one, many;
+    for (TileRaster* t : {&one, &many}) { t->setPalette(TILE_PALETTE); t->layout(PANELS, 1400, 2); }
+    std::mt19937 rng(8);
+    FleetSnapshot s;
+    int mismatched = 0;
+    for (int tick = 0; tick < 60; ++tick) {
+        if (tick % 20 == 10) {
+            TileRaster::Palette p = TILE_PALETTE;
+            p.tile += tick;
+            one.setPalette(p); many.setPalette(p);
+        }
+        s = tileTick(sim, rng);
+        CHECK_EQ(one.update(s), many.update(s));
+        one.render(serial);
+        many.render(parallel);
+        mismatched += !samePixels(one, many);
+    }
+    CHECK_EQ(mismatched, 0);
+    CHECK_EQ(one.drawn(), many.drawn());
+
+    TileRaster fresh;
+    TileRaster::Palette p = TILE_PALETTE;
+    p.tile += 50;
+    fresh.setPalette(p);
+    fresh.layout(PANELS, 1400, 2);
+    fresh.update(s);
+    fresh.render(serial);
+    CHECK(samePixels(fresh, many));
+}
+
+// A tile queued by a palette change and changed again before the render is
+// drawn once.
+TEST(tiles_queue_each_tile_once) {
+    SimFleet sim(64, 3);
+    sim.identify();
+    RenderPool pool(0);
+    TileRaster t;
+    t.setPalette(TILE_PALETTE);
+    t.layout(64, 1400, 1);
+    CHECK_EQ(t.update(sim.next()), 64);
+    t.render(pool);
+    CHECK_EQ(t.drawn(), (uint64_t)64);
+    t.setPalette(TILE_PALETTE);
+    CHECK_EQ(t.update(sim.next()), 64);
+    t.render(pool);
+    CHECK_EQ(t.drawn(), (uint64_t)128);
+}
+
+// Render time per tick at 256 and 1,024 panels on 1, 2 and 4 threads: a
+// full repaint, and a tick of the simulated fleet in which most tiles change.
+BENCH(tile_render) {
+    for (int panels : {256, 1024}) {
+        SimFleet sim(panels, 23);
+        sim.identify();
+        std::vector<FleetSnapshot> ticks;
+        for (int t = 0; t < 40; ++t) ticks.push_back(sim.next());
+        for (int threads : {1, 2, 4}) {
+            RenderPool pool(threads - 1);
+            TileRaster tiles;
+            tiles.setPalette(TILE_PALETTE);
+            tiles.layout(panels, 2560, 1);
+            tiles.update(ticks[0]);
+            tiles.render(pool);
+            auto t0 = std::chrono::steady_clock::now();
+            for (int r = 0; r < 10; ++r) { tiles.setPalette(TILE_PALETTE); tiles.render(pool); }
+            double full = secondsSince(t0) / 10;
+            uint64_t drawn = tiles.drawn();
+            t0 = std::chrono::steady_clock::now();
+            for (size_t k = 1; k < ticks.size(); ++k) { tiles.update(ticks[k]); tiles.render(pool); }
+            double tick = secondsSince(t0) / (ticks.size() - 1);
+            char what[96];
+            snprintf(what, sizeof(what), "%d panels, %d threads: full repaint", panels, threads);
+            report(what, full * 1e3, "ms");
+            snprintf(what, sizeof(what), "%d panels, %d threads: tick (%.0f tiles)", panels, threads,
+                     (double)(tiles.drawn() - drawn) / (ticks.size() - 1));
+            report(what, tick * 1e3, "ms");
+        }
+    }
+}
@@ -0,0 +1,323 @@
+// Web dashboard over loopback: browsers played by SSE clients that rebuild
+// the panels from `full` and `delta` events, and a load generator for the
+// per-client cost.
+
+#include <poll.h>
+
+// Just enough JSON for the dashboard's events.
+struct Json {
+    enum Type { NUL, NUM, STR, ARR, OBJ } type = NUL;
+    double num = 0;
+    std::string str;
+    std::vector<Json> arr;
+    std::vector<std::pair<std::string, Json>> obj;
+
+    const Json* get(const std::string& key) const {
+        for (const auto& kv : obj) if (kv.first == key) return &kv.second;
+        return nullptr;
+    }
+
+    static bool parse(const char*& p, Json& out) {
+        while (*p == ' ') ++p;
+        if (*p == '{' || *p == '[') {
+            bool isObj = *p++ == '{';
+            out.type = isObj ? OBJ : ARR;
+            if (*p == (isObj ? '}' : ']')) { ++p; return true; }
+            for (;;) {
+                std::string key;
+                if (isObj) {
+                    Json k;
+                    if (!parse(p, k) || k.type != STR || *p++ != ':') return false;
+                    key = k.str;
+                }
+                Json v;
+                if (!parse(p, v)) return false;
+                if (isObj) out.obj.emplace_back(key, std::move(v)); else out.arr.push_back(std::move(v));
+                if (*p == ',') { ++p; continue; }
+                return *p++ == (isObj ? '}' : ']');
+            }
+        }
+        if (*p == '"') {
+            out.type = STR;
+            for (++p; *p != '"'; ++p) {
+                if (!*p) return false;
+                if (*p == '\\') {
+                    ++p;
+                    if (*p == 'u') { out.str += (char)strtol(std::string(p + 1, 4).c_str(), nullptr, 16); p += 4; }
+                    else out.str += *p;
+                } else out.str += *p;
+            }
+            ++p;
+            return true;
+        }
+        if (!strncmp(p, "null", 4)) { p += 4; return true; }
+        char* end;
+        out.num = strtod(p, &end);
+        out.type = NUM;
+        bool ok = end != p;
+        p = end;
+        return ok;
+    }
+};
+
+// One browser tab: reads the event stream and keeps the panels it would draw.
+// Counts fields a delta sent without their value having changed.
+struct SseClient {
+    struct Panel { int64_t q[M_COUNT]; bool stale = false; std::string name; };
+    std::map<int, Panel> panels;
+    uint64_t seq = 0;
+    int fulls = 0, deltas = 0, redundant = 0, malformed = 0;
+    std::string buf;
+    bool headers = false;
+
+    // Feeds received bytes; returns events applied.
+    int feed(const char* data, size_t n) {
+        buf.append(data, n);
+        int events = 0;
+        if (!headers) {
+            size_t e = buf.find("\r\n\r\n");
+            if (e == std::string::npos) return 0;
+            if (buf.compare(0, 15, "HTTP/1.1 200 OK") != 0) ++malformed;
+            buf.erase(0, e + 4);
+            headers = true;
+        }
+        for (size_t e; (e = buf.find("\n\n")) != std::string::npos; buf.erase(0, e + 2)) {
+            std::string ev = buf.substr(0, e);
+            if (ev.compare(0, 6, "retry:") == 0) continue;
+            size_t nl = ev.find('\n');
+            if (nl == std::string::npos || ev.compare(nl + 1, 6, "data: ") != 0) { ++malformed; continue; }
+            Json j;
+            const char* p = ev.c_str() + nl + 7;
+            if (!Json::parse(p, j) || *p || j.type != Json::OBJ) { ++malformed; continue; }
+            if (ev.compare(0, nl, "event: full") == 0) applyFull(j);
+            else if (ev.compare(0, nl, "event: delta") == 0) applyDelta(j);
+            else ++malformed;
+            ++events;
+        }
+        return events;
+    }
+
+    static int64_t value(const Json& v) { return v.type == Json::NUM ? quantize(v.num) : Q_NAN; }
+
+    void applyIdentity(Panel& p, const Json* id) {
+        const Json* name = id ? id->get("name") : nullptr;
+        if (name) p.name = name->str;
+    }
+
+    void applyFull(const Json& j) {
+        ++fulls;
+        panels.clear();
+        const Json* gpus = j.get("gpus");
+        if (!j.get("host") || !gpus) { ++malformed; return; }
+        for (const Json& g : gpus->arr) {
+            const Json *i = g.get("i"), *st = g.get("st"), *v = g.get("v");
+            if (!i || !st || !v || v->arr.size() != M_COUNT) { ++malformed; continue; }
+            Panel& p = panels[(int)i->num];
+            p.stale = st->num != 0;
+            for (int m = 0; m < M_COUNT; ++m) p.q[m] = value(v->arr[m]);
+            applyIdentity(p, g.get("id"));
+        }
+    }
+
+    void applyDelta(const Json& j) {
+        ++deltas;
+        const Json *s = j.get("seq"), *g = j.get("g");
+        if (!s || !g) { ++malformed; return; }
+        seq = (uint64_t)s->num;
+        for (const Json& e : g->arr) {
+            if (e.arr.size() != 3) { ++malformed; continue; }
+            int i = (int)e.arr[0].num;
+            bool known = panels.count(i) && !panels[i].name.empty();
+            Panel& p = panels[i];
+            p.stale = e.arr[1].num != 0;
+            for (const auto& kv : e.arr[2].obj) {
+                int m = atoi(kv.first.c_str());
+                int64_t q = value(kv.second);
+                if (known && p.q[m] == q) ++redundant;
+                p.q[m] = q;
+            }
+        }
+        if (const Json* ids = j.get("id"))      // after the values, so a GPU that came back is not `known`
+            for (const auto& kv : ids->obj) applyIdentity(panels[atoi(kv.first.c_str())], &kv.second);
+        if (const Json* gone = j.get("gone"))
+            for (const Json& i : gone->arr) panels.erase((int)i.num);
+    }
+
+    // The panels are the snapshot's GPUs, values, staleness and names.
+    bool shows(const FleetSnapshot& s) const {
+        if (panels.size() != s.gpus.size()) return false;
+        for (const auto& g : s.gpus) {
+            auto it = panels.find(g.index);
+            if (it == panels.end() || it->second.stale != g.stale || it->second.name != "Simulated GPU") return false;
+            for (int m = 0; m < M_COUNT; ++m) if (it->second.q[m] != quantize(g.v[m])) return false;
+        }
+        return true;
+    }
+};
+
+static socket_t openEventStream(const std::string& spec) {
+    socket_t s = connectTo(spec);
+    if (s == BAD_SOCKET) return s;
+    const char req[] = "GET /events HTTP/1.1\r\nHost: localhost\r\nAccept: text/event-stream\r\n\r\n";
+    if (send(s, req, sizeof(req) - 1, SEND_FLAGS) != (int)sizeof(req) - 1) { closeSocket(s); return BAD_SOCKET; }
+    return s;
+}
+
+static unsigned long long webStreamsServed(WebDashboard& web) {
+    unsigned long long served = 0;
+    sscanf(printed(web).c_str(), "web: %llu streams served", &served);
+    return served;
+}
+
+// A tab on its own thread, as the browser would be.
+struct SseTab {
+    SseClient client;
+    std::mutex mutex;
+    std::thread thread;
+    std::atomic<bool> stop{false};
+
+    void start(const std::string& spec) {
+        thread = std::thread([this, spec] {
+            socket_t s = openEventStream(spec);
+            if (s == BAD_SOCKET) return;
+            setRecvTimeout(s, 50);
+            char buf[65536];
+            while (!stop) {
+                int n = (int)recv(s, buf, sizeof(buf), 0);
+                if (n > 0) { std::lock_guard<std::mutex> lk(mutex); client.feed(buf, n); }
+                else if (n == 0 || !wouldBlock()) break;
+            }
+            closeSocket(s);
+        });
+    }
+
+    uint64_t seq() { std::lock_guard<std::mutex> lk(mutex); return client.seq; }
+    void join() { stop = true; if (thread.joinable()) thread.join(); }
+};
+
+// Tabs opened before the first tick and midway end up drawing the last
+// snapshot, through GPUs going N/A, stale, missing and back, and no delta
+// carries a field that did not change.
+TEST(web_tabs_rebuild_the_fleet) {
+    std::string spec = testPort(30);
+    WebDashboard web;
+    REQUIRE(web.start(spec, "node \"7\""));
+    SimFleet sim(30, 12);
+    sim.identify();
+    std::vector<std::unique_ptr<SseTab>> tabs;
+    auto open = [&](int n) {
+        unsigned long long want = webStreamsServed(web) + n;
+        for (int i = 0; i < n; ++i) { tabs.emplace_back(new SseTab); tabs.back()->start(spec); }
+        return waitFor([&] { return webStreamsServed(web) == want; }, 5);
+    };
+    REQUIRE(open(3));
+    std::mt19937 rng(5);
+    FleetSnapshot s;
+    for (int t = 0; t < 200; ++t) {
+        if (t == 100) REQUIRE(open(2));
+        s = sim.next();
+        std::vector<GpuSample> kept;
+        for (auto& g : s.gpus) {
+            if (rng() % 40 == 0) continue;
+            if (rng() % 30 == 0) g.v[rng() % M_COUNT] = NAN;
+            g.stale = rng() % 25 == 0;
+            kept.push_back(g);
+        }
+        s.gpus = kept;
+        web.publish(s);
+    }
+    for (auto& tab : tabs) CHECK(waitFor([&] { return tab->seq() == s.seq; }, 5));
+    for (auto& tab : tabs) tab->join();
+    for (size_t i = 0; i < tabs.size(); ++i) {
+        const SseClient& c = tabs[i]->client;
+        CHECK_EQ(c.fulls, 1);
+        CHECK_EQ(c.deltas, i < 3 ? 200 : 100);
+        CHECK_EQ(c.malformed, 0);
+        CHECK_EQ(c.redundant, 0);
+        CHECK(c.shows(s));
+    }
+    std::string stats = printed(web);
+    CHECK(stats.find("5 streams served, 0 dropped") != std::string::npos);
+    printf("%s", stats.c_str());
+    web.stop();
+}
+
+static std::string httpGet(const std::string& spec, const std::string& path) {
+    socket_t s = connectTo(spec);
+    if (s == BAD_SOCKET) return "";
+    std::string req = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n", resp;
+    send(s, req.data(), (int)req.size(), SEND_FLAGS);
+    setRecvTimeout(s, 2000);
+    char buf[65536];
+    for (int n; (n = (int)recv(s, buf, sizeof(buf), 0)) > 0; ) resp.append(buf, n);
+    closeSocket(s);
+    return resp;
+}
+
+TEST(web_serves_the_page) {
+    std::string spec = testPort(31);
+    WebDashboard web;
+    REQUIRE(web.start(spec, "h"));
+    std::string page = httpGet(spec, "/");
+    CHECK(page.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    CHECK(page.find("Content-Length: " + std::to_string(strlen(WEB_PAGE)) + "\r\n") != std::string::npos);
+    CHECK(page.size() > strlen(WEB_PAGE) && page.compare(page.size() - strlen(WEB_PAGE), std::string::npos, WEB_PAGE) == 0);
+    CHECK(httpGet(spec, "/nope").compare(0, 22, "HTTP/1.1 404 Not Found") == 0);
+    web.stop();
+}
+
+// Publish cost per tick of 1,000 GPUs as tabs are added: the event is
+// encoded once, so each tab adds a send. One load-generator thread reads
+// every stream with poll() and checks it decodes to the fleet.
+BENCH(web_fanout) {
+    SimFleet sim(1000, 6);
+    sim.identify();
+    for (int tabs : {0, 1, 10, 50}) {
+        std::string spec = testPort(40 + tabs);
+        WebDashboard web;
+        REQUIRE(web.start(spec, "bench"));
+        web.publish(sim.next());
+        std::vector<pollfd> fds;
+        std::vector<SseClient> clients(tabs);
+        for (int i = 0; i < tabs; ++i) {
+            socket_t s = openEventStream(spec);
+            REQUIRE(s != BAD_SOCKET);
+            fds.push_back({s, POLLIN, 0});
+        }
+        REQUIRE(waitFor([&] { return webStreamsServed(web) == (unsigned long long)tabs; }, 10));
+        std::atomic<bool> stop{false};
+        std::thread load([&] {
+            char buf[1 << 16];
+            while (!stop) {
+                if (fds.empty() || poll(fds.data(), fds.size(), 20) <= 0) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); continue; }
+                for (size_t i = 0; i < fds.size(); ++i)
+                    if (fds[i].revents & POLLIN) {
+                        int n = (int)recv(fds[i].fd, buf, sizeof(buf), 0);
+                        if (n > 0) clients[i].feed(buf, n);
+                    }
+            }
+        });
+        const int TICKS = 100;
+        std::vector<FleetSnapshot> ticks;
+        for (int t = 0; t < TICKS; ++t) ticks.push_back(sim.next());
+        double cpu = 0;
+        for (const auto& s : ticks) {
+            double c0 = threadCpuSeconds();
+            web.publish(s);
+            cpu += threadCpuSeconds() - c0;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));   // a tick's worth of time for the readers
+        }
+        waitFor([&] { for (auto& c : clients) if (c.seq != ticks.back().seq) return false; return true; }, 30);
+        stop = true;
+        load.join();
+        int behind = 0;
+        for (auto& c : clients) behind += !c.shows(ticks.back()) || c.malformed;
+        for (auto& f : fds) closeSocket(f.fd);
+        CHECK_EQ(behind, 0);
+        printf("%s", printed(web).c_str());
+        char what[64];
+        snprintf(what, sizeof(what), "publish cpu per tick, %d tabs", tabs);
+        report(what, cpu / TICKS * 1e6, "us");
+        web.stop();
+    }
+}
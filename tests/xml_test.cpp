@@ -0,0 +1,166 @@
+// `nvidia-smi -q -x` scanning: the fixture (an H100 with MIG and a V100 on
+// an older driver's element names) through DetailHandler, whole and in
+// pieces, the simulator's MIG topology and its rollup, and the scan rate on
+// a full-size document.
+
+static std::vector<GpuDetail> scanDetails(const std::string& xml, size_t chunk) {
+    std::vector<GpuDetail> ds;
+    DetailHandler handler{ds};
+    XmlScanner scanner(DETAIL_PATHS, (int)(sizeof(DETAIL_PATHS) / sizeof(DETAIL_PATHS[0])));
+    std::string buf;
+    for (size_t at = 0; at < xml.size(); at += chunk) {
+        buf.append(xml, at, chunk);
+        buf.erase(0, scanner.feed(buf.data(), buf.data() + buf.size(), handler) - buf.data());
+    }
+    for (auto& d : ds) attachMigProcesses(d);
+    return ds;
+}
+
+TEST(xml_detail_fixture) {
+    std::vector<GpuDetail> ds = scanDetails(readFixture("nvidia-smi-q-x.xml"), SIZE_MAX / 2);
+    REQUIRE(ds.size() == 2);
+
+    const GpuDetail& h = ds[0];
+    CHECK_EQ(h.uuid, std::string("GPU-9c1f4a52-3e0b-7d21-88aa-0f6e2c4b1d07"));
+    CHECK_EQ(h.pcieGen, 5.0); CHECK_EQ(h.pcieGenMax, 5.0); CHECK_EQ(h.pcieWidth, 16.0); CHECK_EQ(h.pcieWidthMax, 16.0);
+    CHECK_EQ(h.clockEvents, 1u << 2);                                    // sw_power_cap only
+    CHECK_EQ(h.eccVolatile[0], 3.0); CHECK_EQ(h.eccVolatile[1], 0.0);    // SRAM + DRAM
+    CHECK_EQ(h.eccAggregate[0], 19.0); CHECK_EQ(h.eccAggregate[1], 1.0);
+    CHECK(std::isnan(h.retiredPages[0]) && std::isnan(h.retiredPages[1]));
+    CHECK_EQ(h.remappedRows[0], 1.0); CHECK_EQ(h.remappedRows[1], 0.0);
+    CHECK(!h.retirePending);
+    CHECK(h.migEnabled);
+    REQUIRE(h.mig.size() == 2);
+    CHECK_EQ(h.mig[0].gi, 1); CHECK_EQ(h.mig[0].ci, 0); CHECK_EQ(h.mig[0].sms, 60.0);
+    CHECK_EQ(h.mig[0].memTotal, 40192.0); CHECK_EQ(h.mig[0].memUsed, 12000.0); CHECK_EQ(h.mig[0].processes, 1);
+    CHECK_EQ(h.mig[1].index, 1); CHECK_EQ(h.mig[1].memUsed, 37.0); CHECK_EQ(h.mig[1].processes, 0);
+    REQUIRE(h.processes.size() == 1);                                    // not the one in the comment
+    CHECK_EQ(h.processes[0].pid, 4242u);
+    CHECK_EQ(h.processes[0].name, std::string("python3 train.py --tag \"a&b\""));
+    CHECK_EQ(h.processes[0].memUsed, 11000.0);
+
+    const GpuDetail& v = ds[1];
+    CHECK_EQ(v.uuid, std::string("GPU-1b2c3d4e-5f60-7182-93a4-b5c6d7e8f901"));
+    CHECK_EQ(v.pcieGen, 1.0); CHECK_EQ(v.pcieGenMax, 3.0); CHECK_EQ(v.pcieWidth, 8.0);
+    CHECK_EQ(v.clockEvents, (1u << 0) | (1u << 3));                      // gpu_idle, hw_slowdown
+    CHECK_EQ(v.eccVolatile[0], 5.0); CHECK_EQ(v.eccAggregate[0], 12.0); CHECK_EQ(v.eccAggregate[1], 1.0);
+    CHECK_EQ(v.retiredPages[0], 2.0); CHECK_EQ(v.retiredPages[1], 1.0);
+    CHECK(v.retirePending);
+    CHECK(std::isnan(v.remappedRows[0]));
+    CHECK(!v.migEnabled && v.mig.empty());
+    REQUIRE(v.processes.size() == 2);
+    CHECK_EQ(v.processes[0].type, std::string("C+G"));
+    CHECK_EQ(v.processes[0].gi, -1);
+    CHECK(std::isnan(v.processes[1].memUsed));
+    CHECK(describeDetail(v).find("clocks held by hw_slowdown") != std::string::npos);
+}
+
+// Fed in pieces down to a byte at a time, as a pipe delivers it, the scan
+// gives the same details as the whole document at once.
+TEST(xml_chunked_equals_whole) {
+    std::string xml = readFixture("nvidia-smi-q-x.xml");
+    std::vector<GpuDetail> whole = scanDetails(xml, SIZE_MAX / 2);
+    REQUIRE(whole.size() == 2);
+    for (size_t chunk : {1, 2, 3, 7, 64, 1000, 16384}) {
+        std::vector<GpuDetail> ds = scanDetails(xml, chunk);
+        REQUIRE(ds.size() == whole.size());
+        for (size_t i = 0; i < ds.size(); ++i) {
+            CHECK_EQ(describeDetail(ds[i]), describeDetail(whole[i]));
+            CHECK_EQ(ds[i].mig.size(), whole[i].mig.size());
+        }
+    }
+}
+
+// 8 simulated GPUs split into 7 and into 3 instances: the slices tile
+// gi 1 to 7 and add up to the whole GPU, each instance counts the processes
+// resident in it, the collapsed line sums them, and the GPUs stay 8 panels
+// however many instances they hold.
+TEST(mig_topology_rolls_up) {
+    for (int instances : {7, 3}) {
+        std::mt19937 rng(5);
+        std::vector<GpuDetail> ds;
+        for (int round = 0; round < 20; ++round) simulateMig(ds, 8, instances, rng);
+        REQUIRE(ds.size() == 8);
+        int busyInstances = 0;
+        for (const GpuDetail& d : ds) {
+            REQUIRE((int)d.mig.size() == instances);
+            int gi = 1, procs = 0, busy = 0;
+            double sms = 0, memTotal = 0, memUsed = 0;
+            for (size_t k = 0; k < d.mig.size(); ++k) {
+                const MigDevice& m = d.mig[k];
+                int slices = 7 / instances + ((int)k < 7 % instances);
+                CHECK_EQ(m.index, (int)k); CHECK_EQ(m.gi, gi); CHECK_EQ(m.ci, 0);
+                CHECK_EQ(m.sms, 14.0 * slices);
+                gi += slices; sms += m.sms; memTotal += m.memTotal; memUsed += m.memUsed;
+                int resident = 0;
+                for (const auto& p : d.processes) resident += p.gi == m.gi && p.ci == m.ci;
+                CHECK_EQ(m.processes, resident);
+                procs += m.processes; busy += m.processes > 0;
+            }
+            CHECK_EQ(gi, 8);
+            CHECK_EQ(sms, 98.0); CHECK_EQ(memTotal, 7 * 9728.0);
+            CHECK_EQ(procs, (int)d.processes.size());
+            char want[160];
+            snprintf(want, sizeof(want), "MIG %d instances, %d busy, %.1f/66.5 GiB", instances, busy, memUsed / 1024);
+            CHECK_EQ(describeMig(d), std::string(want));
+            busyInstances += busy;
+        }
+        CHECK(busyInstances > 0);
+
+        DetailTable table;
+        table.update(ds, 0, 0);
+        int panels = 0;
+        for (int i = 0; i < 64; ++i) panels += table.get(i) != nullptr;
+        CHECK_EQ(panels, 8);
+        std::string out = printed(table);
+        size_t gpus = 0, rows = 0;
+        for (size_t at = 0; (at = out.find("\n  gpu ", at)) != std::string::npos; ++at) ++gpus;
+        for (size_t at = 0; (at = out.find("\n    mig ", at)) != std::string::npos; ++at) ++rows;
+        CHECK_EQ(gpus, (size_t)8);
+        CHECK_EQ(rows, (size_t)(8 * instances));
+    }
+
+    GpuDetail d;
+    d.migEnabled = true;
+    d.mig.resize(2);
+    d.mig[0].gi = 1; d.mig[0].ci = 0; d.mig[0].memTotal = 1024; d.mig[0].memUsed = 256;
+    d.mig[1].gi = 2; d.mig[1].ci = 0; d.mig[1].memTotal = 1024; d.mig[1].memUsed = 768;
+    GpuProcessInfo p; p.gi = 2; p.ci = 0;
+    d.processes = {p, p};
+    attachMigProcesses(d);
+    MigRollup r = rollupMig(d);
+    CHECK_EQ(r.instances, 2); CHECK_EQ(r.busy, 1); CHECK_EQ(r.fullest, 1);
+    CHECK_EQ(describeMig(d), std::string("MIG 2 instances, 1 busy, 1.0/2.0 GiB"));
+    CHECK_EQ(describeMigDevice(d.mig[1]), std::string("gi 2 ci 0, N/A SMs, 768/1024 MiB, 2 processes"));
+}
+
+// An 8-GPU document at real size: the fixture's H100 with the supported
+// clocks table nvidia-smi prints for each GPU, which makes up most of it.
+BENCH(xml_scan) {
+    std::string xml = readFixture("nvidia-smi-q-x.xml");
+    size_t b = xml.find("\t<gpu "), e = xml.find("</gpu>", b) + 7;
+    REQUIRE(b != std::string::npos);
+    std::string gpu = xml.substr(b, e - b), clocks = "\t\t<supported_clocks>\n";
+    for (int mem : {2619, 1593}) {
+        clocks += "\t\t\t<supported_mem_clock>\n\t\t\t\t<value>" + std::to_string(mem) + " MHz</value>\n";
+        for (int g = 1980; g >= 345; g -= 15) clocks += "\t\t\t\t<supported_graphics_clock>" + std::to_string(g) + " MHz</supported_graphics_clock>\n";
+        clocks += "\t\t\t</supported_mem_clock>\n";
+    }
+    clocks += "\t\t</supported_clocks>\n";
+    gpu.insert(gpu.find("\t\t<processes>"), clocks);
+    std::string doc = xml.substr(0, b);
+    for (int i = 0; i < 8; ++i) doc += gpu;
+    doc += "</nvidia_smi_log>\n";
+
+    for (size_t chunk : {doc.size(), (size_t)16384}) {
+        const int REPS = 200;
+        size_t gpus = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < REPS; ++r) gpus += scanDetails(doc, chunk).size();
+        double secs = secondsSince(t0) / REPS;
+        char what[96];
+        snprintf(what, sizeof(what), "scan %.0f KB (8 GPUs), %s", doc.size() / 1024.0, chunk == doc.size() ? "whole" : "16 KB reads");
+        report(what, doc.size() / 1048576.0 / secs, "MB/s");
+        CHECK_EQ(gpus, (size_t)8 * REPS);
+    }
+}